@@ -6,7 +6,9 @@
 #include "AzAudio.h"
 
 #include "error.h"
+#include "file_stream.h"
 #include "helpers.h"
+#include "simd.h"
 #include "backend/interface.h"
 
 #include <stdlib.h>
@@ -54,10 +56,34 @@ int azaInit() {
 			azaLogLevel = AZA_LOG_LEVEL_TRACE;
 		}
 	}
+	char backendStr[64];
+	size_t backendLen = 0;
+	errno_t hasBackend = getenv_s(&backendLen, backendStr, 64, "AZAUDIO_BACKEND");
+	if (0 == hasBackend && backendLen > 0 && backendLen <= sizeof(backendStr)) {
+		azaStrToLower(backendStr, sizeof(backendStr), backendStr);
+		for (int backend = AZA_BACKEND_NULL; backend < AZA_BACKEND_ONE_AFTER_LAST; backend++) {
+			char nameStr[64];
+			azaStrToLower(nameStr, sizeof(nameStr), azaBackendString(backend));
+			if (strncmp(backendStr, nameStr, sizeof(backendStr)) == 0) {
+				azaBackendPreferred = backend;
+				break;
+			}
+		}
+	}
 	AZA_LOG_INFO("AzAudio Version: " AZA_VERSION_FORMAT_STR "\n", AZA_VERSION_ARGS);
 
+	azaSIMDInit();
+
+	int err = azaScratchInitThreadLocal();
+	if (err) return err;
+
 	azaKernelMakeLanczos(&azaKernelDefaultLanczos, 128.0f, 50.0f);
+	azaKernelMakeLanczos(&azaKernelDefaultLanczosShort, 128.0f, 8.0f);
 	azaInitOscillators();
+	azaFileStreamInitThread();
+	azaSpeakerGeometryCacheInit();
+	azaSamplerSincCacheInit();
+	azaConvolutionWorkerInit();
 
 	memset(&azaWorldDefault, 0, sizeof(azaWorldDefault));
 	azaWorldDefault.orientation.right   = (azaVec3) { 1.0f, 0.0f, 0.0f };
@@ -69,6 +95,11 @@ int azaInit() {
 
 void azaDeinit() {
 	azaBackendDeinit();
+	azaFileStreamDeinitThread();
+	azaSpeakerGeometryCacheDeinit();
+	azaSamplerSincCacheDeinit();
+	azaConvolutionWorkerDeinit();
+	azaScratchDeinitThreadLocal();
 }
 
 void azaLogDefault(AzaLogLevel level, const char* format, ...) {
@@ -111,6 +142,9 @@ static const char *azaErrorStr[] = {
 	"AZA_ERROR_DSP_INTERFACE_EXPECTED_DUAL",
 	"AZA_ERROR_DSP_INTERFACE_NOT_GENERIC",
 	"AZA_ERROR_MIXER_ROUTING_CYCLE",
+	"AZA_ERROR_MIXER_COMMAND_QUEUE_FULL",
+	"AZA_ERROR_FILE_IO",
+	"AZA_ERROR_UNSUPPORTED_FORMAT",
 };
 
 const char* azaErrorString(int error, char *buffer, size_t bufferSize) {
@@ -0,0 +1,80 @@
+/*
+	File: atomic.h
+	Author: Philip Haynes
+	The handful of atomic operations we need to share work between threads. MSVC's C compiler doesn't do C11 atomics, so these wrap the Interlocked functions there and the __atomic builtins everywhere else. Everything is sequentially consistent.
+*/
+
+#ifndef AZAUDIO_ATOMIC_H
+#define AZAUDIO_ATOMIC_H
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+
+static inline uint32_t azaAtomicLoad32(volatile uint32_t *value) {
+	return (uint32_t)_InterlockedOr((volatile long*)value, 0);
+}
+
+static inline void azaAtomicStore32(volatile uint32_t *value, uint32_t desired) {
+	_InterlockedExchange((volatile long*)value, (long)desired);
+}
+
+// Returns the value from before the add
+static inline uint32_t azaAtomicFetchAdd32(volatile uint32_t *value, uint32_t add) {
+	return (uint32_t)_InterlockedExchangeAdd((volatile long*)value, (long)add);
+}
+
+// Returns whether the exchange happened. If it didn't, expected gets the current value.
+static inline int azaAtomicCompareExchange32(volatile uint32_t *value, uint32_t *expected, uint32_t desired) {
+	uint32_t previous = (uint32_t)_InterlockedCompareExchange((volatile long*)value, (long)desired, (long)*expected);
+	if (previous == *expected) return 1;
+	*expected = previous;
+	return 0;
+}
+
+#else
+
+static inline uint32_t azaAtomicLoad32(volatile uint32_t *value) {
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static inline void azaAtomicStore32(volatile uint32_t *value, uint32_t desired) {
+	__atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+}
+
+// Returns the value from before the add
+static inline uint32_t azaAtomicFetchAdd32(volatile uint32_t *value, uint32_t add) {
+	return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+}
+
+// Returns whether the exchange happened. If it didn't, expected gets the current value.
+static inline int azaAtomicCompareExchange32(volatile uint32_t *value, uint32_t *expected, uint32_t desired) {
+	return __atomic_compare_exchange_n(value, expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+// Tells the CPU we're in a spin-wait loop so it can go easy on the other hyperthread and the memory bus
+static inline void azaSpinPause() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+	__asm__ volatile ("yield");
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_ATOMIC_H
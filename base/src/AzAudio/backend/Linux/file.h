@@ -0,0 +1,76 @@
+/*
+	File: file.h
+	Author: Philip Haynes
+	The same read-only file mapping as Win32/file.h, implemented with mmap.
+*/
+
+#ifndef AZA_FILE_LINUX_H
+#define AZA_FILE_LINUX_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct azaFileMapping {
+	const uint8_t *data;
+	uint64_t size;
+} azaFileMapping;
+
+// Maps the whole file into memory for reading. Pages are only read from disk when they're first touched, so touching them is where the I/O actually happens.
+// returns 0 on success, errno on failure
+static inline int azaFileMap(azaFileMapping *mapping, const char *path) {
+	mapping->data = NULL;
+	mapping->size = 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return errno;
+	struct stat info;
+	if (fstat(fd, &info) == -1) {
+		int err = errno;
+		close(fd);
+		return err;
+	}
+	if (info.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	int err = errno;
+	// The mapping keeps its own reference to the file
+	close(fd);
+	if (data == MAP_FAILED) return err;
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+	mapping->data = data;
+	mapping->size = (uint64_t)info.st_size;
+	return 0;
+}
+
+static inline void azaFileUnmap(azaFileMapping *mapping) {
+	if (mapping->data) {
+		munmap((void*)mapping->data, (size_t)mapping->size);
+	}
+	mapping->data = NULL;
+	mapping->size = 0;
+}
+
+// Lets the OS drop pages we're done with for now, so reading through a big file doesn't keep all of it resident. Only whole pages inside the range are affected.
+static inline void azaFileMappingRelease(azaFileMapping *mapping, uint64_t offset, uint64_t size) {
+	uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t start = (offset + pageSize - 1) / pageSize * pageSize;
+	uint64_t end = (offset + size) / pageSize * pageSize;
+	if (end <= start) return;
+	madvise((void*)(mapping->data + start), (size_t)(end - start), MADV_DONTNEED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZA_FILE_LINUX_H
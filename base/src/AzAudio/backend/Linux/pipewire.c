@@ -392,6 +392,7 @@ static void azaStreamProcess(void *userdata) {
 		.samples = pcm,
 		.frames = numFrames,
 		.stride = data->channels,
+		.channelStride = 1,
 		.channels = data->channels,
 		.samplerate = data->samplerate,
 	}, stream->userdata);
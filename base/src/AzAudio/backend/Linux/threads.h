@@ -0,0 +1,156 @@
+/*
+	File: threads.h
+	Author: Philip Haynes
+	The same thread primitives as Win32/threads.h, implemented on top of pthreads.
+*/
+
+#ifndef AZA_THREADS_LINUX_H
+#define AZA_THREADS_LINUX_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Use this to define thread procs so they have the right signature on every platform. They should return 0.
+#define AZA_THREAD_PROC_DEF(procName, userdataName) void* procName(void *userdataName)
+
+typedef struct azaThread {
+	pthread_t thread;
+	int joinable;
+} azaThread;
+
+// returns 0 on success, errno on failure
+static inline int azaThreadLaunch(azaThread *thread, void* (*proc)(void*), void *userdata) {
+	int err = pthread_create(&thread->thread, NULL, proc, userdata);
+	thread->joinable = err == 0;
+	return err;
+}
+
+static inline int azaThreadJoinable(azaThread *thread) {
+	return thread->joinable;
+}
+
+static inline void azaThreadJoin(azaThread *thread) {
+	assert(!pthread_equal(thread->thread, pthread_self()));
+	assert(thread->joinable);
+	pthread_join(thread->thread, NULL);
+	thread->joinable = 0;
+}
+
+static inline void azaThreadDetach(azaThread *thread) {
+	assert(azaThreadJoinable(thread));
+	pthread_detach(thread->thread);
+	thread->joinable = 0;
+}
+
+static inline void azaThreadSleep(uint32_t milliseconds) {
+	struct timespec duration = {
+		.tv_sec = milliseconds / 1000,
+		.tv_nsec = (milliseconds % 1000) * 1000000,
+	};
+	while (nanosleep(&duration, &duration) == -1 && errno == EINTR) {}
+}
+
+static inline void azaThreadYield() {
+	sched_yield();
+}
+
+// Asks for realtime scheduling for the calling thread. This usually needs privileges (or rtkit limits) that we may not have, in which case it returns errno and nothing changes.
+static inline int azaThreadSetRealtime() {
+	struct sched_param param = {0};
+	int priorityMin = sched_get_priority_min(SCHED_FIFO);
+	int priorityMax = sched_get_priority_max(SCHED_FIFO);
+	// Leave some room above us for whatever the system thinks is more important than audio
+	param.sched_priority = priorityMax - 10 > priorityMin ? priorityMax - 10 : priorityMin;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+// Monotonic time, only useful for measuring durations
+static inline uint64_t azaGetTimestampNanoseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+typedef struct azaMutex {
+	pthread_mutex_t mutex;
+} azaMutex;
+
+static inline void azaMutexInit(azaMutex *mutex) {
+	pthread_mutex_init(&mutex->mutex, NULL);
+}
+
+static inline void azaMutexDeinit(azaMutex *mutex) {
+	pthread_mutex_destroy(&mutex->mutex);
+}
+
+static inline void azaMutexLock(azaMutex *mutex) {
+	pthread_mutex_lock(&mutex->mutex);
+}
+
+static inline void azaMutexUnlock(azaMutex *mutex) {
+	pthread_mutex_unlock(&mutex->mutex);
+}
+
+typedef struct azaSemaphore {
+	sem_t semaphore;
+} azaSemaphore;
+
+static inline void azaSemaphoreInit(azaSemaphore *semaphore, uint32_t count) {
+	sem_init(&semaphore->semaphore, 0, count);
+}
+
+static inline void azaSemaphoreDeinit(azaSemaphore *semaphore) {
+	sem_destroy(&semaphore->semaphore);
+}
+
+static inline void azaSemaphorePost(azaSemaphore *semaphore, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		sem_post(&semaphore->semaphore);
+	}
+}
+
+static inline void azaSemaphoreWait(azaSemaphore *semaphore) {
+	while (sem_wait(&semaphore->semaphore) == -1 && errno == EINTR) {}
+}
+
+// Use this to define destructors for azaThreadLocal so they have the right signature on every platform.
+#define AZA_THREAD_LOCAL_DESTRUCTOR_DEF(procName, valueName) void procName(void *valueName)
+
+// A pointer with a separate value for every thread, where each thread's value is passed to the destructor when that thread exits (if it's not NULL). Unlike thread_local, this lets us clean up after threads we didn't create.
+typedef struct azaThreadLocal {
+	pthread_key_t key;
+} azaThreadLocal;
+
+// returns 0 on success, errno on failure
+static inline int azaThreadLocalInit(azaThreadLocal *threadLocal, void (*destructor)(void*)) {
+	return pthread_key_create(&threadLocal->key, destructor);
+}
+
+// NOTE: Doesn't call the destructor for any thread's value
+static inline void azaThreadLocalDeinit(azaThreadLocal *threadLocal) {
+	pthread_key_delete(threadLocal->key);
+}
+
+static inline void* azaThreadLocalGet(azaThreadLocal *threadLocal) {
+	return pthread_getspecific(threadLocal->key);
+}
+
+static inline void azaThreadLocalSet(azaThreadLocal *threadLocal, void *value) {
+	pthread_setspecific(threadLocal->key, value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZA_THREADS_LINUX_H
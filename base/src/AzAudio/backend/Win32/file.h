@@ -0,0 +1,81 @@
+/*
+	File: file.h
+	Author: Philip Haynes
+	Read-only file mapping on top of CreateFileMapping.
+*/
+
+#ifndef AZA_FILE_WIN32_H
+#define AZA_FILE_WIN32_H
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <memoryapi.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct azaFileMapping {
+	const uint8_t *data;
+	uint64_t size;
+} azaFileMapping;
+
+// Maps the whole file into memory for reading. Pages are only read from disk when they're first touched, so touching them is where the I/O actually happens.
+// returns 0 on success, GetLastError() on failure
+static inline int azaFileMap(azaFileMapping *mapping, const char *path) {
+	mapping->data = NULL;
+	mapping->size = 0;
+	HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return (int)GetLastError();
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size)) {
+		int err = (int)GetLastError();
+		CloseHandle(hFile);
+		return err;
+	}
+	if (size.QuadPart == 0) {
+		CloseHandle(hFile);
+		return 0;
+	}
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	int err = (int)GetLastError();
+	// The view keeps its own references to the file and the mapping
+	CloseHandle(hFile);
+	if (hMapping == NULL) return err;
+	void *data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	err = (int)GetLastError();
+	CloseHandle(hMapping);
+	if (data == NULL) return err;
+	mapping->data = data;
+	mapping->size = (uint64_t)size.QuadPart;
+	return 0;
+}
+
+static inline void azaFileUnmap(azaFileMapping *mapping) {
+	if (mapping->data) {
+		UnmapViewOfFile(mapping->data);
+	}
+	mapping->data = NULL;
+	mapping->size = 0;
+}
+
+// Lets the OS drop pages we're done with for now, so reading through a big file doesn't keep all of it resident. Only whole pages inside the range are affected.
+static inline void azaFileMappingRelease(azaFileMapping *mapping, uint64_t offset, uint64_t size) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	uint64_t pageSize = (uint64_t)info.dwPageSize;
+	uint64_t start = (offset + pageSize - 1) / pageSize * pageSize;
+	uint64_t end = (offset + size) / pageSize * pageSize;
+	if (end <= start) return;
+	// Unlocking pages that aren't locked takes them out of our working set, which is exactly what we want here
+	VirtualUnlock((void*)(mapping->data + start), (size_t)(end - start));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZA_FILE_WIN32_H
@@ -30,6 +30,9 @@ extern "C" {
 #define AZA_MSVC_ONLY(a)
 #endif
 
+// Use this to define thread procs so they have the right signature on every platform. They should return 0.
+#define AZA_THREAD_PROC_DEF(procName, userdataName) unsigned __stdcall procName(void *userdataName)
+
 typedef struct azaThread {
 	HANDLE hThread;
 	unsigned id;
@@ -74,6 +77,19 @@ static inline void azaThreadYield() {
 	Sleep(0);
 }
 
+// Asks for realtime scheduling for the calling thread. returns 0 on success
+static inline int azaThreadSetRealtime() {
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? 0 : (int)GetLastError();
+}
+
+// Monotonic time, only useful for measuring durations
+static inline uint64_t azaGetTimestampNanoseconds() {
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / (uint64_t)frequency.QuadPart;
+}
+
 typedef struct azaMutex {
 	CRITICAL_SECTION criticalSection;
 } azaMutex;
@@ -94,6 +110,56 @@ static inline void azaMutexUnlock(azaMutex *mutex) {
 	LeaveCriticalSection(&mutex->criticalSection);
 }
 
+typedef struct azaSemaphore {
+	HANDLE hSemaphore;
+} azaSemaphore;
+
+static inline void azaSemaphoreInit(azaSemaphore *semaphore, uint32_t count) {
+	semaphore->hSemaphore = CreateSemaphoreA(NULL, (LONG)count, 0x7fffffff, NULL);
+}
+
+static inline void azaSemaphoreDeinit(azaSemaphore *semaphore) {
+	CloseHandle(semaphore->hSemaphore);
+	semaphore->hSemaphore = NULL;
+}
+
+static inline void azaSemaphorePost(azaSemaphore *semaphore, uint32_t count) {
+	ReleaseSemaphore(semaphore->hSemaphore, (LONG)count, NULL);
+}
+
+static inline void azaSemaphoreWait(azaSemaphore *semaphore) {
+	WaitForSingleObject(semaphore->hSemaphore, INFINITE);
+}
+
+// Use this to define destructors for azaThreadLocal so they have the right signature on every platform.
+#define AZA_THREAD_LOCAL_DESTRUCTOR_DEF(procName, valueName) void NTAPI procName(void *valueName)
+
+// A pointer with a separate value for every thread, where each thread's value is passed to the destructor when that thread exits (if it's not NULL). Unlike thread_local, this lets us clean up after threads we didn't create.
+// This uses fiber local storage because plain TLS has no destructors.
+typedef struct azaThreadLocal {
+	DWORD index;
+} azaThreadLocal;
+
+// returns 0 on success, GetLastError() on failure
+static inline int azaThreadLocalInit(azaThreadLocal *threadLocal, PFLS_CALLBACK_FUNCTION destructor) {
+	threadLocal->index = FlsAlloc(destructor);
+	if (threadLocal->index == FLS_OUT_OF_INDEXES) return (int)GetLastError();
+	return 0;
+}
+
+// NOTE: Unlike pthreads, FlsFree does call the destructor for every thread's value
+static inline void azaThreadLocalDeinit(azaThreadLocal *threadLocal) {
+	FlsFree(threadLocal->index);
+}
+
+static inline void* azaThreadLocalGet(azaThreadLocal *threadLocal) {
+	return FlsGetValue(threadLocal->index);
+}
+
+static inline void azaThreadLocalSet(azaThreadLocal *threadLocal, void *value) {
+	FlsSetValue(threadLocal->index, value);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -121,6 +121,8 @@ typedef struct azaStreamData {
 	// Has the channel layout and samplerate as requested by the user. This may be the same as nativeBuffer if everything lines up.
 	azaBuffer processingBuffer;
 	float resamplingHoldoverFrames;
+	// Converts from processingBuffer's samplerate to nativeBuffer's for outputs, and the other way around for inputs
+	azaResampler resampler;
 	// May point some offset into myBuffer, depending on resampling conditions
 	float *processingBufferStart;
 	float *nativeBufferStart;
@@ -159,6 +161,7 @@ static void azaStreamDataFree(azaStreamData *data) {
 		streamCount--;
 		azaBufferDeinit(&data->nativeBuffer);
 		azaBufferDeinit(&data->processingBuffer);
+		azaResamplerDeinit(&data->resampler);
 	}
 }
 
@@ -286,16 +289,8 @@ static uint32_t GetResampledFramecount(uint32_t dstSamplerate, uint32_t srcSampl
 	return (uint32_t)ceilf((float)numSamples * (float)dstSamplerate / (float)srcSamplerate);
 }
 
-// TODO: Maybe make this configurable. Real hardcore audio quality requires a much larger window, which comes at a pretty significant cost. Maybe use SIMD instead and just make it bigger (with possibly an option for a low-latency resampling kernel that sacrifices the phase-frequency relationship).
-#define AZA_RESAMPLING_WINDOW 50
-
-#define AZA_LANCZOS_SAMPLES_PER_ZERO_CROSSING 128
-
-static azaKernel lanczosResamplingKernel;
-
-static void lanczosTableInit() {
-	azaKernelMakeLanczos(&lanczosResamplingKernel, AZA_LANCZOS_SAMPLES_PER_ZERO_CROSSING, AZA_RESAMPLING_WINDOW);
-}
+// TODO: Maybe make this configurable. Real hardcore audio quality requires a much larger window, which comes at a pretty significant cost. Maybe make it bigger (with possibly an option for a low-latency resampling kernel that sacrifices the phase-frequency relationship).
+// Every stream's azaResampler is built from azaKernelDefaultLanczos (radius 50 with 128 samples per zero crossing). When downsampling, the window is stretched by the resampling factor, so the padding we need is data->resampler.padding rather than the kernel radius.
 
 // TODO: This works well in fairly trivial cases, but a better implementation needs to know about the actual function of each channel.
 static void azaMixChannels(float *dst, int dstChannels, float *src, int srcChannels, int numFrames) {
@@ -312,21 +307,21 @@ static void azaMixChannels(float *dst, int dstChannels, float *src, int srcChann
 	}
 }
 
-static void azaMixChannelsResampled(azaKernel *kernel, float factor, float *dst, int dstChannels, int dstFrames, float *src, int srcChannels, int srcFrameMin, int srcFrameMax, float srcSampleOffset) {
+static void azaMixChannelsResampled(azaResampler *resampler, float *dst, int dstChannels, int dstFrames, float *src, int srcChannels, int srcFrameMin, int srcFrameMax, float srcSampleOffset) {
 	float amplification = AZA_MIN(1.0f, (float)dstChannels / (float)srcChannels);
 	memset(dst, 0, dstFrames * dstChannels * sizeof(float));
 	for (int dstC = 0; dstC < dstChannels; dstC++) {
 		float *dstOffset = dst + dstC;
 		for (int srcC = 0; srcC < AZA_MAX(1, srcChannels / dstChannels); srcC++) {
 			float *srcOffset = src + srcC + dstC * srcChannels / dstChannels;
-			azaResampleAdd(kernel, factor, amplification, dstOffset, dstChannels, dstFrames, srcOffset, srcChannels, srcFrameMin, srcFrameMax, srcSampleOffset);
+			azaResamplerProcessAdd(resampler, amplification, dstOffset, dstChannels, dstFrames, srcOffset, srcChannels, srcFrameMin, srcFrameMax, srcSampleOffset);
 		}
 	}
 }
 
 static void azaStreamConvertFromNative(azaStreamData *data, uint32_t numFramesNative, uint32_t numFrames) {
 	// First, populate nativeBuffer, doing any type conversions necessary
-	// NOTE: We're leaving 2*AZA_RESAMPLING_WINDOW space at the beginning, allowing us to process the incoming data with exactly enough latency for resampling to occur with no artifacts. This block will have been copied from the end of the last chunk.
+	// NOTE: We're leaving 2*data->resampler.padding space at the beginning, allowing us to process the incoming data with exactly enough latency for resampling to occur with no artifacts. This block will have been copied from the end of the last chunk.
 	if (IsEqualGUID(&data->waveFormatExtensible.SubFormat, &KSDATAFORMAT_SUBTYPE_PCM)) {
 		switch (data->waveFormatExtensible.Format.wBitsPerSample) {
 			case 8: {
@@ -389,9 +384,10 @@ static void azaStreamConvertFromNative(azaStreamData *data, uint32_t numFramesNa
 			azaMixChannels(data->processingBuffer.samples, data->processingBuffer.channelLayout.count, data->nativeBufferStart, data->waveFormatExtensible.Format.nChannels, numFrames);
 		}
 	} else {
-		// Move our reference position back by half of the entire resampling kernel window, adding AZA_RESAMPLING_WINDOW samples of latency, but allowing for artifact-free resampling.
-		float *nativeBuffer = data->nativeBuffer.samples + AZA_RESAMPLING_WINDOW * data->waveFormatExtensible.Format.nChannels;
-		float factor = (float)data->waveFormatExtensible.Format.nSamplesPerSec / (float)data->processingBuffer.samplerate;
+		int window = (int)data->resampler.padding;
+		// Move our reference position back by half of the entire resampling kernel window, adding window samples of latency, but allowing for artifact-free resampling.
+		float *nativeBuffer = data->nativeBuffer.samples + window * data->waveFormatExtensible.Format.nChannels;
+		float factor = data->resampler.factor;
 		float srcSampleOffset = -data->resamplingHoldoverFrames;
 		data->resamplingHoldoverFrames += (float)numFrames * factor - (float)numFramesNative;
 		uint32_t holdoverFrames = (uint32_t)ceilf(data->resamplingHoldoverFrames);
@@ -403,15 +399,15 @@ static void azaStreamConvertFromNative(azaStreamData *data, uint32_t numFramesNa
 			for (uint32_t c = 0; c < data->processingBuffer.channelLayout.count; c++) {
 				float *dst = data->processingBuffer.samples + c;
 				float *src = nativeBuffer + c;
-				azaResample(&lanczosResamplingKernel, factor, dst, stride, numFrames, src, stride, -AZA_RESAMPLING_WINDOW, numFramesNative + AZA_RESAMPLING_WINDOW, srcSampleOffset);
+				azaResamplerProcess(&data->resampler, dst, stride, numFrames, src, stride, -window, numFramesNative + window, srcSampleOffset);
 			}
 		} else {
 			// Resample and do channel mixing
-			azaMixChannelsResampled(&lanczosResamplingKernel, factor, data->processingBuffer.samples, data->processingBuffer.channelLayout.count, numFrames, nativeBuffer, data->waveFormatExtensible.Format.nChannels, -AZA_RESAMPLING_WINDOW, numFramesNative + AZA_RESAMPLING_WINDOW, srcSampleOffset);
+			azaMixChannelsResampled(&data->resampler, data->processingBuffer.samples, data->processingBuffer.channelLayout.count, numFrames, nativeBuffer, data->waveFormatExtensible.Format.nChannels, -window, numFramesNative + window, srcSampleOffset);
 		}
 		// Finally, copy the end of the buffer to the beginning for the next go around. (This is only necessary when resampling).
-		memcpy(data->nativeBuffer.samples, data->nativeBuffer.samples + (numFramesNative - holdoverFrames) * data->waveFormatExtensible.Format.nChannels, (AZA_RESAMPLING_WINDOW * 2 + holdoverFrames) * data->waveFormatExtensible.Format.nChannels * sizeof(float));
-		data->nativeBufferStart = data->nativeBuffer.samples + (AZA_RESAMPLING_WINDOW * 2 + holdoverFrames) * data->waveFormatExtensible.Format.nChannels;
+		memcpy(data->nativeBuffer.samples, data->nativeBuffer.samples + (numFramesNative - holdoverFrames) * data->waveFormatExtensible.Format.nChannels, (window * 2 + holdoverFrames) * data->waveFormatExtensible.Format.nChannels * sizeof(float));
+		data->nativeBufferStart = data->nativeBuffer.samples + (window * 2 + holdoverFrames) * data->waveFormatExtensible.Format.nChannels;
 	}
 }
 
@@ -427,28 +423,29 @@ static void azaStreamConvertToNative(azaStreamData *data, uint32_t numFramesNati
 			azaMixChannels(data->nativeBuffer.samples, data->waveFormatExtensible.Format.nChannels, data->processingBufferStart, data->processingBuffer.channelLayout.count, numFrames);
 		}
 	} else {
-		float factor = (float)data->processingBuffer.samplerate / (float)data->waveFormatExtensible.Format.nSamplesPerSec;
+		int window = (int)data->resampler.padding;
+		float factor = data->resampler.factor;
 		float srcSampleOffset = -data->resamplingHoldoverFrames;
 		data->resamplingHoldoverFrames += (float)numFrames - (float)numFramesNative * factor;
 		uint32_t holdoverFrames = (uint32_t)ceilf(data->resamplingHoldoverFrames);
 		data->resamplingHoldoverFrames -= (float)holdoverFrames;
 		// Resample
-		float *myBuffer = data->processingBuffer.samples + AZA_RESAMPLING_WINDOW * data->processingBuffer.channelLayout.count;
+		float *myBuffer = data->processingBuffer.samples + window * data->processingBuffer.channelLayout.count;
 		if (data->processingBuffer.channelLayout.count == data->waveFormatExtensible.Format.nChannels) {
 			// Just resample
 			uint32_t stride = data->processingBuffer.channelLayout.count;
 			for (uint32_t c = 0; c < data->processingBuffer.channelLayout.count; c++) {
 				float *src = myBuffer + c;
 				float *dst = data->nativeBuffer.samples + c;
-				azaResample(&lanczosResamplingKernel, factor, dst, stride, numFramesNative, src, stride, -AZA_RESAMPLING_WINDOW, numFrames + AZA_RESAMPLING_WINDOW, srcSampleOffset);
+				azaResamplerProcess(&data->resampler, dst, stride, numFramesNative, src, stride, -window, numFrames + window, srcSampleOffset);
 			}
 		} else {
 			// Resample and do channel mixing
-			azaMixChannelsResampled(&lanczosResamplingKernel, factor, data->nativeBuffer.samples, data->waveFormatExtensible.Format.nChannels, numFramesNative, myBuffer, data->processingBuffer.channelLayout.count, -AZA_RESAMPLING_WINDOW, numFrames + AZA_RESAMPLING_WINDOW, srcSampleOffset);
+			azaMixChannelsResampled(&data->resampler, data->nativeBuffer.samples, data->waveFormatExtensible.Format.nChannels, numFramesNative, myBuffer, data->processingBuffer.channelLayout.count, -window, numFrames + window, srcSampleOffset);
 		}
 		// Finally, copy the end of the buffer to the beginning for the next go around. (This is only necessary when resampling).
-		memcpy(data->processingBuffer.samples, data->processingBuffer.samples + (numFrames - holdoverFrames) * data->processingBuffer.channelLayout.count, (AZA_RESAMPLING_WINDOW * 2 + holdoverFrames) * data->processingBuffer.channelLayout.count * sizeof(float));
-		data->processingBufferStart = data->processingBuffer.samples + (AZA_RESAMPLING_WINDOW * 2 + holdoverFrames) * data->processingBuffer.channelLayout.count;
+		memcpy(data->processingBuffer.samples, data->processingBuffer.samples + (numFrames - holdoverFrames) * data->processingBuffer.channelLayout.count, (window * 2 + holdoverFrames) * data->processingBuffer.channelLayout.count * sizeof(float));
+		data->processingBufferStart = data->processingBuffer.samples + (window * 2 + holdoverFrames) * data->processingBuffer.channelLayout.count;
 	}
 	if (IsEqualGUID(&data->waveFormatExtensible.SubFormat, &KSDATAFORMAT_SUBTYPE_PCM)) {
 		switch (data->waveFormatExtensible.Format.wBitsPerSample) {
@@ -565,6 +562,7 @@ static void azaStreamProcess(azaStreamData *data) {
 		.samplerate = data->processingBuffer.samplerate,
 		.frames = numFrames,
 		.stride = data->processingBuffer.channelLayout.count,
+		.channelStride = 1,
 		.channelLayout = data->processingBuffer.channelLayout,
 	});
 	if (err) {
@@ -626,7 +624,6 @@ static void azaWASAPIDeinit() {
 }
 
 static int azaWASAPIInit() {
-	lanczosTableInit();
 	HRESULT hResult;
 	hResult = CoInitialize(NULL);
 	CHECK_RESULT("CoInitialize", goto error);
@@ -903,12 +900,21 @@ static int azaStreamInitWASAPI(azaStream *stream, azaStreamConfig config, azaDev
 	CHECK_RESULT("IAudioClient::Start", FAIL_ACTION);
 
 	if (!exactFormat) {
+		float factor;
+		if (stream->deviceInterface == AZA_OUTPUT) {
+			factor = (float)data->processingBuffer.samplerate / (float)data->waveFormatExtensible.Format.nSamplesPerSec;
+		} else {
+			factor = (float)data->waveFormatExtensible.Format.nSamplesPerSec / (float)data->processingBuffer.samplerate;
+		}
+		errCode = azaResamplerInit(&data->resampler, &azaKernelDefaultLanczos, 0, factor);
+		if (errCode) goto error;
+		uint32_t window = data->resampler.padding;
 		data->processingBuffer.frames = GetResampledFramecount(data->processingBuffer.samplerate, data->waveFormatExtensible.Format.nSamplesPerSec, data->deviceBufferFrames);
-		data->nativeBuffer.samples = aza_calloc((data->deviceBufferFrames + AZA_RESAMPLING_WINDOW*2) * data->waveFormatExtensible.Format.nChannels, sizeof(float));
-		data->nativeBufferStart = data->nativeBuffer.samples + (AZA_RESAMPLING_WINDOW * 2) * data->waveFormatExtensible.Format.nChannels;
+		data->nativeBuffer.samples = aza_calloc((data->deviceBufferFrames + window*2) * data->waveFormatExtensible.Format.nChannels, sizeof(float));
+		data->nativeBufferStart = data->nativeBuffer.samples + (window * 2) * data->waveFormatExtensible.Format.nChannels;
 		data->nativeBuffer.channelLayout = azaGetChannelLayoutFromMask((uint8_t)data->waveFormatExtensible.Format.nChannels, data->waveFormatExtensible.dwChannelMask);
-		data->processingBuffer.samples = aza_calloc((data->processingBuffer.frames + AZA_RESAMPLING_WINDOW*2) * data->processingBuffer.channelLayout.count, sizeof(float));
-		data->processingBufferStart = data->processingBuffer.samples + (AZA_RESAMPLING_WINDOW * 2) * data->processingBuffer.channelLayout.count;
+		data->processingBuffer.samples = aza_calloc((data->processingBuffer.frames + window*2) * data->processingBuffer.channelLayout.count, sizeof(float));
+		data->processingBufferStart = data->processingBuffer.samples + (window * 2) * data->processingBuffer.channelLayout.count;
 		data->processingBuffer.channelLayout = azaChannelLayoutStandardFromCount(data->processingBuffer.channelLayout.count);
 	} else {
 		data->processingBuffer.samples = NULL;
@@ -9,6 +9,10 @@
 
 // TODO: Some of these will be stubs that return 0 until their backends get implemented.
 
+// Available on every platform
+int azaBackendNullInit();
+void azaBackendNullDeinit();
+
 #ifdef __unix
 
 int azaBackendPipewireInit();
@@ -0,0 +1,16 @@
+/*
+	File: file.h
+	Author: Philip Haynes
+	Pulls in the read-only file mapping for whichever platform we're building for.
+*/
+
+#ifndef AZA_FILE_H
+#define AZA_FILE_H
+
+#ifdef _WIN32
+#include "Win32/file.h"
+#else
+#include "Linux/file.h"
+#endif
+
+#endif // AZA_FILE_H
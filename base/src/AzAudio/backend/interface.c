@@ -9,52 +9,65 @@
 #include "backend.h"
 #include "../error.h"
 
-typedef enum azaBackend {
-	AZA_BACKEND_NONE=0,
+azaBackend azaBackendPreferred = AZA_BACKEND_NONE;
+static azaBackend backend = AZA_BACKEND_NONE;
+
+static int azaBackendTryInit(azaBackend which) {
+	int err;
+	switch (which) {
+		case AZA_BACKEND_NULL: err = azaBackendNullInit(); break;
 #ifdef __unix
-	AZA_BACKEND_PIPEWIRE,
-	AZA_BACKEND_PULSEAUDIO,
-	AZA_BACKEND_JACK,
-	AZA_BACKEND_ALSA,
+		case AZA_BACKEND_PIPEWIRE: err = azaBackendPipewireInit(); break;
+		case AZA_BACKEND_PULSEAUDIO: err = azaBackendPulseAudioInit(); break;
+		case AZA_BACKEND_JACK: err = azaBackendJackInit(); break;
+		case AZA_BACKEND_ALSA: err = azaBackendALSAInit(); break;
 #elif defined(_WIN32)
-	AZA_BACKEND_WASAPI,
-	AZA_BACKEND_XAUDIO2,
+		case AZA_BACKEND_WASAPI: err = azaBackendWASAPIInit(); break;
+		case AZA_BACKEND_XAUDIO2: err = azaBackendXAudio2Init(); break;
 #endif
-} azaBackend;
-static azaBackend backend = AZA_BACKEND_NONE;
+		default: return AZA_ERROR_BACKEND_UNAVAILABLE;
+	}
+	if (err == AZA_SUCCESS) {
+		backend = which;
+		AZA_LOG_INFO("AzAudio will use backend \"%s\"\n", azaBackendString(which));
+	}
+	return err;
+}
 
 int azaBackendInit() {
-	if (0) {
+	if (azaBackendPreferred != AZA_BACKEND_NONE) {
+		int err = azaBackendTryInit(azaBackendPreferred);
+		if (err) {
+			AZA_LOG_ERR("Backend \"%s\" is not available :(\n", azaBackendString(azaBackendPreferred));
+		}
+		return err;
+	}
+	// In order of preference. The null backend is only used when asked for explicitly.
+	static const azaBackend backendsToTry[] = {
 #ifdef __unix
-	} else if (AZA_SUCCESS == azaBackendPipewireInit()) {
-		backend = AZA_BACKEND_PIPEWIRE;
-		AZA_LOG_INFO("AzAudio will use backend \"Pipewire\"\n");
-	} else if (AZA_SUCCESS == azaBackendPulseAudioInit()) {
-		backend = AZA_BACKEND_PULSEAUDIO;
-		AZA_LOG_INFO("AzAudio will use backend \"PulseAudio\"\n");
-	} else if (AZA_SUCCESS == azaBackendJackInit()) {
-		backend = AZA_BACKEND_JACK;
-		AZA_LOG_INFO("AzAudio will use backend \"Jack\"\n");
-	} else if (AZA_SUCCESS == azaBackendALSAInit()) {
-		backend = AZA_BACKEND_ALSA;
-		AZA_LOG_INFO("AzAudio will use backend \"ALSA\"\n");
+		AZA_BACKEND_PIPEWIRE,
+		AZA_BACKEND_PULSEAUDIO,
+		AZA_BACKEND_JACK,
+		AZA_BACKEND_ALSA,
 #elif defined(_WIN32)
-	} else if (AZA_SUCCESS == azaBackendWASAPIInit()) {
-		backend = AZA_BACKEND_WASAPI;
-		AZA_LOG_INFO("AzAudio will use backend \"WASAPI\"\n");
-	} else if (AZA_SUCCESS == azaBackendXAudio2Init()) {
-		backend = AZA_BACKEND_XAUDIO2;
-		AZA_LOG_INFO("AzAudio will use backend \"XAudio2\"\n");
+		AZA_BACKEND_WASAPI,
+		AZA_BACKEND_XAUDIO2,
 #endif
-	} else {
-		AZA_LOG_ERR("No backends available :(\n");
-		return AZA_ERROR_BACKEND_UNAVAILABLE;
+	};
+	for (size_t i = 0; i < sizeof(backendsToTry) / sizeof(backendsToTry[0]); i++) {
+		if (AZA_SUCCESS == azaBackendTryInit(backendsToTry[i])) {
+			return AZA_SUCCESS;
+		}
 	}
-	return AZA_SUCCESS;
+	AZA_LOG_ERR("No backends available :( Set AZAUDIO_BACKEND=null to run without audio devices.\n");
+	return AZA_ERROR_BACKEND_UNAVAILABLE;
 }
 
 void azaBackendDeinit() {
 	switch (backend) {
+		case AZA_BACKEND_NULL:
+			azaBackendNullDeinit();
+			break;
 #ifdef __unix
 		case AZA_BACKEND_PIPEWIRE:
 			azaBackendPipewireDeinit();
@@ -78,6 +91,29 @@ void azaBackendDeinit() {
 #endif
 		default: break;
 	}
+	backend = AZA_BACKEND_NONE;
+}
+
+azaBackend azaGetBackend() {
+	return backend;
+}
+
+const char* azaBackendString(azaBackend backend) {
+	switch (backend) {
+		case AZA_BACKEND_NONE: return "None";
+		case AZA_BACKEND_NULL: return "Null";
+#ifdef __unix
+		case AZA_BACKEND_PIPEWIRE: return "Pipewire";
+		case AZA_BACKEND_PULSEAUDIO: return "PulseAudio";
+		case AZA_BACKEND_JACK: return "Jack";
+		case AZA_BACKEND_ALSA: return "ALSA";
+#elif defined(_WIN32)
+		case AZA_BACKEND_WASAPI: return "WASAPI";
+		case AZA_BACKEND_XAUDIO2: return "XAudio2";
+#endif
+		case AZA_BACKEND_ONE_AFTER_LAST: break;
+	}
+	return "Unknown";
 }
 
 fp_azaStreamInit azaStreamInit;
@@ -15,10 +15,35 @@
 extern "C" {
 #endif
 
+typedef enum azaBackend {
+	AZA_BACKEND_NONE=0,
+	// Has no devices behind it, see azaBackendNullConfig
+	AZA_BACKEND_NULL,
+#ifdef __unix
+	AZA_BACKEND_PIPEWIRE,
+	AZA_BACKEND_PULSEAUDIO,
+	AZA_BACKEND_JACK,
+	AZA_BACKEND_ALSA,
+#elif defined(_WIN32)
+	AZA_BACKEND_WASAPI,
+	AZA_BACKEND_XAUDIO2,
+#endif
+	AZA_BACKEND_ONE_AFTER_LAST,
+} azaBackend;
+
+// If not AZA_BACKEND_NONE, azaBackendInit will only try this backend. Otherwise it tries the real backends in order and the null backend is never picked.
+// azaInit will set this from the AZAUDIO_BACKEND environment variable if it's set (for example AZAUDIO_BACKEND=null).
+extern azaBackend azaBackendPreferred;
+
 // Find out what backends are available, picks one, and set up function pointers.
 int azaBackendInit();
 void azaBackendDeinit();
 
+// Which backend azaBackendInit picked
+azaBackend azaGetBackend();
+
+const char* azaBackendString(azaBackend backend);
+
 typedef enum azaDeviceInterface {
 	AZA_OUTPUT=0,
 	AZA_INPUT,
@@ -109,6 +134,40 @@ extern fp_azaGetDeviceName azaGetDeviceName;
 typedef size_t (*fp_azaGetDeviceChannels)(azaDeviceInterface interface, size_t index);
 extern fp_azaGetDeviceChannels azaGetDeviceChannels;
 
+
+
+
+typedef enum azaNullClock {
+	// A thread calls mixCallback at the pace of the samplerate, as though there were a real device
+	AZA_NULL_CLOCK_REALTIME=0,
+	// A thread calls mixCallback back-to-back as fast as it can
+	AZA_NULL_CLOCK_FAST,
+	// There's no thread, and mixCallback only gets called by azaStreamNullProcess
+	AZA_NULL_CLOCK_MANUAL,
+} azaNullClock;
+
+typedef struct azaBackendNullConfig {
+	// Default samplerate of the null devices. Leave at 0 for 48000
+	uint32_t samplerate;
+	// Default channel layout of the null devices. Leave at 0 for stereo
+	azaChannelLayout channelLayout;
+	// How many frames get processed per callback. Leave at 0 for 10ms
+	uint32_t bufferFrames;
+	azaNullClock clock;
+} azaBackendNullConfig;
+// Read by azaStreamInit for the null backend, so changes here only affect streams made afterwards
+extern azaBackendNullConfig azaBackendNull;
+
+// Calls mixCallback once for the given number of frames (0 means the stream's buffer size, which is the most you can do at once). If dst is not NULL, it will point to the buffer that was just processed, which stays valid until the next call.
+// This is the only way streams get processed with AZA_NULL_CLOCK_MANUAL, but it works for the other clocks too.
+// May return AZA_ERROR_BACKEND_UNAVAILABLE if the null backend isn't the one in use
+// May return AZA_ERROR_INVALID_FRAME_COUNT if frames is more than azaStreamGetBufferFrameCount
+// Otherwise returns whatever mixCallback returned
+int azaStreamNullProcess(azaStream *stream, uint32_t frames, azaBuffer *dst);
+
+// How many frames a null backend stream has processed since it was initialized
+uint64_t azaStreamNullGetFramesProcessed(azaStream *stream);
+
 #ifdef __cplusplus
 }
 #endif
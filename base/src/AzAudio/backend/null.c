@@ -0,0 +1,265 @@
+/*
+	File: null.c
+	Author: Philip Haynes
+	A backend with no devices behind it. Streams are driven by a clock thread, as fast as possible, or manually, which makes it useful for headless machines, tests, benchmarks and offline rendering.
+*/
+
+#include "interface.h"
+#include "backend.h"
+#include "threads.h"
+
+#include "../AzAudio.h"
+#include "../error.h"
+
+#include <string.h>
+
+azaBackendNullConfig azaBackendNull = {0};
+
+typedef struct azaStreamDataNull {
+	azaStream *stream;
+	// Has the samplerate and channel layout that the user asked for (or the null device's defaults)
+	azaBuffer buffer;
+	azaNullClock clock;
+	azaThread thread;
+	azaMutex mutex;
+	uint64_t framesProcessed;
+	volatile bool isActive;
+	volatile bool shouldQuit;
+} azaStreamDataNull;
+
+static uint32_t azaNullGetDeviceSamplerate() {
+	return azaBackendNull.samplerate ? azaBackendNull.samplerate : 48000;
+}
+
+static azaChannelLayout azaNullGetDeviceChannelLayout() {
+	if (azaBackendNull.channelLayout.count) {
+		return azaBackendNull.channelLayout;
+	}
+	return azaChannelLayoutStereo();
+}
+
+static uint32_t azaNullGetDeviceBufferFrames(uint32_t samplerate) {
+	if (azaBackendNull.bufferFrames) {
+		return azaBackendNull.bufferFrames;
+	}
+	// 10ms
+	return (samplerate + 99) / 100;
+}
+
+// Expects data->mutex to be locked
+static int azaStreamProcessNull(azaStreamDataNull *data, uint32_t frames) {
+	azaStream *stream = data->stream;
+	azaBuffer buffer = data->buffer;
+	buffer.frames = frames;
+	if (stream->deviceInterface == AZA_INPUT) {
+		// The null device only ever hears silence
+		azaBufferZero(buffer);
+	}
+	int err = stream->mixCallback(stream->userdata, buffer);
+	data->framesProcessed += frames;
+	return err;
+}
+
+static AZA_THREAD_PROC_DEF(azaNullThreadProc, userdata) {
+	azaStreamDataNull *data = userdata;
+	uint32_t samplerate = data->buffer.samplerate;
+	uint32_t frames = data->buffer.frames;
+	uint64_t framesSinceStart = 0;
+	uint64_t timeStart = azaGetTimestampNanoseconds();
+	bool wasActive = false;
+	azaMutexLock(&data->mutex);
+	while (!data->shouldQuit) {
+		if (!data->isActive) {
+			wasActive = false;
+			azaMutexUnlock(&data->mutex);
+			azaThreadSleep(1);
+			azaMutexLock(&data->mutex);
+			continue;
+		}
+		if (!wasActive) {
+			// Restart the clock so we don't try to catch up on time spent inactive
+			wasActive = true;
+			framesSinceStart = 0;
+			timeStart = azaGetTimestampNanoseconds();
+		}
+		int err = azaStreamProcessNull(data, frames);
+		if (err) {
+			char buffer[64];
+			data->isActive = false;
+			AZA_LOG_ERR("Processing stream for device \"%s\" had an error (%s). Disabling stream...\n", azaStreamGetDeviceName(data->stream), azaErrorString(err, buffer, sizeof(buffer)));
+		}
+		azaMutexUnlock(&data->mutex);
+		if (data->clock == AZA_NULL_CLOCK_REALTIME) {
+			framesSinceStart += frames;
+			uint64_t deadline = timeStart + framesSinceStart * 1000000000ull / samplerate;
+			while (!data->shouldQuit) {
+				uint64_t now = azaGetTimestampNanoseconds();
+				if (now >= deadline) break;
+				uint64_t remaining = deadline - now;
+				if (remaining > 2000000) {
+					azaThreadSleep((uint32_t)(remaining / 1000000) - 1);
+				} else {
+					azaThreadYield();
+				}
+			}
+		} else {
+			// Give azaStreamSetActive and azaStreamDeinit a chance to grab the mutex
+			azaThreadYield();
+		}
+		azaMutexLock(&data->mutex);
+	}
+	azaMutexUnlock(&data->mutex);
+	return 0;
+}
+
+static int azaStreamInitNull(azaStream *stream, azaStreamConfig config, azaDeviceInterface deviceInterface, uint32_t flags, bool activate) {
+	if (stream->mixCallback == NULL) {
+		AZA_LOG_ERR("azaStreamInit error: no mix callback provided.\n");
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	azaStreamDataNull *data = aza_calloc(1, sizeof(azaStreamDataNull));
+	if (!data) return AZA_ERROR_OUT_OF_MEMORY;
+	stream->config = config;
+	stream->deviceInterface = deviceInterface;
+	if (flags & AZA_STREAM_COMMIT_DEVICE_NAME && config.deviceName == NULL) {
+		stream->config.deviceName = deviceInterface == AZA_OUTPUT ? "Null Output" : "Null Input";
+	}
+	uint32_t samplerate = config.samplerate ? config.samplerate : azaNullGetDeviceSamplerate();
+	azaChannelLayout channelLayout = config.channelLayout.count ? config.channelLayout : azaNullGetDeviceChannelLayout();
+	if (flags & AZA_STREAM_COMMIT_SAMPLERATE) {
+		stream->config.samplerate = samplerate;
+	}
+	if (flags & AZA_STREAM_COMMIT_CHANNEL_LAYOUT) {
+		stream->config.channelLayout = channelLayout;
+	}
+	int err = azaBufferInit(&data->buffer, azaNullGetDeviceBufferFrames(samplerate), channelLayout);
+	if (err) {
+		aza_free(data);
+		return err;
+	}
+	data->buffer.samplerate = samplerate;
+	data->stream = stream;
+	data->clock = azaBackendNull.clock;
+	data->isActive = activate;
+	azaMutexInit(&data->mutex);
+	stream->data = data;
+	if (data->clock != AZA_NULL_CLOCK_MANUAL) {
+		if (azaThreadLaunch(&data->thread, azaNullThreadProc, data)) {
+			AZA_LOG_ERR("azaStreamInit error: failed to launch null stream thread.\n");
+			azaMutexDeinit(&data->mutex);
+			azaBufferDeinit(&data->buffer);
+			aza_free(data);
+			stream->data = NULL;
+			return AZA_ERROR_BACKEND_ERROR;
+		}
+	}
+	AZA_LOG_INFO("Null %s stream: %u channels at %uHz with %u frames per callback\n", deviceInterface == AZA_OUTPUT ? "output" : "input", (uint32_t)channelLayout.count, samplerate, data->buffer.frames);
+	return AZA_SUCCESS;
+}
+
+static void azaStreamDeinitNull(azaStream *stream) {
+	azaStreamDataNull *data = stream->data;
+	if (!data) return;
+	data->shouldQuit = true;
+	if (azaThreadJoinable(&data->thread)) {
+		azaThreadJoin(&data->thread);
+	}
+	azaMutexDeinit(&data->mutex);
+	azaBufferDeinit(&data->buffer);
+	aza_free(data);
+	stream->data = NULL;
+}
+
+static void azaStreamSetActiveNull(azaStream *stream, bool active) {
+	azaStreamDataNull *data = stream->data;
+	azaMutexLock(&data->mutex);
+	data->isActive = active;
+	azaMutexUnlock(&data->mutex);
+}
+
+static bool azaStreamGetActiveNull(azaStream *stream) {
+	azaStreamDataNull *data = stream->data;
+	return data->isActive;
+}
+
+static const char* azaStreamGetDeviceNameNull(azaStream *stream) {
+	return stream->deviceInterface == AZA_OUTPUT ? "Null Output" : "Null Input";
+}
+
+static uint32_t azaStreamGetSamplerateNull(azaStream *stream) {
+	azaStreamDataNull *data = stream->data;
+	return data->buffer.samplerate;
+}
+
+static azaChannelLayout azaStreamGetChannelLayoutNull(azaStream *stream) {
+	azaStreamDataNull *data = stream->data;
+	return data->buffer.channelLayout;
+}
+
+static uint32_t azaStreamGetBufferFrameCountNull(azaStream *stream) {
+	azaStreamDataNull *data = stream->data;
+	return data->buffer.frames;
+}
+
+static size_t azaGetDeviceCountNull(azaDeviceInterface interface) {
+	return 1;
+}
+
+static const char* azaGetDeviceNameNull(azaDeviceInterface interface, size_t index) {
+	assert(index == 0);
+	return interface == AZA_OUTPUT ? "Null Output" : "Null Input";
+}
+
+static size_t azaGetDeviceChannelsNull(azaDeviceInterface interface, size_t index) {
+	assert(index == 0);
+	return azaNullGetDeviceChannelLayout().count;
+}
+
+int azaStreamNullProcess(azaStream *stream, uint32_t frames, azaBuffer *dst) {
+	if (azaGetBackend() != AZA_BACKEND_NULL) {
+		return AZA_ERROR_BACKEND_UNAVAILABLE;
+	}
+	azaStreamDataNull *data = stream->data;
+	if (!data) return AZA_ERROR_NULL_POINTER;
+	if (frames == 0) {
+		frames = data->buffer.frames;
+	} else if (frames > data->buffer.frames) {
+		return AZA_ERROR_INVALID_FRAME_COUNT;
+	}
+	azaMutexLock(&data->mutex);
+	int err = azaStreamProcessNull(data, frames);
+	azaMutexUnlock(&data->mutex);
+	if (dst) {
+		*dst = data->buffer;
+		dst->frames = frames;
+	}
+	return err;
+}
+
+uint64_t azaStreamNullGetFramesProcessed(azaStream *stream) {
+	if (azaGetBackend() != AZA_BACKEND_NULL) {
+		return 0;
+	}
+	azaStreamDataNull *data = stream->data;
+	azaMutexLock(&data->mutex);
+	uint64_t result = data->framesProcessed;
+	azaMutexUnlock(&data->mutex);
+	return result;
+}
+
+int azaBackendNullInit() {
+	azaStreamInit = azaStreamInitNull;
+	azaStreamDeinit = azaStreamDeinitNull;
+	azaStreamSetActive = azaStreamSetActiveNull;
+	azaStreamGetActive = azaStreamGetActiveNull;
+	azaStreamGetDeviceName = azaStreamGetDeviceNameNull;
+	azaStreamGetSamplerate = azaStreamGetSamplerateNull;
+	azaStreamGetChannelLayout = azaStreamGetChannelLayoutNull;
+	azaStreamGetBufferFrameCount = azaStreamGetBufferFrameCountNull;
+	azaGetDeviceCount = azaGetDeviceCountNull;
+	azaGetDeviceName = azaGetDeviceNameNull;
+	azaGetDeviceChannels = azaGetDeviceChannelsNull;
+	return AZA_SUCCESS;
+}
+
+void azaBackendNullDeinit() {}
@@ -0,0 +1,16 @@
+/*
+	File: threads.h
+	Author: Philip Haynes
+	Pulls in the thread primitives for whichever platform we're building for.
+*/
+
+#ifndef AZA_THREADS_H
+#define AZA_THREADS_H
+
+#ifdef _WIN32
+#include "Win32/threads.h"
+#else
+#include "Linux/threads.h"
+#endif
+
+#endif // AZA_THREADS_H
@@ -71,6 +71,15 @@ static inline azaChannelLayout azaChannelLayoutOneChannel(azaChannelLayout src,
 	};
 }
 
+// Returns 1 if a and b describe the same channels in the same order, otherwise 0. Positions past count are ignored.
+static inline int azaChannelLayoutsEqual(azaChannelLayout a, azaChannelLayout b) {
+	if (a.count != b.count || a.formFactor != b.formFactor) return 0;
+	for (uint8_t i = 0; i < a.count; i++) {
+		if (a.positions[i] != b.positions[i]) return 0;
+	}
+	return 1;
+}
+
 // Some standard layouts, for your convenience
 
 static inline azaChannelLayout azaChannelLayoutMono() {
@@ -6,8 +6,12 @@
 #include "dsp.h"
 
 #include "AzAudio.h"
+#include "atomic.h"
 #include "error.h"
 #include "helpers.h"
+#include "simd.h"
+#include "backend/file.h"
+#include "backend/threads.h"
 
 // Good ol' MSVC causing problems like always. Never change, MSVC... never change.
 #ifdef _MSC_VER
@@ -25,70 +29,235 @@
 
 
 
-// TODO: Maybe make this dynamic, and also deal with the thread_local memory leak snafu (possibly by making it not a stack, and therefore no longer thread_local)
-#define AZA_MAX_SIDE_BUFFERS 64
-thread_local azaBuffer sideBufferPool[AZA_MAX_SIDE_BUFFERS] = {{0}};
-thread_local size_t sideBufferCapacity[AZA_MAX_SIDE_BUFFERS] = {0};
-thread_local size_t sideBuffersInUse = 0;
-
 azaKernel azaKernelDefaultLanczos;
+azaKernel azaKernelDefaultLanczosShort;
 
 azaWorld azaWorldDefault;
 
-azaBuffer azaPushSideBuffer(uint32_t frames, uint32_t channels, uint32_t samplerate) {
-	assert(sideBuffersInUse < AZA_MAX_SIDE_BUFFERS);
-	azaBuffer *buffer = &sideBufferPool[sideBuffersInUse];
-	size_t *capacity = &sideBufferCapacity[sideBuffersInUse];
-	size_t capacityNeeded = frames * channels;
-	if (*capacity < capacityNeeded) {
-		if (*capacity) {
-			azaBufferDeinit(buffer);
+
+
+void azaScratchInit(azaScratch *data) {
+	memset(data, 0, sizeof(*data));
+}
+
+void azaScratchDeinit(azaScratch *data) {
+	azaScratchChunk *chunk = data->chunks;
+	while (chunk) {
+		azaScratchChunk *next = chunk->next;
+		aza_free(chunk);
+		chunk = next;
+	}
+	memset(data, 0, sizeof(*data));
+}
+
+// Makes a chunk with at least capacity bytes and links it in right after the top chunk, leaving any chunks that were there for later
+static azaScratchChunk* azaScratchInsertChunk(azaScratch *data, size_t capacity) {
+	// Grow geometrically so the number of chunks stays small
+	capacity = aza_align(AZA_MAX(AZA_MAX(capacity, AZA_SCRATCH_CHUNK_SIZE_DEFAULT), data->capacity), AZA_SCRATCH_ALIGNMENT);
+	azaScratchChunk *chunk = aza_malloc(sizeof(azaScratchChunk) + AZA_SCRATCH_ALIGNMENT + capacity);
+	if (!chunk) return NULL;
+	chunk->capacity = capacity;
+	chunk->data = (char*)aza_align((size_t)(chunk + 1), AZA_SCRATCH_ALIGNMENT);
+	azaScratchChunk **link = data->top.chunk ? &data->top.chunk->next : &data->chunks;
+	chunk->next = *link;
+	*link = chunk;
+	data->capacity += capacity;
+	return chunk;
+}
+
+int azaScratchReserve(azaScratch *data, size_t bytes) {
+	bytes = aza_align(bytes, AZA_SCRATCH_ALIGNMENT);
+	azaScratchChunk *chunk = data->top.chunk;
+	if (chunk && chunk->capacity - data->top.used >= bytes) return AZA_SUCCESS;
+	// If the next chunk fits it all, then whatever doesn't fit in the top chunk will fit there.
+	azaScratchChunk *next = chunk ? chunk->next : data->chunks;
+	if (next && next->capacity >= bytes) return AZA_SUCCESS;
+	if (!azaScratchInsertChunk(data, bytes)) return AZA_ERROR_OUT_OF_MEMORY;
+	return AZA_SUCCESS;
+}
+
+void* azaScratchAlloc(azaScratch *data, size_t bytes) {
+	bytes = aza_align(bytes, AZA_SCRATCH_ALIGNMENT);
+	azaScratchChunk *chunk = data->top.chunk;
+	if AZA_UNLIKELY(!chunk || chunk->capacity - data->top.used < bytes) {
+		// Skip the rest of this chunk and move on to the next one, making a new one if it's missing or too small
+		azaScratchChunk *next = chunk ? chunk->next : data->chunks;
+		if (!next || next->capacity < bytes) {
+			next = azaScratchInsertChunk(data, bytes);
+			if (!next) return NULL;
+		}
+		chunk = next;
+		data->top.chunk = chunk;
+		data->top.used = 0;
+	}
+	void *result = chunk->data + data->top.used;
+	data->top.used += bytes;
+	data->top.total += bytes;
+	data->highWaterMark = AZA_MAX(data->highWaterMark, data->top.total);
+	return result;
+}
+
+
+
+// The thread_local only caches a pointer. Default scratches are owned by azaScratchThreadLocal so they get freed when their thread exits, including threads we didn't create.
+static thread_local azaScratch *azaScratchCurrent = NULL;
+static azaThreadLocal azaScratchThreadLocal;
+static int azaScratchThreadLocalReady = 0;
+
+static AZA_THREAD_LOCAL_DESTRUCTOR_DEF(azaScratchDefaultFree, value) {
+	azaScratch *scratch = value;
+	azaScratchDeinit(scratch);
+	aza_free(scratch);
+}
+
+int azaScratchInitThreadLocal() {
+	if (azaScratchThreadLocalReady) return AZA_SUCCESS;
+	if (azaThreadLocalInit(&azaScratchThreadLocal, azaScratchDefaultFree)) {
+		AZA_LOG_ERR("azaScratchInitThreadLocal error: failed to make a thread local for side buffers\n");
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	azaScratchThreadLocalReady = 1;
+	return AZA_SUCCESS;
+}
+
+void azaScratchDeinitThreadLocal() {
+	if (!azaScratchThreadLocalReady) return;
+	// Destructors don't run for the thread that deletes the key, so take care of ours.
+	azaScratch *scratch = azaThreadLocalGet(&azaScratchThreadLocal);
+	if (scratch) {
+		azaThreadLocalSet(&azaScratchThreadLocal, NULL);
+		if (azaScratchCurrent == scratch) {
+			azaScratchCurrent = NULL;
 		}
+		azaScratchDefaultFree(scratch);
+	}
+	azaThreadLocalDeinit(&azaScratchThreadLocal);
+	azaScratchThreadLocalReady = 0;
+}
+
+azaScratch* azaGetScratch() {
+	if AZA_LIKELY(azaScratchCurrent) return azaScratchCurrent;
+	assert(azaScratchThreadLocalReady && "Did you forget to call azaInit?");
+	azaScratch *scratch = azaThreadLocalGet(&azaScratchThreadLocal);
+	if (!scratch) {
+		scratch = aza_malloc(sizeof(azaScratch));
+		if (!scratch) return NULL;
+		azaScratchInit(scratch);
+		azaThreadLocalSet(&azaScratchThreadLocal, scratch);
+	}
+	azaScratchCurrent = scratch;
+	return scratch;
+}
+
+azaScratch* azaSetScratch(azaScratch *scratch) {
+	azaScratch *previous = azaScratchCurrent;
+	if (previous && azaScratchThreadLocalReady && previous == azaThreadLocalGet(&azaScratchThreadLocal)) {
+		previous = NULL;
+	}
+	azaScratchCurrent = scratch;
+	return previous;
+}
+
+
+
+// Lives in the scratch right before the samples, so the stack of side buffers needs no memory of its own
+typedef struct azaSideBufferHeader {
+	// Where the top was before this side buffer was pushed
+	azaScratchMark mark;
+} azaSideBufferHeader;
+
+static azaBuffer azaPushSideBufferLayout(uint32_t frames, uint32_t channels, uint32_t samplerate, bool planar) {
+	azaBuffer buffer = {0};
+	buffer.frames = frames;
+	if (planar) {
+		buffer.stride = 1;
+		// Keep every channel aligned for the kernels
+		buffer.channelStride = (uint32_t)aza_align(frames, AZA_SCRATCH_ALIGNMENT / sizeof(float));
+	} else {
+		buffer.stride = channels;
+		buffer.channelStride = 1;
 	}
-	buffer->frames = frames;
-	buffer->stride = channels;
-	buffer->channelLayout.count = channels;
-	buffer->samplerate = samplerate;
-	if (*capacity < capacityNeeded) {
-		azaBufferInit(buffer, buffer->frames, buffer->channelLayout);
-		*capacity = capacityNeeded;
+	buffer.channelLayout.count = channels;
+	buffer.samplerate = samplerate;
+	azaScratch *scratch = azaGetScratch();
+	if AZA_UNLIKELY(!scratch) return buffer;
+	azaScratchMark mark = azaScratchGetMark(scratch);
+	size_t headerSize = aza_align(sizeof(azaSideBufferHeader), AZA_SCRATCH_ALIGNMENT);
+	size_t samplesSize = sizeof(float) * (planar ? buffer.channelStride : frames) * channels;
+	// Once a push has failed, every push fails until it's popped, so that pops always undo the right push
+	char *memory = mark.sideBuffersFailed ? NULL : azaScratchAlloc(scratch, headerSize + samplesSize);
+	if AZA_UNLIKELY(!memory) {
+		scratch->top.sideBuffersFailed++;
+		return buffer;
 	}
-	sideBuffersInUse++;
-	return *buffer;
+	azaSideBufferHeader *header = (azaSideBufferHeader*)memory;
+	header->mark = mark;
+	scratch->top.sideBufferTop = header;
+	buffer.samples = (float*)(memory + headerSize);
+	return buffer;
+}
+
+azaBuffer azaPushSideBuffer(uint32_t frames, uint32_t channels, uint32_t samplerate) {
+	return azaPushSideBufferLayout(frames, channels, samplerate, false);
 }
 
 azaBuffer azaPushSideBufferZero(uint32_t frames, uint32_t channels, uint32_t samplerate) {
 	azaBuffer buffer = azaPushSideBuffer(frames, channels, samplerate);
-	memset(buffer.samples, 0, sizeof(float) * frames * channels);
+	if (buffer.samples) {
+		memset(buffer.samples, 0, sizeof(float) * frames * channels);
+	}
 	return buffer;
 }
 
+azaBuffer azaPushSideBufferPlanar(uint32_t frames, uint32_t channels, uint32_t samplerate) {
+	return azaPushSideBufferLayout(frames, channels, samplerate, true);
+}
+
+// A side buffer with the same layout as like, for intermediate results that get mixed back into it
+static azaBuffer azaPushSideBufferLike(azaBuffer like, uint32_t frames, uint32_t channels) {
+	return azaPushSideBufferLayout(frames, channels, like.samplerate, azaBufferIsPlanar(like));
+}
+
 azaBuffer azaPushSideBufferCopy(azaBuffer src) {
-	azaBuffer result = azaPushSideBuffer(src.frames, src.channelLayout.count, src.samplerate);
-	azaBufferCopy(result, src);
+	azaBufferNormalize(&src);
+	azaBuffer result = azaPushSideBufferLike(src, src.frames, src.channelLayout.count);
+	if (result.samples) {
+		azaBufferCopy(result, src);
+	}
 	return result;
 }
 
 void azaPopSideBuffer() {
-	assert(sideBuffersInUse > 0);
-	sideBuffersInUse--;
+	azaScratch *scratch = azaGetScratch();
+	if AZA_UNLIKELY(!scratch) return;
+	if AZA_UNLIKELY(scratch->top.sideBuffersFailed) {
+		scratch->top.sideBuffersFailed--;
+		return;
+	}
+	azaSideBufferHeader *header = scratch->top.sideBufferTop;
+	assert(header != NULL && "Popped more side buffers than were pushed");
+	if (!header) return;
+	azaScratchRelease(scratch, header->mark);
 }
 
 void azaPopSideBuffers(uint8_t count) {
-	assert(sideBuffersInUse >= count);
-	sideBuffersInUse -= count;
+	for (uint8_t i = 0; i < count; i++) {
+		azaPopSideBuffer();
+	}
 }
 
 
 
-static int azaCheckBuffer(azaBuffer buffer) {
-	if (buffer.samples == NULL) {
+// Also normalizes buffer, so everything after this can rely on channelStride
+static int azaCheckBuffer(azaBuffer *buffer) {
+	azaBufferNormalize(buffer);
+	if (buffer->samples == NULL) {
 		return AZA_ERROR_NULL_POINTER;
 	}
-	if (buffer.channelLayout.count < 1) {
+	if (buffer->channelLayout.count < 1) {
 		return AZA_ERROR_INVALID_CHANNEL_COUNT;
 	}
-	if (buffer.frames < 1) {
+	if (buffer->frames < 1) {
 		return AZA_ERROR_INVALID_FRAME_COUNT;
 	}
 	return AZA_SUCCESS;
@@ -104,6 +273,20 @@ int azaBufferInit(azaBuffer *data, uint32_t frames, azaChannelLayout channelLayo
 	data->samples = (float*)aza_calloc(data->frames * data->channelLayout.count, sizeof(float));
 	if (!data->samples) return AZA_ERROR_OUT_OF_MEMORY;
 	data->stride = data->channelLayout.count;
+	data->channelStride = 1;
+	return AZA_SUCCESS;
+}
+
+int azaBufferInitPlanar(azaBuffer *data, uint32_t frames, azaChannelLayout channelLayout) {
+	if (frames < 1) return AZA_ERROR_INVALID_FRAME_COUNT;
+	if (channelLayout.count == 0) return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	data->frames = frames;
+	data->channelLayout = channelLayout;
+	// Keep every channel aligned to 64 bytes
+	data->channelStride = (uint32_t)aza_align(frames, 16);
+	data->samples = (float*)aza_calloc(data->channelStride * data->channelLayout.count, sizeof(float));
+	if (!data->samples) return AZA_ERROR_OUT_OF_MEMORY;
+	data->stride = 1;
 	return AZA_SUCCESS;
 }
 
@@ -111,15 +294,19 @@ void azaBufferDeinit(azaBuffer *data) {
 	aza_free(data->samples);
 }
 
+// The kernels want the channels in a frame to be adjacent. When they aren't we go one channel at a time, which for planar buffers means contiguous runs.
+static inline bool azaBuffersChannelsAdjacent(azaBuffer a, azaBuffer b) {
+	return (a.channelStride == 1 && b.channelStride == 1) || a.channelLayout.count == 1;
+}
+
 void azaBufferZero(azaBuffer buffer) {
+	azaBufferNormalize(&buffer);
 	if (buffer.samples && buffer.frames && buffer.channelLayout.count) {
-		if AZA_LIKELY(buffer.channelLayout.count == buffer.stride) {
-			memset(buffer.samples, 0, sizeof(float) * buffer.frames * buffer.channelLayout.count);
+		if (buffer.channelStride == 1 || buffer.channelLayout.count == 1) {
+			azaSIMDZero(buffer.samples, buffer.stride, buffer.frames, buffer.channelLayout.count);
 		} else {
-			for (uint32_t i = 0; i < buffer.frames * buffer.stride; i += buffer.stride) {
-				for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-					buffer.samples[i + c] = 0.0f;
-				}
+			for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+				azaSIMDZero(buffer.samples + c * buffer.channelStride, buffer.stride, buffer.frames, 1);
 			}
 		}
 	}
@@ -127,123 +314,78 @@ void azaBufferZero(azaBuffer buffer) {
 
 
 void azaBufferMix(azaBuffer dst, float volumeDst, azaBuffer src, float volumeSrc) {
+	azaBufferNormalize(&dst);
+	azaBufferNormalize(&src);
 	assert(dst.frames == src.frames);
 	assert(dst.channelLayout.count == src.channelLayout.count);
-	uint32_t channels = dst.channelLayout.count;
 	if AZA_UNLIKELY(volumeDst == 1.0f && volumeSrc == 0.0f) {
 		return;
 	} else if AZA_UNLIKELY(volumeDst == 0.0f && volumeSrc == 0.0f) {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			for (uint32_t c = 0; c < channels; c++) {
-				dst.samples[i * dst.stride + c] = 0.0f;
-			}
-		}
-	} else if (volumeDst == 1.0f && volumeSrc == 1.0f) {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			for (uint32_t c = 0; c < channels; c++) {
-				dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] + src.samples[i * src.stride + c];
-			}
-		}
-	} else if AZA_LIKELY(volumeDst == 1.0f) {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			for (uint32_t c = 0; c < channels; c++) {
-				dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] + src.samples[i * src.stride + c] * volumeSrc;
-			}
-		}
-	} else if (volumeSrc == 1.0f) {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			for (uint32_t c = 0; c < channels; c++) {
-				dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] * volumeDst + src.samples[i * src.stride + c];
-			}
-		}
+		azaBufferZero(dst);
+	} else if AZA_UNLIKELY(volumeDst == 0.0f && volumeSrc == 1.0f) {
+		azaBufferCopy(dst, src);
+	} else if (azaBuffersChannelsAdjacent(dst, src)) {
+		azaSIMDMix(dst.samples, dst.stride, volumeDst, src.samples, src.stride, volumeSrc, dst.frames, dst.channelLayout.count);
 	} else {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			for (uint32_t c = 0; c < channels; c++) {
-				dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] * volumeDst + src.samples[i * src.stride + c] * volumeSrc;
-			}
+		for (uint8_t c = 0; c < dst.channelLayout.count; c++) {
+			azaSIMDMix(dst.samples + c * dst.channelStride, dst.stride, volumeDst, src.samples + c * src.channelStride, src.stride, volumeSrc, dst.frames, 1);
 		}
 	}
 }
 
 void azaBufferMixFade(azaBuffer dst, float volumeDstStart, float volumeDstEnd, azaBuffer src, float volumeSrcStart, float volumeSrcEnd) {
+	azaBufferNormalize(&dst);
+	azaBufferNormalize(&src);
 	if (volumeDstStart == volumeDstEnd && volumeSrcStart == volumeSrcEnd) {
 		azaBufferMix(dst, volumeDstStart, src, volumeSrcStart);
 		return;
 	}
 	assert(dst.frames == src.frames);
 	assert(dst.channelLayout.count == src.channelLayout.count);
-	uint32_t channels = dst.channelLayout.count;
-	float volumeDstDelta = volumeDstEnd - volumeDstStart;
-	float volumeSrcDelta = volumeSrcEnd - volumeSrcStart;
 	float framesF = (float)dst.frames;
-	if (volumeDstDelta == 0.0f) {
-		if (volumeDstStart == 1.0f) {
-			for (uint32_t i = 0; i < dst.frames; i++) {
-				float t = (float)i / framesF;
-				float volumeSrc = volumeSrcStart + volumeSrcDelta * t;
-				for (uint32_t c = 0; c < channels; c++) {
-					dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] + src.samples[i * src.stride + c] * volumeSrc;
-				}
-			}
-		} else {
-			for (uint32_t i = 0; i < dst.frames; i++) {
-				float t = (float)i / framesF;
-				float volumeSrc = volumeSrcStart + volumeSrcDelta * t;
-				for (uint32_t c = 0; c < channels; c++) {
-					dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] * volumeDstStart + src.samples[i * src.stride + c] * volumeSrc;
-				}
-			}
-		}
+	float volumeDstStep = (volumeDstEnd - volumeDstStart) / framesF;
+	float volumeSrcStep = (volumeSrcEnd - volumeSrcStart) / framesF;
+	if (azaBuffersChannelsAdjacent(dst, src)) {
+		azaSIMDMixFade(dst.samples, dst.stride, volumeDstStart, volumeDstStep, src.samples, src.stride, volumeSrcStart, volumeSrcStep, dst.frames, dst.channelLayout.count);
 	} else {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			float t = (float)i / framesF;
-			float volumeDst = volumeDstStart + volumeDstDelta * t;
-			float volumeSrc = volumeSrcStart + volumeSrcDelta * t;
-			for (uint32_t c = 0; c < channels; c++) {
-				dst.samples[i * dst.stride + c] = dst.samples[i * dst.stride + c] * volumeDst + src.samples[i * src.stride + c] * volumeSrc;
-			}
+		for (uint8_t c = 0; c < dst.channelLayout.count; c++) {
+			azaSIMDMixFade(dst.samples + c * dst.channelStride, dst.stride, volumeDstStart, volumeDstStep, src.samples + c * src.channelStride, src.stride, volumeSrcStart, volumeSrcStep, dst.frames, 1);
 		}
 	}
 }
 
 void azaBufferCopy(azaBuffer dst, azaBuffer src) {
+	azaBufferNormalize(&dst);
+	azaBufferNormalize(&src);
 	assert(dst.frames == src.frames);
 	assert(dst.channelLayout.count == src.channelLayout.count);
-	if (dst.channelLayout.count == dst.stride && src.channelLayout.count == src.stride) {
-		memcpy(dst.samples, src.samples, sizeof(float) * src.frames * src.channelLayout.count);
+	uint8_t channels = src.channelLayout.count;
+	if (azaBuffersChannelsAdjacent(dst, src)) {
+		azaSIMDCopy(dst.samples, dst.stride, src.samples, src.stride, src.frames, channels);
+	} else if (dst.channelStride == 1 && src.stride == 1) {
+		azaSIMDInterleave(dst.samples, dst.stride, src.samples, src.channelStride, src.frames, channels);
+	} else if (src.channelStride == 1 && dst.stride == 1) {
+		azaSIMDDeinterleave(dst.samples, dst.channelStride, src.samples, src.stride, src.frames, channels);
 	} else {
-		for (uint32_t i = 0; i < src.frames; i++) {
-			for (uint8_t c = 0; c < src.channelLayout.count; c++) {
-				dst.samples[i * dst.stride + c] = src.samples[i * src.stride + c];
-			}
+		for (uint8_t c = 0; c < channels; c++) {
+			azaSIMDCopy(dst.samples + c * dst.channelStride, dst.stride, src.samples + c * src.channelStride, src.stride, src.frames, 1);
 		}
 	}
 }
 
 void azaBufferCopyChannel(azaBuffer dst, uint8_t channelDst, azaBuffer src, uint8_t channelSrc) {
+	azaBufferNormalize(&dst);
+	azaBufferNormalize(&src);
 	assert(dst.frames == src.frames);
 	assert(channelDst < dst.channelLayout.count);
 	assert(channelSrc < src.channelLayout.count);
-	if (dst.stride == 1 && src.stride == 1) {
-		memcpy(dst.samples, src.samples, sizeof(float) * dst.frames);
-	} else if (dst.stride == 1) {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			dst.samples[i] = src.samples[i * src.stride + channelSrc];
-		}
-	} else if (src.stride == 1) {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			dst.samples[i * dst.stride + channelDst] = src.samples[i];
-		}
-	} else {
-		for (uint32_t i = 0; i < dst.frames; i++) {
-			dst.samples[i * dst.stride + channelDst] = src.samples[i * src.stride + channelSrc];
-		}
-	}
+	azaSIMDCopy(dst.samples + channelDst * dst.channelStride, dst.stride, src.samples + channelSrc * src.channelStride, src.stride, dst.frames, 1);
 }
 
 
 
 int azaDSPProcessSingle(azaDSP *data, azaBuffer buffer) {
+	azaBufferNormalize(&buffer);
 	switch (data->kind) {
 		case AZA_DSP_USER_SINGLE: return azaDSPUserProcessSingle((azaDSPUser*)data, buffer);
 		case AZA_DSP_CUBIC_LIMITER: return azaCubicLimiterProcess((azaCubicLimiter*)data, buffer);
@@ -253,11 +395,16 @@ int azaDSPProcessSingle(azaDSP *data, azaBuffer buffer) {
 		case AZA_DSP_COMPRESSOR: return azaCompressorProcess((azaCompressor*)data, buffer);
 		case AZA_DSP_DELAY: return azaDelayProcess((azaDelay*)data, buffer);
 		case AZA_DSP_REVERB: return azaReverbProcess((azaReverb*)data, buffer);
+		case AZA_DSP_REVERB_FDN: return azaReverbFDNProcess((azaReverbFDN*)data, buffer);
+		case AZA_DSP_CONVOLUTION: return azaConvolutionProcess((azaConvolution*)data, buffer);
+		case AZA_DSP_FILTER_SVF: return azaFilterSVFProcess((azaFilterSVF*)data, buffer);
 		case AZA_DSP_SAMPLER: return azaSamplerProcess((azaSampler*)data, buffer);
+		case AZA_DSP_SAMPLER_BANK: return azaSamplerBankProcess((azaSamplerBank*)data, buffer);
 		case AZA_DSP_GATE: return azaGateProcess((azaGate*)data, buffer);
 		case AZA_DSP_DELAY_DYNAMIC: return azaDelayDynamicProcess((azaDelayDynamic*)data, buffer, NULL);
 
 		case AZA_DSP_SPATIALIZE:
+		case AZA_DSP_BINAURAL:
 			return AZA_ERROR_DSP_INTERFACE_NOT_GENERIC;
 
 		case AZA_DSP_USER_DUAL:
@@ -268,11 +415,14 @@ int azaDSPProcessSingle(azaDSP *data, azaBuffer buffer) {
 }
 
 int azaDSPProcessDual(azaDSP *data, azaBuffer dst, azaBuffer src) {
+	azaBufferNormalize(&dst);
+	azaBufferNormalize(&src);
 	switch (data->kind) {
 		case AZA_DSP_USER_DUAL: return azaDSPUserProcessDual((azaDSPUser*)data, dst, src);
 		case AZA_DSP_RMS: return azaRMSProcessDual((azaRMS*)data, dst, src);
 
 		case AZA_DSP_SPATIALIZE:
+		case AZA_DSP_BINAURAL:
 			return AZA_ERROR_DSP_INTERFACE_NOT_GENERIC;
 
 		default: return AZA_ERROR_INVALID_DSP_KIND;
@@ -375,19 +525,9 @@ static void* azaGetChannelData(azaDSPChannelData *data, uint8_t channel) {
 
 
 
-#define AZA_RMS_INLINE_BUFFER_SIZE 256
-
-static inline uint32_t azaRMSGetBufferCapNeeded(azaRMSConfig config, uint8_t channelCapInline) {
-	return (uint32_t)aza_grow(AZA_RMS_INLINE_BUFFER_SIZE, config.windowSamples * AZA_MAX(channelCapInline, 1), 32);
-}
-
-uint32_t azaRMSGetAllocSize(azaRMSConfig config, uint8_t channelCapInline) {
+uint32_t azaRMSGetAllocSize(uint8_t channelCapInline) {
 	size_t size = sizeof(azaRMS);
 	size = azaAddSizeWithAlign(size, channelCapInline * sizeof(azaRMSChannelData), alignof(azaRMSChannelData));
-	uint32_t bufferCapNeeded = azaRMSGetBufferCapNeeded(config, channelCapInline);
-	if (bufferCapNeeded <= AZA_RMS_INLINE_BUFFER_SIZE) {
-		size = aza_align(size + AZA_RMS_INLINE_BUFFER_SIZE * sizeof(float), alignof(azaRMS));
-	}
 	return (uint32_t)size;
 }
 
@@ -396,24 +536,18 @@ void azaRMSInit(azaRMS *data, uint32_t allocSize, azaRMSConfig config, uint8_t c
 	data->header.structSize = allocSize;
 	data->config = config;
 	azaDSPChannelDataInit(&data->channelData, channelCapInline, sizeof(azaRMSChannelData), alignof(azaRMSChannelData));
-
-	data->bufferCap = azaRMSGetBufferCapNeeded(config, channelCapInline);
-	if (data->bufferCap > AZA_RMS_INLINE_BUFFER_SIZE) {
-		data->buffer = aza_calloc(data->bufferCap, sizeof(float));
-	} else {
-		data->buffer = (float*)((char*)&data->buffer + sizeof(float*) + sizeof(azaDSPChannelData) + channelCapInline * sizeof(azaRMSChannelData));
-	}
 }
 
 void azaRMSDeinit(azaRMS *data) {
 	azaDSPChannelDataDeinit(&data->channelData);
-	if (data->bufferCap > AZA_RMS_INLINE_BUFFER_SIZE) {
+	if (data->buffer) {
 		aza_free(data->buffer);
+		data->buffer = NULL;
 	}
 }
 
 azaRMS* azaMakeRMS(azaRMSConfig config, uint8_t channelCapInline) {
-	uint32_t size = azaRMSGetAllocSize(config, channelCapInline);
+	uint32_t size = azaRMSGetAllocSize(channelCapInline);
 	azaRMS *result = aza_calloc(1, size);
 	if (result) azaRMSInit(result, size, config, channelCapInline);
 	return result;
@@ -424,49 +558,132 @@ void azaFreeRMS(azaRMS *data) {
 	aza_free(data);
 }
 
-static int azaHandleRMSBuffer(azaRMS *data, uint8_t channels) {
-	if (data->bufferCap < data->config.windowSamples * channels) {
-		uint32_t newBufferCap = (uint32_t)aza_grow(data->bufferCap, data->config.windowSamples * channels, 32);
-		float *newBuffer = aza_calloc(newBufferCap, sizeof(float));
-		if (!newBuffer) {
-			return AZA_ERROR_OUT_OF_MEMORY;
-		}
-		if (data->bufferCap > AZA_RMS_INLINE_BUFFER_SIZE) {
+static uint32_t azaRMSGetWindowFrames(azaRMS *data, uint32_t samplerate) {
+	float window = data->config.window > 0.0f ? data->config.window : AZAUDIO_RMS_DEFAULT_WINDOW_MS;
+	uint32_t windowFrames = (uint32_t)aza_ms_to_samples(window, (float)samplerate);
+	return AZA_MAX(windowFrames, 1);
+}
+
+static int azaRMSHandleBufferResizes(azaRMS *data, uint32_t samplerate, uint8_t channelCount) {
+	int err = AZA_SUCCESS;
+	err = azaEnsureChannels(&data->channelData, channelCount);
+	if (err) return err;
+	uint32_t windowFrames = azaRMSGetWindowFrames(data, samplerate);
+	if (data->buffer && data->windowFrames == windowFrames && data->channelCount == channelCount) return AZA_SUCCESS;
+	uint32_t size = windowFrames * channelCount;
+	if (size > data->bufferCap) {
+		float *newBuffer = aza_calloc(size, sizeof(float));
+		if (!newBuffer) return AZA_ERROR_OUT_OF_MEMORY;
+		if (data->buffer) {
 			aza_free(data->buffer);
 		}
-		data->bufferCap = newBufferCap;
 		data->buffer = newBuffer;
+		data->bufferCap = size;
+	} else {
+		memset(data->buffer, 0, sizeof(float) * size);
+	}
+	data->windowFrames = windowFrames;
+	data->channelCount = channelCount;
+	data->index = 0;
+	for (uint8_t c = 0; c < channelCount; c++) {
+		azaRMSChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		channelData->squaredSum = 0.0f;
+		channelData->squaredSumLap = 0.0f;
 	}
 	return AZA_SUCCESS;
 }
 
+// Runs the window over src, putting the RMS into dst, one contiguous run of the ring at a time. Both have data->channelCount channels.
+static void azaRMSUpdate(azaRMS *data, azaBuffer dst, azaBuffer src, float scale) {
+	uint8_t channels = data->channelCount;
+	// Gather the sums so the kernel can load them a whole group of channels at a time
+	float sums[UINT8_MAX];
+	float lapSums[UINT8_MAX];
+	for (uint8_t c = 0; c < channels; c++) {
+		azaRMSChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		sums[c] = channelData->squaredSum;
+		lapSums[c] = channelData->squaredSumLap;
+	}
+	bool adjacent = azaBuffersChannelsAdjacent(dst, src);
+	for (uint32_t i = 0; i < src.frames;) {
+		uint32_t run = AZA_MIN(src.frames - i, data->windowFrames - data->index);
+		float *ring = data->buffer + data->index * channels;
+		float *dstRun = dst.samples + i * dst.stride;
+		const float *srcRun = src.samples + i * src.stride;
+		if (adjacent) {
+			azaSIMDRMS(dstRun, dst.stride, srcRun, src.stride, ring, channels, sums, lapSums, scale, run, channels);
+		} else {
+			for (uint8_t c = 0; c < channels; c++) {
+				azaSIMDRMS(dstRun + c * dst.channelStride, dst.stride, srcRun + c * src.channelStride, src.stride, ring + c, channels, sums + c, lapSums + c, scale, run, 1);
+			}
+		}
+		i += run;
+		data->index += run;
+		if (data->index == data->windowFrames) {
+			data->index = 0;
+			// Start the running sums over from what's actually in the window so rounding error can't build up
+			for (uint8_t c = 0; c < channels; c++) {
+				sums[c] = lapSums[c];
+				lapSums[c] = 0.0f;
+			}
+		}
+	}
+	for (uint8_t c = 0; c < channels; c++) {
+		azaRMSChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		channelData->squaredSum = sums[c];
+		channelData->squaredSumLap = lapSums[c];
+	}
+}
+
 int azaRMSProcessDual(azaRMS *data, azaBuffer dst, azaBuffer src) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(dst);
+	err = azaCheckBuffer(&dst);
 	if (err) return err;
-	err = azaCheckBuffer(src);
+	err = azaCheckBuffer(&src);
 	if (err) return err;
-	err = azaHandleRMSBuffer(data, 1);
+	err = azaRMSHandleBufferResizes(data, src.samplerate, 1);
 	if (err) return err;
-	err = azaEnsureChannels(&data->channelData, 1);
-	if (err) return err;
-	azaRMSChannelData *channelData = azaGetChannelData(&data->channelData, 0);
-	float *channelBuffer = data->buffer;
+	// Combine the channels into dst's first channel, and then run the window over that in place
+	azaBuffer combined = azaBufferOneChannel(dst, 0);
+	combined.frames = src.frames;
 	fp_azaOp op = data->config.combineOp ? data->config.combineOp : azaOpMax;
-	for (size_t i = 0; i < src.frames; i++) {
-		channelData->squaredSum -= channelBuffer[data->index];
-		channelBuffer[data->index] = 0.0f;
-		for (size_t c = 0; c < src.channelLayout.count; c++) {
-			op(&channelBuffer[data->index], azaSqr(src.samples[i * src.stride + c]));
-		}
-		channelData->squaredSum += channelBuffer[data->index];
-		// Deal with potential rounding errors making sqrtf emit NaNs
-		if (channelData->squaredSum < 0.0f) channelData->squaredSum = 0.0f;
-		dst.samples[i * dst.stride] = sqrtf(channelData->squaredSum/(data->config.windowSamples * src.channelLayout.count));
-		if (++data->index >= data->config.windowSamples)
-			data->index = 0;
+	if (op == azaOpMax) {
+		// The biggest square belongs to the biggest magnitude, so we can skip squaring here
+		if (src.channelStride == 1) {
+			for (uint32_t i = 0; i < src.frames; i++) {
+				const float *frame = src.samples + i * src.stride;
+				float peak = azaAbs(frame[0]);
+				for (uint8_t c = 1; c < src.channelLayout.count; c++) {
+					peak = AZA_MAX(peak, azaAbs(frame[c]));
+				}
+				combined.samples[i * combined.stride] = peak;
+			}
+		} else {
+			// Going one channel at a time keeps planar buffers contiguous
+			for (uint32_t i = 0; i < src.frames; i++) {
+				combined.samples[i * combined.stride] = azaAbs(src.samples[i * src.stride]);
+			}
+			for (uint8_t c = 1; c < src.channelLayout.count; c++) {
+				const float *channel = src.samples + c * src.channelStride;
+				for (uint32_t i = 0; i < src.frames; i++) {
+					float *sample = &combined.samples[i * combined.stride];
+					*sample = AZA_MAX(*sample, azaAbs(channel[i * src.stride]));
+				}
+			}
+		}
+	} else {
+		for (uint32_t i = 0; i < src.frames; i++) {
+			float combinedSquare = 0.0f;
+			for (uint8_t c = 0; c < src.channelLayout.count; c++) {
+				op(&combinedSquare, azaSqr(src.samples[i * src.stride + c * src.channelStride]));
+			}
+			// The window squares it again
+			combined.samples[i * combined.stride] = sqrtf(AZA_MAX(combinedSquare, 0.0f));
+		}
 	}
+	azaRMSUpdate(data, combined, combined, 1.0f / (float)(data->windowFrames * src.channelLayout.count));
+	data->channelData.countActive = 1;
 	if (data->header.pNext) {
 		return azaDSPProcessSingle(data->header.pNext, dst);
 	}
@@ -476,30 +693,12 @@ int azaRMSProcessDual(azaRMS *data, azaBuffer dst, azaBuffer src) {
 int azaRMSProcessSingle(azaRMS *data, azaBuffer buffer) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+	err = azaCheckBuffer(&buffer);
 	if (err) return err;
-	err = azaHandleRMSBuffer(data, buffer.channelLayout.count);
+	err = azaRMSHandleBufferResizes(data, buffer.samplerate, buffer.channelLayout.count);
 	if (err) return err;
-	err = azaEnsureChannels(&data->channelData, buffer.channelLayout.count);
-	if (err) return err;
-	for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-		azaRMSChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		float *channelBuffer = &data->buffer[data->config.windowSamples * c];
-
-		for (uint32_t i = 0; i < buffer.frames; i++) {
-			uint32_t s = i * buffer.stride + c;
-			channelData->squaredSum -= channelBuffer[data->index];
-			channelBuffer[data->index] = azaSqr(buffer.samples[s]);
-			channelData->squaredSum += channelBuffer[data->index];
-			// Deal with potential rounding errors making sqrtf emit NaNs
-			if (channelData->squaredSum < 0.0f) channelData->squaredSum = 0.0f;
-
-			if (++data->index >= data->config.windowSamples)
-				data->index = 0;
-
-			buffer.samples[s] = sqrtf(channelData->squaredSum/data->config.windowSamples);
-		}
-	}
+	azaRMSUpdate(data, buffer, buffer, 1.0f / (float)data->windowFrames);
+	data->channelData.countActive = buffer.channelLayout.count;
 	if (data->header.pNext) {
 		return azaDSPProcessSingle(data->header.pNext, buffer);
 	}
@@ -534,16 +733,16 @@ void azaFreeCubicLimiter(azaCubicLimiter *data) {
 }
 
 int azaCubicLimiterProcess(azaCubicLimiter *data, azaBuffer buffer) {
-	int err = azaCheckBuffer(buffer);
+	int err = azaCheckBuffer(&buffer);
 	if (err) return err;
-	if (buffer.stride == buffer.channelLayout.count) {
+	if (buffer.stride == buffer.channelLayout.count && buffer.channelStride == 1) {
 		for (size_t i = 0; i < buffer.frames*buffer.channelLayout.count; i++) {
 			buffer.samples[i] = azaCubicLimiterSample(buffer.samples[i]);
 		}
 	} else {
 		for (size_t c = 0; c < buffer.channelLayout.count; c++) {
 			for (size_t i = 0; i < buffer.frames; i++) {
-				size_t s = i * buffer.stride + c;
+				size_t s = i * buffer.stride + c * buffer.channelStride;
 				buffer.samples[s] = azaCubicLimiterSample(buffer.samples[s]);
 			}
 		}
@@ -567,6 +766,10 @@ void azaLookaheadLimiterInit(azaLookaheadLimiter *data, uint32_t allocSize, azaL
 }
 
 void azaLookaheadLimiterDeinit(azaLookaheadLimiter *data) {
+	if (data->buffer) {
+		aza_free(data->buffer);
+		data->buffer = NULL;
+	}
 	azaDSPChannelDataDeinit(&data->channelData);
 }
 
@@ -582,74 +785,162 @@ void azaFreeLookaheadLimiter(azaLookaheadLimiter *data) {
 	aza_free(data);
 }
 
+static uint32_t azaLookaheadLimiterGetLookaheadFrames(azaLookaheadLimiter *data, uint32_t samplerate) {
+	float lookahead = data->config.lookahead > 0.0f ? data->config.lookahead : AZAUDIO_LOOKAHEAD_LIMITER_DEFAULT_LOOKAHEAD_MS;
+	uint32_t lookaheadFrames = (uint32_t)aza_ms_to_samples(lookahead, (float)samplerate);
+	return AZA_MAX(lookaheadFrames, 1);
+}
+
+static int azaLookaheadLimiterHandleBufferResizes(azaLookaheadLimiter *data, uint32_t samplerate, uint8_t channelCount) {
+	int err = AZA_SUCCESS;
+	err = azaEnsureChannels(&data->channelData, channelCount);
+	if (err) return err;
+	uint32_t lookaheadFrames = azaLookaheadLimiterGetLookaheadFrames(data, samplerate);
+	if (data->buffer && data->lookaheadFrames == lookaheadFrames && data->channelCount == channelCount) return AZA_SUCCESS;
+	uint32_t windowFrames = lookaheadFrames + 1;
+	size_t delaySize = sizeof(float) * lookaheadFrames * channelCount;
+	size_t peaksSize = sizeof(azaLookaheadLimiterPeak) * windowFrames;
+	size_t windowSize = sizeof(float) * windowFrames;
+	size_t size = delaySize + peaksSize + windowSize;
+	if (size > data->bufferCap) {
+		void *newBuffer = aza_calloc(1, size);
+		if (!newBuffer) return AZA_ERROR_OUT_OF_MEMORY;
+		if (data->buffer) {
+			aza_free(data->buffer);
+		}
+		data->buffer = newBuffer;
+		data->bufferCap = size;
+	} else {
+		memset(data->buffer, 0, size);
+	}
+	char *memory = data->buffer;
+	for (uint8_t c = 0; c < channelCount; c++) {
+		azaLookaheadLimiterChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		channelData->delay = (float*)memory + c * lookaheadFrames;
+	}
+	data->peaks = (azaLookaheadLimiterPeak*)(memory + delaySize);
+	data->window = (float*)(memory + delaySize + peaksSize);
+	data->lookaheadFrames = lookaheadFrames;
+	data->channelCount = channelCount;
+	data->peakFirst = 0;
+	data->peakCount = 0;
+	data->frame = 0;
+	data->windowIndex = 0;
+	data->windowSum = 0.0;
+	data->delayIndex = 0;
+	data->attenuation = 0.0f;
+	return AZA_SUCCESS;
+}
+
 int azaLookaheadLimiterProcess(azaLookaheadLimiter *data, azaBuffer buffer) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+	err = azaCheckBuffer(&buffer);
 	if (err) return err;
-	err = azaEnsureChannels(&data->channelData, buffer.channelLayout.count);
+	uint8_t channels = buffer.channelLayout.count;
+	err = azaLookaheadLimiterHandleBufferResizes(data, buffer.samplerate, channels);
 	if (err) return err;
-	azaBuffer gainBuffer;
-	gainBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
-	memset(gainBuffer.samples, 0, sizeof(float) * gainBuffer.frames);
+	azaScratchMark mark = azaMarkSideBuffers();
+	azaBuffer gainBuffer = azaPushSideBufferZero(buffer.frames, 1, buffer.samplerate);
+	azaBuffer delayedBuffer = azaPushSideBufferLike(buffer, buffer.frames, channels);
+	if (!gainBuffer.samples || !delayedBuffer.samples) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto done;
+	}
 	// TODO: It may be desirable to prevent the subwoofer channel from affecting the rest, and it may want its own independent limiter.
-	int index = data->index;
-	// Do all the gain calculations and put them into gainBuffer
-	for (uint32_t i = 0; i < buffer.frames; i++) {
-		for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-			float sample = azaAbs(buffer.samples[i * buffer.stride + c]);
+	// Find the peaks across all channels, one channel at a time so planar buffers are read contiguously
+	for (uint8_t c = 0; c < channels; c++) {
+		const float *src = buffer.samples + c * buffer.channelStride;
+		for (uint32_t i = 0; i < buffer.frames; i++) {
+			float sample = azaAbs(src[i * buffer.stride]);
 			gainBuffer.samples[i] = AZA_MAX(sample, gainBuffer.samples[i]);
 		}
-		float gain = data->config.gainInput;
-		float peak = AZA_MAX(aza_amp_to_dbf(gainBuffer.samples[i]) + gain, 0.0f);
-		float slope = (peak - data->sum) / AZAUDIO_LOOKAHEAD_SAMPLES;
-		if (slope > 0.0f && slope > data->slope) {
-			data->slope = slope;
-			data->cooldown = AZAUDIO_LOOKAHEAD_SAMPLES;
-		} else if (data->cooldown == 0 && data->sum > 0.0f) {
-			data->slope = -data->sum / (AZAUDIO_LOOKAHEAD_SAMPLES * 5.0f);
-			for (int index2 = 0; index2 < AZAUDIO_LOOKAHEAD_SAMPLES; index2++) {
-				float peak2 = data->peakBuffer[(index+index2)%AZAUDIO_LOOKAHEAD_SAMPLES];
-				float slope2 = (peak2 - data->sum) / (float)(index2+1);
-				if (slope2 > 0.0f && slope2 > data->slope) {
-					data->slope = slope2;
-					data->cooldown = index2+1;
-				}
-			}
-		} else if (data->cooldown > 0) {
-			data->cooldown -= 1;
+	}
+	// Do all the gain calculations in dB and put them into gainBuffer, converting to and from amplitude a block at a time
+	azaSIMDAmpToDb(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+	uint32_t windowFrames = data->lookaheadFrames + 1;
+	double windowScale = 1.0 / (double)windowFrames;
+	float release = data->config.release > 0.0f ? data->config.release : AZAUDIO_LOOKAHEAD_LIMITER_DEFAULT_RELEASE_MS;
+	float releaseFactor = azaFastExpf(-1.0f / aza_ms_to_samples(release, (float)buffer.samplerate));
+	// Input and output gain get folded into the gain we apply
+	float gainTotal = data->config.gainInput + data->config.gainOutput;
+	for (uint32_t i = 0; i < buffer.frames; i++) {
+		float peak = AZA_MAX(gainBuffer.samples[i] + data->config.gainInput, 0.0f);
+		// The first peak is the only one that can be old enough to leave the window, since they're in order of arrival
+		if (data->peakCount && data->frame - data->peaks[data->peakFirst].frame >= windowFrames) {
+			data->peakFirst = data->peakFirst+1 == windowFrames ? 0 : data->peakFirst+1;
+			data->peakCount--;
+		}
+		// Anything no bigger than the new peak will leave the window before it does, so it can never be the maximum again
+		while (data->peakCount) {
+			uint32_t last = data->peakFirst + data->peakCount - 1;
+			if (last >= windowFrames) last -= windowFrames;
+			if (data->peaks[last].attenuation > peak) break;
+			data->peakCount--;
 		}
-		data->sum += data->slope;
-		if (data->sum < 0.0f) {
-			data->slope = 0.0f;
-			data->sum = 0.0f;
+		uint32_t next = data->peakFirst + data->peakCount;
+		if (next >= windowFrames) next -= windowFrames;
+		data->peaks[next].attenuation = peak;
+		data->peaks[next].frame = data->frame;
+		data->peakCount++;
+		data->frame++;
+		float held = data->peaks[data->peakFirst].attenuation;
+		data->windowSum += held - data->window[data->windowIndex];
+		data->window[data->windowIndex] = held;
+		if (++data->windowIndex == windowFrames) {
+			data->windowIndex = 0;
+			// Start the running sum over once per lap so rounding error can't build up
+			double sum = 0.0;
+			for (uint32_t j = 0; j < windowFrames; j++) {
+				sum += data->window[j];
+			}
+			data->windowSum = sum;
 		}
-		data->peakBuffer[index] = peak;
-		index = (index+1)%AZAUDIO_LOOKAHEAD_SAMPLES;
-		gainBuffer.samples[i] = aza_db_to_ampf(-data->sum);
+		float ramp = (float)(data->windowSum * windowScale);
+		// Never below the ramp, so peaks are always fully attenuated, and otherwise decaying exponentially
+		data->attenuation = AZA_MAX(ramp, data->attenuation * releaseFactor);
+		gainBuffer.samples[i] = gainTotal - data->attenuation;
 	}
-	float amountInput = aza_db_to_ampf(data->config.gainInput);
-	float amountOutput = aza_db_to_ampf(data->config.gainOutput);
-	// Apply the gain from gainBuffer to all the channels
-	for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-		azaLookaheadLimiterChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		index = data->index;
-
-		for (uint32_t i = 0; i < buffer.frames; i++) {
-			uint32_t s = i * buffer.stride + c;
-			channelData->valBuffer[index] = buffer.samples[s];
-			index = (index+1)%AZAUDIO_LOOKAHEAD_SAMPLES;
-			float out = azaClampf(channelData->valBuffer[index] * gainBuffer.samples[i] * amountInput, -1.0f, 1.0f);
-			buffer.samples[s] = out * amountOutput;
+	azaSIMDDbToAmp(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+	// Swap the new input into the delay lines and take the delayed samples out, a contiguous run of the rings at a time
+	azaLookaheadLimiterChannelData *firstChannel = azaGetChannelData(&data->channelData, 0);
+	azaBuffer delayLines = {
+		.samples = firstChannel->delay,
+		.samplerate = buffer.samplerate,
+		.frames = data->lookaheadFrames,
+		.stride = 1,
+		.channelStride = data->lookaheadFrames,
+		.channelLayout = buffer.channelLayout,
+	};
+	uint32_t delayIndex = data->delayIndex;
+	for (uint32_t i = 0; i < buffer.frames;) {
+		uint32_t run = AZA_MIN(buffer.frames - i, data->lookaheadFrames - delayIndex);
+		azaBuffer delaySlice = azaBufferSlice(delayLines, delayIndex, run);
+		azaBufferCopy(azaBufferSlice(delayedBuffer, i, run), delaySlice);
+		azaBufferCopy(delaySlice, azaBufferSlice(buffer, i, run));
+		i += run;
+		delayIndex += run;
+		if (delayIndex == data->lookaheadFrames) delayIndex = 0;
+	}
+	data->delayIndex = delayIndex;
+	// Apply the gain from gainBuffer to all the channels. The clamp only ever catches rounding error, since the attenuation already covers every peak.
+	float limit = aza_db_to_ampf(data->config.gainOutput);
+	if (azaBuffersChannelsAdjacent(buffer, delayedBuffer)) {
+		azaSIMDApplyGain(buffer.samples, buffer.stride, delayedBuffer.samples, delayedBuffer.stride, gainBuffer.samples, limit, buffer.frames, channels);
+	} else {
+		for (uint8_t c = 0; c < channels; c++) {
+			azaSIMDApplyGain(buffer.samples + c * buffer.channelStride, buffer.stride, delayedBuffer.samples + c * delayedBuffer.channelStride, delayedBuffer.stride, gainBuffer.samples, limit, buffer.frames, 1);
 		}
 	}
-	data->index = index;
-	data->channelData.countActive = buffer.channelLayout.count;
-	azaPopSideBuffer();
+	data->channelData.countActive = channels;
+	azaReleaseSideBuffers(mark);
 	if (data->header.pNext) {
 		return azaDSPProcessSingle(data->header.pNext, buffer);
 	}
 	return AZA_SUCCESS;
+done:
+	azaReleaseSideBuffers(mark);
+	return err;
 }
 
 
@@ -686,7 +977,7 @@ void azaFreeFilter(azaFilter *data) {
 int azaFilterProcess(azaFilter *data, azaBuffer buffer) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+	err = azaCheckBuffer(&buffer);
 	if (err) return err;
 	err = azaEnsureChannels(&data->channelData, buffer.channelLayout.count);
 	if (err) return err;
@@ -699,7 +990,7 @@ int azaFilterProcess(azaFilter *data, azaBuffer buffer) {
 			case AZA_FILTER_HIGH_PASS: {
 				float decay = azaClampf(expf(-AZA_TAU * (data->config.frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
 				for (uint32_t i = 0; i < buffer.frames; i++) {
-					uint32_t s = i * buffer.stride + c;
+					uint32_t s = i * buffer.stride + c * buffer.channelStride;
 					channelData->outputs[0] = buffer.samples[s] + decay * (channelData->outputs[0] - buffer.samples[s]);
 					buffer.samples[s] = (buffer.samples[s] - channelData->outputs[0]) * amount + buffer.samples[s] * amountDry;
 				}
@@ -707,7 +998,7 @@ int azaFilterProcess(azaFilter *data, azaBuffer buffer) {
 			case AZA_FILTER_LOW_PASS: {
 				float decay = azaClampf(expf(-AZA_TAU * (data->config.frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
 				for (uint32_t i = 0; i < buffer.frames; i++) {
-					uint32_t s = i * buffer.stride + c;
+					uint32_t s = i * buffer.stride + c * buffer.channelStride;
 					channelData->outputs[0] = buffer.samples[s] + decay * (channelData->outputs[0] - buffer.samples[s]);
 					buffer.samples[s] = channelData->outputs[0] * amount + buffer.samples[s] * amountDry;
 				}
@@ -716,7 +1007,7 @@ int azaFilterProcess(azaFilter *data, azaBuffer buffer) {
 				float decayLow = azaClampf(expf(-AZA_TAU * (data->config.frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
 				float decayHigh = azaClampf(expf(-AZA_TAU * (data->config.frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
 				for (uint32_t i = 0; i < buffer.frames; i++) {
-					uint32_t s = i * buffer.stride + c;
+					uint32_t s = i * buffer.stride + c * buffer.channelStride;
 					channelData->outputs[0] = buffer.samples[s] + decayLow * (channelData->outputs[0] - buffer.samples[s]);
 					channelData->outputs[1] = channelData->outputs[0] + decayHigh * (channelData->outputs[1] - channelData->outputs[0]);
 					buffer.samples[s] = (channelData->outputs[0] - channelData->outputs[1]) * 2.0f * amount + buffer.samples[s] * amountDry;
@@ -732,10 +1023,206 @@ int azaFilterProcess(azaFilter *data, azaBuffer buffer) {
 }
 
 
+uint32_t azaFilterSVFGetAllocSize(uint8_t channelCapInline) {
+	size_t size = sizeof(azaFilterSVF);
+	size = azaAddSizeWithAlign(size, channelCapInline * sizeof(azaFilterSVFChannelData), alignof(azaFilterSVFChannelData));
+	return (uint32_t)size;
+}
+
+void azaFilterSVFInit(azaFilterSVF *data, uint32_t allocSize, azaFilterSVFConfig config, uint8_t channelCapInline) {
+	data->header.kind = AZA_DSP_FILTER_SVF;
+	data->header.structSize = allocSize;
+	data->config = config;
+	// Forces the coefficients to be computed on the first process
+	data->samplerateCoefficients = 0;
+	azaDSPChannelDataInit(&data->channelData, channelCapInline, sizeof(azaFilterSVFChannelData), alignof(azaFilterSVFChannelData));
+}
+
+void azaFilterSVFDeinit(azaFilterSVF *data) {
+	azaDSPChannelDataDeinit(&data->channelData);
+}
+
+azaFilterSVF* azaMakeFilterSVF(azaFilterSVFConfig config, uint8_t channelCapInline) {
+	uint32_t size = azaFilterSVFGetAllocSize(channelCapInline);
+	azaFilterSVF *result = aza_calloc(1, size);
+	if (result) azaFilterSVFInit(result, size, config, channelCapInline);
+	return result;
+}
+
+void azaFreeFilterSVF(azaFilterSVF *data) {
+	azaFilterSVFDeinit(data);
+	aza_free(data);
+}
+
+// Coefficients follow Andrew Simper's "Linear Trapezoidal Integrated SVF" paper
+static void azaFilterSVFUpdateCoefficients(azaFilterSVF *data, uint32_t samplerate) {
+	if (data->samplerateCoefficients == samplerate && memcmp(&data->configCoefficients, &data->config, sizeof(data->config)) == 0) return;
+	azaFilterSVFConfig config = data->config;
+	data->configCoefficients = config;
+	data->samplerateCoefficients = samplerate;
+	data->sectionCount = config.slope == AZA_FILTER_SVF_24DB ? 2 : 1;
+	// tan blows up as we approach nyquist
+	float frequency = azaClampf(config.frequency, 1.0f, (float)samplerate * 0.49f);
+	float g = tanf(AZA_PI * frequency / (float)samplerate);
+	float q = config.q > 0.0f ? AZA_MAX(config.q, 0.01f) : 0.70710678f;
+	// Split the gain between sections so they add up to config.gain
+	float A = powf(10.0f, config.gain / (40.0f * (float)data->sectionCount));
+	for (uint8_t s = 0; s < data->sectionCount; s++) {
+		azaSIMDSVFCoefficients *coefficients = &data->coefficients[s];
+		float qSection = q;
+		if (data->sectionCount == 2 && (config.kind == AZA_FILTER_SVF_LOW_PASS || config.kind == AZA_FILTER_SVF_HIGH_PASS)) {
+			// Pole pairs of a 4th order Butterworth, scaled so q means the same thing it does for 12dB
+			static const float butterworth[2] = { 0.54119610f, 1.30656296f };
+			qSection = q * butterworth[s] / 0.70710678f;
+		}
+		float k = 1.0f / qSection;
+		float gSection = g;
+		float m0 = 0.0f, m1 = 0.0f, m2 = 0.0f;
+		switch (config.kind) {
+			case AZA_FILTER_SVF_LOW_PASS:
+				m0 = 0.0f;
+				m1 = 0.0f;
+				m2 = 1.0f;
+				break;
+			case AZA_FILTER_SVF_HIGH_PASS:
+				m0 = 1.0f;
+				m1 = -k;
+				m2 = -1.0f;
+				break;
+			case AZA_FILTER_SVF_BAND_PASS:
+				m0 = 0.0f;
+				m1 = k;
+				m2 = 0.0f;
+				break;
+			case AZA_FILTER_SVF_NOTCH:
+				m0 = 1.0f;
+				m1 = -k;
+				m2 = 0.0f;
+				break;
+			case AZA_FILTER_SVF_PEAK:
+				k = 1.0f / (qSection * A);
+				m0 = 1.0f;
+				m1 = k * (A * A - 1.0f);
+				m2 = 0.0f;
+				break;
+			case AZA_FILTER_SVF_LOW_SHELF:
+				gSection = g / sqrtf(A);
+				m0 = 1.0f;
+				m1 = k * (A - 1.0f);
+				m2 = A * A - 1.0f;
+				break;
+			case AZA_FILTER_SVF_HIGH_SHELF:
+				gSection = g * sqrtf(A);
+				m0 = A * A;
+				m1 = k * (1.0f - A) * A;
+				m2 = 1.0f - A * A;
+				break;
+		}
+		float a1 = 1.0f / (1.0f + gSection * (gSection + k));
+		float a2 = gSection * a1;
+		float a3 = gSection * a2;
+		// Per sample the SVF does:
+		// v3 = in - ic2eq
+		// v1 = a1 * ic1eq + a2 * v3
+		// v2 = ic2eq + a2 * ic1eq + a3 * v3
+		// ic1eq, ic2eq = 2 * v1 - ic1eq, 2 * v2 - ic2eq
+		// out = m0 * in + m1 * v1 + m2 * v2
+		// which we expand into something with a shorter dependency chain.
+		coefficients->a11 = 2.0f * a1 - 1.0f;
+		coefficients->a12 = -2.0f * a2;
+		coefficients->a21 = 2.0f * a2;
+		coefficients->a22 = 1.0f - 2.0f * a3;
+		coefficients->b1 = 2.0f * a2;
+		coefficients->b2 = 2.0f * a3;
+		coefficients->c1 = m1 * a1 + m2 * a2;
+		coefficients->c2 = m2 * (1.0f - a3) - m1 * a2;
+		coefficients->d = m0 + m1 * a2 + m2 * a3;
+	}
+}
+
+int azaFilterSVFProcess(azaFilterSVF *data, azaBuffer buffer) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	uint8_t channels = buffer.channelLayout.count;
+	err = azaEnsureChannels(&data->channelData, channels);
+	if (err) return err;
+	azaFilterSVFUpdateCoefficients(data, buffer.samplerate);
+	float amount = azaClampf(1.0f - data->config.dryMix, 0.0f, 1.0f);
+	float amountDry = azaClampf(data->config.dryMix, 0.0f, 1.0f);
+	uint8_t sectionCount = data->sectionCount;
+	azaSIMDSVFCoefficients coefficients[AZAUDIO_FILTER_SVF_MAX_SECTIONS];
+	memcpy(coefficients, data->coefficients, sizeof(coefficients));
+	// The wet amount goes into the last section's output mix. With one section the dry amount can go in there too, otherwise we keep a copy of the input around to mix back in.
+	azaSIMDSVFCoefficients *last = &coefficients[sectionCount-1];
+	last->c1 *= amount;
+	last->c2 *= amount;
+	last->d *= amount;
+	bool mixDry = sectionCount > 1 && amountDry > 0.0f;
+	if (!mixDry) {
+		last->d += amountDry;
+	}
+	azaScratchMark mark = azaMarkSideBuffers();
+	azaBuffer dryBuffer = {0};
+	if (mixDry) {
+		dryBuffer = azaPushSideBufferCopy(buffer);
+		if (!dryBuffer.samples) {
+			err = AZA_ERROR_OUT_OF_MEMORY;
+			goto done;
+		}
+	}
+	// The kernel wants all the channels of a frame side by side, so planar buffers get interleaved for the duration
+	azaBuffer work = buffer;
+	if (!azaBuffersChannelsAdjacent(buffer, buffer)) {
+		work = azaPushSideBuffer(buffer.frames, channels, buffer.samplerate);
+		if (!work.samples) {
+			err = AZA_ERROR_OUT_OF_MEMORY;
+			goto done;
+		}
+		azaBufferCopy(work, buffer);
+	}
+	// Gather the states so the kernel can load them a whole group of channels at a time
+	float ic1eq[AZAUDIO_FILTER_SVF_MAX_SECTIONS * UINT8_MAX];
+	float ic2eq[AZAUDIO_FILTER_SVF_MAX_SECTIONS * UINT8_MAX];
+	for (uint8_t c = 0; c < channels; c++) {
+		azaFilterSVFChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		for (uint8_t s = 0; s < sectionCount; s++) {
+			ic1eq[s * channels + c] = channelData->ic1eq[s];
+			ic2eq[s * channels + c] = channelData->ic2eq[s];
+		}
+	}
+	azaSIMDSVF(work.samples, work.stride, coefficients, sectionCount, ic1eq, ic2eq, channels, work.frames, channels);
+	for (uint8_t c = 0; c < channels; c++) {
+		azaFilterSVFChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		for (uint8_t s = 0; s < sectionCount; s++) {
+			channelData->ic1eq[s] = ic1eq[s * channels + c];
+			channelData->ic2eq[s] = ic2eq[s * channels + c];
+		}
+	}
+	if (work.samples != buffer.samples) {
+		azaBufferCopy(buffer, work);
+	}
+	if (mixDry) {
+		azaBufferMix(buffer, 1.0f, dryBuffer, amountDry);
+	}
+	data->channelData.countActive = channels;
+	azaReleaseSideBuffers(mark);
+	if (data->header.pNext) {
+		return azaDSPProcessSingle(data->header.pNext, buffer);
+	}
+	return AZA_SUCCESS;
+done:
+	azaReleaseSideBuffers(mark);
+	return err;
+}
+
+
+
 
 uint32_t azaCompressorGetAllocSize(uint8_t channelCapInline) {
 	size_t size = sizeof(azaCompressor) - sizeof(azaRMS);
-	size = azaAddSizeWithAlign(size, azaRMSGetAllocSize((azaRMSConfig) { 128 }, channelCapInline), alignof(azaRMS));
+	size = azaAddSizeWithAlign(size, azaRMSGetAllocSize(1), alignof(azaRMS));
 	return (uint32_t)size;
 }
 
@@ -744,10 +1231,10 @@ void azaCompressorInit(azaCompressor *data, uint32_t allocSize, azaCompressorCon
 	data->header.structSize = allocSize;
 	data->config = config;
 	azaRMSConfig rmsConfig = (azaRMSConfig) {
-		.windowSamples = 128,
+		.window = AZAUDIO_RMS_DEFAULT_WINDOW_MS,
 		.combineOp = azaOpMax
 	};
-	azaRMSInit(&data->rms, azaRMSGetAllocSize(rmsConfig, 1), rmsConfig, 1);
+	azaRMSInit(&data->rms, azaRMSGetAllocSize(1), rmsConfig, 1);
 }
 
 void azaCompressorDeinit(azaCompressor *data) {
@@ -769,14 +1256,17 @@ void azaFreeCompressor(azaCompressor *data) {
 int azaCompressorProcess(azaCompressor *data, azaBuffer buffer) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+	err = azaCheckBuffer(&buffer);
 	if (err) return err;
 	azaBuffer rmsBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
 	err = azaRMSProcessDual(&data->rms, rmsBuffer, buffer);
-	if (err) return err;
+	if (err) {
+		azaPopSideBuffer();
+		return err;
+	}
 	float t = (float)buffer.samplerate / 1000.0f;
-	float attackFactor = expf(-1.0f / (data->config.attack * t));
-	float decayFactor = expf(-1.0f / (data->config.decay * t));
+	float attackFactor = azaFastExpf(-1.0f / (data->config.attack * t));
+	float decayFactor = azaFastExpf(-1.0f / (data->config.decay * t));
 	float overgainFactor;
 	if (data->config.ratio > 1.0f) {
 		overgainFactor = (1.0f - 1.0f / data->config.ratio);
@@ -785,8 +1275,9 @@ int azaCompressorProcess(azaCompressor *data, azaBuffer buffer) {
 	} else {
 		overgainFactor = 0.0f;
 	}
+	azaSIMDAmpToDb(rmsBuffer.samples, rmsBuffer.samples, buffer.frames);
 	for (size_t i = 0; i < buffer.frames; i++) {
-		float rms = aza_amp_to_dbf(rmsBuffer.samples[i]);
+		float rms = rmsBuffer.samples[i];
 		if (rms < -120.0f) rms = -120.0f;
 		if (rms > data->attenuation) {
 			data->attenuation = rms + attackFactor * (data->attenuation - rms);
@@ -800,10 +1291,14 @@ int azaCompressorProcess(azaCompressor *data, azaBuffer buffer) {
 			gain = 0.0f;
 		}
 		data->gain = gain;
-		float amp = aza_db_to_ampf(gain);
-		for (size_t c = 0; c < buffer.channelLayout.count; c++) {
-			size_t s = i * buffer.stride + c;
-			buffer.samples[s] *= amp;
+		// Reuse the rms buffer for the gain
+		rmsBuffer.samples[i] = gain;
+	}
+	azaSIMDDbToAmp(rmsBuffer.samples, rmsBuffer.samples, buffer.frames);
+	for (size_t c = 0; c < buffer.channelLayout.count; c++) {
+		float *dst = buffer.samples + c * buffer.channelStride;
+		for (size_t i = 0; i < buffer.frames; i++) {
+			dst[i * buffer.stride] *= rmsBuffer.samples[i];
 		}
 	}
 	azaPopSideBuffer();
@@ -852,6 +1347,12 @@ void azaFreeDelay(azaDelay *data) {
 	aza_free(data);
 }
 
+// A delay shorter than one sample would leave us nothing to ring through, and 1 sample already means no delay at all since the output tap sits one sample ahead of the write head.
+static uint32_t azaDelayGetDelaySamples(azaDelay *data, azaDelayChannelData *channelData, uint32_t samplerate) {
+	uint32_t delaySamples = (uint32_t)aza_ms_to_samples(data->config.delay + channelData->config.delay, (float)samplerate);
+	return AZA_MAX(delaySamples, 1);
+}
+
 static int azaDelayHandleBufferResizes(azaDelay *data, uint32_t samplerate, uint8_t channelCount) {
 	int err = AZA_SUCCESS;
 	err = azaEnsureChannels(&data->channelData, channelCount);
@@ -861,10 +1362,10 @@ static int azaDelayHandleBufferResizes(azaDelay *data, uint32_t samplerate, uint
 	uint8_t realloc = 0;
 	for (uint8_t c = 0; c < channelCount; c++) {
 		azaDelayChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		uint32_t delaySamples = (uint32_t)aza_ms_to_samples(data->config.delay + channelData->config.delay, (float)samplerate);
+		uint32_t delaySamples = azaDelayGetDelaySamples(data, channelData, samplerate);
 		if (delaySamples > delaySamplesMax) delaySamplesMax = delaySamples;
 		if (channelData->delaySamples >= delaySamples) {
-			if (channelData->index > delaySamples) {
+			if (channelData->index >= delaySamples) {
 				channelData->index = 0;
 			}
 			channelData->delaySamples = delaySamples;
@@ -887,54 +1388,106 @@ static int azaDelayHandleBufferResizes(azaDelay *data, uint32_t samplerate, uint
 		}
 		channelData->buffer = newChannelBuffer;
 		// We also have to set delaySamples since we didn't do it above
-		channelData->delaySamples = (uint32_t)aza_ms_to_samples(data->config.delay + channelData->config.delay, (float)samplerate);
+		channelData->delaySamples = azaDelayGetDelaySamples(data, channelData, samplerate);
+		if (channelData->index >= channelData->delaySamples) {
+			channelData->index = 0;
+		}
 	}
 	if (data->buffer) {
 		aza_free(data->buffer);
 	}
 	data->buffer = newBuffer;
+	data->bufferCap = newPerChannelBufferCap * channelCount;
 	return AZA_SUCCESS;
 }
 
+// Each channel's buffer is a ring of delaySamples floats. Within a block no longer than the shortest ring, the frames we touch cover at most two contiguous segments of each ring (before and after the wrap), so we walk those segments with the SIMD kernels instead of going sample by sample with a modulo.
+// For each frame, the write head gets the wet signal, the feedback comes from what the write head is about to overwrite (delaySamples ago), and the output comes from the slot just past the write head (delaySamples-1 ago).
 int azaDelayProcess(azaDelay *data, azaBuffer buffer) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+	err = azaCheckBuffer(&buffer);
 	if (err) return err;
 	err = azaDelayHandleBufferResizes(data, buffer.samplerate, buffer.channelLayout.count);
 	if (err) return err;
-	azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, buffer.channelLayout.count, buffer.samplerate);
-	memset(sideBuffer.samples, 0, sizeof(float) * sideBuffer.frames * sideBuffer.channelLayout.count);
-	for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+	uint8_t channels = buffer.channelLayout.count;
+	uint32_t blockFramesMax = buffer.frames;
+	for (uint8_t c = 0; c < channels; c++) {
 		azaDelayChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		uint32_t index = channelData->index;
-		for (uint32_t i = 0; i < buffer.frames; i++) {
-			uint32_t s = i * buffer.stride + c;
-			uint8_t c2 = (c + 1) % buffer.channelLayout.count;
-			float toAdd = buffer.samples[s] + channelData->buffer[index] * data->config.feedback;
-			sideBuffer.samples[i * sideBuffer.stride + c] += toAdd * (1.0f - data->config.pingpong);
-			sideBuffer.samples[i * sideBuffer.stride + c2] += toAdd * data->config.pingpong;
-			index = (index+1) % channelData->delaySamples;
-		}
+		blockFramesMax = AZA_MIN(blockFramesMax, channelData->delaySamples);
 	}
-	if (data->config.wetEffects) {
-		err = azaDSPProcessSingle(data->config.wetEffects, sideBuffer);
-		if (err) return err;
+	azaScratchMark mark = azaMarkSideBuffers();
+	azaBuffer sideBufferFull = azaPushSideBufferLike(buffer, blockFramesMax, channels);
+	if (!sideBufferFull.samples) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto done;
 	}
-	for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-		azaDelayChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		uint32_t index = channelData->index;
-		float amount = aza_db_to_ampf(data->config.gain);
-		float amountDry = aza_db_to_ampf(data->config.gainDry);
-		for (uint32_t i = 0; i < buffer.frames; i++) {
-			uint32_t s = i * buffer.stride + c;
-			channelData->buffer[index] = sideBuffer.samples[i * sideBuffer.stride + c];
-			index = (index+1) % channelData->delaySamples;
-			buffer.samples[s] = channelData->buffer[index] * amount + buffer.samples[s] * amountDry;
+	float amount = aza_db_to_ampf(data->config.gain);
+	float amountDry = aza_db_to_ampf(data->config.gainDry);
+	float feedback = data->config.feedback;
+	float pingpong = data->config.pingpong;
+	for (uint32_t frame = 0; frame < buffer.frames; frame += blockFramesMax) {
+		uint32_t frames = AZA_MIN(buffer.frames - frame, blockFramesMax);
+		azaBuffer block = azaBufferSlice(buffer, frame, frames);
+		azaBuffer sideBuffer = azaBufferSlice(sideBufferFull, 0, frames);
+		// Input and ping-pong. With pingpong == 0 this is just a copy.
+		azaBufferCopy(sideBuffer, block);
+		if (pingpong != 0.0f) {
+			azaBufferMix(sideBuffer, 1.0f - pingpong, sideBuffer, 0.0f);
+			for (uint8_t c = 0; c < channels; c++) {
+				uint8_t c2 = (c + 1) % channels;
+				azaSIMDMix(sideBuffer.samples + c2 * sideBuffer.channelStride, sideBuffer.stride, 1.0f, block.samples + c * block.channelStride, block.stride, pingpong, frames, 1);
+			}
+		}
+		// Feedback, with the same ping-pong split
+		if (feedback != 0.0f) {
+			for (uint8_t c = 0; c < channels; c++) {
+				azaDelayChannelData *channelData = azaGetChannelData(&data->channelData, c);
+				uint8_t c2 = (c + 1) % channels;
+				uint32_t index = channelData->index;
+				uint32_t i = 0;
+				while (i < frames) {
+					uint32_t run = AZA_MIN(frames - i, channelData->delaySamples - index);
+					float *src = channelData->buffer + index;
+					azaSIMDMix(sideBuffer.samples + i * sideBuffer.stride + c * sideBuffer.channelStride, sideBuffer.stride, 1.0f, src, 1, feedback * (1.0f - pingpong), run, 1);
+					if (pingpong != 0.0f) {
+						azaSIMDMix(sideBuffer.samples + i * sideBuffer.stride + c2 * sideBuffer.channelStride, sideBuffer.stride, 1.0f, src, 1, feedback * pingpong, run, 1);
+					}
+					i += run;
+					index = 0;
+				}
+			}
+		}
+		if (data->config.wetEffects) {
+			err = azaDSPProcessSingle(data->config.wetEffects, sideBuffer);
+			if (err) goto done;
+		}
+		// Output and write-back
+		for (uint8_t c = 0; c < channels; c++) {
+			azaDelayChannelData *channelData = azaGetChannelData(&data->channelData, c);
+			uint32_t delaySamples = channelData->delaySamples;
+			uint32_t index = channelData->index;
+			uint32_t i = 0;
+			while (i < frames) {
+				uint32_t run = AZA_MIN(frames - i, delaySamples - index);
+				float *ring = channelData->buffer + index;
+				float *dst = block.samples + i * block.stride + c * block.channelStride;
+				// All but the last frame of the run read slots we haven't written yet.
+				azaSIMDMix(dst, block.stride, amountDry, ring + 1, 1, amount, run - 1, 1);
+				azaSIMDCopy(ring, 1, sideBuffer.samples + i * sideBuffer.stride + c * sideBuffer.channelStride, sideBuffer.stride, run, 1);
+				i += run;
+				index += run;
+				if (index == delaySamples) index = 0;
+				// The last frame's output is wherever the write head ends up, which may be something we just wrote when the block covers the whole ring.
+				dst += (run - 1) * block.stride;
+				*dst = channelData->buffer[index] * amount + *dst * amountDry;
+			}
+			channelData->index = index;
 		}
-		channelData->index = index;
 	}
-	azaPopSideBuffer();
+done:
+	azaReleaseSideBuffers(mark);
+	if (err) return err;
 	if (data->header.pNext) {
 		return azaDSPProcessSingle(data->header.pNext, buffer);
 	}
@@ -1063,14 +1616,20 @@ void azaFreeReverb(azaReverb *data) {
 int azaReverbProcess(azaReverb *data, azaBuffer buffer) {
 	int err = AZA_SUCCESS;
 	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+	err = azaCheckBuffer(&buffer);
 	if (err) return err;
+	azaScratchMark mark = azaMarkSideBuffers();
 	azaBuffer inputBuffer = azaPushSideBufferCopy(buffer);
 	err = azaDelayProcess(&data->inputDelay, inputBuffer);
-	if (err) return err;
-	azaBuffer sideBufferCombined = azaPushSideBufferZero(buffer.frames, buffer.channelLayout.count, buffer.samplerate);
-	azaBuffer sideBufferEarly = azaPushSideBuffer(buffer.frames, buffer.channelLayout.count, buffer.samplerate);
-	azaBuffer sideBufferDiffuse = azaPushSideBuffer(buffer.frames, buffer.channelLayout.count, buffer.samplerate);
+	if (err) goto done;
+	azaBuffer sideBufferCombined = azaPushSideBufferLike(buffer, buffer.frames, buffer.channelLayout.count);
+	azaBufferZero(sideBufferCombined);
+	azaBuffer sideBufferEarly = azaPushSideBufferLike(buffer, buffer.frames, buffer.channelLayout.count);
+	azaBuffer sideBufferDiffuse = azaPushSideBufferLike(buffer, buffer.frames, buffer.channelLayout.count);
+	if (!sideBufferCombined.samples || !sideBufferEarly.samples || !sideBufferDiffuse.samples) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto done;
+	}
 	float feedback = 0.985f - (0.2f / data->config.roomsize);
 	float color = data->config.color * 4000.0f;
 	float amount = aza_db_to_ampf(data->config.gain);
@@ -1081,11 +1640,11 @@ int azaReverbProcess(azaReverb *data, azaBuffer buffer) {
 		azaFilter *filter = azaReverbGetFilterTap(data, tap);
 		delay->config.feedback = feedback;
 		filter->config.frequency = color;
-		memcpy(sideBufferEarly.samples, inputBuffer.samples, sizeof(float) * buffer.frames * buffer.channelLayout.count);
+		azaBufferCopy(sideBufferEarly, inputBuffer);
 		err = azaFilterProcess(filter, sideBufferEarly);
-		if (err) return err;
+		if (err) goto done;
 		err = azaDelayProcess(delay, sideBufferEarly);
-		if (err) return err;
+		if (err) goto done;
 		azaBufferMix(sideBufferCombined, 1.0f, sideBufferEarly, 1.0f / (float)AZAUDIO_REVERB_DELAY_COUNT);
 	}
 	for (int tap = AZAUDIO_REVERB_DELAY_COUNT*2/3; tap < AZAUDIO_REVERB_DELAY_COUNT; tap++) {
@@ -1093,361 +1652,1680 @@ int azaReverbProcess(azaReverb *data, azaBuffer buffer) {
 		azaFilter *filter = azaReverbGetFilterTap(data, tap);
 		delay->config.feedback = (float)(tap+AZAUDIO_REVERB_DELAY_COUNT) / (AZAUDIO_REVERB_DELAY_COUNT*2);
 		filter->config.frequency = color*4.0f;
-		memcpy(sideBufferDiffuse.samples, sideBufferCombined.samples, sizeof(float) * buffer.frames * buffer.channelLayout.count);
+		azaBufferCopy(sideBufferDiffuse, sideBufferCombined);
 		azaBufferCopyChannel(sideBufferDiffuse, 0, sideBufferCombined, 0);
 		err = azaFilterProcess(filter, sideBufferDiffuse);
-		if (err) return err;
+		if (err) goto done;
 		err = azaDelayProcess(delay, sideBufferDiffuse);
-		if (err) return err;
+		if (err) goto done;
 		azaBufferMix(sideBufferCombined, 1.0f, sideBufferDiffuse, 1.0f / (float)AZAUDIO_REVERB_DELAY_COUNT);
 	}
 	azaBufferMix(buffer, amountDry, sideBufferCombined, amount);
-	azaPopSideBuffers(4);
+	azaReleaseSideBuffers(mark);
 	if (data->header.pNext) {
 		return azaDSPProcessSingle(data->header.pNext, buffer);
 	}
 	return AZA_SUCCESS;
+done:
+	azaReleaseSideBuffers(mark);
+	return err;
 }
 
 
 
-void azaSamplerInit(azaSampler *data, uint32_t allocSize, azaSamplerConfig config) {
-	data->header.kind = AZA_DSP_SAMPLER;
+uint32_t azaReverbFDNGetAllocSize(uint8_t channelCapInline) {
+	size_t size = sizeof(azaReverbFDN) - sizeof(azaDelay);
+	size = azaAddSizeWithAlign(size, azaDelayGetAllocSize(channelCapInline), alignof(azaDelay));
+	return (uint32_t)size;
+}
+
+void azaReverbFDNInit(azaReverbFDN *data, uint32_t allocSize, azaReverbFDNConfig config, uint8_t channelCapInline) {
+	data->header.kind = AZA_DSP_REVERB_FDN;
 	data->header.structSize = allocSize;
 	data->config = config;
-	data->pos.frame = 0;
-	data->pos.fraction = 0.0f;
-	data->s = config.speed;
-	// Starting at zero ensures click-free playback no matter what
-	data->g = 0.0f;
-	// TODO: Probably use envelopes
+	data->samplerate = 0;
+	data->lineCount = 0;
+	data->buffer = NULL;
+	data->bufferCap = 0;
+	memset(data->lines, 0, sizeof(data->lines));
+	azaDelayInit(&data->inputDelay, azaDelayGetAllocSize(channelCapInline), (azaDelayConfig){
+		.gain = 0.0f,
+		.gainDry = -INFINITY,
+		.delay = config.delay,
+		.feedback = 0.0f,
+		.wetEffects = NULL,
+		.pingpong = 0.0f,
+	}, channelCapInline);
 }
 
-void azaSamplerDeinit(azaSampler *data) {
-	// Nothing to do :)
+void azaReverbFDNDeinit(azaReverbFDN *data) {
+	azaDelayDeinit(&data->inputDelay);
+	if (data->buffer) {
+		aza_free(data->buffer);
+		data->buffer = NULL;
+	}
 }
 
-azaSampler* azaMakeSampler(azaSamplerConfig config) {
-	uint32_t size = azaSamplerGetAllocSize();
-	azaSampler *result = aza_calloc(1, size);
-	if (result) azaSamplerInit(result, size, config);
+azaReverbFDN* azaMakeReverbFDN(azaReverbFDNConfig config, uint8_t channelCapInline) {
+	uint32_t size = azaReverbFDNGetAllocSize(channelCapInline);
+	azaReverbFDN *result = aza_calloc(1, size);
+	if (result) azaReverbFDNInit(result, size, config, channelCapInline);
 	return result;
 }
 
-void azaFreeSampler(azaSampler *data) {
-	azaSamplerDeinit(data);
+void azaFreeReverbFDN(azaReverbFDN *data) {
+	azaReverbFDNDeinit(data);
 	aza_free(data);
 }
 
-int azaSamplerProcess(azaSampler *data, azaBuffer buffer) {
-	int err = AZA_SUCCESS;
-	if (data == NULL || data->config.buffer == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
-	if (err) return err;
-	if (buffer.channelLayout.count != data->config.buffer->channelLayout.count) return AZA_ERROR_MISMATCHED_CHANNEL_COUNT;
-	float transition = expf(-1.0f / (AZAUDIO_SAMPLER_TRANSITION_FRAMES));
-	float samplerateFactor = (float)data->config.buffer->samplerate / (float)buffer.samplerate;
-	for (size_t i = 0; i < buffer.frames; i++) {
-		data->s = data->config.speed + transition * (data->s - data->config.speed);
-		data->g = data->config.gain + transition * (data->g - data->config.gain);
+// Line lengths in samples at 48kHz. Mutually prime so their echoes rarely line up. Using every other one for 8 lines keeps the same overall spread.
+static const uint32_t azaReverbFDNLineLengths[AZAUDIO_REVERB_FDN_MAX_LINES] = {
+	2129, 2017, 1753, 1699, 1447, 1361, 1201, 1129,
+	1063, 1039,  977,  857,  773,  719,  643,  619,
+};
+// The loop length that roomsize's feedback amount is for, which is about the average of azaReverb's taps
+#define AZAUDIO_REVERB_FDN_REFERENCE_LENGTH 1300.0f
 
-		// Adjust for different samplerates
-		float speed = data->s * samplerateFactor;
-		float volume = aza_db_to_ampf(data->g);
+static uint32_t azaReverbFDNGetLineLength(uint8_t lineCount, uint8_t line, uint32_t samplerate) {
+	uint32_t length48k = azaReverbFDNLineLengths[line * (AZAUDIO_REVERB_FDN_MAX_LINES / lineCount)];
+	return AZA_MAX(1, (uint32_t)((uint64_t)length48k * samplerate / 48000));
+}
 
-		for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-			float sample = 0.0f;
-			// TODO: Maybe switch to using the lanczos kernel that we use to resample for the backend
-			/* Lanczos
-			int t = (int)datum->frame + (int)data->s;
-			for (int i = (int)datum->frame-2; i <= t+2; i++) {
-				float x = datum->frame - (float)(i);
-				sample += datum->buffer->samples[i % datum->buffer->frames] * sinc(x) * sinc(x/3);
+static int azaReverbFDNHandleBufferResizes(azaReverbFDN *data, uint32_t samplerate) {
+	uint8_t lineCount = data->config.lineCount == 16 ? 16 : 8;
+	if (data->samplerate == samplerate && data->lineCount == lineCount) return AZA_SUCCESS;
+	uint32_t total = 0;
+	for (uint8_t l = 0; l < lineCount; l++) {
+		total += azaReverbFDNGetLineLength(lineCount, l, samplerate);
+	}
+	if (data->bufferCap < total) {
+		uint32_t newBufferCap = (uint32_t)aza_grow(data->bufferCap, total, 256);
+		float *newBuffer = aza_calloc(newBufferCap, sizeof(float));
+		if (!newBuffer) return AZA_ERROR_OUT_OF_MEMORY;
+		if (data->buffer) {
+			aza_free(data->buffer);
+		}
+		data->buffer = newBuffer;
+		data->bufferCap = newBufferCap;
+	} else {
+		memset(data->buffer, 0, sizeof(float) * total);
+	}
+	float *lineBuffer = data->buffer;
+	for (uint8_t l = 0; l < lineCount; l++) {
+		azaReverbFDNLine *line = &data->lines[l];
+		line->buffer = lineBuffer;
+		line->length = azaReverbFDNGetLineLength(lineCount, l, samplerate);
+		line->index = 0;
+		line->damping = 0.0f;
+		lineBuffer += line->length;
+	}
+	data->samplerate = samplerate;
+	data->lineCount = lineCount;
+	return AZA_SUCCESS;
+}
+
+// Applies the feedback matrix to all the lines, each of which has count contiguous samples, lineStride floats apart. scratch must have room for count floats.
+static void azaReverbFDNApplyMatrix(azaReverbFDNMatrix matrix, float *lines, uint32_t lineStride, uint8_t lineCount, uint32_t count, float *scratch) {
+	switch (matrix) {
+		case AZA_REVERB_FDN_HOUSEHOLDER: {
+			azaSIMDCopy(scratch, 1, lines, 1, count, 1);
+			for (uint8_t l = 1; l < lineCount; l++) {
+				azaSIMDMix(scratch, 1, 1.0f, lines + l * lineStride, 1, 1.0f, count, 1);
 			}
-			*/
-
-			if (speed <= 1.0f) {
-				// Cubic
-				float abcd[4];
-				int ii = data->pos.frame + (int)data->config.buffer->frames - 2;
-				for (int i = 0; i < 4; i++) {
-					abcd[i] = data->config.buffer->samples[(ii++ % data->config.buffer->frames) * data->config.buffer->stride + c];
-				}
-				sample = cubic(abcd[0], abcd[1], abcd[2], abcd[3], data->pos.fraction);
-			} else {
-				// Oversampling
-				float total = 0.0f;
-				total += data->config.buffer->samples[(data->pos.frame % data->config.buffer->frames) * data->config.buffer->stride + c] * (1.0f - data->pos.fraction);
-				for (int i = 1; i < (int)speed; i++) {
-					total += data->config.buffer->samples[((data->pos.frame + i) % data->config.buffer->frames) * data->config.buffer->stride + c];
+			float factor = -2.0f / (float)lineCount;
+			for (uint8_t l = 0; l < lineCount; l++) {
+				azaSIMDMix(lines + l * lineStride, 1, 1.0f, scratch, 1, factor, count, 1);
+			}
+		} break;
+		case AZA_REVERB_FDN_HADAMARD: {
+			// Unnormalized, so the caller has to scale by 1/sqrt(lineCount)
+			for (uint8_t half = 1; half < lineCount; half <<= 1) {
+				for (uint8_t l = 0; l < lineCount; l += half * 2) {
+					for (uint8_t o = l; o < l + half; o++) {
+						azaSIMDButterfly(lines + o * lineStride, lines + (o + half) * lineStride, count);
+					}
 				}
-				total += data->config.buffer->samples[((data->pos.frame + (int)speed) % data->config.buffer->frames) * data->config.buffer->stride + c] * data->pos.fraction;
-				sample = total / (float)((int)speed);
 			}
+		} break;
+	}
+}
 
-			/* Linear
-			int t = (int)data->pos.frame + (int)data->s;
-			for (int i = (int)data->pos.frame; i <= t+1; i++) {
-				float x = data->pos.frame - (float)(i);
-				sample += data->config.buffer->samples[i % data->config.buffer->frames] * linc(x);
+int azaReverbFDNProcess(azaReverbFDN *data, azaBuffer buffer) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	err = azaReverbFDNHandleBufferResizes(data, buffer.samplerate);
+	if (err) return err;
+	uint8_t lineCount = data->lineCount;
+	uint8_t channels = buffer.channelLayout.count;
+	azaScratchMark mark = azaMarkSideBuffers();
+	azaBuffer inputBuffer = buffer;
+	data->inputDelay.config.delay = data->config.delay;
+	if (aza_ms_to_samples(data->config.delay, (float)buffer.samplerate) >= 1.0f) {
+		inputBuffer = azaPushSideBufferCopy(buffer);
+		if (!inputBuffer.samples) {
+			err = AZA_ERROR_OUT_OF_MEMORY;
+			goto done;
+		}
+		err = azaDelayProcess(&data->inputDelay, inputBuffer);
+		if (err) goto done;
+	}
+	// We can process as many frames at once as the shortest line is long, since nothing we write can come back around within that many frames.
+	uint32_t blockMax = AZA_MIN(buffer.frames, data->lines[lineCount-1].length);
+	// The lines, one after another, and one more for the matrix to use
+	azaBuffer linesBuffer = azaPushSideBuffer(blockMax, lineCount + 1, buffer.samplerate);
+	azaBuffer wetBuffer = azaPushSideBufferLike(buffer, buffer.frames, channels);
+	if (!linesBuffer.samples || !wetBuffer.samples) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto done;
+	}
+	azaBufferZero(wetBuffer);
+	float feedback = azaClampf(0.985f - (0.2f / data->config.roomsize), 0.0f, 0.9999f);
+	float decay = azaClampf(expf(-AZA_TAU * (data->config.color * 4000.0f / (float)buffer.samplerate)), 0.0f, 1.0f);
+	float matrixScale = data->config.matrix == AZA_REVERB_FDN_HADAMARD ? 1.0f / sqrtf((float)lineCount) : 1.0f;
+	float lineGains[AZAUDIO_REVERB_FDN_MAX_LINES];
+	for (uint8_t l = 0; l < lineCount; l++) {
+		// Scale feedback with line length so every line decays at the same rate over time
+		float length48k = (float)azaReverbFDNLineLengths[l * (AZAUDIO_REVERB_FDN_MAX_LINES / lineCount)];
+		lineGains[l] = powf(feedback, length48k / AZAUDIO_REVERB_FDN_REFERENCE_LENGTH) * matrixScale;
+	}
+	// Each channel goes into and comes out of every lineCount/channels'th line
+	uint8_t linesPerChannel = AZA_MAX(1, lineCount / channels);
+	float ioScale = 1.0f / sqrtf((float)linesPerChannel);
+	float *lines = linesBuffer.samples;
+	uint32_t lineStride = blockMax;
+	float *matrixScratch = lines + lineCount * lineStride;
+	for (uint32_t frame = 0; frame < buffer.frames; frame += blockMax) {
+		uint32_t count = AZA_MIN(blockMax, buffer.frames - frame);
+		for (uint8_t l = 0; l < lineCount; l++) {
+			azaReverbFDNLine *line = &data->lines[l];
+			float *samples = lines + l * lineStride;
+			uint32_t first = AZA_MIN(count, line->length - line->index);
+			memcpy(samples, line->buffer + line->index, sizeof(float) * first);
+			memcpy(samples + first, line->buffer, sizeof(float) * (count - first));
+			// Damping is a recurrence, so this one has to be done the slow way.
+			float damping = line->damping;
+			float gain = lineGains[l];
+			for (uint32_t i = 0; i < count; i++) {
+				damping = samples[i] + decay * (damping - samples[i]);
+				samples[i] = damping * gain;
 			}
-			*/
-
-			buffer.samples[i * buffer.stride + c] = sample * volume;
+			line->damping = damping;
 		}
-		data->pos.fraction += speed;
-		uint32_t framesToAdd = (uint32_t)data->pos.fraction;
-		data->pos.frame += framesToAdd;
-		data->pos.fraction -= framesToAdd;
-		if (data->pos.frame > data->config.buffer->frames) {
-			data->pos.frame -= data->config.buffer->frames;
+		for (uint8_t c = 0; c < channels; c++) {
+			for (uint8_t l = c % lineCount; l < lineCount; l += channels) {
+				azaSIMDMix(wetBuffer.samples + frame * wetBuffer.stride + c * wetBuffer.channelStride, wetBuffer.stride, 1.0f, lines + l * lineStride, 1, ioScale / matrixScale, count, 1);
+			}
+		}
+		azaReverbFDNApplyMatrix(data->config.matrix, lines, lineStride, lineCount, count, matrixScratch);
+		for (uint8_t c = 0; c < channels; c++) {
+			for (uint8_t l = c % lineCount; l < lineCount; l += channels) {
+				azaSIMDMix(lines + l * lineStride, 1, 1.0f, inputBuffer.samples + frame * inputBuffer.stride + c * inputBuffer.channelStride, inputBuffer.stride, ioScale, count, 1);
+			}
+		}
+		for (uint8_t l = 0; l < lineCount; l++) {
+			azaReverbFDNLine *line = &data->lines[l];
+			float *samples = lines + l * lineStride;
+			uint32_t first = AZA_MIN(count, line->length - line->index);
+			memcpy(line->buffer + line->index, samples, sizeof(float) * first);
+			memcpy(line->buffer, samples + first, sizeof(float) * (count - first));
+			line->index += count;
+			if (line->index >= line->length) line->index -= line->length;
 		}
 	}
+	azaBufferMix(buffer, aza_db_to_ampf(data->config.gainDry), wetBuffer, aza_db_to_ampf(data->config.gain));
+	azaReleaseSideBuffers(mark);
 	if (data->header.pNext) {
 		return azaDSPProcessSingle(data->header.pNext, buffer);
 	}
 	return AZA_SUCCESS;
+done:
+	azaReleaseSideBuffers(mark);
+	return err;
 }
 
 
 
-uint32_t azaGateGetAllocSize() {
-	size_t size = sizeof(azaGate);
-	size = azaAddSizeWithAlign(size, azaRMSGetAllocSize((azaRMSConfig) { 128 }, 1), alignof(azaRMS));
-	return (uint32_t)size;
+// Transforms irFrames samples of ir into partitionCount spectra of partitionFrames each, zero-padded to windows of twice that, and scaled so that azaFFTInverse comes out at unity gain. scratch must have room for 2*partitionFrames floats.
+static void azaMakePartitionSpectra(azaFFT *fft, float *dst, const float *ir, uint32_t irStride, uint32_t irFrames, uint32_t partitionFrames, uint32_t partitionCount, float *scratch) {
+	float scale = 1.0f / (float)(partitionFrames * 2);
+	size_t spectrumFloats = AZA_FFT_SPECTRUM_FLOATS(partitionFrames * 2);
+	for (uint32_t p = 0; p < partitionCount; p++) {
+		uint32_t start = p * partitionFrames;
+		uint32_t frames = start < irFrames ? AZA_MIN(partitionFrames, irFrames - start) : 0;
+		memset(scratch, 0, sizeof(float) * partitionFrames * 2);
+		for (uint32_t f = 0; f < frames; f++) {
+			scratch[f] = ir[(size_t)(start + f) * irStride] * scale;
+		}
+		azaFFTForward(fft, dst + spectrumFloats * p, scratch);
+	}
 }
 
-void azaGateInit(azaGate *data, uint32_t allocSize, azaGateConfig config) {
-	data->header.kind = AZA_DSP_GATE;
-	data->header.structSize = allocSize;
-	data->config = config;
-	azaRMSConfig rmsConfig = (azaRMSConfig) {
-		.windowSamples = 128,
-		.combineOp = azaOpMax
-	};
-	azaRMSInit(&data->rms, azaRMSGetAllocSize(rmsConfig, 1), rmsConfig, 1);
+static uint32_t azaPowerOfTwoAtLeast(uint32_t value) {
+	uint32_t result = 1;
+	while (result < value) {
+		result *= 2;
+	}
+	return result;
 }
 
-void azaGateDeinit(azaGate *data) {
-	azaRMSDeinit(&data->rms);
+static void azaConvolutionStageDeinit(azaConvolutionStage *data) {
+	azaFFTDeinit(&data->fft);
+	if (data->buffer) {
+		aza_free(data->buffer);
+	}
+	memset(data, 0, sizeof(*data));
 }
 
-azaGate* azaMakeGate(azaGateConfig config) {
-	uint32_t size = azaGateGetAllocSize();
-	azaGate *result = aza_calloc(1, size);
-	if (result) azaGateInit(result, size, config);
-	return result;
+// Sets up data to convolve channels channels with irFrames frames of ir, starting at irStart.
+// If irFrames is 0, data is left empty with a partitionCount of 0.
+static int azaConvolutionStageInit(azaConvolutionStage *data, uint32_t partitionFrames, uint8_t channels, const azaBuffer *ir, uint8_t irChannels, uint32_t irStart, uint32_t irFrames) {
+	memset(data, 0, sizeof(*data));
+	if (irFrames == 0) return AZA_SUCCESS;
+	int err = azaFFTInit(&data->fft, partitionFrames * 2);
+	if (err) return err;
+	uint32_t partitionCount = (irFrames + partitionFrames - 1) / partitionFrames;
+	size_t spectrumFloats = AZA_FFT_SPECTRUM_FLOATS(partitionFrames * 2);
+	size_t filterFloats = spectrumFloats * partitionCount * irChannels;
+	size_t windowFloats = (size_t)partitionFrames * 2 * channels;
+	size_t spectraFloats = spectrumFloats * partitionCount * channels;
+	size_t outputFloats = (size_t)partitionFrames * channels;
+	data->buffer = aza_calloc(filterFloats + windowFloats + spectraFloats + spectrumFloats + partitionFrames * 2 + outputFloats, sizeof(float));
+	if (!data->buffer) {
+		azaConvolutionStageDeinit(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	data->partitionFrames = partitionFrames;
+	data->partitionCount = partitionCount;
+	data->filters = data->buffer;
+	data->windows = data->filters + filterFloats;
+	data->spectra = data->windows + windowFloats;
+	data->accum = data->spectra + spectraFloats;
+	data->scratch = data->accum + spectrumFloats;
+	data->output = data->scratch + partitionFrames * 2;
+	for (uint8_t c = 0; c < irChannels; c++) {
+		const float *samples = ir->samples + c * ir->channelStride + (size_t)irStart * ir->stride;
+		azaMakePartitionSpectra(&data->fft, data->filters + spectrumFloats * partitionCount * c, samples, ir->stride, irFrames, partitionFrames, partitionCount, data->scratch);
+	}
+	return AZA_SUCCESS;
 }
 
-void azaFreeGate(azaGate *data) {
-	azaGateDeinit(data);
-	aza_free(data);
+// Forgets all the input, as if it had been silent forever
+static void azaConvolutionStageReset(azaConvolutionStage *data, uint8_t channels) {
+	if (!data->partitionCount) return;
+	memset(data->windows, 0, sizeof(float) * data->partitionFrames * 2 * channels);
+	memset(data->spectra, 0, sizeof(float) * AZA_FFT_SPECTRUM_FLOATS(data->partitionFrames * 2) * data->partitionCount * channels);
 }
 
-int azaGateProcess(azaGate *data, azaBuffer buffer) {
-	int err = AZA_SUCCESS;
-	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
-	if (err) return err;
-	azaBuffer rmsBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
-	azaBuffer activationBuffer = buffer;
-	uint8_t sideBuffersInUse = 1;
-
-	if (data->config.activationEffects) {
-		activationBuffer = azaPushSideBufferCopy(buffer);
-		sideBuffersInUse++;
-		int err = azaDSPProcessSingle(data->config.activationEffects, activationBuffer);
-		if (err) {
-			azaPopSideBuffers(sideBuffersInUse);
-			return err;
+// Convolves the partition of input in the second half of every channel's window, putting partitionFrames of output per channel into dst, dstChannelStride floats apart.
+static void azaConvolutionStageProcess(azaConvolutionStage *data, uint8_t channels, uint8_t irChannels, float *dst, uint32_t dstChannelStride) {
+	uint32_t partitionFrames = data->partitionFrames;
+	uint32_t partitionCount = data->partitionCount;
+	size_t spectrumFloats = AZA_FFT_SPECTRUM_FLOATS(partitionFrames * 2);
+	data->partitionIndex = (data->partitionIndex + 1) % partitionCount;
+	for (uint8_t c = 0; c < channels; c++) {
+		float *window = data->windows + (size_t)partitionFrames * 2 * c;
+		float *spectra = data->spectra + spectrumFloats * partitionCount * c;
+		const float *filters = data->filters + spectrumFloats * partitionCount * (irChannels == 1 ? 0 : c);
+		azaFFTForward(&data->fft, spectra + spectrumFloats * data->partitionIndex, window);
+		// Slide the window along. The second half gets written over by the next partition's input.
+		memcpy(window, window + partitionFrames, sizeof(float) * partitionFrames);
+		memset(data->accum, 0, sizeof(float) * spectrumFloats);
+		for (uint32_t p = 0; p < partitionCount; p++) {
+			const float *spectrum = spectra + spectrumFloats * ((data->partitionIndex + partitionCount - p) % partitionCount);
+			azaSpectrumMulAdd(data->accum, spectrum, filters + spectrumFloats * p, partitionFrames + 1);
 		}
+		azaFFTInverse(&data->fft, data->scratch, data->accum);
+		// Overlap-save: Only the second half of the window is free of circular wraparound
+		memcpy(dst + (size_t)dstChannelStride * c, data->scratch + partitionFrames, sizeof(float) * partitionFrames);
 	}
+}
 
-	err = azaRMSProcessDual(&data->rms, rmsBuffer, activationBuffer);
-	if (err) return err;
-	float t = (float)buffer.samplerate / 1000.0f;
-	float attackFactor = expf(-1.0f / (data->config.attack * t));
-	float decayFactor = expf(-1.0f / (data->config.decay * t));
-
-	for (size_t i = 0; i < buffer.frames; i++) {
-		float rms = aza_amp_to_dbf(rmsBuffer.samples[i]);
-		if (rms < -120.0f) rms = -120.0f;
-		if (rms > data->config.threshold) {
-			data->attenuation = rms + attackFactor * (data->attenuation - rms);
-		} else {
-			data->attenuation = rms + decayFactor * (data->attenuation - rms);
+static azaMutex azaConvolutionWorkerMutex;
+static azaSemaphore azaConvolutionWorkerSemaphore;
+static azaThread azaConvolutionWorkerThread;
+static bool azaConvolutionWorkerLaunched = false;
+static volatile uint32_t azaConvolutionWorkerQuit = 0;
+// Every azaConvolution with a tail for the worker to do
+static azaConvolution *azaConvolutionWorkerHead = NULL;
+
+// Convolves every tail partition that's been handed off since last time. Whoever calls this MUST be the only one doing so for data.
+static void azaConvolutionTailCatchUp(azaConvolution *data) {
+	uint32_t partitionFrames = data->tail.partitionFrames;
+	uint8_t channels = data->channels;
+	uint32_t submitted = azaAtomicLoad32(&data->tailSubmitted);
+	while (data->tailNext != submitted) {
+		// If we're this far behind, the input we need is about to be written over and our output would be too late anyway, so skip ahead to the newest partition and leave out what we missed.
+		if (submitted - data->tailNext >= AZAUDIO_CONVOLUTION_TAIL_SLOTS - 1) {
+			data->tailNext = submitted - 1;
+			azaConvolutionStageReset(&data->tail, channels);
 		}
-		float gain;
-		if (data->attenuation > data->config.threshold) {
-			gain = 0.0f;
-		} else {
-			gain = -10.0f * (data->config.threshold - data->attenuation);
+		uint32_t job = data->tailNext;
+		uint32_t slot = job % AZAUDIO_CONVOLUTION_TAIL_SLOTS;
+		size_t slotFloats = (size_t)partitionFrames * channels;
+		for (uint8_t c = 0; c < channels; c++) {
+			memcpy(data->tail.windows + (size_t)partitionFrames * (2 * c + 1), data->tailInput + slotFloats * slot + (size_t)partitionFrames * c, sizeof(float) * partitionFrames);
 		}
-		data->gain = gain;
-		float amp = aza_db_to_ampf(gain);
-		for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
-			buffer.samples[i * buffer.stride + c] *= amp;
+		if (azaAtomicLoad32(&data->tailInputTags[slot]) != job + 1) {
+			// It got written over while we were copying it, so we're too far behind. Start over from whatever's newest.
+			submitted = azaAtomicLoad32(&data->tailSubmitted);
+			data->tailNext = submitted;
+			azaConvolutionStageReset(&data->tail, channels);
+			continue;
 		}
+		azaAtomicStore32(&data->tailOutputTags[slot], 0);
+		azaConvolutionStageProcess(&data->tail, channels, data->irChannels, data->tailOutput + slotFloats * slot, partitionFrames);
+		azaAtomicStore32(&data->tailOutputTags[slot], job + 1);
+		data->tailNext = job + 1;
+		submitted = azaAtomicLoad32(&data->tailSubmitted);
 	}
-	azaPopSideBuffers(sideBuffersInUse);
-	if (data->header.pNext) {
-		return azaDSPProcessSingle(data->header.pNext, buffer);
-	}
-	return AZA_SUCCESS;
 }
 
-
-
-azaDelayDynamicChannelConfig* azaDelayDynamicGetChannelConfig(azaDelayDynamic *data, uint8_t channel) {
-	azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, channel);
-	return &channelData->config;
+static AZA_THREAD_PROC_DEF(azaConvolutionWorkerProc, userdata) {
+	(void)userdata;
+	while (true) {
+		azaSemaphoreWait(&azaConvolutionWorkerSemaphore);
+		if (azaAtomicLoad32(&azaConvolutionWorkerQuit)) break;
+		azaMutexLock(&azaConvolutionWorkerMutex);
+		for (azaConvolution *convolution = azaConvolutionWorkerHead; convolution; convolution = convolution->workerNext) {
+			azaConvolutionTailCatchUp(convolution);
+		}
+		azaMutexUnlock(&azaConvolutionWorkerMutex);
+	}
+	return 0;
 }
 
-static azaKernel* azaDelayDynamicGetKernel(azaDelayDynamic *data) {
-	azaKernel *kernel = data->config.kernel;
-	if (!kernel) {
-		kernel = &azaKernelDefaultLanczos;
-	}
-	return kernel;
+void azaConvolutionWorkerInit() {
+	azaMutexInit(&azaConvolutionWorkerMutex);
+	azaSemaphoreInit(&azaConvolutionWorkerSemaphore, 0);
+	azaConvolutionWorkerQuit = 0;
+	azaConvolutionWorkerLaunched = false;
+	azaConvolutionWorkerHead = NULL;
 }
 
-static int azaDelayDynamicHandleBufferResizes(azaDelayDynamic *data, azaBuffer src) {
-	// TODO: Probably track channel layouts and handle them changing. Right now the buffers will break if the number of channels changes.
-	int err = AZA_SUCCESS;
-	err = azaEnsureChannels(&data->channelData, src.channelLayout.count);
-	if (err) return err;
-	uint32_t kernelSamples;
-	azaKernel *kernel = azaDelayDynamicGetKernel(data);
-	kernelSamples = (uint32_t)ceilf(kernel->isSymmetrical ? (kernel->length - 1.0f) * 2.0f : (kernel->length-1.0f));
-	// kernelSamples = 0;
-	uint32_t delaySamplesMax = (uint32_t)ceilf(aza_ms_to_samples(data->config.delayMax, (float)src.samplerate)) + kernelSamples;
-	uint32_t totalSamplesNeeded = delaySamplesMax + src.frames;
-	uint32_t perChannelBufferCap = data->bufferCap / src.channelLayout.count;
-	if (perChannelBufferCap >= totalSamplesNeeded) return AZA_SUCCESS;
-	// Have to realloc buffer
-	uint32_t newPerChannelBufferCap = (uint32_t)aza_grow(perChannelBufferCap, totalSamplesNeeded, 256);
-	float *newBuffer = aza_calloc(sizeof(float), newPerChannelBufferCap * src.channelLayout.count);
-	if (!newBuffer) return AZA_ERROR_OUT_OF_MEMORY;
-	for (uint8_t c = 0; c < src.channelLayout.count; c++) {
-		azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		float *newChannelBuffer = newBuffer + c * newPerChannelBufferCap;
-		if (data->buffer) {
-			memcpy(newChannelBuffer + newPerChannelBufferCap - perChannelBufferCap, channelData->buffer, sizeof(float) * perChannelBufferCap);
-		}
-		channelData->buffer = newChannelBuffer;
-		// Maybe we don't have to do this because we probably do it in Process
-		// channelData->delaySamples = aza_ms_to_samples(channelData->config.delay, (float)samplerate);
-	}
-	if (data->buffer) {
-		aza_free(data->buffer);
+void azaConvolutionWorkerDeinit() {
+	if (azaConvolutionWorkerLaunched) {
+		azaAtomicStore32(&azaConvolutionWorkerQuit, 1);
+		azaSemaphorePost(&azaConvolutionWorkerSemaphore, 1);
+		azaThreadJoin(&azaConvolutionWorkerThread);
+		azaConvolutionWorkerLaunched = false;
 	}
-	data->buffer = newBuffer;
-	data->bufferCap = newPerChannelBufferCap * src.channelLayout.count;
-	return AZA_SUCCESS;
+	azaSemaphoreDeinit(&azaConvolutionWorkerSemaphore);
+	azaMutexDeinit(&azaConvolutionWorkerMutex);
 }
 
-// Puts new audio data into the buffer for immediate sampling. Assumes azaDelayDynamicHandleBufferResizes was called already.
-static void azaDelayDynamicPrimeBuffer(azaDelayDynamic *data, azaBuffer src) {
-	uint32_t kernelSamples;
-	azaKernel *kernel = azaDelayDynamicGetKernel(data);
-	kernelSamples = (uint32_t)ceilf(kernel->isSymmetrical ? (kernel->length - 1.0f) * 2.0f : (kernel->length-1.0f));
-	// kernelSamples = 0;
-	uint32_t delaySamplesMax = (uint32_t)ceilf(aza_ms_to_samples(data->config.delayMax, (float)src.samplerate)) + kernelSamples;
-	for (uint8_t c = 0; c < src.channelLayout.count; c++) {
-		azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		// Move existing buffer back to make room for new buffer data
-		// This should work because we're expecting each buffer to be at least delaySamplesMax+src.frames in size
-		for (uint32_t i = 0; i < delaySamplesMax; i++) {
-			channelData->buffer[i] = channelData->buffer[i+src.frames];
+// MUST be called with azaConvolutionWorkerMutex locked
+static void azaConvolutionWorkerUnregister(azaConvolution *data) {
+	if (!data->workerRegistered) return;
+	for (azaConvolution **link = &azaConvolutionWorkerHead; *link; link = &(*link)->workerNext) {
+		if (*link == data) {
+			*link = data->workerNext;
+			break;
 		}
-		azaBufferCopyChannel((azaBuffer) {
-			.samples = channelData->buffer + delaySamplesMax,
-			.samplerate = src.samplerate,
-			.frames = src.frames,
-			.stride = 1,
-			.channelLayout = (azaChannelLayout) { .count = 1 },
-		}, 0, src, c);
 	}
+	data->workerNext = NULL;
+	data->workerRegistered = false;
 }
 
-uint32_t azaDelayDynamicGetAllocSize(uint8_t channelCapInline) {
-	size_t size = sizeof(azaDelayDynamic);
-	size = azaAddSizeWithAlign(size, channelCapInline * sizeof(azaDelayDynamicChannelData), alignof(azaDelayDynamicChannelData));
-	return (uint32_t)size;
+uint32_t azaConvolutionGetAllocSize() {
+	return sizeof(azaConvolution);
 }
 
-int azaDelayDynamicInit(azaDelayDynamic *data, uint32_t allocSize, azaDelayDynamicConfig config, uint8_t channelCapInline, uint8_t channelCount, azaDelayDynamicChannelConfig *channelConfigs) {
-	data->header.kind = AZA_DSP_DELAY_DYNAMIC;
+void azaConvolutionInit(azaConvolution *data, uint32_t allocSize, azaConvolutionConfig config) {
+	assert(allocSize >= azaConvolutionGetAllocSize());
+	memset(data, 0, sizeof(*data));
+	data->header.kind = AZA_DSP_CONVOLUTION;
 	data->header.structSize = allocSize;
 	data->config = config;
-	azaDSPChannelDataInit(&data->channelData, channelCapInline, sizeof(azaDelayDynamicChannelData), alignof(azaDelayDynamicChannelData));
-	int err = azaEnsureChannels(&data->channelData, channelCount);
-	if (err) return err;
-	if (channelConfigs) {
-		for (uint8_t c = 0; c < channelCount; c++) {
-			azaDelayDynamicChannelConfig *channelConfig = azaDelayDynamicGetChannelConfig(data, c);
-			*channelConfig = channelConfigs[c];
-		}
-	}
-	return AZA_SUCCESS;
 }
 
-void azaDelayDynamicDeinit(azaDelayDynamic *data) {
-	if (data->buffer) {
-		aza_free(data->buffer);
+// MUST be called with azaConvolutionWorkerMutex locked if data is registered with the worker
+static void azaConvolutionFreeBuffers(azaConvolution *data) {
+	azaConvolutionStageDeinit(&data->head);
+	azaConvolutionStageDeinit(&data->tail);
+	if (data->tailInput) {
+		aza_free(data->tailInput);
 	}
-	data->buffer = NULL;
-	data->bufferCap = 0;
+	data->tailInput = NULL;
+	data->tailOutput = NULL;
+	data->impulseResponse = NULL;
 }
 
-azaDelayDynamic* azaMakeDelayDynamic(azaDelayDynamicConfig config, uint8_t channelCapInline, uint8_t channelCount, azaDelayDynamicChannelConfig *channelConfigs) {
-	uint32_t size = azaDelayDynamicGetAllocSize(channelCapInline);
-	azaDelayDynamic *result = aza_calloc(1, size);
-	if (result) {
-		int err = azaDelayDynamicInit(result, size, config, channelCapInline, channelCount, channelConfigs);
-		if (err) {
-			aza_free(result);
-			return NULL;
-		}
+void azaConvolutionDeinit(azaConvolution *data) {
+	if (data->workerRegistered) {
+		azaMutexLock(&azaConvolutionWorkerMutex);
+		azaConvolutionWorkerUnregister(data);
+		azaMutexUnlock(&azaConvolutionWorkerMutex);
 	}
+	azaConvolutionFreeBuffers(data);
+}
+
+azaConvolution* azaMakeConvolution(azaConvolutionConfig config) {
+	uint32_t size = azaConvolutionGetAllocSize();
+	azaConvolution *result = aza_calloc(1, size);
+	if (result) azaConvolutionInit(result, size, config);
 	return result;
 }
 
-void azaFreeDelayDynamic(azaDelayDynamic *data) {
-	azaDelayDynamicDeinit(data);
+void azaFreeConvolution(azaConvolution *data) {
+	azaConvolutionDeinit(data);
 	aza_free(data);
 }
 
-int azaDelayDynamicProcess(azaDelayDynamic *data, azaBuffer buffer, float *endChannelDelays) {
-	int err = AZA_SUCCESS;
-	uint8_t numSideBuffers = 0;
-	if (data == NULL) return AZA_ERROR_NULL_POINTER;
-	err = azaCheckBuffer(buffer);
+static int azaConvolutionHandleBufferResizes(azaConvolution *data, uint8_t channels, uint32_t samplerate) {
+	// Check a copy since the IR is the user's and checking normalizes it
+	azaBuffer irChecked = *data->config.impulseResponse;
+	int err = azaCheckBuffer(&irChecked);
 	if (err) return err;
-	azaKernel *kernel = azaDelayDynamicGetKernel(data);
-	azaBuffer inputBuffer;
-	if (data->config.wetEffects) {
-		inputBuffer = azaPushSideBufferCopy(buffer);
-		numSideBuffers++;
-		err = azaDSPProcessSingle(data->config.wetEffects, inputBuffer);
-		if (err) goto error;
+	const azaBuffer *ir = &irChecked;
+	uint32_t headPartitionFrames = azaPowerOfTwoAtLeast(AZA_MAX(AZA_MIN(data->config.partitionFrames ? data->config.partitionFrames : AZAUDIO_CONVOLUTION_DEFAULT_PARTITION_FRAMES, 65536), 2));
+	uint32_t tailPartitionFrames = azaPowerOfTwoAtLeast(AZA_MAX(AZA_MIN(data->config.tailPartitionFrames ? data->config.tailPartitionFrames : AZAUDIO_CONVOLUTION_DEFAULT_TAIL_PARTITION_FRAMES, 65536), headPartitionFrames * 2));
+	if (data->impulseResponse == data->config.impulseResponse && data->channels == channels && data->samplerate == samplerate && data->offline == data->config.offline && data->head.partitionFrames == headPartitionFrames && (!data->tail.partitionCount || data->tail.partitionFrames == tailPartitionFrames)) return AZA_SUCCESS;
+	uint8_t irChannels = ir->channelLayout.count;
+	if (ir->samplerate != samplerate) return AZA_ERROR_MISMATCHED_SAMPLERATE;
+	if (irChannels != 1 && irChannels != channels) return AZA_ERROR_MISMATCHED_CHANNEL_COUNT;
+	// The worker can't be looking at us while we change
+	bool locked = data->workerRegistered;
+	if (locked) {
+		azaMutexLock(&azaConvolutionWorkerMutex);
+		azaConvolutionWorkerUnregister(data);
+	}
+	azaConvolutionFreeBuffers(data);
+	data->frame = 0;
+	data->tailSubmitted = 0;
+	data->tailNext = 0;
+	memset(data->tailInputTags, 0, sizeof(data->tailInputTags));
+	memset(data->tailOutputTags, 0, sizeof(data->tailOutputTags));
+	uint32_t headFrames = AZA_MIN(ir->frames, tailPartitionFrames * 2);
+	err = azaConvolutionStageInit(&data->head, headPartitionFrames, channels, ir, irChannels, 0, headFrames);
+	if (err) goto done;
+	err = azaConvolutionStageInit(&data->tail, tailPartitionFrames, channels, ir, irChannels, headFrames, ir->frames - headFrames);
+	if (err) goto done;
+	if (data->tail.partitionCount) {
+		size_t slotFloats = (size_t)tailPartitionFrames * channels * AZAUDIO_CONVOLUTION_TAIL_SLOTS;
+		data->tailInput = aza_calloc(slotFloats * 2, sizeof(float));
+		if (!data->tailInput) {
+			err = AZA_ERROR_OUT_OF_MEMORY;
+			goto done;
+		}
+		data->tailOutput = data->tailInput + slotFloats;
+	}
+	data->impulseResponse = data->config.impulseResponse;
+	data->channels = channels;
+	data->irChannels = irChannels;
+	data->samplerate = samplerate;
+	data->offline = data->config.offline;
+	if (data->tail.partitionCount && !data->offline) {
+		if (!locked) {
+			azaMutexLock(&azaConvolutionWorkerMutex);
+			locked = true;
+		}
+		data->workerNext = azaConvolutionWorkerHead;
+		azaConvolutionWorkerHead = data;
+		data->workerRegistered = true;
+		if (!azaConvolutionWorkerLaunched) {
+			if (azaThreadLaunch(&azaConvolutionWorkerThread, azaConvolutionWorkerProc, NULL)) {
+				AZA_LOG_ERR("azaConvolution error: Failed to launch the worker thread\n");
+			} else {
+				azaConvolutionWorkerLaunched = true;
+			}
+		}
+	}
+done:
+	if (err) {
+		azaConvolutionFreeBuffers(data);
+	}
+	if (locked) {
+		azaMutexUnlock(&azaConvolutionWorkerMutex);
+	}
+	return err;
+}
+
+int azaConvolutionProcess(azaConvolution *data, azaBuffer buffer) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	if (data->config.impulseResponse == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	err = azaConvolutionHandleBufferResizes(data, buffer.channelLayout.count, buffer.samplerate);
+	if (err) return err;
+	uint8_t channels = data->channels;
+	uint32_t headFrames = data->head.partitionFrames;
+	uint32_t tailFrames = data->tail.partitionFrames;
+	bool hasTail = data->tail.partitionCount != 0;
+	// Tail partition k covers impulse response frames from 2 tail partitions in, so its output belongs 2 tail partitions after its input, plus the same lag the head has.
+	uint64_t tailOutputStart = (uint64_t)tailFrames * 2 + headFrames;
+	size_t tailSlotFloats = (size_t)tailFrames * channels;
+	float amount = aza_db_to_ampf(data->config.gain);
+	float amountDry = aza_db_to_ampf(data->config.gainDry);
+	for (uint32_t frame = 0; frame < buffer.frames;) {
+		uint32_t headFill = (uint32_t)(data->frame % headFrames);
+		// Tail partitions are a whole number of head partitions and so is tailOutputStart, so staying within one head partition means we stay within one of everything.
+		uint32_t count = AZA_MIN(buffer.frames - frame, headFrames - headFill);
+		float *tailInput = NULL;
+		const float *tailOutput = NULL;
+		uint32_t tailJob = 0;
+		if (hasTail) {
+			tailJob = (uint32_t)(data->frame / tailFrames);
+			uint32_t slot = tailJob % AZAUDIO_CONVOLUTION_TAIL_SLOTS;
+			uint32_t tailFill = (uint32_t)(data->frame % tailFrames);
+			if (tailFill == 0) {
+				azaAtomicStore32(&data->tailInputTags[slot], 0);
+			}
+			tailInput = data->tailInput + tailSlotFloats * slot + tailFill;
+			if (data->frame >= tailOutputStart) {
+				uint64_t outputFrame = data->frame - tailOutputStart;
+				uint32_t outputJob = (uint32_t)(outputFrame / tailFrames);
+				uint32_t outputSlot = outputJob % AZAUDIO_CONVOLUTION_TAIL_SLOTS;
+				if (azaAtomicLoad32(&data->tailOutputTags[outputSlot]) == outputJob + 1) {
+					tailOutput = data->tailOutput + tailSlotFloats * outputSlot + outputFrame % tailFrames;
+				} else {
+					data->tailMisses++;
+				}
+			}
+		}
+		for (uint8_t c = 0; c < channels; c++) {
+			float *samples = buffer.samples + (size_t)frame * buffer.stride + c * buffer.channelStride;
+			float *headInput = data->head.windows + (size_t)headFrames * (2 * c + 1) + headFill;
+			const float *headOutput = data->head.output + (size_t)headFrames * c + headFill;
+			for (uint32_t i = 0; i < count; i++) {
+				headInput[i] = samples[i * buffer.stride];
+			}
+			if (tailInput) {
+				memcpy(tailInput + (size_t)tailFrames * c, headInput, sizeof(float) * count);
+			}
+			if (tailOutput) {
+				const float *tail = tailOutput + (size_t)tailFrames * c;
+				for (uint32_t i = 0; i < count; i++) {
+					samples[i * buffer.stride] = headInput[i] * amountDry + (headOutput[i] + tail[i]) * amount;
+				}
+			} else {
+				for (uint32_t i = 0; i < count; i++) {
+					samples[i * buffer.stride] = headInput[i] * amountDry + headOutput[i] * amount;
+				}
+			}
+		}
+		data->frame += count;
+		frame += count;
+		if (data->frame % headFrames == 0) {
+			azaConvolutionStageProcess(&data->head, channels, data->irChannels, data->head.output, headFrames);
+		}
+		if (hasTail && data->frame % tailFrames == 0) {
+			azaAtomicStore32(&data->tailInputTags[tailJob % AZAUDIO_CONVOLUTION_TAIL_SLOTS], tailJob + 1);
+			azaAtomicStore32(&data->tailSubmitted, tailJob + 1);
+			if (data->offline) {
+				azaConvolutionTailCatchUp(data);
+			} else {
+				azaSemaphorePost(&azaConvolutionWorkerSemaphore, 1);
+			}
+		}
+	}
+	if (data->header.pNext) {
+		return azaDSPProcessSingle(data->header.pNext, buffer);
+	}
+	return AZA_SUCCESS;
+}
+
+
+
+void azaSamplerInit(azaSampler *data, uint32_t allocSize, azaSamplerConfig config) {
+	data->header.kind = AZA_DSP_SAMPLER;
+	data->header.structSize = allocSize;
+	data->config = config;
+	data->pos.frame = 0;
+	data->pos.fraction = 0.0f;
+	data->s = config.speed;
+	// Starting at zero ensures click-free playback no matter what
+	data->g = 0.0f;
+	// TODO: Probably use envelopes
+	data->sinc = NULL;
+	memset(&data->resampler, 0, sizeof(data->resampler));
+	if (config.interpolation == AZA_SAMPLER_INTERPOLATION_SINC) {
+		// Init usually happens off the audio thread, so this is a good time to make sure the shared tables exist
+		azaSamplerPrepareSinc(config.kernel);
+	}
+}
+
+void azaSamplerDeinit(azaSampler *data) {
+	azaResamplerDeinit(&data->resampler);
+	data->resampler.kernel = NULL;
+	data->sinc = NULL;
+}
+
+azaSampler* azaMakeSampler(azaSamplerConfig config) {
+	uint32_t size = azaSamplerGetAllocSize();
+	azaSampler *result = aza_calloc(1, size);
+	if (result) azaSamplerInit(result, size, config);
+	return result;
+}
+
+void azaFreeSampler(azaSampler *data) {
+	azaSamplerDeinit(data);
+	aza_free(data);
+}
+
+static azaKernel* azaSamplerGetKernel(azaSampler *data) {
+	azaKernel *kernel = data->config.kernel;
+	if (!kernel) {
+		kernel = &azaKernelDefaultLanczosShort;
+	}
+	return kernel;
+}
+
+// Every cutoff step's table for one kernel
+typedef struct azaSamplerSincTables {
+	azaKernel *kernel;
+	// What kernel looked like when we built these, so a kernel that was remade in the same place doesn't get stale tables
+	float *kernelTable;
+	float kernelLength;
+	float kernelScale;
+	uint32_t kernelSize;
+	int kernelIsSymmetrical;
+	// Indexed by step, AZA_SAMPLER_SINC_STEP_COUNT of them
+	azaResampler *steps;
+} azaSamplerSincTables;
+
+// Step 0 is the unstretched kernel, and the last one reaches AZAUDIO_SAMPLER_SINC_MAX_CUTOFF_SCALE
+#define AZA_SAMPLER_SINC_STEP_COUNT ((uint32_t)ceilf(log2f(AZAUDIO_SAMPLER_SINC_MAX_CUTOFF_SCALE) * (float)AZAUDIO_SAMPLER_SINC_CUTOFF_STEPS_PER_OCTAVE) + 1)
+
+static azaSamplerSincTables azaSamplerSincCache[AZAUDIO_SAMPLER_SINC_CACHE_CAP];
+// Entries before this are finished and never change, so they can be read without the lock
+static volatile uint32_t azaSamplerSincCacheCount = 0;
+static azaMutex azaSamplerSincCacheMutex;
+
+static float azaSamplerSincStepCutoffScale(uint32_t step) {
+	return AZA_MIN(exp2f((float)step / (float)AZAUDIO_SAMPLER_SINC_CUTOFF_STEPS_PER_OCTAVE), AZAUDIO_SAMPLER_SINC_MAX_CUTOFF_SCALE);
+}
+
+static bool azaSamplerSincTablesMatch(const azaSamplerSincTables *tables, const azaKernel *kernel) {
+	return tables->kernel == kernel
+		&& tables->kernelTable == kernel->table
+		&& tables->kernelLength == kernel->length
+		&& tables->kernelScale == kernel->scale
+		&& tables->kernelSize == kernel->size
+		&& tables->kernelIsSymmetrical == kernel->isSymmetrical;
+}
+
+static void azaSamplerSincTablesDeinit(azaSamplerSincTables *data) {
+	if (!data->steps) return;
+	for (uint32_t step = 0; step < AZA_SAMPLER_SINC_STEP_COUNT; step++) {
+		azaResamplerDeinit(&data->steps[step]);
+	}
+	aza_free(data->steps);
+	data->steps = NULL;
+}
+
+static int azaSamplerSincTablesInit(azaSamplerSincTables *data, azaKernel *kernel) {
+	data->kernel = kernel;
+	data->kernelTable = kernel->table;
+	data->kernelLength = kernel->length;
+	data->kernelScale = kernel->scale;
+	data->kernelSize = kernel->size;
+	data->kernelIsSymmetrical = kernel->isSymmetrical;
+	data->steps = aza_calloc(AZA_SAMPLER_SINC_STEP_COUNT, sizeof(azaResampler));
+	if (!data->steps) return AZA_ERROR_OUT_OF_MEMORY;
+	for (uint32_t step = 0; step < AZA_SAMPLER_SINC_STEP_COUNT; step++) {
+		int err = azaResamplerInit(&data->steps[step], kernel, 0, azaSamplerSincStepCutoffScale(step));
+		if (err) return err;
+	}
+	return AZA_SUCCESS;
+}
+
+// Returns NULL if the cache is full or out of memory, in which case err says which
+static const azaSamplerSincTables* azaSamplerGetSincTables(azaKernel *kernel, int *err) {
+	*err = AZA_SUCCESS;
+	uint32_t count = azaAtomicLoad32(&azaSamplerSincCacheCount);
+	for (uint32_t i = 0; i < count; i++) {
+		if (azaSamplerSincTablesMatch(&azaSamplerSincCache[i], kernel)) return &azaSamplerSincCache[i];
+	}
+	const azaSamplerSincTables *result = NULL;
+	azaMutexLock(&azaSamplerSincCacheMutex);
+	// Someone else may have made it while we were looking
+	count = azaSamplerSincCacheCount;
+	for (uint32_t i = 0; i < count; i++) {
+		if (azaSamplerSincTablesMatch(&azaSamplerSincCache[i], kernel)) {
+			result = &azaSamplerSincCache[i];
+			goto done;
+		}
+	}
+	if (count < AZAUDIO_SAMPLER_SINC_CACHE_CAP) {
+		*err = azaSamplerSincTablesInit(&azaSamplerSincCache[count], kernel);
+		if (*err == AZA_SUCCESS) {
+			result = &azaSamplerSincCache[count];
+			azaAtomicStore32(&azaSamplerSincCacheCount, count + 1);
+		} else {
+			azaSamplerSincTablesDeinit(&azaSamplerSincCache[count]);
+		}
 	} else {
-		inputBuffer = buffer;
+		*err = AZA_ERROR_INVALID_CONFIGURATION;
 	}
-	err = azaDelayDynamicHandleBufferResizes(data, inputBuffer);
-	if (err) goto error;
-	// TODO: Verify whether this matters. It was difficult to tell whether there was any problem with not factoring in the kernel (which I suppose would only matter for very close to 0 delay).
-	int kernelSamplesLeft, kernelSamplesRight;
+done:
+	azaMutexUnlock(&azaSamplerSincCacheMutex);
+	return result;
+}
+
+int azaSamplerPrepareSinc(azaKernel *kernel) {
+	int err;
+	azaSamplerGetSincTables(kernel ? kernel : &azaKernelDefaultLanczosShort, &err);
+	return err;
+}
+
+void azaSamplerSincCacheInit() {
+	azaMutexInit(&azaSamplerSincCacheMutex);
+	azaSamplerSincCacheCount = 0;
+}
+
+void azaSamplerSincCacheDeinit() {
+	for (uint32_t i = 0; i < azaSamplerSincCacheCount; i++) {
+		azaSamplerSincTablesDeinit(&azaSamplerSincCache[i]);
+	}
+	azaSamplerSincCacheCount = 0;
+	azaMutexDeinit(&azaSamplerSincCacheMutex);
+}
+
+// Picks a table with a cutoff low enough for the fastest we'll play this block, where ratioMax is in source frames per output frame
+static int azaSamplerHandleResampler(azaSampler *data, float ratioMax) {
+	azaKernel *kernel = azaSamplerGetKernel(data);
+	uint32_t step = 0;
+	if (ratioMax > 1.0f) {
+		step = (uint32_t)AZA_MIN(ceilf(log2f(ratioMax) * (float)AZAUDIO_SAMPLER_SINC_CUTOFF_STEPS_PER_OCTAVE), (float)(AZA_SAMPLER_SINC_STEP_COUNT - 1));
+	}
+	int err;
+	const azaSamplerSincTables *tables = azaSamplerGetSincTables(kernel, &err);
+	if AZA_LIKELY(tables) {
+		data->sinc = &tables->steps[step];
+		return AZA_SUCCESS;
+	}
+	// No shared tables, so we're stuck building our own whenever the step changes
+	float cutoffScale = azaSamplerSincStepCutoffScale(step);
+	if AZA_UNLIKELY(data->resampler.kernel != kernel) {
+		azaResamplerDeinit(&data->resampler);
+		err = azaResamplerInit(&data->resampler, kernel, 0, cutoffScale);
+	} else {
+		// We only ever sample at single positions, so the factor is only there to pick the cutoff
+		err = azaResamplerSetFactor(&data->resampler, cutoffScale);
+	}
+	data->sinc = &data->resampler;
+	return err;
+}
+
+static inline const azaResampler* azaSamplerGetResampler(azaSampler *data) {
+	return data->sinc ? data->sinc : &data->resampler;
+}
+
+static inline uint32_t azaSamplerWrap(int64_t frame, uint32_t frames) {
+	if AZA_LIKELY(frame >= 0 && frame < (int64_t)frames) return (uint32_t)frame;
+	int64_t result = frame % (int64_t)frames;
+	return (uint32_t)(result < 0 ? result + frames : result);
+}
+
+// How many frames around pos the interpolation reads, so we know how much of a stream has to be ready and what we can let go of
+static void azaSamplerGetStreamReach(azaSampler *data, uint32_t *dstAhead, uint32_t *dstBehind) {
+	const azaResampler *resampler = azaSamplerGetResampler(data);
+	switch (data->config.interpolation) {
+		case AZA_SAMPLER_INTERPOLATION_LINEAR:
+			*dstAhead = 1;
+			*dstBehind = 0;
+			break;
+		case AZA_SAMPLER_INTERPOLATION_SINC:
+			*dstAhead = (uint32_t)AZA_MAX((int)resampler->taps - 1 + resampler->tapOffset, 0);
+			*dstBehind = (uint32_t)AZA_MAX(-resampler->tapOffset, 0);
+			break;
+		default:
+			*dstAhead = 2;
+			*dstBehind = 1;
+			break;
+	}
+}
+
+// Lets the I/O thread reuse everything behind pos that the interpolation won't read again
+static void azaSamplerConsumeStream(azaSampler *data, azaFileStream *stream, uint32_t streamConsumed, uint32_t streamReady, uint32_t streamBehind) {
+	// The I/O thread leaves AZAUDIO_FILE_STREAM_HISTORY_FRAMES behind consumed alone, so we only have to hold back taps beyond that
+	uint32_t offset = (data->pos.frame - streamConsumed) & (stream->capacity - 1);
+	uint32_t keep = streamBehind > AZAUDIO_FILE_STREAM_HISTORY_FRAMES ? streamBehind - AZAUDIO_FILE_STREAM_HISTORY_FRAMES : 0;
+	if (offset > keep) {
+		azaFileStreamConsume(stream, AZA_MIN(offset - keep, streamReady));
+	}
+}
+
+int azaSamplerProcess(azaSampler *data, azaBuffer buffer) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	azaFileStream *stream = data->config.stream;
+	azaBuffer srcView;
+	if (stream) {
+		// The ring is just a looping buffer whose length is a power of two, so the usual wrapping does the right thing
+		srcView = (azaBuffer) {
+			.samples = stream->ring,
+			.samplerate = stream->samplerate,
+			.frames = stream->capacity,
+			.stride = stream->channels,
+			.channelStride = 1,
+			.channelLayout = { .count = stream->channels },
+		};
+	} else {
+		if (data->config.buffer == NULL) return AZA_ERROR_NULL_POINTER;
+		// A copy so we can normalize it without touching the user's buffer
+		srcView = *data->config.buffer;
+		azaBufferNormalize(&srcView);
+	}
+	azaBuffer *src = &srcView;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	if (buffer.channelLayout.count != src->channelLayout.count) return AZA_ERROR_MISMATCHED_CHANNEL_COUNT;
+	if (src->frames == 0) return AZA_ERROR_INVALID_FRAME_COUNT;
+	// In case config.buffer was swapped for a shorter one
+	data->pos.frame = azaSamplerWrap(data->pos.frame, src->frames);
+	float transition = expf(-1.0f / (AZAUDIO_SAMPLER_TRANSITION_FRAMES));
+	float samplerateFactor = (float)src->samplerate / (float)buffer.samplerate;
+	azaSamplerInterpolation interpolation = data->config.interpolation;
+	azaScratchMark mark = azaMarkSideBuffers();
+	// Taps gathered from around the loop point, which can't be read in one run
+	float *wrapped = NULL;
+	if (interpolation == AZA_SAMPLER_INTERPOLATION_SINC) {
+		// Speed only ever eases towards config.speed, so this is the fastest we'll go this block
+		err = azaSamplerHandleResampler(data, AZA_MAX(data->s, data->config.speed) * samplerateFactor);
+		if (err) goto done;
+		wrapped = azaPushSideBuffer(data->sinc->taps, 1, buffer.samplerate).samples;
+		if (!wrapped) {
+			err = AZA_ERROR_OUT_OF_MEMORY;
+			goto done;
+		}
+	}
+	const azaResampler *resampler = azaSamplerGetResampler(data);
+	// For streams, how many frames around pos the interpolation reads
+	uint32_t streamAhead = 0, streamBehind = 0;
+	uint32_t streamReady = 0, streamConsumed = 0;
+	bool streamUnderrun = false;
+	if (stream) {
+		azaSamplerGetStreamReach(data, &streamAhead, &streamBehind);
+		streamReady = azaFileStreamGetReady(stream);
+		streamConsumed = stream->consumed;
+	}
+	for (size_t i = 0; i < buffer.frames; i++) {
+		data->s = data->config.speed + transition * (data->s - data->config.speed);
+		data->g = data->config.gain + transition * (data->g - data->config.gain);
+
+		if (stream) {
+			uint32_t offset = (data->pos.frame - streamConsumed) & (stream->capacity - 1);
+			if AZA_UNLIKELY(offset + streamAhead >= streamReady) {
+				// Either the I/O thread fell behind or the file is over, and we can't wait on either
+				streamUnderrun |= !azaAtomicLoad32(&stream->ended);
+				for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+					buffer.samples[i * buffer.stride + c * buffer.channelStride] = 0.0f;
+				}
+				continue;
+			}
+		}
+
+		// Adjust for different samplerates
+		float speed = data->s * samplerateFactor;
+		float volume = azaFastDbToAmpf(data->g);
+		float *dst = buffer.samples + i * buffer.stride;
+		float fraction = data->pos.fraction;
+
+		switch (interpolation) {
+			case AZA_SAMPLER_INTERPOLATION_LINEAR: {
+				uint32_t i0 = data->pos.frame;
+				uint32_t i1 = i0 + 1 < src->frames ? i0 + 1 : 0;
+				for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+					const float *s = src->samples + c * src->channelStride;
+					dst[c * buffer.channelStride] = volume * azaLerp(s[i0 * src->stride], s[i1 * src->stride], fraction);
+				}
+			} break;
+			case AZA_SAMPLER_INTERPOLATION_SINC: {
+				float phase = fraction * (float)resampler->phases;
+				uint32_t row = (uint32_t)phase;
+				// fraction can round up to exactly 1
+				if (row >= resampler->phases) row = resampler->phases - 1;
+				float t = phase - (float)row;
+				const float *coefficients0 = resampler->table + row * resampler->tapsStride;
+				const float *coefficients1 = coefficients0 + resampler->tapsStride;
+				int64_t start = (int64_t)data->pos.frame + resampler->tapOffset;
+				bool contiguous = start >= 0 && start + resampler->taps <= src->frames;
+				for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+					const float *s = src->samples + c * src->channelStride;
+					float sample;
+					if AZA_LIKELY(contiguous) {
+						sample = azaSIMDDotLerp(s + start * src->stride, src->stride, coefficients0, coefficients1, t, resampler->taps);
+					} else {
+						for (uint32_t tap = 0; tap < resampler->taps; tap++) {
+							wrapped[tap] = s[azaSamplerWrap(start + tap, src->frames) * src->stride];
+						}
+						sample = azaSIMDDotLerp(wrapped, 1, coefficients0, coefficients1, t, resampler->taps);
+					}
+					dst[c * buffer.channelStride] = volume * sample;
+				}
+			} break;
+			default: {
+				uint32_t i0 = azaSamplerWrap((int64_t)data->pos.frame - 1, src->frames);
+				uint32_t i1 = data->pos.frame;
+				uint32_t i2 = azaSamplerWrap((int64_t)data->pos.frame + 1, src->frames);
+				uint32_t i3 = azaSamplerWrap((int64_t)data->pos.frame + 2, src->frames);
+				for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+					const float *s = src->samples + c * src->channelStride;
+					dst[c * buffer.channelStride] = volume * cubic(s[i0 * src->stride], s[i1 * src->stride], s[i2 * src->stride], s[i3 * src->stride], fraction);
+				}
+			} break;
+		}
+
+		data->pos.fraction += speed;
+		uint32_t framesToAdd = (uint32_t)data->pos.fraction;
+		data->pos.fraction -= framesToAdd;
+		data->pos.frame = azaSamplerWrap((int64_t)data->pos.frame + framesToAdd, src->frames);
+	}
+	if (stream) {
+		if (streamUnderrun) stream->underruns++;
+		azaSamplerConsumeStream(data, stream, streamConsumed, streamReady, streamBehind);
+	}
+	azaReleaseSideBuffers(mark);
+	if (data->header.pNext) {
+		return azaDSPProcessSingle(data->header.pNext, buffer);
+	}
+	return AZA_SUCCESS;
+done:
+	azaReleaseSideBuffers(mark);
+	return err;
+}
+
+int azaSamplerSkip(azaSampler *data, uint32_t frames, uint32_t samplerate) {
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	if (samplerate == 0) return AZA_ERROR_INVALID_CONFIGURATION;
+	azaFileStream *stream = data->config.stream;
+	uint32_t srcFrames, srcSamplerate;
+	if (stream) {
+		srcFrames = stream->capacity;
+		srcSamplerate = stream->samplerate;
+	} else {
+		if (data->config.buffer == NULL) return AZA_ERROR_NULL_POINTER;
+		srcFrames = data->config.buffer->frames;
+		srcSamplerate = data->config.buffer->samplerate;
+	}
+	if (srcFrames == 0) return AZA_ERROR_INVALID_FRAME_COUNT;
+	data->pos.frame = azaSamplerWrap(data->pos.frame, srcFrames);
+	float transition = expf(-1.0f / (AZAUDIO_SAMPLER_TRANSITION_FRAMES));
+	float samplerateFactor = (float)srcSamplerate / (float)samplerate;
+	uint32_t streamAhead = 0, streamBehind = 0;
+	uint32_t streamReady = 0, streamConsumed = 0;
+	bool streamUnderrun = false;
+	if (stream) {
+		azaSamplerGetStreamReach(data, &streamAhead, &streamBehind);
+		streamReady = azaFileStreamGetReady(stream);
+		streamConsumed = stream->consumed;
+	}
+	// Same steps as azaSamplerProcess, so we end up exactly where it would have
+	for (uint32_t i = 0; i < frames; i++) {
+		data->s = data->config.speed + transition * (data->s - data->config.speed);
+		data->g = data->config.gain + transition * (data->g - data->config.gain);
+		if (stream) {
+			uint32_t offset = (data->pos.frame - streamConsumed) & (stream->capacity - 1);
+			if AZA_UNLIKELY(offset + streamAhead >= streamReady) {
+				streamUnderrun |= !azaAtomicLoad32(&stream->ended);
+				continue;
+			}
+		}
+		data->pos.fraction += data->s * samplerateFactor;
+		uint32_t framesToAdd = (uint32_t)data->pos.fraction;
+		data->pos.fraction -= framesToAdd;
+		data->pos.frame = azaSamplerWrap((int64_t)data->pos.frame + framesToAdd, srcFrames);
+	}
+	if (stream) {
+		if (streamUnderrun) stream->underruns++;
+		azaSamplerConsumeStream(data, stream, streamConsumed, streamReady, streamBehind);
+	}
+	return AZA_SUCCESS;
+}
+
+
+
+enum {
+	AZA_SAMPLER_BANK_VOICE_LOOPING = 1,
+	AZA_SAMPLER_BANK_VOICE_STOPPING = 2,
+};
+// Stopping voices are dropped once their amp falls below this (-80dB)
+#define AZA_SAMPLER_BANK_SILENT_AMP 0.0001f
+#define AZA_SAMPLER_BANK_SLOT_NONE UINT16_MAX
+
+// Places one of the per-voice arrays after everything before it. base may be NULL if we only want the size.
+static void* azaSamplerBankArray(char *base, size_t *size, uint16_t voiceCap, size_t elementSize, size_t alignment) {
+	*size = aza_align(*size, alignment);
+	void *result = base ? base + *size : NULL;
+	*size += voiceCap * elementSize;
+	return result;
+}
+
+static size_t azaSamplerBankLayout(azaSamplerBank *data, uint16_t voiceCap) {
+	char *base = (char*)data;
+	size_t size = sizeof(azaSamplerBank);
+	void *voiceBuffer      = azaSamplerBankArray(base, &size, voiceCap, sizeof(azaBuffer*), alignof(azaBuffer*));
+	void *voiceFrame       = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint32_t), alignof(uint32_t));
+	void *voiceFraction    = azaSamplerBankArray(base, &size, voiceCap, sizeof(float), alignof(float));
+	void *voiceSpeed       = azaSamplerBankArray(base, &size, voiceCap, sizeof(float), alignof(float));
+	void *voiceSpeedTarget = azaSamplerBankArray(base, &size, voiceCap, sizeof(float), alignof(float));
+	void *voiceAmp         = azaSamplerBankArray(base, &size, voiceCap, sizeof(float), alignof(float));
+	void *voiceAmpTarget   = azaSamplerBankArray(base, &size, voiceCap, sizeof(float), alignof(float));
+	void *voiceLoopStart   = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint32_t), alignof(uint32_t));
+	void *voiceLoopEnd     = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint32_t), alignof(uint32_t));
+	void *voicePriority    = azaSamplerBankArray(base, &size, voiceCap, sizeof(int32_t), alignof(int32_t));
+	void *voiceSerial      = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint32_t), alignof(uint32_t));
+	void *voiceHandle      = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint16_t), alignof(uint16_t));
+	void *handleSlot       = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint16_t), alignof(uint16_t));
+	void *handleGeneration = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint16_t), alignof(uint16_t));
+	void *handleFree       = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint16_t), alignof(uint16_t));
+	void *voiceFlags       = azaSamplerBankArray(base, &size, voiceCap, sizeof(uint8_t), alignof(uint8_t));
+	if (data) {
+		data->voiceBuffer = voiceBuffer;
+		data->voiceFrame = voiceFrame;
+		data->voiceFraction = voiceFraction;
+		data->voiceSpeed = voiceSpeed;
+		data->voiceSpeedTarget = voiceSpeedTarget;
+		data->voiceAmp = voiceAmp;
+		data->voiceAmpTarget = voiceAmpTarget;
+		data->voiceLoopStart = voiceLoopStart;
+		data->voiceLoopEnd = voiceLoopEnd;
+		data->voicePriority = voicePriority;
+		data->voiceSerial = voiceSerial;
+		data->voiceHandle = voiceHandle;
+		data->handleSlot = handleSlot;
+		data->handleGeneration = handleGeneration;
+		data->handleFree = handleFree;
+		data->voiceFlags = voiceFlags;
+	}
+	return size;
+}
+
+uint32_t azaSamplerBankGetAllocSize(uint16_t voiceCap) {
+	return (uint32_t)azaSamplerBankLayout(NULL, voiceCap);
+}
+
+void azaSamplerBankInit(azaSamplerBank *data, uint32_t allocSize, azaSamplerBankConfig config, uint16_t voiceCap) {
+	assert(allocSize >= azaSamplerBankGetAllocSize(voiceCap));
+	data->header.kind = AZA_DSP_SAMPLER_BANK;
+	data->header.structSize = allocSize;
+	data->config = config;
+	data->amp = aza_db_to_ampf(config.gain);
+	data->voiceCap = voiceCap;
+	data->voiceCount = 0;
+	data->serial = 0;
+	azaSamplerBankLayout(data, voiceCap);
+	// Handles are handed out from the back, so the first voice gets handle 0
+	data->handleFreeCount = voiceCap;
+	for (uint16_t i = 0; i < voiceCap; i++) {
+		data->handleFree[i] = voiceCap - 1 - i;
+		data->handleSlot[i] = AZA_SAMPLER_BANK_SLOT_NONE;
+		// Generation is never 0, so neither is a valid id
+		data->handleGeneration[i] = 1;
+	}
+}
+
+void azaSamplerBankDeinit(azaSamplerBank *data) {
+	// Nothing to do :)
+}
+
+azaSamplerBank* azaMakeSamplerBank(azaSamplerBankConfig config, uint16_t voiceCap) {
+	uint32_t size = azaSamplerBankGetAllocSize(voiceCap);
+	azaSamplerBank *result = aza_calloc(1, size);
+	if (result) azaSamplerBankInit(result, size, config, voiceCap);
+	return result;
+}
+
+void azaFreeSamplerBank(azaSamplerBank *data) {
+	azaSamplerBankDeinit(data);
+	aza_free(data);
+}
+
+static uint16_t azaSamplerBankGetSlot(azaSamplerBank *data, azaSamplerBankVoiceID id) {
+	uint16_t handle = (uint16_t)(id & 0xffff);
+	uint16_t generation = (uint16_t)(id >> 16);
+	if (data == NULL || handle >= data->voiceCap || data->handleGeneration[handle] != generation) return AZA_SAMPLER_BANK_SLOT_NONE;
+	return data->handleSlot[handle];
+}
+
+// Invalidates the voice's id and moves the last voice into its slot
+static void azaSamplerBankFreeSlot(azaSamplerBank *data, uint16_t slot) {
+	uint16_t handle = data->voiceHandle[slot];
+	data->handleSlot[handle] = AZA_SAMPLER_BANK_SLOT_NONE;
+	if (++data->handleGeneration[handle] == 0) data->handleGeneration[handle] = 1;
+	data->handleFree[data->handleFreeCount++] = handle;
+	uint16_t last = --data->voiceCount;
+	if (slot == last) return;
+	data->voiceBuffer[slot]      = data->voiceBuffer[last];
+	data->voiceFrame[slot]       = data->voiceFrame[last];
+	data->voiceFraction[slot]    = data->voiceFraction[last];
+	data->voiceSpeed[slot]       = data->voiceSpeed[last];
+	data->voiceSpeedTarget[slot] = data->voiceSpeedTarget[last];
+	data->voiceAmp[slot]         = data->voiceAmp[last];
+	data->voiceAmpTarget[slot]   = data->voiceAmpTarget[last];
+	data->voiceLoopStart[slot]   = data->voiceLoopStart[last];
+	data->voiceLoopEnd[slot]     = data->voiceLoopEnd[last];
+	data->voicePriority[slot]    = data->voicePriority[last];
+	data->voiceSerial[slot]      = data->voiceSerial[last];
+	data->voiceHandle[slot]      = data->voiceHandle[last];
+	data->voiceFlags[slot]       = data->voiceFlags[last];
+	data->handleSlot[data->voiceHandle[slot]] = slot;
+}
+
+azaSamplerBankVoiceID azaSamplerBankPlay(azaSamplerBank *data, azaSamplerBankVoiceConfig config) {
+	if (data == NULL || config.buffer == NULL || config.buffer->samples == NULL || config.buffer->frames == 0 || config.buffer->channelLayout.count == 0) return 0;
+	if (data->voiceCount == data->voiceCap) {
+		uint16_t victim = AZA_SAMPLER_BANK_SLOT_NONE;
+		for (uint16_t slot = 0; slot < data->voiceCount; slot++) {
+			int32_t priority = data->voicePriority[slot];
+			if (priority > config.priority) continue;
+			if (victim == AZA_SAMPLER_BANK_SLOT_NONE
+			 || priority < data->voicePriority[victim]
+			 || (priority == data->voicePriority[victim] && data->serial - data->voiceSerial[slot] > data->serial - data->voiceSerial[victim])) {
+				victim = slot;
+			}
+		}
+		if (victim == AZA_SAMPLER_BANK_SLOT_NONE) return 0;
+		azaSamplerBankFreeSlot(data, victim);
+	}
+	uint16_t slot = data->voiceCount++;
+	uint16_t handle = data->handleFree[--data->handleFreeCount];
+	data->handleSlot[handle] = slot;
+	data->voiceHandle[slot] = handle;
+	uint32_t loopEnd = AZA_MIN(config.loopEnd, config.buffer->frames);
+	float speed = AZA_MAX(config.speed, 0.0f);
+	data->voiceBuffer[slot] = config.buffer;
+	data->voiceFrame[slot] = 0;
+	data->voiceFraction[slot] = 0.0f;
+	data->voiceSpeed[slot] = speed;
+	data->voiceSpeedTarget[slot] = speed;
+	// Starting at zero ensures click-free playback no matter what
+	data->voiceAmp[slot] = 0.0f;
+	data->voiceAmpTarget[slot] = aza_db_to_ampf(config.gain);
+	data->voiceLoopStart[slot] = config.loopStart;
+	data->voiceLoopEnd[slot] = loopEnd;
+	data->voicePriority[slot] = config.priority;
+	data->voiceSerial[slot] = data->serial++;
+	data->voiceFlags[slot] = loopEnd > config.loopStart ? AZA_SAMPLER_BANK_VOICE_LOOPING : 0;
+	return ((uint32_t)data->handleGeneration[handle] << 16) | handle;
+}
+
+void azaSamplerBankStop(azaSamplerBank *data, azaSamplerBankVoiceID id) {
+	uint16_t slot = azaSamplerBankGetSlot(data, id);
+	if (slot == AZA_SAMPLER_BANK_SLOT_NONE) return;
+	data->voiceAmpTarget[slot] = 0.0f;
+	data->voiceFlags[slot] |= AZA_SAMPLER_BANK_VOICE_STOPPING;
+}
+
+void azaSamplerBankRelease(azaSamplerBank *data, azaSamplerBankVoiceID id) {
+	uint16_t slot = azaSamplerBankGetSlot(data, id);
+	if (slot == AZA_SAMPLER_BANK_SLOT_NONE) return;
+	data->voiceFlags[slot] &= ~AZA_SAMPLER_BANK_VOICE_LOOPING;
+}
+
+void azaSamplerBankSetGain(azaSamplerBank *data, azaSamplerBankVoiceID id, float gain) {
+	uint16_t slot = azaSamplerBankGetSlot(data, id);
+	if (slot == AZA_SAMPLER_BANK_SLOT_NONE) return;
+	if (data->voiceFlags[slot] & AZA_SAMPLER_BANK_VOICE_STOPPING) return;
+	data->voiceAmpTarget[slot] = aza_db_to_ampf(gain);
+}
+
+void azaSamplerBankSetSpeed(azaSamplerBank *data, azaSamplerBankVoiceID id, float speed) {
+	uint16_t slot = azaSamplerBankGetSlot(data, id);
+	if (slot == AZA_SAMPLER_BANK_SLOT_NONE) return;
+	data->voiceSpeedTarget[slot] = AZA_MAX(speed, 0.0f);
+}
+
+bool azaSamplerBankIsPlaying(azaSamplerBank *data, azaSamplerBankVoiceID id) {
+	return azaSamplerBankGetSlot(data, id) != AZA_SAMPLER_BANK_SLOT_NONE;
+}
+
+// Adds one voice into dst, returning false once the voice is done
+static bool azaSamplerBankRenderVoice(azaSamplerBank *data, uint16_t slot, azaBuffer dst, float bankAmpStart, float bankAmpEnd, float transitionChunk, float transitionTail) {
+	// A copy so we can normalize it without touching the user's buffer
+	azaBuffer srcView = *data->voiceBuffer[slot];
+	azaBufferNormalize(&srcView);
+	const azaBuffer *src = &srcView;
+	uint8_t srcChannels = src->channelLayout.count;
+	uint8_t channels = dst.channelLayout.count;
+	if (srcChannels != 1 && srcChannels < channels) channels = srcChannels;
+	float rateFactor = (float)src->samplerate / (float)dst.samplerate;
+	bool looping = data->voiceFlags[slot] & AZA_SAMPLER_BANK_VOICE_LOOPING;
+	bool stopping = data->voiceFlags[slot] & AZA_SAMPLER_BANK_VOICE_STOPPING;
+	uint32_t loopStart = data->voiceLoopStart[slot];
+	uint32_t loopEnd = data->voiceLoopEnd[slot];
+	uint32_t loopLength = loopEnd - loopStart;
+	// Past this we have to wrap or run out of samples
+	uint32_t end = looping ? loopEnd : src->frames;
+	uint32_t frame = data->voiceFrame[slot];
+	float fraction = data->voiceFraction[slot];
+	float speed = data->voiceSpeed[slot];
+	float speedTarget = data->voiceSpeedTarget[slot];
+	float amp = data->voiceAmp[slot];
+	float ampTarget = data->voiceAmpTarget[slot];
+	float bankAmpStep = (bankAmpEnd - bankAmpStart) / (float)dst.frames;
+	bool alive = true;
+
+	int32_t offset[AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES];
+	float t[AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES];
+	float a[AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES];
+	float sample[AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES];
+	for (uint32_t start = 0; start < dst.frames && alive; start += AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES) {
+		uint32_t frames = AZA_MIN(dst.frames - start, AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES);
+		float transition = frames == AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES ? transitionChunk : transitionTail;
+		float speedEnd = speedTarget + transition * (speed - speedTarget);
+		float ampEnd = ampTarget + transition * (amp - ampTarget);
+		// Speed and amp ramp linearly across the chunk, so position is a running sum of a linear ramp
+		float rate = speed * rateFactor;
+		float rateStepHalf = 0.5f * (speedEnd - speed) * rateFactor / (float)frames;
+		float gain = amp * (bankAmpStart + bankAmpStep * (float)start);
+		float gainStep = (ampEnd * (bankAmpStart + bankAmpStep * (float)(start + frames)) - gain) / (float)frames;
+		// Positions stay well below 2^31 frames past frame, so we can use the cheaper signed conversions
+		// This always fills the whole chunk because a fixed count is what lets the compiler vectorize it
+		for (uint32_t i = 0; i < AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES; i++) {
+			float x = fraction + rate * (float)i + rateStepHalf * (float)(i * (i-1));
+			int32_t whole = (int32_t)x;
+			offset[i] = whole;
+			t[i] = x - (float)whole;
+			a[i] = gain + gainStep * (float)i;
+		}
+		// Frames before this can read both of their samples without wrapping
+		uint32_t fast = frames;
+		if (frame + (uint32_t)offset[frames-1] + 1 >= end) {
+			fast = 0;
+			while (frame + (uint32_t)offset[fast] + 1 < end) fast++;
+		}
+		for (uint32_t i = 0; i < fast; i++) {
+			offset[i] *= src->stride;
+		}
+		float *out = dst.samples + start * dst.stride;
+		if (srcChannels == 1 && channels > 1) {
+			// Mono sources are interpolated once and then added to every channel
+			const float *s = src->samples + frame * src->stride;
+			const float *sNext = s + src->stride;
+			for (uint32_t i = 0; i < fast; i++) {
+				float s0 = s[offset[i]];
+				float s1 = sNext[offset[i]];
+				sample[i] = a[i] * (s0 + t[i] * (s1 - s0));
+			}
+			for (uint8_t c = 0; c < channels; c++) {
+				float *o = out + c * dst.channelStride;
+				for (uint32_t i = 0; i < fast; i++) {
+					o[i * dst.stride] += sample[i];
+				}
+			}
+		} else {
+			for (uint8_t c = 0; c < channels; c++) {
+				const float *s = src->samples + frame * src->stride + c * src->channelStride;
+				const float *sNext = s + src->stride;
+				float *o = out + c * dst.channelStride;
+				for (uint32_t i = 0; i < fast; i++) {
+					float s0 = s[offset[i]];
+					float s1 = sNext[offset[i]];
+					o[i * dst.stride] += a[i] * (s0 + t[i] * (s1 - s0));
+				}
+			}
+		}
+		for (uint32_t i = fast; i < frames; i++) {
+			uint32_t i0 = frame + (uint32_t)offset[i];
+			if (looping) {
+				while (i0 >= loopEnd) i0 -= loopLength;
+			} else if (i0 >= src->frames) {
+				alive = false;
+				break;
+			}
+			uint32_t i1 = i0 + 1;
+			bool hasNext = true;
+			if (i1 >= end) {
+				if (looping) {
+					i1 = loopStart;
+				} else {
+					hasNext = false;
+				}
+			}
+			for (uint8_t c = 0; c < channels; c++) {
+				const float *s = src->samples + (srcChannels == 1 ? 0 : c) * src->channelStride;
+				float s0 = s[i0 * src->stride];
+				float s1 = hasNext ? s[i1 * src->stride] : 0.0f;
+				out[i * dst.stride + c * dst.channelStride] += a[i] * (s0 + t[i] * (s1 - s0));
+			}
+		}
+		float x = fraction + rate * (float)frames + rateStepHalf * (float)(frames * (frames-1));
+		uint32_t whole = (uint32_t)x;
+		frame += whole;
+		fraction = x - (float)whole;
+		if (looping) {
+			while (frame >= loopEnd) frame -= loopLength;
+		} else if (frame >= src->frames) {
+			alive = false;
+		}
+		speed = speedEnd;
+		amp = ampEnd;
+		if (stopping && amp < AZA_SAMPLER_BANK_SILENT_AMP) {
+			alive = false;
+		}
+	}
+	data->voiceFrame[slot] = frame;
+	data->voiceFraction[slot] = fraction;
+	data->voiceSpeed[slot] = speed;
+	data->voiceAmp[slot] = amp;
+	return alive;
+}
+
+int azaSamplerBankProcess(azaSamplerBank *data, azaBuffer buffer) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	azaBufferZero(buffer);
+	float bankAmpStart = data->amp;
+	float bankAmpEnd = aza_db_to_ampf(data->config.gain);
+	data->amp = bankAmpEnd;
+	float transitionChunk = expf(-(float)AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES / (AZAUDIO_SAMPLER_TRANSITION_FRAMES));
+	float transitionTail = expf(-(float)(buffer.frames % AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES) / (AZAUDIO_SAMPLER_TRANSITION_FRAMES));
+	// Going backwards means a finished voice is always replaced by one we've already done
+	for (uint16_t slot = data->voiceCount; slot-- > 0;) {
+		if (!azaSamplerBankRenderVoice(data, slot, buffer, bankAmpStart, bankAmpEnd, transitionChunk, transitionTail)) {
+			azaSamplerBankFreeSlot(data, slot);
+		}
+	}
+	if (data->header.pNext) {
+		return azaDSPProcessSingle(data->header.pNext, buffer);
+	}
+	return AZA_SUCCESS;
+}
+
+
+
+
+uint32_t azaGateGetAllocSize() {
+	size_t size = sizeof(azaGate);
+	size = azaAddSizeWithAlign(size, azaRMSGetAllocSize(1), alignof(azaRMS));
+	return (uint32_t)size;
+}
+
+void azaGateInit(azaGate *data, uint32_t allocSize, azaGateConfig config) {
+	data->header.kind = AZA_DSP_GATE;
+	data->header.structSize = allocSize;
+	data->config = config;
+	azaRMSConfig rmsConfig = (azaRMSConfig) {
+		.window = AZAUDIO_RMS_DEFAULT_WINDOW_MS,
+		.combineOp = azaOpMax
+	};
+	azaRMSInit(&data->rms, azaRMSGetAllocSize(1), rmsConfig, 1);
+}
+
+void azaGateDeinit(azaGate *data) {
+	azaRMSDeinit(&data->rms);
+}
+
+azaGate* azaMakeGate(azaGateConfig config) {
+	uint32_t size = azaGateGetAllocSize();
+	azaGate *result = aza_calloc(1, size);
+	if (result) azaGateInit(result, size, config);
+	return result;
+}
+
+void azaFreeGate(azaGate *data) {
+	azaGateDeinit(data);
+	aza_free(data);
+}
+
+int azaGateProcess(azaGate *data, azaBuffer buffer) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	azaBuffer rmsBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	azaBuffer activationBuffer = buffer;
+	uint8_t sideBuffersInUse = 1;
+
+	if (data->config.activationEffects) {
+		activationBuffer = azaPushSideBufferCopy(buffer);
+		sideBuffersInUse++;
+		int err = azaDSPProcessSingle(data->config.activationEffects, activationBuffer);
+		if (err) {
+			azaPopSideBuffers(sideBuffersInUse);
+			return err;
+		}
+	}
+
+	err = azaRMSProcessDual(&data->rms, rmsBuffer, activationBuffer);
+	if (err) {
+		azaPopSideBuffers(sideBuffersInUse);
+		return err;
+	}
+	float t = (float)buffer.samplerate / 1000.0f;
+	float attackFactor = azaFastExpf(-1.0f / (data->config.attack * t));
+	float decayFactor = azaFastExpf(-1.0f / (data->config.decay * t));
+
+	azaSIMDAmpToDb(rmsBuffer.samples, rmsBuffer.samples, buffer.frames);
+	for (size_t i = 0; i < buffer.frames; i++) {
+		float rms = rmsBuffer.samples[i];
+		if (rms < -120.0f) rms = -120.0f;
+		if (rms > data->config.threshold) {
+			data->attenuation = rms + attackFactor * (data->attenuation - rms);
+		} else {
+			data->attenuation = rms + decayFactor * (data->attenuation - rms);
+		}
+		float gain;
+		if (data->attenuation > data->config.threshold) {
+			gain = 0.0f;
+		} else {
+			gain = -10.0f * (data->config.threshold - data->attenuation);
+		}
+		data->gain = gain;
+		// Reuse the rms buffer for the gain
+		rmsBuffer.samples[i] = gain;
+	}
+	azaSIMDDbToAmp(rmsBuffer.samples, rmsBuffer.samples, buffer.frames);
+	for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+		float *dst = buffer.samples + c * buffer.channelStride;
+		for (size_t i = 0; i < buffer.frames; i++) {
+			dst[i * buffer.stride] *= rmsBuffer.samples[i];
+		}
+	}
+	azaPopSideBuffers(sideBuffersInUse);
+	if (data->header.pNext) {
+		return azaDSPProcessSingle(data->header.pNext, buffer);
+	}
+	return AZA_SUCCESS;
+}
+
+
+
+azaDelayDynamicChannelConfig* azaDelayDynamicGetChannelConfig(azaDelayDynamic *data, uint8_t channel) {
+	azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, channel);
+	return &channelData->config;
+}
+
+static azaKernel* azaDelayDynamicGetKernel(azaDelayDynamic *data) {
+	azaKernel *kernel = data->config.kernel;
+	if (!kernel) {
+		kernel = &azaKernelDefaultLanczos;
+	}
+	return kernel;
+}
+
+static int azaDelayDynamicHandleResampler(azaDelayDynamic *data) {
+	azaKernel *kernel = azaDelayDynamicGetKernel(data);
+	if AZA_LIKELY(data->resampler.kernel == kernel) return AZA_SUCCESS;
+	azaResamplerDeinit(&data->resampler);
+	// NOTE: The delay time can sweep in either direction, so rather than rebuild the tables every time the effective factor changes we stick with the unstretched kernel, which is what we did when sampling the kernel directly.
+	return azaResamplerInit(&data->resampler, kernel, 0, 1.0f);
+}
+
+// How many frames the kernel reaches to either side of where it samples
+static void azaDelayDynamicGetKernelSamples(azaDelayDynamic *data, int *dstLeft, int *dstRight) {
+	azaKernel *kernel = azaDelayDynamicGetKernel(data);
 	if (kernel->isSymmetrical) {
-		kernelSamplesLeft = (int)ceilf(kernel->length - 1.0f);
-		kernelSamplesRight = (int)ceilf(kernel->length - 1.0f);
+		*dstLeft = (int)ceilf(kernel->length - 1.0f);
+		*dstRight = (int)ceilf(kernel->length - 1.0f);
 	} else {
-		kernelSamplesLeft = 0;
-		kernelSamplesRight = (int)ceilf(kernel->length - 1.0f);
+		*dstLeft = 0;
+		*dstRight = (int)ceilf(kernel->length - 1.0f);
 	}
-	// kernelSamplesLeft = 0;
-	// kernelSamplesRight = 0;
-	uint32_t delaySamplesMax = (uint32_t)ceilf(aza_ms_to_samples(data->config.delayMax, (float)buffer.samplerate));
+}
+
+// Expects azaDelayDynamicHandleResampler to have been called already, since the guard has to fit its taps
+static int azaDelayDynamicHandleBufferResizes(azaDelayDynamic *data, azaBuffer src) {
+	// TODO: Probably track channel layouts and handle them changing. Right now the buffers will break if the number of channels changes.
+	int err = AZA_SUCCESS;
+	err = azaEnsureChannels(&data->channelData, src.channelLayout.count);
+	if (err) return err;
+	int kernelSamplesLeft, kernelSamplesRight;
+	azaDelayDynamicGetKernelSamples(data, &kernelSamplesLeft, &kernelSamplesRight);
+	uint32_t delaySamplesMax = (uint32_t)ceilf(aza_ms_to_samples(data->config.delayMax, (float)src.samplerate)) + (uint32_t)(kernelSamplesLeft + kernelSamplesRight);
+	// Past the newest frame there's room for the kernel to reach into when the delay is near 0
+	uint32_t framesNeeded = delaySamplesMax + src.frames + (uint32_t)kernelSamplesRight;
+	uint32_t guardNeeded = data->resampler.taps;
+	uint32_t stride = data->bufferFrames + data->bufferGuard;
+	if (data->bufferFrames >= framesNeeded && data->bufferGuard >= guardNeeded && data->bufferCap >= stride * src.channelLayout.count) return AZA_SUCCESS;
+	// Have to realloc buffer
+	uint32_t newFrames = (uint32_t)aza_grow(data->bufferFrames, framesNeeded, 256);
+	uint32_t newGuard = AZA_MAX(data->bufferGuard, guardNeeded);
+	uint32_t newStride = newFrames + newGuard;
+	float *newBuffer = aza_calloc(sizeof(float), newStride * src.channelLayout.count);
+	if (!newBuffer) return AZA_ERROR_OUT_OF_MEMORY;
+	uint32_t oldChannels = stride ? data->bufferCap / stride : 0;
+	for (uint8_t c = 0; c < src.channelLayout.count; c++) {
+		azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		float *newRing = newBuffer + c * newStride;
+		if (c < oldChannels) {
+			// Unwrap the old ring so it ends right before the new head at 0, leaving anything older as silence
+			float *oldest = newRing + newFrames - data->bufferFrames;
+			uint32_t tail = data->bufferFrames - data->bufferHead;
+			memcpy(oldest, channelData->buffer + data->bufferHead, sizeof(float) * tail);
+			memcpy(oldest + tail, channelData->buffer, sizeof(float) * data->bufferHead);
+		}
+		memcpy(newRing + newFrames, newRing, sizeof(float) * newGuard);
+		channelData->buffer = newRing;
+	}
+	if (data->buffer) {
+		aza_free(data->buffer);
+	}
+	data->buffer = newBuffer;
+	data->bufferCap = newStride * src.channelLayout.count;
+	data->bufferFrames = newFrames;
+	data->bufferGuard = newGuard;
+	data->bufferHead = 0;
+	return AZA_SUCCESS;
+}
+
+// Puts new audio data into the rings for immediate sampling. Assumes azaDelayDynamicHandleBufferResizes was called already.
+static void azaDelayDynamicPrimeBuffer(azaDelayDynamic *data, azaBuffer src) {
+	int kernelSamplesLeft, kernelSamplesRight;
+	azaDelayDynamicGetKernelSamples(data, &kernelSamplesLeft, &kernelSamplesRight);
+	uint32_t frames = data->bufferFrames;
+	uint32_t head = data->bufferHead;
+	uint32_t newHead = (head + src.frames) % frames;
+	// At most two runs, one up to the end of the ring and one wrapping around to the start
+	uint32_t firstRun = AZA_MIN(src.frames, frames - head);
+	bool touchesGuard = head < data->bufferGuard || head + src.frames + (uint32_t)kernelSamplesRight > frames;
+	for (uint8_t c = 0; c < src.channelLayout.count; c++) {
+		azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		azaBuffer ring = {
+			.samples = channelData->buffer,
+			.samplerate = src.samplerate,
+			.frames = frames,
+			.stride = 1,
+			.channelStride = 1,
+			.channelLayout = (azaChannelLayout) { .count = 1 },
+		};
+		azaBufferCopyChannel(azaBufferSlice(ring, head, firstRun), 0, azaBufferSlice(src, 0, firstRun), c);
+		if (firstRun < src.frames) {
+			azaBufferCopyChannel(azaBufferSlice(ring, 0, src.frames - firstRun), 0, azaBufferSlice(src, firstRun, src.frames - firstRun), c);
+		}
+		// Frames the kernel can see past the newest one hold the newest one, which is what clamping the reads used to do. These are the oldest frames, which nothing reads anymore.
+		float newest = channelData->buffer[(newHead + frames - 1) % frames];
+		for (uint32_t i = 0; i < (uint32_t)kernelSamplesRight; i++) {
+			channelData->buffer[(newHead + i) % frames] = newest;
+		}
+		if (touchesGuard) {
+			memcpy(channelData->buffer + frames, channelData->buffer, sizeof(float) * data->bufferGuard);
+		}
+	}
+	data->bufferHead = newHead;
+}
+
+// Where index 0 of a block of frames lands in the rings. Indices count up from the oldest frame we keep (minus the kernel's reach to the left), same as when the history was a flat buffer that got shifted along every block, so delaySamplesMax+frames-1 is the newest frame. This holds both before and after azaDelayDynamicPrimeBuffer puts frames more in.
+static uint32_t azaDelayDynamicGetRingOffset(azaDelayDynamic *data, uint32_t delaySamplesMax, int kernelSamplesRight, uint32_t frames) {
+	uint32_t back = delaySamplesMax + (uint32_t)kernelSamplesRight + frames;
+	return (data->bufferHead + data->bufferFrames - back % data->bufferFrames) % data->bufferFrames;
+}
+
+// Samples a channel's ring at index (as counted by azaDelayDynamicGetRingOffset). The guard means no read ever has to wrap or clamp.
+static inline float azaDelayDynamicSample(azaDelayDynamic *data, const float *ring, uint32_t offset, float index) {
+	// Wrap the whole frames separately so the fraction only gets rounded once
+	float indexFloor = floorf(index);
+	int frame = (int)indexFloor + (int)offset;
+	if (frame + data->resampler.tapOffset >= (int)data->bufferFrames) {
+		frame -= (int)data->bufferFrames;
+	} else if (frame + data->resampler.tapOffset < 0) {
+		frame += (int)data->bufferFrames;
+	}
+	return azaResamplerSample(&data->resampler, ring, 1, 0, (int)(data->bufferFrames + data->bufferGuard), (float)frame + (index - indexFloor));
+}
+
+uint32_t azaDelayDynamicGetAllocSize(uint8_t channelCapInline) {
+	size_t size = sizeof(azaDelayDynamic);
+	size = azaAddSizeWithAlign(size, channelCapInline * sizeof(azaDelayDynamicChannelData), alignof(azaDelayDynamicChannelData));
+	return (uint32_t)size;
+}
+
+int azaDelayDynamicInit(azaDelayDynamic *data, uint32_t allocSize, azaDelayDynamicConfig config, uint8_t channelCapInline, uint8_t channelCount, azaDelayDynamicChannelConfig *channelConfigs) {
+	data->header.kind = AZA_DSP_DELAY_DYNAMIC;
+	data->header.structSize = allocSize;
+	data->config = config;
+	memset(&data->resampler, 0, sizeof(data->resampler));
+	azaDSPChannelDataInit(&data->channelData, channelCapInline, sizeof(azaDelayDynamicChannelData), alignof(azaDelayDynamicChannelData));
+	int err = azaEnsureChannels(&data->channelData, channelCount);
+	if (err) return err;
+	if (channelConfigs) {
+		for (uint8_t c = 0; c < channelCount; c++) {
+			azaDelayDynamicChannelConfig *channelConfig = azaDelayDynamicGetChannelConfig(data, c);
+			*channelConfig = channelConfigs[c];
+		}
+	}
+	return AZA_SUCCESS;
+}
+
+void azaDelayDynamicDeinit(azaDelayDynamic *data) {
+	if (data->buffer) {
+		aza_free(data->buffer);
+	}
+	data->buffer = NULL;
+	data->bufferCap = 0;
+	data->bufferFrames = 0;
+	data->bufferGuard = 0;
+	data->bufferHead = 0;
+	azaResamplerDeinit(&data->resampler);
+	data->resampler.kernel = NULL;
+}
+
+azaDelayDynamic* azaMakeDelayDynamic(azaDelayDynamicConfig config, uint8_t channelCapInline, uint8_t channelCount, azaDelayDynamicChannelConfig *channelConfigs) {
+	uint32_t size = azaDelayDynamicGetAllocSize(channelCapInline);
+	azaDelayDynamic *result = aza_calloc(1, size);
+	if (result) {
+		int err = azaDelayDynamicInit(result, size, config, channelCapInline, channelCount, channelConfigs);
+		if (err) {
+			aza_free(result);
+			return NULL;
+		}
+	}
+	return result;
+}
+
+void azaFreeDelayDynamic(azaDelayDynamic *data) {
+	azaDelayDynamicDeinit(data);
+	aza_free(data);
+}
+
+// Adds feedback to inputBuffer in place and puts it in the delay lines. Shared by azaDelayDynamicProcess and azaDelayDynamicPrime so the delay lines end up the same either way.
+static int azaDelayDynamicFeed(azaDelayDynamic *data, azaBuffer inputBuffer, float *endChannelDelays) {
+	int err = AZA_SUCCESS;
+	err = azaDelayDynamicHandleResampler(data);
+	if (err) return err;
+	err = azaDelayDynamicHandleBufferResizes(data, inputBuffer);
+	if (err) return err;
+	int kernelSamplesLeft, kernelSamplesRight;
+	azaDelayDynamicGetKernelSamples(data, &kernelSamplesLeft, &kernelSamplesRight);
+	uint32_t delaySamplesMax = (uint32_t)ceilf(aza_ms_to_samples(data->config.delayMax, (float)inputBuffer.samplerate));
+	uint32_t offset = azaDelayDynamicGetRingOffset(data, delaySamplesMax, kernelSamplesRight, inputBuffer.frames);
 	for (uint8_t c = 0; c < inputBuffer.channelLayout.count; c++) {
 		azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, c);
 		float startIndex = (float)delaySamplesMax - aza_ms_to_samples(channelData->config.delay, (float)inputBuffer.samplerate);
@@ -1461,16 +3339,40 @@ int azaDelayDynamicProcess(azaDelayDynamic *data, azaBuffer buffer, float *endCh
 		uint8_t c2 = (c + 1) % inputBuffer.channelLayout.count;
 		for (uint32_t i = 0; i < inputBuffer.frames; i++) {
 			float index = azaLerp(startIndex, endIndex, (float)i / (float)inputBuffer.frames);
-			uint32_t s = i * inputBuffer.stride + c;
+			uint32_t s = i * inputBuffer.stride + c * inputBuffer.channelStride;
 			float toAdd = inputBuffer.samples[s];
 			if (data->config.feedback != 0.0f) {
-			 	toAdd += azaSampleWithKernel(channelData->buffer+kernelSamplesLeft, 1, -kernelSamplesLeft, delaySamplesMax+kernelSamplesRight+inputBuffer.frames, kernel, index) * data->config.feedback;
+				toAdd += azaDelayDynamicSample(data, channelData->buffer, offset, index) * data->config.feedback;
 			}
-			inputBuffer.samples[i * inputBuffer.stride + c] += toAdd * (1.0f - data->config.pingpong);
-			inputBuffer.samples[i * inputBuffer.stride + c2] += toAdd * data->config.pingpong;
+			inputBuffer.samples[s] += toAdd * (1.0f - data->config.pingpong);
+			inputBuffer.samples[i * inputBuffer.stride + c2 * inputBuffer.channelStride] += toAdd * data->config.pingpong;
 		}
 	}
 	azaDelayDynamicPrimeBuffer(data, inputBuffer);
+	return AZA_SUCCESS;
+}
+
+int azaDelayDynamicProcess(azaDelayDynamic *data, azaBuffer buffer, float *endChannelDelays) {
+	int err = AZA_SUCCESS;
+	uint8_t numSideBuffers = 0;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	azaBuffer inputBuffer;
+	if (data->config.wetEffects) {
+		inputBuffer = azaPushSideBufferCopy(buffer);
+		numSideBuffers++;
+		err = azaDSPProcessSingle(data->config.wetEffects, inputBuffer);
+		if (err) goto error;
+	} else {
+		inputBuffer = buffer;
+	}
+	err = azaDelayDynamicFeed(data, inputBuffer, endChannelDelays);
+	if (err) goto error;
+	int kernelSamplesLeft, kernelSamplesRight;
+	azaDelayDynamicGetKernelSamples(data, &kernelSamplesLeft, &kernelSamplesRight);
+	uint32_t delaySamplesMax = (uint32_t)ceilf(aza_ms_to_samples(data->config.delayMax, (float)buffer.samplerate));
+	uint32_t offset = azaDelayDynamicGetRingOffset(data, delaySamplesMax, kernelSamplesRight, buffer.frames);
 	for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
 		azaDelayDynamicChannelData *channelData = azaGetChannelData(&data->channelData, c);
 		float startIndex = (float)delaySamplesMax - aza_ms_to_samples(channelData->config.delay, (float)buffer.samplerate);
@@ -1486,19 +3388,48 @@ int azaDelayDynamicProcess(azaDelayDynamic *data, azaBuffer buffer, float *endCh
 		if (startIndex >= endIndex) amount = 0.0f;
 		for (uint32_t i = 0; i < buffer.frames; i++) {
 			float index = azaLerp(startIndex, endIndex, (float)i / (float)buffer.frames);
-			uint32_t s = i * buffer.stride + c;
-			float wet = azaSampleWithKernel(channelData->buffer+kernelSamplesLeft, 1, -kernelSamplesLeft, delaySamplesMax+kernelSamplesRight+buffer.frames, kernel, index);
+			uint32_t s = i * buffer.stride + c * buffer.channelStride;
+			float wet = azaDelayDynamicSample(data, channelData->buffer, offset, index);
 			buffer.samples[s] = wet * amount + buffer.samples[s] * amountDry;
 		}
 	}
-	if (data->header.pNext) {
-		err = azaDSPProcessSingle(data->header.pNext, buffer);
-	}
+	if (data->header.pNext) {
+		err = azaDSPProcessSingle(data->header.pNext, buffer);
+	}
+error:
+	azaPopSideBuffers(numSideBuffers);
+	return err;
+}
+
+int azaDelayDynamicPrime(azaDelayDynamic *data, azaBuffer buffer, float *endChannelDelays) {
+	int err = AZA_SUCCESS;
+	if (data == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&buffer);
+	if (err) return err;
+	// Feeding changes the input in place, which is fine in azaDelayDynamicProcess but we promised to leave buffer alone
+	azaBuffer inputBuffer = azaPushSideBufferCopy(buffer);
+	if (data->config.wetEffects) {
+		err = azaDSPProcessSingle(data->config.wetEffects, inputBuffer);
+		if (err) goto error;
+	}
+	err = azaDelayDynamicFeed(data, inputBuffer, endChannelDelays);
+	if (err) goto error;
+	if (endChannelDelays) {
+		for (uint8_t c = 0; c < buffer.channelLayout.count; c++) {
+			azaDelayDynamicGetChannelConfig(data, c)->delay = endChannelDelays[c];
+		}
+	}
 error:
-	azaPopSideBuffers(numSideBuffers);
+	azaPopSideBuffer();
 	return err;
 }
 
+void azaDelayDynamicClear(azaDelayDynamic *data) {
+	if (data->buffer) {
+		memset(data->buffer, 0, sizeof(float) * data->bufferCap);
+	}
+}
+
 
 
 int azaKernelInit(azaKernel *kernel, int isSymmetrical, float length, float scale) {
@@ -1570,35 +3501,134 @@ void azaResampleAdd(azaKernel *kernel, float factor, float amp, float *dst, int
 	}
 }
 
-#define PRINT_CHANNEL_AMPS 0
-#define PRINT_CHANNEL_DELAYS 0
 
-#if PRINT_CHANNEL_AMPS || PRINT_CHANNEL_DELAYS
-static int repeatCount = 0;
-#endif
 
-struct channelMetadata {
-	float amp;
-	uint32_t channel;
-};
+static int azaResamplerBuildTable(azaResampler *data, float cutoffScale) {
+	azaKernel *kernel = data->kernel;
+	uint32_t radius = (uint32_t)ceilf((kernel->length - 1.0f) * cutoffScale);
+	if (radius < 1) radius = 1;
+	uint32_t taps;
+	int32_t tapOffset;
+	if (kernel->isSymmetrical) {
+		taps = radius * 2;
+		tapOffset = 1 - (int32_t)radius;
+	} else {
+		taps = radius + 1;
+		tapOffset = 0;
+	}
+	uint32_t tapsStride = (uint32_t)aza_align(taps, 8);
+	uint32_t tableSize = (data->phases + 1) * tapsStride;
+	if (tableSize > data->tableCap) {
+		float *newTable = aza_calloc(tableSize, sizeof(float));
+		if (!newTable) return AZA_ERROR_OUT_OF_MEMORY;
+		if (data->table) {
+			aza_free(data->table);
+		}
+		data->table = newTable;
+		data->tableCap = tableSize;
+	}
+	// Stretching the kernel in time by cutoffScale scales its frequency response by 1/cutoffScale, and we divide by cutoffScale to keep unity gain.
+	float gain = 1.0f / cutoffScale;
+	for (uint32_t phase = 0; phase <= data->phases; phase++) {
+		float *row = data->table + phase * tapsStride;
+		float frac = (float)phase / (float)data->phases;
+		for (uint32_t i = 0; i < taps; i++) {
+			float x = ((float)((int32_t)i + tapOffset) - frac) * gain;
+			row[i] = azaKernelSample(kernel, x) * gain;
+		}
+		for (uint32_t i = taps; i < tapsStride; i++) {
+			row[i] = 0.0f;
+		}
+	}
+	data->cutoffScale = cutoffScale;
+	data->taps = taps;
+	data->tapsStride = tapsStride;
+	data->tapOffset = tapOffset;
+	data->padding = radius;
+	return AZA_SUCCESS;
+}
 
-int compareChannelMetadataAmp(const void *_lhs, const void *_rhs) {
-	const struct channelMetadata *lhs = _lhs;
-	const struct channelMetadata *rhs = _rhs;
-	if (lhs->amp == rhs->amp) return 0;
-	// We want descending order
-	if (lhs->amp < rhs->amp) return 1;
-	return -1;
-};
-int compareChannelMetadataChannel(const void *_lhs, const void *_rhs) {
-	const struct channelMetadata *lhs = _lhs;
-	const struct channelMetadata *rhs = _rhs;
-	if (lhs->channel == rhs->channel) return 0;
-	// We want ascending order
-	if (lhs->channel < rhs->channel) return -1;
-	return 1;
-};
+int azaResamplerInit(azaResampler *data, azaKernel *kernel, uint32_t phases, float factor) {
+	assert(kernel != NULL);
+	assert(factor > 0.0f);
+	memset(data, 0, sizeof(*data));
+	data->kernel = kernel;
+	data->factor = factor;
+	data->phases = phases ? phases : AZA_MAX((uint32_t)kernel->scale, 1);
+	return azaResamplerBuildTable(data, AZA_MAX(factor, 1.0f));
+}
+
+void azaResamplerDeinit(azaResampler *data) {
+	if (data->table) {
+		aza_free(data->table);
+	}
+	data->table = NULL;
+	data->tableCap = 0;
+}
+
+int azaResamplerSetFactor(azaResampler *data, float factor) {
+	assert(factor > 0.0f);
+	data->factor = factor;
+	float cutoffScale = AZA_MAX(factor, 1.0f);
+	if (cutoffScale == data->cutoffScale) return AZA_SUCCESS;
+	return azaResamplerBuildTable(data, cutoffScale);
+}
+
+float azaResamplerSample(azaResampler *data, const float *src, int stride, int minFrame, int maxFrame, float pos) {
+	float posFloor = floorf(pos);
+	float phase = (pos - posFloor) * (float)data->phases;
+	uint32_t row = (uint32_t)phase;
+	// pos - posFloor can round up to exactly 1
+	if (row >= data->phases) row = data->phases - 1;
+	float t = phase - (float)row;
+	const float *coefficients0 = data->table + row * data->tapsStride;
+	const float *coefficients1 = coefficients0 + data->tapsStride;
+	int start = (int)posFloor + data->tapOffset;
+	int end = start + (int)data->taps;
+	if AZA_LIKELY(start >= minFrame && end <= maxFrame) {
+		return azaSIMDDotLerp(src + start * stride, (uint32_t)stride, coefficients0, coefficients1, t, data->taps);
+	}
+	// Near the edges of the extent we have to clamp every index
+	float sum0 = 0.0f, sum1 = 0.0f;
+	for (uint32_t i = 0; i < data->taps; i++) {
+		int index = AZA_CLAMP(start + (int)i, minFrame, maxFrame-1);
+		float s = src[index * stride];
+		sum0 += s * coefficients0[i];
+		sum1 += s * coefficients1[i];
+	}
+	return sum0 + t * (sum1 - sum0);
+}
+
+void azaResamplerProcess(azaResampler *data, float *dst, int dstStride, int dstFrames, const float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset) {
+	for (uint32_t i = 0; i < (uint32_t)dstFrames; i++) {
+		float pos = (float)i * data->factor + srcSampleOffset;
+		dst[i * dstStride] = azaResamplerSample(data, src, srcStride, srcFrameMin, srcFrameMax, pos);
+	}
+}
+
+void azaResamplerProcessAdd(azaResampler *data, float amp, float *dst, int dstStride, int dstFrames, const float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset) {
+	for (uint32_t i = 0; i < (uint32_t)dstFrames; i++) {
+		float pos = (float)i * data->factor + srcSampleOffset;
+		dst[i * dstStride] += amp * azaResamplerSample(data, src, srcStride, srcFrameMin, srcFrameMax, pos);
+	}
+}
 
+// Returns the value that would be at index k if values were sorted in descending order, without sorting all of them
+static float azaSpatializeKthLargest(const float *values, uint8_t count, uint8_t k) {
+	float sorted[AZA_MAX_CHANNEL_POSITIONS];
+	memcpy(sorted, values, count * sizeof(float));
+	// k is tiny, so a partial selection sort beats anything clever
+	for (uint8_t i = 0; i <= k; i++) {
+		uint8_t best = i;
+		for (uint8_t j = i+1; j < count; j++) {
+			if (sorted[j] > sorted[best]) best = j;
+		}
+		float temp = sorted[i];
+		sorted[i] = sorted[best];
+		sorted[best] = temp;
+	}
+	return sorted[k];
+}
 
 static void azaGatherChannelPresenseMetadata(azaChannelLayout channelLayout, uint8_t *hasFront, uint8_t *hasMidFront, uint8_t *hasSub, uint8_t *hasBack, uint8_t *hasSide, uint8_t *hasAerials, uint8_t *subChannel) {
 	for (uint8_t i = 0; i < channelLayout.count; i++) {
@@ -1644,10 +3674,13 @@ static void azaGatherChannelPresenseMetadata(azaChannelLayout channelLayout, uin
 	}
 }
 
-static void azaGetChannelMetadata(azaChannelLayout channelLayout, azaVec3 *dstVectors, uint8_t *nonSubChannels, uint8_t *hasAerials) {
-	uint8_t hasFront = 0, hasMidFront = 0, hasSub = 0, hasBack = 0, hasSide = 0, subChannel = 0;
+static void azaGetChannelMetadata(azaChannelLayout channelLayout, azaVec3 *dstVectors, uint8_t *nonSubChannels, uint8_t *hasAerials, uint8_t *subChannel) {
+	// The subwoofer doesn't get a direction
+	memset(dstVectors, 0, channelLayout.count * sizeof(azaVec3));
+	uint8_t hasFront = 0, hasMidFront = 0, hasSub = 0, hasBack = 0, hasSide = 0;
 	*hasAerials = 0;
-	azaGatherChannelPresenseMetadata(channelLayout, &hasFront, &hasMidFront, &hasSub, &hasBack, &hasSide, hasAerials, &subChannel);
+	*subChannel = channelLayout.count;
+	azaGatherChannelPresenseMetadata(channelLayout, &hasFront, &hasMidFront, &hasSub, &hasBack, &hasSide, hasAerials, subChannel);
 	*nonSubChannels = hasSub ? channelLayout.count-1 : channelLayout.count;
 	// Angles are relative to front center, to be signed later
 	// These relate to anglePhi above
@@ -1737,262 +3770,1374 @@ static void azaGetChannelMetadata(azaChannelLayout channelLayout, azaVec3 *dstVe
 	}
 }
 
-static uint32_t azaSpatializeChannelDataGetAllocSize(uint8_t channelCapInline) {
-	return channelCapInline * azaFilterGetAllocSize(1);
+
+
+// Octahedral map from a direction to [-1; 1]^2. The upper hemisphere fills the diamond |u|+|v| <= 1 and the lower hemisphere is folded out into the corners.
+static void azaOctahedralEncode(azaVec3 dir, float *u, float *v) {
+	float l1 = fabsf(dir.x) + fabsf(dir.y) + fabsf(dir.z);
+	float x = dir.x / l1, z = dir.z / l1;
+	if (dir.y < 0.0f) {
+		float foldedX = (1.0f - fabsf(z)) * copysignf(1.0f, x);
+		float foldedZ = (1.0f - fabsf(x)) * copysignf(1.0f, z);
+		x = foldedX;
+		z = foldedZ;
+	}
+	*u = x;
+	*v = z;
+}
+
+static azaVec3 azaOctahedralDecode(float u, float v) {
+	float y = 1.0f - fabsf(u) - fabsf(v);
+	if (y < 0.0f) {
+		float unfoldedU = (1.0f - fabsf(v)) * copysignf(1.0f, u);
+		float unfoldedV = (1.0f - fabsf(u)) * copysignf(1.0f, v);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+	return azaVec3Normalized((azaVec3) { u, y, v });
+}
+
+// Panning gains for layouts with more than 2 channels. Only the loudest few channels get any of the signal.
+// Scaling or offsetting every dot product the same way doesn't change these, so they only depend on the direction of dir.
+// Returns the sum of the gains.
+static float azaSpeakerGeometryGetDirectionGains(const azaSpeakerGeometry *data, azaVec3 dir, float *dstGains) {
+	uint8_t count = data->layout.count;
+	// Zeroed because GCC can't see that count is always more than 2
+	float dots[AZA_MAX_CHANNEL_POSITIONS] = {0};
+	for (uint8_t i = 0; i < count; i++) {
+		dots[i] = azaVec3Dot(data->vectors[i], dir);
+	}
+	uint8_t minChannel = 2;
+	if (count > 3 && data->hasAerials) {
+		// TODO: This probably isn't a reliable way to use aerials. Probably do something smarter.
+		minChannel = 3;
+	}
+	float dotMaxRange = azaSpatializeKthLargest(dots, count, 0);
+	float dotMinRange = azaSpatializeKthLargest(dots, count, minChannel);
+	float total = 0.0f;
+	if AZA_UNLIKELY(dotMaxRange - dotMinRange < 1e-6f) {
+		// Straight up or down from a flat layout, where every channel is as good as the next
+		for (uint8_t i = 0; i < count; i++) {
+			dstGains[i] = dots[i] >= dotMinRange ? 1.0f : 0.0f;
+			total += dstGains[i];
+		}
+		return total;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		dstGains[i] = linstepf(dots[i], dotMinRange, dotMaxRange);
+		total += dstGains[i];
+	}
+	return total;
+}
+
+// Same as azaSpeakerGeometryGetDirectionGains, but interpolated from data->gainGrid. dstGains gets the sum too, so it needs room for layout.count+1 floats.
+static float azaSpeakerGeometrySampleGains(const azaSpeakerGeometry *data, azaVec3 dir, float *dstGains) {
+	const uint32_t res = AZAUDIO_SPEAKER_GEOMETRY_GRID_RES;
+	uint32_t stride = data->layout.count + 1;
+	uint32_t rowStride = (res + 1) * stride;
+	float u, v;
+	azaOctahedralEncode(dir, &u, &v);
+	float gridU = AZA_CLAMP((u + 1.0f) * (0.5f * (float)res), 0.0f, (float)res);
+	float gridV = AZA_CLAMP((v + 1.0f) * (0.5f * (float)res), 0.0f, (float)res);
+	uint32_t indexU = AZA_MIN((uint32_t)gridU, res - 1);
+	uint32_t indexV = AZA_MIN((uint32_t)gridV, res - 1);
+	float fractionU = gridU - (float)indexU;
+	float fractionV = gridV - (float)indexV;
+	const float *p00 = data->gainGrid + indexV * rowStride + indexU * stride;
+	const float *p01 = p00 + stride;
+	const float *p10 = p00 + rowStride;
+	const float *p11 = p10 + stride;
+	for (uint32_t i = 0; i < stride; i++) {
+		float top = azaLerp(p00[i], p01[i], fractionU);
+		float bottom = azaLerp(p10[i], p11[i], fractionU);
+		dstGains[i] = azaLerp(top, bottom, fractionV);
+	}
+	return dstGains[data->layout.count];
+}
+
+// Everything but the gain grid, which is cheap enough to do on the stack
+static void azaSpeakerGeometryInitVectors(azaSpeakerGeometry *data, azaChannelLayout layout) {
+	if (layout.count > AZA_MAX_CHANNEL_POSITIONS) layout.count = AZA_MAX_CHANNEL_POSITIONS;
+	data->layout = layout;
+	azaGetChannelMetadata(layout, data->vectors, &data->nonSubChannels, &data->hasAerials, &data->subChannel);
+	data->gainGrid = NULL;
+	data->hasAmbisonicDecoders = false;
+}
+
+// Defined with the rest of the ambisonics further down
+static void azaSpeakerGeometryMakeAmbisonicDecoders(azaSpeakerGeometry *data);
+
+int azaSpeakerGeometryInit(azaSpeakerGeometry *data, azaChannelLayout layout) {
+	azaSpeakerGeometryInitVectors(data, layout);
+	if (data->layout.count > 2) {
+		const uint32_t res = AZAUDIO_SPEAKER_GEOMETRY_GRID_RES;
+		uint32_t stride = data->layout.count + 1;
+		data->gainGrid = aza_malloc(sizeof(float) * (res + 1) * (res + 1) * stride);
+		if (!data->gainGrid) return AZA_ERROR_OUT_OF_MEMORY;
+		for (uint32_t y = 0; y <= res; y++) {
+			for (uint32_t x = 0; x <= res; x++) {
+				float *point = data->gainGrid + (y * (res + 1) + x) * stride;
+				azaVec3 dir = azaOctahedralDecode((float)x * 2.0f / (float)res - 1.0f, (float)y * 2.0f / (float)res - 1.0f);
+				point[data->layout.count] = azaSpeakerGeometryGetDirectionGains(data, dir, point);
+			}
+		}
+	}
+	// After the grid, so the decoders pan the same way sources do
+	azaSpeakerGeometryMakeAmbisonicDecoders(data);
+	return AZA_SUCCESS;
+}
+
+void azaSpeakerGeometryDeinit(azaSpeakerGeometry *data) {
+	if (data->gainGrid) {
+		aza_free(data->gainGrid);
+		data->gainGrid = NULL;
+	}
+}
+
+static azaSpeakerGeometry azaSpeakerGeometryCache[AZAUDIO_SPEAKER_GEOMETRY_CACHE_CAP];
+// Entries before this are finished and never change, so they can be read without the lock
+static volatile uint32_t azaSpeakerGeometryCacheCount = 0;
+static azaMutex azaSpeakerGeometryCacheMutex;
+
+const azaSpeakerGeometry* azaGetSpeakerGeometry(azaChannelLayout layout) {
+	if (layout.count > AZA_MAX_CHANNEL_POSITIONS) layout.count = AZA_MAX_CHANNEL_POSITIONS;
+	uint32_t count = azaAtomicLoad32(&azaSpeakerGeometryCacheCount);
+	for (uint32_t i = 0; i < count; i++) {
+		if (azaChannelLayoutsEqual(azaSpeakerGeometryCache[i].layout, layout)) return &azaSpeakerGeometryCache[i];
+	}
+	const azaSpeakerGeometry *result = NULL;
+	azaMutexLock(&azaSpeakerGeometryCacheMutex);
+	// Someone else may have made it while we were looking
+	count = azaSpeakerGeometryCacheCount;
+	for (uint32_t i = 0; i < count; i++) {
+		if (azaChannelLayoutsEqual(azaSpeakerGeometryCache[i].layout, layout)) {
+			result = &azaSpeakerGeometryCache[i];
+			goto done;
+		}
+	}
+	if (count < AZAUDIO_SPEAKER_GEOMETRY_CACHE_CAP) {
+		if (azaSpeakerGeometryInit(&azaSpeakerGeometryCache[count], layout) == AZA_SUCCESS) {
+			result = &azaSpeakerGeometryCache[count];
+			azaAtomicStore32(&azaSpeakerGeometryCacheCount, count + 1);
+		} else {
+			azaSpeakerGeometryDeinit(&azaSpeakerGeometryCache[count]);
+		}
+	}
+done:
+	azaMutexUnlock(&azaSpeakerGeometryCacheMutex);
+	return result;
+}
+
+void azaSpeakerGeometryCacheInit() {
+	azaMutexInit(&azaSpeakerGeometryCacheMutex);
+	azaSpeakerGeometryCacheCount = 0;
+}
+
+void azaSpeakerGeometryCacheDeinit() {
+	for (uint32_t i = 0; i < azaSpeakerGeometryCacheCount; i++) {
+		azaSpeakerGeometryDeinit(&azaSpeakerGeometryCache[i]);
+	}
+	azaSpeakerGeometryCacheCount = 0;
+	azaMutexDeinit(&azaSpeakerGeometryCacheMutex);
+}
+
+
+
+static uint32_t azaSpatializeChannelDataGetAllocSize(uint8_t channelCapInline) {
+	return channelCapInline * azaFilterGetAllocSize(1);
+}
+
+uint32_t azaSpatializeGetAllocSize(uint8_t channelCapInline) {
+	size_t size = sizeof(azaSpatialize);
+	size = azaAddSizeWithAlign(size, azaSpatializeChannelDataGetAllocSize(channelCapInline), alignof(azaSpatializeChannelData));
+	size = azaAddSizeWithAlign(size, azaDelayDynamicGetAllocSize(channelCapInline), alignof(azaDelayDynamic));
+	return (uint32_t)size;
+}
+
+void azaSpatializeInit(azaSpatialize *data, uint32_t allocSize, azaSpatializeConfig config, uint8_t channelCapInline) {
+	uint32_t filterAllocSize = azaFilterGetAllocSize(1);
+	data->header.kind = AZA_DSP_SPATIALIZE;
+	data->header.structSize = allocSize;
+	data->config = config;
+	azaDSPChannelDataInit(&data->channelData, channelCapInline, filterAllocSize, alignof(azaSpatializeChannelData));
+	for (uint8_t c = 0; c < channelCapInline; c++) {
+		azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		azaFilterInit(&channelData->filter, filterAllocSize, (azaFilterConfig) {
+			.kind = AZA_FILTER_LOW_PASS,
+			.dryMix = 0.0f,
+			.frequency = 15000.0f,
+		}, 1);
+	}
+	azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
+	// NOTE: We can ignore the return value because channelCount == channelCapInline
+	azaDelayDynamicInit(delay, azaDelayDynamicGetAllocSize(channelCapInline), (azaDelayDynamicConfig){
+		.gain = 0.0f,
+		.gainDry = -INFINITY,
+		.delayMax = config.delayMax != 0.0f ? config.delayMax : 500.0f,
+		.feedback = 0.0f,
+		.pingpong = 0.0f,
+		.wetEffects = NULL,
+		.kernel = NULL,
+	}, channelCapInline, channelCapInline, NULL);
+}
+
+void azaSpatializeDeinit(azaSpatialize *data) {
+	for (uint8_t c = 0; c < data->channelData.capInline + data->channelData.capAdditional; c++) {
+		azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		azaFilterDeinit(&channelData->filter);
+	}
+	azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
+	azaDelayDynamicDeinit(delay);
+}
+
+azaDelayDynamic* azaSpatializeGetDelayDynamic(azaSpatialize *data) {
+	azaDelayDynamic *result = (azaDelayDynamic*)azaGetBufferOffset((char*)data, sizeof(azaSpatialize) + data->channelData.size * data->channelData.capInline, alignof(azaDelayDynamic));
+	return result;
+}
+
+azaSpatialize* azaMakeSpatialize(azaSpatializeConfig config, uint8_t channelCapInline) {
+	uint32_t size = azaSpatializeGetAllocSize(channelCapInline);
+	azaSpatialize *result = aza_calloc(1, size);
+	if (result) azaSpatializeInit(result, size, config, channelCapInline);
+	return result;
+}
+
+void azaFreeSpatialize(azaSpatialize *data) {
+	azaSpatializeDeinit(data);
+	aza_free(data);
+}
+
+static float azaSpatializeGetFilterCutoff(float delay, float dot) {
+	return 192000.0f / AZA_MAX(delay, 1.0f) * (dot * 0.35f + 0.65f);
+}
+
+// Works out how loud each channel should be for a source at srcPos (in headspace), not counting the source's own amp.
+// If dstDots isn't NULL, it gets how closely each channel points at the source.
+static void azaSpatializeGetChannelAmps(const azaSpeakerGeometry *geometry, azaSpatializeMode mode, azaVec3 srcPos, float *dstAmps, float *dstDots) {
+	uint8_t count = geometry->layout.count;
+	// How much of the signal to add to all channels in case srcPos is crossing close to the head
+	float allChannelAddAmp = 0.0f;
+	azaVec3 srcNormal;
+	float norm = azaVec3Norm(srcPos);
+	if (norm < 0.5f) {
+		allChannelAddAmp = (0.5f - norm) * 2.0f;
+		srcNormal = srcPos;
+	} else {
+		srcNormal = azaDivVec3Scalar(srcPos, norm);
+	}
+	float allChannelAdd = allChannelAddAmp / (float)geometry->nonSubChannels;
+	if (dstDots) {
+		for (uint8_t i = 0; i < count; i++) {
+			dstDots[i] = azaVec3Dot(geometry->vectors[i], srcNormal);
+		}
+	}
+	float amps[AZA_MAX_CHANNEL_POSITIONS + 1];
+	float totalMagnitude = 0.0f;
+	if (count > 2) {
+		// Right on top of us there's no direction to speak of, so just pick one. allChannelAdd spreads it everywhere anyway.
+		azaVec3 direction = norm > 0.0f ? srcNormal : (azaVec3) { 0.0f, 0.0f, 1.0f };
+		if (geometry->gainGrid) {
+			totalMagnitude = azaSpeakerGeometrySampleGains(geometry, direction, amps);
+		} else {
+			totalMagnitude = azaSpeakerGeometryGetDirectionGains(geometry, direction, amps);
+		}
+		for (uint8_t i = 0; i < count; i++) {
+			amps[i] += allChannelAdd;
+		}
+		totalMagnitude += (float)count * allChannelAdd;
+	} else {
+		for (uint8_t i = 0; i < count; i++) {
+			amps[i] = 0.5f * norm + 0.5f * azaVec3Dot(geometry->vectors[i], srcNormal) + allChannelAdd;
+			totalMagnitude += amps[i];
+		}
+	}
+	float minAmp = mode == AZA_SPATIALIZE_SIMPLE ? 0.0f : 0.8f;
+	for (uint8_t c = 0; c < count; c++) {
+		if (c == geometry->subChannel) {
+			dstAmps[c] = 1.0f;
+		} else {
+			dstAmps[c] = (amps[c] / totalMagnitude) * (1.0f - minAmp) + minAmp;
+		}
+	}
+}
+
+static inline void azaSpatializeMixFadeChannels(float *dst, uint32_t dstStride, uint32_t dstChannelStride, const float *src, uint32_t srcStride, uint32_t frames, const float *ampStart, const float *ampStep, uint8_t channels) {
+	// Local copies so the compiler knows writing to dst can't change them
+	float start[AZA_MAX_CHANNEL_POSITIONS], step[AZA_MAX_CHANNEL_POSITIONS];
+	for (uint8_t c = 0; c < channels; c++) {
+		start[c] = ampStart[c];
+		step[c] = ampStep[c];
+	}
+	float t = 0.0f;
+	for (uint32_t i = 0; i < frames; i++) {
+		float sample = src[i * srcStride];
+		float *d = dst + i * dstStride;
+		for (uint8_t c = 0; c < channels; c++) {
+			d[c * dstChannelStride] += sample * (start[c] + step[c] * t);
+		}
+		t += 1.0f;
+	}
+}
+
+// Same as azaSpatializeMixFadeChannels for channels+1 channels, for counts where only channels vectorizes well on its own
+static inline void azaSpatializeMixFadeChannelsPlusOne(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, uint32_t frames, const float *ampStart, const float *ampStep, uint8_t channels) {
+	float start[AZA_MAX_CHANNEL_POSITIONS], step[AZA_MAX_CHANNEL_POSITIONS];
+	for (uint8_t c = 0; c <= channels; c++) {
+		start[c] = ampStart[c];
+		step[c] = ampStep[c];
+	}
+	float t = 0.0f;
+	for (uint32_t i = 0; i < frames; i++) {
+		float sample = src[i * srcStride];
+		float *d = dst + i * dstStride;
+		for (uint8_t c = 0; c < channels; c++) {
+			d[c] += sample * (start[c] + step[c] * t);
+		}
+		d[channels] += sample * (start[channels] + step[channels] * t);
+		t += 1.0f;
+	}
+}
+
+// Adds the 1-channel srcBuffer to every channel of dstBuffer at once, with each channel's amp fading from ampStart to ampEnd
+static void azaSpatializeMixFade(azaBuffer dstBuffer, azaBuffer srcBuffer, const float *ampStart, const float *ampEnd) {
+	uint8_t channels = dstBuffer.channelLayout.count;
+	float ampStep[AZA_MAX_CHANNEL_POSITIONS];
+	float framesF = (float)dstBuffer.frames;
+	for (uint8_t c = 0; c < channels; c++) {
+		ampStep[c] = (ampEnd[c] - ampStart[c]) / framesF;
+	}
+	if (dstBuffer.channelStride == 1) {
+		// Constant channel counts let the compiler keep every amp in registers and vectorize across channels
+		switch (channels) {
+			case 2: azaSpatializeMixFadeChannels(dstBuffer.samples, dstBuffer.stride, 1, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, 2); return;
+			case 4: azaSpatializeMixFadeChannels(dstBuffer.samples, dstBuffer.stride, 1, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, 4); return;
+			case 6: azaSpatializeMixFadeChannels(dstBuffer.samples, dstBuffer.stride, 1, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, 6); return;
+			case 8: azaSpatializeMixFadeChannels(dstBuffer.samples, dstBuffer.stride, 1, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, 8); return;
+			// Ambisonic soundfields
+			case 9: azaSpatializeMixFadeChannelsPlusOne(dstBuffer.samples, dstBuffer.stride, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, 8); return;
+			case 16: azaSpatializeMixFadeChannels(dstBuffer.samples, dstBuffer.stride, 1, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, 16); return;
+			default: break;
+		}
+	}
+	azaSpatializeMixFadeChannels(dstBuffer.samples, dstBuffer.stride, dstBuffer.channelStride, srcBuffer.samples, srcBuffer.stride, dstBuffer.frames, ampStart, ampStep, channels);
+}
+
+enum {
+	// Forget whatever is in the delays, because they weren't kept up while the source was virtual
+	AZA_SPATIALIZE_DOPPLER_RESET = 1,
+	// Keep the delays of a downgraded ADVANCED source fed while it's mixed with AZA_SPATIALIZE_SIMPLE
+	AZA_SPATIALIZE_DOPPLER_PRIME = 2,
+};
+
+// Does the work of azaSpatializeProcess once the buffers are validated and geometry has been made from dstBuffer.channelLayout.
+// data may be NULL, in which case we do AZA_SPATIALIZE_SIMPLE using world.
+// lod MUST NOT be AZA_SPATIALIZE_LOD_VIRTUAL. dopplerFlags is any of the AZA_SPATIALIZE_DOPPLER_* flags, which only matter for AZA_SPATIALIZE_ADVANCED sources.
+// The output fades from fadeStart to fadeEnd on its way into dstBuffer. For ADVANCED that happens after the delays, so they're still fed the whole signal.
+static int azaSpatializeProcessWithGeometry(azaSpatialize *data, const azaWorld *world, const azaSpeakerGeometry *geometry, azaSpatializeLOD lod, uint8_t dopplerFlags, float fadeStart, float fadeEnd, azaBuffer dstBuffer, azaBuffer srcBuffer, azaVec3 srcPosStart, float srcAmpStart, azaVec3 srcPosEnd, float srcAmpEnd) {
+	int err = AZA_SUCCESS;
+	azaSpatializeMode mode = AZA_SPATIALIZE_SIMPLE;
+	if (data) {
+		world = data->config.world;
+		mode = data->config.mode;
+	}
+	if (world == NULL) {
+		world = &azaWorldDefault;
+	}
+	bool prime = false;
+	if (mode == AZA_SPATIALIZE_ADVANCED && lod == AZA_SPATIALIZE_LOD_SIMPLE) {
+		mode = AZA_SPATIALIZE_SIMPLE;
+		prime = (dopplerFlags & AZA_SPATIALIZE_DOPPLER_PRIME) != 0;
+	}
+	uint8_t channels = dstBuffer.channelLayout.count;
+	// Transform srcPos to headspace
+	srcPosStart = azaMulVec3Mat3(azaSubVec3(srcPosStart, world->origin), world->orientation);
+	srcPosEnd = azaMulVec3Mat3(azaSubVec3(srcPosEnd, world->origin), world->orientation);
+	float channelAmpStart[AZA_MAX_CHANNEL_POSITIONS];
+	float channelAmpEnd[AZA_MAX_CHANNEL_POSITIONS];
+	float channelDot[AZA_MAX_CHANNEL_POSITIONS];
+	if (channels == 1) {
+		// Nothing to do but put it in there I guess
+		channelAmpStart[0] = srcAmpStart;
+		channelAmpEnd[0] = srcAmpEnd;
+		channelDot[0] = 1.0f;
+	} else {
+		azaSpatializeGetChannelAmps(geometry, mode, srcPosStart, channelAmpStart, channelDot);
+		azaSpatializeGetChannelAmps(geometry, mode, srcPosEnd, channelAmpEnd, NULL);
+		for (uint8_t c = 0; c < channels; c++) {
+			channelAmpStart[c] *= srcAmpStart;
+			channelAmpEnd[c] *= srcAmpEnd;
+		}
+	}
+	if (mode == AZA_SPATIALIZE_SIMPLE) {
+		// Volume is all there is, so we can go straight into dstBuffer
+		for (uint8_t c = 0; c < channels; c++) {
+			channelAmpStart[c] *= fadeStart;
+			channelAmpEnd[c] *= fadeEnd;
+		}
+		azaSpatializeMixFade(dstBuffer, srcBuffer, channelAmpStart, channelAmpEnd);
+		if (!prime) return AZA_SUCCESS;
+	}
+	// Gotta do the doppler
+	azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
+	err = azaEnsureChannels(&data->channelData, channels);
+	if (err) return err;
+	err = azaEnsureChannels(&delay->channelData, channels);
+	if (err) return err;
+	float earDistance = data->config.earDistance;
+	if (earDistance == 0.0f) {
+		earDistance = 0.085f;
+	}
+	float channelDelayStart[AZA_MAX_CHANNEL_POSITIONS];
+	float channelDelayEnd[AZA_MAX_CHANNEL_POSITIONS];
+	if (channels == 1) {
+		channelDelayStart[0] = azaVec3Norm(srcPosStart) / world->speedOfSound * 1000.0f;
+		channelDelayEnd[0] = azaVec3Norm(srcPosEnd) / world->speedOfSound * 1000.0f;
+	} else {
+		for (uint8_t c = 0; c < channels; c++) {
+			azaVec3 earPos = azaMulVec3Scalar(geometry->vectors[c], earDistance);
+			channelDelayStart[c] = azaVec3Norm(azaSubVec3(srcPosStart, earPos)) / world->speedOfSound * 1000.0f;
+			channelDelayEnd[c] = azaVec3Norm(azaSubVec3(srcPosEnd, earPos)) / world->speedOfSound * 1000.0f;
+		}
+	}
+	if (dopplerFlags & AZA_SPATIALIZE_DOPPLER_RESET) {
+		// Start from silence right where the source is now, rather than sweeping over from wherever it was when it went virtual
+		azaDelayDynamicClear(delay);
+		for (uint8_t c = 0; c < channels; c++) {
+			azaDelayDynamicGetChannelConfig(delay, c)->delay = channelDelayStart[c];
+			azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
+			azaFilterChannelData *filterData = azaGetChannelData(&channelData->filter.channelData, 0);
+			filterData->outputs[0] = 0.0f;
+			filterData->outputs[1] = 0.0f;
+		}
+	}
+	azaScratchMark mark = azaMarkSideBuffers();
+	azaBuffer sideBuffer = azaPushSideBufferLike(dstBuffer, dstBuffer.frames, channels);
+	if (!sideBuffer.samples) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto done;
+	}
+	azaBufferZero(sideBuffer);
+	if (prime) {
+		// Feed the delays exactly what ADVANCED would have, so it can take over without a seam. Only reading them back out gets skipped, but that's the costly part.
+		if (channels > 1) {
+			azaSpatializeGetChannelAmps(geometry, AZA_SPATIALIZE_ADVANCED, srcPosStart, channelAmpStart, NULL);
+			azaSpatializeGetChannelAmps(geometry, AZA_SPATIALIZE_ADVANCED, srcPosEnd, channelAmpEnd, NULL);
+		} else {
+			channelAmpStart[0] = channelAmpEnd[0] = 1.0f;
+		}
+		for (uint8_t c = 0; c < channels; c++) {
+			channelAmpStart[c] *= srcAmpStart;
+			channelAmpEnd[c] *= srcAmpEnd;
+		}
+	}
+	azaSpatializeMixFade(sideBuffer, srcBuffer, channelAmpStart, channelAmpEnd);
+	for (uint8_t c = 0; c < channels; c++) {
+		azaDelayDynamicChannelConfig *channelConfig = azaDelayDynamicGetChannelConfig(delay, c);
+		channelConfig->delay = channelDelayStart[c];
+		azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
+		channelData->filter.config.frequency = azaSpatializeGetFilterCutoff(channelDelayStart[c], channelDot[c]);
+		err = azaFilterProcess(&channelData->filter, azaBufferOneChannel(sideBuffer, c));
+		if (err) goto done;
+	}
+	if (prime) {
+		err = azaDelayDynamicPrime(delay, sideBuffer, channelDelayEnd);
+		goto done;
+	}
+	err = azaDelayDynamicProcess(delay, sideBuffer, channelDelayEnd);
+	if (err) goto done;
+	azaBufferMixFade(dstBuffer, 1.0f, 1.0f, sideBuffer, fadeStart, fadeEnd);
+done:
+	azaReleaseSideBuffers(mark);
+	return err;
+}
+
+static int azaSpatializeCheckSource(azaBuffer dstBuffer, azaBuffer srcBuffer) {
+	int err = azaCheckBuffer(&srcBuffer);
+	if (err) return err;
+	if (dstBuffer.samplerate != srcBuffer.samplerate) return AZA_ERROR_MISMATCHED_SAMPLERATE;
+	if (dstBuffer.frames != srcBuffer.frames) return AZA_ERROR_MISMATCHED_FRAME_COUNT;
+	if (srcBuffer.channelLayout.count != 1) return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	return AZA_SUCCESS;
+}
+
+// Returns the cached geometry for channelLayout, or fills in fallback without a gain grid if the cache can't help
+static const azaSpeakerGeometry* azaSpatializeGetGeometry(azaSpeakerGeometry *fallback, azaChannelLayout channelLayout) {
+	const azaSpeakerGeometry *result = azaGetSpeakerGeometry(channelLayout);
+	if AZA_UNLIKELY(!result) {
+		azaSpeakerGeometryInitVectors(fallback, channelLayout);
+		result = fallback;
+	}
+	return result;
+}
+
+int azaSpatializeProcess(azaSpatialize *data, azaBuffer dstBuffer, azaBuffer srcBuffer, azaVec3 srcPosStart, float srcAmpStart, azaVec3 srcPosEnd, float srcAmpEnd) {
+	int err = AZA_SUCCESS;
+	err = azaCheckBuffer(&dstBuffer);
+	if (err) return err;
+	err = azaSpatializeCheckSource(dstBuffer, srcBuffer);
+	if (err) return err;
+	// TODO: Should this just be an error?
+	if (dstBuffer.channelLayout.count > AZA_MAX_CHANNEL_POSITIONS) dstBuffer.channelLayout.count = AZA_MAX_CHANNEL_POSITIONS;
+	azaSpeakerGeometry fallback;
+	const azaSpeakerGeometry *geometry = azaSpatializeGetGeometry(&fallback, dstBuffer.channelLayout);
+	return azaSpatializeProcessWithGeometry(data, NULL, geometry, AZA_SPATIALIZE_LOD_FULL, 0, 1.0f, 1.0f, dstBuffer, srcBuffer, srcPosStart, srcAmpStart, srcPosEnd, srcAmpEnd);
+}
+
+int azaSpatializeProcessBatch(const azaWorld *world, azaBuffer dstBuffer, const azaSpatializeSource *sources, uint32_t sourceCount) {
+	int err = AZA_SUCCESS;
+	err = azaCheckBuffer(&dstBuffer);
+	if (err) return err;
+	// There's no speaker geometry for channels past this
+	if (dstBuffer.channelLayout.count > AZA_MAX_CHANNEL_POSITIONS) return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	// Check everything up front so we don't leave dstBuffer half-mixed
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		if (sources[i].lod == AZA_SPATIALIZE_LOD_VIRTUAL && sources[i].lodPrev == AZA_SPATIALIZE_LOD_VIRTUAL) continue;
+		err = azaSpatializeCheckSource(dstBuffer, sources[i].buffer);
+		if (err) return err;
+	}
+	azaSpeakerGeometry fallback;
+	const azaSpeakerGeometry *geometry = azaSpatializeGetGeometry(&fallback, dstBuffer.channelLayout);
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		const azaSpatializeSource *source = &sources[i];
+		azaSpatializeLOD lod = source->lod;
+		azaSpatializeLOD lodPrev = source->lodPrev;
+		if (lod == lodPrev) {
+			if (lod == AZA_SPATIALIZE_LOD_VIRTUAL) continue;
+			err = azaSpatializeProcessWithGeometry(source->spatialize, world, geometry, lod, AZA_SPATIALIZE_DOPPLER_PRIME, 1.0f, 1.0f, dstBuffer, source->buffer, source->posStart, source->ampStart, source->posEnd, source->ampEnd);
+			if (err) return err;
+			continue;
+		}
+		// Crossfade from the old way to the new one over this block. The delays only get fed once, by FULL if either side is, so they can't be fed the same frames twice.
+		if (lodPrev != AZA_SPATIALIZE_LOD_VIRTUAL) {
+			err = azaSpatializeProcessWithGeometry(source->spatialize, world, geometry, lodPrev, 0, 1.0f, 0.0f, dstBuffer, source->buffer, source->posStart, source->ampStart, source->posEnd, source->ampEnd);
+			if (err) return err;
+		}
+		if (lod == AZA_SPATIALIZE_LOD_VIRTUAL) continue;
+		if (lodPrev == AZA_SPATIALIZE_LOD_VIRTUAL) {
+			// The delays start from silence, so the source fades in on its way into them rather than on its way out
+			err = azaSpatializeProcessWithGeometry(source->spatialize, world, geometry, lod, AZA_SPATIALIZE_DOPPLER_RESET | AZA_SPATIALIZE_DOPPLER_PRIME, 1.0f, 1.0f, dstBuffer, source->buffer, source->posStart, 0.0f, source->posEnd, source->ampEnd);
+		} else {
+			err = azaSpatializeProcessWithGeometry(source->spatialize, world, geometry, lod, 0, 0.0f, 1.0f, dstBuffer, source->buffer, source->posStart, source->ampStart, source->posEnd, source->ampEnd);
+		}
+		if (err) return err;
+	}
+	return AZA_SUCCESS;
+}
+
+// How loud a source is in dB for the sake of its lod, counting its priority
+static float azaSpatializeLODLevel(const azaSpatializeSource *source) {
+	return aza_amp_to_dbf(AZA_MAX(source->ampStart, source->ampEnd)) + source->priority;
 }
 
-uint32_t azaSpatializeGetAllocSize(uint8_t channelCapInline) {
-	size_t size = sizeof(azaSpatialize);
-	size = azaAddSizeWithAlign(size, azaSpatializeChannelDataGetAllocSize(channelCapInline), alignof(azaSpatializeChannelData));
-	size = azaAddSizeWithAlign(size, azaDelayDynamicGetAllocSize(channelCapInline), alignof(azaDelayDynamic));
-	return (uint32_t)size;
+// Where a source stands when too many want ADVANCED. Sources that already have it rank hysteresis higher, so two of about the same level don't keep trading places.
+static float azaSpatializeLODRank(const azaSpatializeSource *source, float hysteresis) {
+	return azaSpatializeLODLevel(source) + (source->lodPrev == AZA_SPATIALIZE_LOD_FULL ? hysteresis : 0.0f);
 }
 
-void azaSpatializeInit(azaSpatialize *data, uint32_t allocSize, azaSpatializeConfig config, uint8_t channelCapInline) {
-	uint32_t filterAllocSize = azaFilterGetAllocSize(1);
-	data->header.kind = AZA_DSP_SPATIALIZE;
-	data->header.structSize = allocSize;
-	data->config = config;
-	azaDSPChannelDataInit(&data->channelData, channelCapInline, filterAllocSize, alignof(azaSpatializeChannelData));
-	for (uint8_t c = 0; c < channelCapInline; c++) {
-		azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		azaFilterInit(&channelData->filter, filterAllocSize, (azaFilterConfig) {
-			.kind = AZA_FILTER_LOW_PASS,
-			.dryMix = 0.0f,
-			.frequency = 15000.0f,
-		}, 1);
+// Whether a source should be ADVANCED rather than SIMPLE if we don't run out of room for it
+static bool azaSpatializeLODWantsFull(const azaSpatializeLODConfig *config, const azaWorld *world, const azaSpatializeSource *source, float level, float hysteresis) {
+	if (!source->spatialize || source->spatialize->config.mode != AZA_SPATIALIZE_ADVANCED) return false;
+	float climb = source->lodPrev == AZA_SPATIALIZE_LOD_FULL ? 0.0f : hysteresis;
+	if (level < config->simpleGain + climb) return false;
+	if (config->simpleDistance > 0.0f) {
+		if (source->spatialize->config.world) {
+			world = source->spatialize->config.world;
+		}
+		float distance = azaVec3Norm(azaSubVec3(source->posEnd, world->origin));
+		if (distance > config->simpleDistance * aza_db_to_ampf(-climb)) return false;
 	}
-	azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
-	// NOTE: We can ignore the return value because channelCount == channelCapInline
-	azaDelayDynamicInit(delay, azaDelayDynamicGetAllocSize(channelCapInline), (azaDelayDynamicConfig){
-		.gain = 0.0f,
-		.gainDry = -INFINITY,
-		.delayMax = config.delayMax != 0.0f ? config.delayMax : 500.0f,
-		.feedback = 0.0f,
-		.pingpong = 0.0f,
-		.wetEffects = NULL,
-		.kernel = NULL,
-	}, channelCapInline, channelCapInline, NULL);
+	return true;
 }
 
-void azaSpatializeDeinit(azaSpatialize *data) {
-	for (uint8_t c = 0; c < data->channelData.capInline + data->channelData.capAdditional; c++) {
-		azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
-		azaFilterDeinit(&channelData->filter);
+void azaSpatializeUpdateLOD(azaSpatializeLODConfig config, const azaWorld *world, azaSpatializeSource *sources, uint32_t sourceCount) {
+	if (world == NULL) {
+		world = &azaWorldDefault;
+	}
+	if (config.virtualGain == 0.0f) config.virtualGain = -60.0f;
+	if (config.maskRange == 0.0f) config.maskRange = 50.0f;
+	if (config.simpleGain == 0.0f) config.simpleGain = -30.0f;
+	if (config.hysteresis == 0.0f) config.hysteresis = 3.0f;
+	float loudest = -INFINITY;
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		loudest = AZA_MAX(loudest, azaSpatializeLODLevel(&sources[i]));
+	}
+	float virtualLevel = AZA_MAX(config.virtualGain, loudest - config.maskRange);
+	uint32_t fullCount = 0;
+	float fullLevelMin = INFINITY, fullLevelMax = -INFINITY;
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		azaSpatializeSource *source = &sources[i];
+		source->lodPrev = source->lod;
+		float level = azaSpatializeLODLevel(source);
+		float climb = source->lodPrev == AZA_SPATIALIZE_LOD_VIRTUAL ? config.hysteresis : 0.0f;
+		if (level < virtualLevel + climb) {
+			source->lod = AZA_SPATIALIZE_LOD_VIRTUAL;
+		} else if (azaSpatializeLODWantsFull(&config, world, source, level, config.hysteresis)) {
+			source->lod = AZA_SPATIALIZE_LOD_FULL;
+			fullCount++;
+			fullLevelMin = AZA_MIN(fullLevelMin, level);
+			fullLevelMax = AZA_MAX(fullLevelMax, level);
+		} else {
+			source->lod = AZA_SPATIALIZE_LOD_SIMPLE;
+		}
+	}
+	if (config.advancedMax == 0 || fullCount <= config.advancedMax) return;
+	// Too many want ADVANCED, so only the loudest get it.
+	// Rather than sort, narrow down a level that lets through no more than advancedMax. A couple dozen steps get it far finer than anyone could hear.
+	float low = fullLevelMin;
+	float high = fullLevelMax + config.hysteresis + 1.0f;
+	for (uint32_t step = 0; step < 24; step++) {
+		float middle = (low + high) * 0.5f;
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < sourceCount; i++) {
+			const azaSpatializeSource *source = &sources[i];
+			if (source->lod != AZA_SPATIALIZE_LOD_FULL) continue;
+			count += azaSpatializeLODRank(source, config.hysteresis) >= middle;
+		}
+		if (count > config.advancedMax) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	// Everything from high up fits, and anything between low and high is as good as tied, so those fill whatever room is left in order
+	uint32_t room = config.advancedMax;
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		const azaSpatializeSource *source = &sources[i];
+		if (source->lod != AZA_SPATIALIZE_LOD_FULL) continue;
+		float rank = azaSpatializeLODRank(source, config.hysteresis);
+		room -= rank >= high;
+	}
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		azaSpatializeSource *source = &sources[i];
+		if (source->lod != AZA_SPATIALIZE_LOD_FULL) continue;
+		float rank = azaSpatializeLODRank(source, config.hysteresis);
+		if (rank >= high) continue;
+		if (rank >= low && room > 0) {
+			room--;
+		} else {
+			source->lod = AZA_SPATIALIZE_LOD_SIMPLE;
+		}
 	}
-	azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
-	azaDelayDynamicDeinit(delay);
 }
 
-azaDelayDynamic* azaSpatializeGetDelayDynamic(azaSpatialize *data) {
-	azaDelayDynamic *result = (azaDelayDynamic*)azaGetBufferOffset((char*)data, sizeof(azaSpatialize) + data->channelData.size * data->channelData.capInline, alignof(azaDelayDynamic));
-	return result;
+
+
+void azaAmbisonicGetGains(uint8_t order, azaVec3 direction, float *dstGains) {
+	// Ambisonics has x forward, y left, and z up
+	float x = direction.z, y = -direction.x, z = direction.y;
+	dstGains[0] = 1.0f;
+	if (order < 1) return;
+	dstGains[1] = y;
+	dstGains[2] = z;
+	dstGains[3] = x;
+	if (order < 2) return;
+	const float sqrt3 = 1.7320508f;
+	dstGains[4] = sqrt3 * x * y;
+	dstGains[5] = sqrt3 * y * z;
+	dstGains[6] = 0.5f * (3.0f * z * z - 1.0f);
+	dstGains[7] = sqrt3 * x * z;
+	dstGains[8] = 0.5f * sqrt3 * (x * x - y * y);
+	if (order < 3) return;
+	// sqrt(5/8), sqrt(15), and sqrt(3/8)
+	const float sqrt5_8 = 0.7905694f, sqrt15 = 3.8729833f, sqrt3_8 = 0.6123724f;
+	dstGains[ 9] = sqrt5_8 * y * (3.0f * x * x - y * y);
+	dstGains[10] = sqrt15 * x * y * z;
+	dstGains[11] = sqrt3_8 * y * (5.0f * z * z - 1.0f);
+	dstGains[12] = 0.5f * z * (5.0f * z * z - 3.0f);
+	dstGains[13] = sqrt3_8 * x * (5.0f * z * z - 1.0f);
+	dstGains[14] = 0.5f * sqrt15 * z * (x * x - y * y);
+	dstGains[15] = sqrt5_8 * x * (x * x - 3.0f * y * y);
 }
 
-azaSpatialize* azaMakeSpatialize(azaSpatializeConfig config, uint8_t channelCapInline) {
-	uint32_t size = azaSpatializeGetAllocSize(channelCapInline);
-	azaSpatialize *result = aza_calloc(1, size);
-	if (result) azaSpatializeInit(result, size, config, channelCapInline);
+// The index'th of count points spread evenly over the sphere along a Fibonacci spiral
+static azaVec3 azaFibonacciSphere(uint32_t index, uint32_t count) {
+	// pi * (3 - sqrt(5))
+	const float goldenAngle = 2.3999632f;
+	float y = 1.0f - (2.0f * (float)index + 1.0f) / (float)count;
+	float radius = sqrtf(AZA_MAX(0.0f, 1.0f - y * y));
+	float angle = goldenAngle * (float)index;
+	return (azaVec3) { radius * cosf(angle), y, radius * sinf(angle) };
+}
+
+// Where the decoder for order starts within each layout's decoders, as a multiple of the channel count
+static uint32_t azaAmbisonicDecoderOffset(uint8_t order) {
+	uint32_t result = 0;
+	for (uint8_t o = 1; o < order; o++) {
+		result += AZA_AMBISONIC_CHANNELS(o);
+	}
 	return result;
 }
 
-void azaFreeSpatialize(azaSpatialize *data) {
-	azaSpatializeDeinit(data);
-	aza_free(data);
+// All-round ambisonic decoding (AllRAD): decode to virtual speakers spread evenly over the sphere, then pan those to the real ones. Works for any layout, including uneven ones where decoding straight to the speakers falls apart.
+// Each order is weighted for max rE, which keeps the energy as focused towards the source as it can be.
+static void azaAmbisonicMakeDecoder(const azaSpeakerGeometry *geometry, uint8_t order, float *dst) {
+	uint8_t channels = geometry->layout.count;
+	uint32_t soundfieldChannels = AZA_AMBISONIC_CHANNELS(order);
+	float rE = cosf(AZA_DEG_TO_RAD(137.9f) / ((float)order + 1.51f));
+	float legendre[AZAUDIO_AMBISONIC_MAX_ORDER+1] = { 1.0f, rE, 0.5f * (3.0f * rE * rE - 1.0f), 0.5f * rE * (5.0f * rE * rE - 3.0f) };
+	float weights[AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+	for (uint8_t l = 0; l <= order; l++) {
+		// SN3D needs 2l+1 to come back out at the same level as it went in
+		for (uint32_t k = l * l; k < AZA_AMBISONIC_CHANNELS(l); k++) {
+			weights[k] = (float)(2 * l + 1) * legendre[l] / (float)AZAUDIO_AMBISONIC_DECODE_POINTS;
+		}
+	}
+	memset(dst, 0, sizeof(float) * channels * soundfieldChannels);
+	for (uint32_t p = 0; p < AZAUDIO_AMBISONIC_DECODE_POINTS; p++) {
+		azaVec3 dir = azaFibonacciSphere(p, AZAUDIO_AMBISONIC_DECODE_POINTS);
+		float gains[AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+		azaAmbisonicGetGains(order, dir, gains);
+		float amps[AZA_MAX_CHANNEL_POSITIONS];
+		azaSpatializeGetChannelAmps(geometry, AZA_SPATIALIZE_SIMPLE, dir, amps, NULL);
+		for (uint8_t c = 0; c < channels; c++) {
+			float *row = dst + c * soundfieldChannels;
+			for (uint32_t k = 0; k < soundfieldChannels; k++) {
+				row[k] += amps[c] * gains[k] * weights[k];
+			}
+		}
+	}
 }
 
-static float azaSpatializeGetFilterCutoff(float delay, float dot) {
-	return 192000.0f / AZA_MAX(delay, 1.0f) * (dot * 0.35f + 0.65f);
+static void azaSpeakerGeometryMakeAmbisonicDecoders(azaSpeakerGeometry *data) {
+	for (uint8_t order = 1; order <= AZAUDIO_AMBISONIC_MAX_ORDER; order++) {
+		azaAmbisonicMakeDecoder(data, order, data->ambisonicDecoders + azaAmbisonicDecoderOffset(order) * data->layout.count);
+	}
+	data->hasAmbisonicDecoders = true;
 }
 
-int azaSpatializeProcess(azaSpatialize *data, azaBuffer dstBuffer, azaBuffer srcBuffer, azaVec3 srcPosStart, float srcAmpStart, azaVec3 srcPosEnd, float srcAmpEnd) {
-	int err = AZA_SUCCESS;
-	err = azaCheckBuffer(dstBuffer);
+// Works out the matrix that turns a soundfield from world space into headspace, with one row of soundfieldChannels per headspace channel.
+// Rather than the usual recurrences, this fits the matrix to the gains of a handful of directions before and after turning them. Turning keeps each order to itself, so the fit is exact.
+static void azaAmbisonicGetRotation(uint8_t order, const azaWorld *world, float *dst) {
+	enum { CHANNELS_MAX = AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER), POINTS = CHANNELS_MAX * 2 };
+	uint32_t soundfieldChannels = AZA_AMBISONIC_CHANNELS(order);
+	// gains[0] are for the directions in headspace and gains[1] for the same directions in world space
+	float gains[2][POINTS][CHANNELS_MAX];
+	for (uint32_t p = 0; p < POINTS; p++) {
+		azaVec3 dir = azaFibonacciSphere(p, POINTS);
+		azaAmbisonicGetGains(order, azaMulVec3Mat3(dir, world->orientation), gains[0][p]);
+		azaAmbisonicGetGains(order, dir, gains[1][p]);
+	}
+	// Least squares for head = R * world, which comes to (H H^T) R = H W^T. Solved with Gauss-Jordan elimination on [H H^T | H W^T].
+	double system[CHANNELS_MAX][CHANNELS_MAX * 2];
+	for (uint32_t i = 0; i < soundfieldChannels; i++) {
+		for (uint32_t j = 0; j < soundfieldChannels; j++) {
+			double hh = 0.0, hw = 0.0;
+			for (uint32_t p = 0; p < POINTS; p++) {
+				hh += (double)gains[0][p][i] * (double)gains[0][p][j];
+				hw += (double)gains[0][p][i] * (double)gains[1][p][j];
+			}
+			system[i][j] = hh;
+			system[i][soundfieldChannels + j] = hw;
+		}
+	}
+	uint32_t columns = soundfieldChannels * 2;
+	for (uint32_t col = 0; col < soundfieldChannels; col++) {
+		uint32_t pivot = col;
+		for (uint32_t row = col+1; row < soundfieldChannels; row++) {
+			if (fabs(system[row][col]) > fabs(system[pivot][col])) pivot = row;
+		}
+		if (pivot != col) {
+			for (uint32_t j = 0; j < columns; j++) {
+				double temp = system[col][j];
+				system[col][j] = system[pivot][j];
+				system[pivot][j] = temp;
+			}
+		}
+		double scale = 1.0 / system[col][col];
+		for (uint32_t j = 0; j < columns; j++) {
+			system[col][j] *= scale;
+		}
+		for (uint32_t row = 0; row < soundfieldChannels; row++) {
+			if (row == col || system[row][col] == 0.0) continue;
+			double factor = system[row][col];
+			for (uint32_t j = 0; j < columns; j++) {
+				system[row][j] -= factor * system[col][j];
+			}
+		}
+	}
+	for (uint32_t i = 0; i < soundfieldChannels; i++) {
+		for (uint32_t j = 0; j < soundfieldChannels; j++) {
+			dst[i * soundfieldChannels + j] = (float)system[i][soundfieldChannels + j];
+		}
+	}
+}
+
+// Gains for a source at pos relative to the origin. Sources crossing close to the head fade towards the omnidirectional channel, the same way azaSpatialize spreads them over every speaker.
+static void azaAmbisonicGetSourceGains(uint8_t order, azaVec3 pos, float amp, float *dstGains) {
+	float norm = azaVec3Norm(pos);
+	azaVec3 direction = norm > 0.0f ? azaDivVec3Scalar(pos, norm) : (azaVec3) { 0.0f, 0.0f, 1.0f };
+	azaAmbisonicGetGains(order, direction, dstGains);
+	float directional = AZA_MIN(norm * 2.0f, 1.0f) * amp;
+	dstGains[0] = amp;
+	for (uint32_t k = 1; k < AZA_AMBISONIC_CHANNELS(order); k++) {
+		dstGains[k] *= directional;
+	}
+}
+
+static int azaAmbisonicCheckSoundfield(azaAmbisonicConfig config, azaBuffer soundfield) {
+	if (config.order < 1 || config.order > AZAUDIO_AMBISONIC_MAX_ORDER) return AZA_ERROR_INVALID_CONFIGURATION;
+	int err = azaCheckBuffer(&soundfield);
 	if (err) return err;
-	err = azaCheckBuffer(srcBuffer);
+	if (soundfield.channelLayout.count != AZA_AMBISONIC_CHANNELS(config.order)) return AZA_ERROR_MISMATCHED_CHANNEL_COUNT;
+	return AZA_SUCCESS;
+}
+
+int azaAmbisonicEncode(azaAmbisonicConfig config, azaBuffer soundfield, const azaSpatializeSource *sources, uint32_t sourceCount) {
+	int err = azaAmbisonicCheckSoundfield(config, soundfield);
 	if (err) return err;
-	if (dstBuffer.samplerate != srcBuffer.samplerate) return AZA_ERROR_MISMATCHED_SAMPLERATE;
-	if (dstBuffer.frames != srcBuffer.frames) return AZA_ERROR_MISMATCHED_FRAME_COUNT;
-	if (srcBuffer.channelLayout.count != 1) return AZA_ERROR_INVALID_CHANNEL_COUNT;
-	// TODO: Should this just be an error?
-	if (dstBuffer.channelLayout.count > AZA_MAX_CHANNEL_POSITIONS) dstBuffer.channelLayout.count = AZA_MAX_CHANNEL_POSITIONS;
-	const azaWorld *world = data->config.world;
-	if (world == NULL) {
-		world = &azaWorldDefault;
+	// Check everything up front so we don't leave soundfield half-mixed
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		err = azaSpatializeCheckSource(soundfield, sources[i].buffer);
+		if (err) return err;
 	}
-	// Transform srcPos to headspace
-	srcPosStart = azaMulVec3Mat3(azaSubVec3(srcPosStart, world->origin), world->orientation);
-	srcPosEnd = azaMulVec3Mat3(azaSubVec3(srcPosEnd, world->origin), world->orientation);
-	azaVec3 srcNormalStart;
-	azaVec3 srcNormalEnd;
+	const azaWorld *world = config.world ? config.world : &azaWorldDefault;
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		const azaSpatializeSource *source = &sources[i];
+		float gainsStart[AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+		float gainsEnd[AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+		azaAmbisonicGetSourceGains(config.order, azaSubVec3(source->posStart, world->origin), source->ampStart, gainsStart);
+		azaAmbisonicGetSourceGains(config.order, azaSubVec3(source->posEnd, world->origin), source->ampEnd, gainsEnd);
+		azaSpatializeMixFade(soundfield, source->buffer, gainsStart, gainsEnd);
+	}
+	return AZA_SUCCESS;
+}
 
-	azaBuffer sideBuffer = azaPushSideBufferZero(dstBuffer.frames, dstBuffer.channelLayout.count, dstBuffer.samplerate);
-	float delayStart = azaVec3Norm(srcPosStart) / world->speedOfSound * 1000.0f;
-	float delayEnd = azaVec3Norm(srcPosEnd) / world->speedOfSound * 1000.0f;
-	if (dstBuffer.channelLayout.count == 1) {
-		// Nothing to do but put it in there I guess
-		if (data->config.mode == AZA_SPATIALIZE_ADVANCED) {
-			// Gotta do the doppler
-			azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
-			err = azaEnsureChannels(&data->channelData, 1);
-			if (err) return err;
-			azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, 0);
-			err = azaEnsureChannels(&delay->channelData, 1);
-			if (err) return err;
-			azaDelayDynamicChannelConfig *channelConfig = azaDelayDynamicGetChannelConfig(delay, 0);
-			channelConfig->delay = delayStart;
-			err = azaDelayDynamicProcess(delay, sideBuffer, &delayEnd);
-			if (err) return err;
-			channelData->filter.config.frequency = azaSpatializeGetFilterCutoff(delayStart, 1.0f);
-			err = azaFilterProcess(&channelData->filter, sideBuffer);
-			if (err) return err;
+static inline void azaAmbisonicDecodeChannels(float *dst, uint32_t dstStride, uint32_t dstChannelStride, uint8_t channels, const float *src, uint32_t srcStride, uint32_t srcChannelStride, uint32_t soundfieldChannels, uint32_t frames, const float *matrix) {
+	for (uint32_t i = 0; i < frames; i++) {
+		float in[AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+		for (uint32_t k = 0; k < soundfieldChannels; k++) {
+			in[k] = src[i * srcStride + k * srcChannelStride];
 		}
-		azaBufferMixFade(dstBuffer, 1.0f, 1.0f, sideBuffer, srcAmpStart, srcAmpEnd);
-		azaPopSideBuffer();
-		return AZA_SUCCESS;
-	}
-	// How much of the signal to add to all channels in case srcPos is crossing close to the head
-	float allChannelAddAmpStart = 0.0f;
-	float allChannelAddAmpEnd = 0.0f;
-	float normStart, normEnd;
-	{
-		normStart = azaVec3Norm(srcPosStart);
-		if (normStart < 0.5f) {
-			allChannelAddAmpStart = (0.5f - normStart) * 2.0f;
-			srcNormalStart = srcPosStart;
-		} else {
-			srcNormalStart = azaDivVec3Scalar(srcPosStart, normStart);
+		float *d = dst + i * dstStride;
+		for (uint8_t c = 0; c < channels; c++) {
+			const float *row = matrix + c * soundfieldChannels;
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < soundfieldChannels; k++) {
+				sum += row[k] * in[k];
+			}
+			d[c * dstChannelStride] += sum;
 		}
-		normEnd = azaVec3Norm(srcPosEnd);
-		if (normEnd < 0.5f) {
-			allChannelAddAmpEnd = (0.5f - normEnd) * 2.0f;
-			srcNormalEnd = srcPosEnd;
-		} else {
-			srcNormalEnd = azaDivVec3Scalar(srcPosEnd, normEnd);
+	}
+}
+
+int azaAmbisonicDecode(azaAmbisonicConfig config, azaBuffer dstBuffer, azaBuffer soundfield, float amp) {
+	int err = azaAmbisonicCheckSoundfield(config, soundfield);
+	if (err) return err;
+	err = azaCheckBuffer(&dstBuffer);
+	if (err) return err;
+	if (dstBuffer.samplerate != soundfield.samplerate) return AZA_ERROR_MISMATCHED_SAMPLERATE;
+	if (dstBuffer.frames != soundfield.frames) return AZA_ERROR_MISMATCHED_FRAME_COUNT;
+	// Same as azaSpatializeProcessBatch, there are no decoders for channels past this
+	if (dstBuffer.channelLayout.count > AZA_MAX_CHANNEL_POSITIONS) return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	const azaWorld *world = config.world ? config.world : &azaWorldDefault;
+	uint8_t channels = dstBuffer.channelLayout.count;
+	uint32_t soundfieldChannels = AZA_AMBISONIC_CHANNELS(config.order);
+	azaSpeakerGeometry fallback;
+	const azaSpeakerGeometry *geometry = azaSpatializeGetGeometry(&fallback, dstBuffer.channelLayout);
+	float fallbackDecoder[AZA_MAX_CHANNEL_POSITIONS * AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+	const float *decoder;
+	if AZA_LIKELY(geometry->hasAmbisonicDecoders) {
+		decoder = geometry->ambisonicDecoders + azaAmbisonicDecoderOffset(config.order) * channels;
+	} else {
+		azaAmbisonicMakeDecoder(geometry, config.order, fallbackDecoder);
+		decoder = fallbackDecoder;
+	}
+	float rotation[AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER) * AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+	azaAmbisonicGetRotation(config.order, world, rotation);
+	// decoder * rotation * amp, so turning costs nothing per frame
+	float matrix[AZA_MAX_CHANNEL_POSITIONS * AZA_AMBISONIC_CHANNELS(AZAUDIO_AMBISONIC_MAX_ORDER)];
+	for (uint8_t c = 0; c < channels; c++) {
+		for (uint32_t k = 0; k < soundfieldChannels; k++) {
+			float sum = 0.0f;
+			for (uint32_t j = 0; j < soundfieldChannels; j++) {
+				sum += decoder[c * soundfieldChannels + j] * rotation[j * soundfieldChannels + k];
+			}
+			matrix[c * soundfieldChannels + k] = sum * amp;
 		}
 	}
+	// Constant soundfield sizes let the compiler unroll the sums
+	switch (config.order) {
+		case 1: azaAmbisonicDecodeChannels(dstBuffer.samples, dstBuffer.stride, dstBuffer.channelStride, channels, soundfield.samples, soundfield.stride, soundfield.channelStride, AZA_AMBISONIC_CHANNELS(1), dstBuffer.frames, matrix); break;
+		case 2: azaAmbisonicDecodeChannels(dstBuffer.samples, dstBuffer.stride, dstBuffer.channelStride, channels, soundfield.samples, soundfield.stride, soundfield.channelStride, AZA_AMBISONIC_CHANNELS(2), dstBuffer.frames, matrix); break;
+		case 3: azaAmbisonicDecodeChannels(dstBuffer.samples, dstBuffer.stride, dstBuffer.channelStride, channels, soundfield.samples, soundfield.stride, soundfield.channelStride, AZA_AMBISONIC_CHANNELS(3), dstBuffer.frames, matrix); break;
+	}
+	return AZA_SUCCESS;
+}
 
-	uint8_t nonSubChannels, hasAerials;
-	azaVec3 channelVectors[AZA_MAX_CHANNEL_POSITIONS];
-	azaGetChannelMetadata(dstBuffer.channelLayout, channelVectors, &nonSubChannels, &hasAerials);
-	float channelDelayStart[AZA_MAX_CHANNEL_POSITIONS];
-	float channelDelayEnd[AZA_MAX_CHANNEL_POSITIONS];
-	float channelDot[AZA_MAX_CHANNEL_POSITIONS];
 
-	// Position our channel vectors
-	struct channelMetadata channelsStart[AZA_MAX_CHANNEL_POSITIONS];
-	struct channelMetadata channelsEnd[AZA_MAX_CHANNEL_POSITIONS];
-	memset(channelsStart, 0, sizeof(channelsStart));
-	memset(channelsEnd, 0, sizeof(channelsEnd));
-	float totalMagnitudeStart = 0.0f;
-	float totalMagnitudeEnd = 0.0f;
-	float earDistance = data->config.earDistance;
-	if (earDistance == 0.0f) {
-		earDistance = 0.085f;
+static void azaHRTFGetCellBounds(uint32_t cell, float *u0, float *v0, float *size) {
+	const uint32_t res = AZAUDIO_HRTF_GRID_RES;
+	*size = 2.0f / (float)res;
+	*u0 = (float)(cell % res) * *size - 1.0f;
+	*v0 = (float)(cell / res) * *size - 1.0f;
+}
+
+static uint32_t azaHRTFGetCell(azaVec3 dir) {
+	const uint32_t res = AZAUDIO_HRTF_GRID_RES;
+	float u, v;
+	azaOctahedralEncode(dir, &u, &v);
+	uint32_t indexU = AZA_MIN((uint32_t)AZA_CLAMP((u + 1.0f) * (0.5f * (float)res), 0.0f, (float)res), res - 1);
+	uint32_t indexV = AZA_MIN((uint32_t)AZA_CLAMP((v + 1.0f) * (0.5f * (float)res), 0.0f, (float)res), res - 1);
+	return indexV * res + indexU;
+}
+
+// For a point p in a cell whose center c has its (taps+1)th nearest measurement at angle a, and whose furthest point is r from c, anything among the nearest to p is within a + r of p, and so within a + 2r of c.
+static int azaHRTFMakeGrid(azaHRTF *data) {
+	const uint32_t cells = AZAUDIO_HRTF_GRID_RES * AZAUDIO_HRTF_GRID_RES;
+	if (data->directionCount <= AZAUDIO_BINAURAL_DIRECTION_TAPS+1) return AZA_SUCCESS;
+	float *limits = aza_malloc(sizeof(float) * cells);
+	azaVec3 *centers = aza_malloc(sizeof(azaVec3) * cells);
+	data->cellStart = aza_malloc(sizeof(uint32_t) * (cells + 1));
+	if (!limits || !centers || !data->cellStart) goto outOfMemory;
+	for (uint32_t cell = 0; cell < cells; cell++) {
+		float u0, v0, size;
+		azaHRTFGetCellBounds(cell, &u0, &v0, &size);
+		azaVec3 center = azaOctahedralDecode(u0 + size * 0.5f, v0 + size * 0.5f);
+		// Cells are small enough that checking a handful of points along their edges finds how far they reach
+		float radius = 0.0f;
+		for (uint32_t i = 0; i <= 8; i++) {
+			for (uint32_t j = 0; j <= 8; j++) {
+				if (i != 0 && i != 8 && j != 0 && j != 8) continue;
+				azaVec3 edge = azaOctahedralDecode(u0 + size * (float)i / 8.0f, v0 + size * (float)j / 8.0f);
+				radius = AZA_MAX(radius, acosf(AZA_CLAMP(azaVec3Dot(center, edge), -1.0f, 1.0f)));
+			}
+		}
+		float nearestDot[AZAUDIO_BINAURAL_DIRECTION_TAPS+1];
+		for (uint32_t n = 0; n < AZAUDIO_BINAURAL_DIRECTION_TAPS+1; n++) {
+			nearestDot[n] = -2.0f;
+		}
+		for (uint32_t d = 0; d < data->directionCount; d++) {
+			float dot = azaVec3Dot(center, data->directions[d]);
+			uint32_t n = AZAUDIO_BINAURAL_DIRECTION_TAPS+1;
+			for (; n > 0 && nearestDot[n-1] < dot; n--) {
+				if (n < AZAUDIO_BINAURAL_DIRECTION_TAPS+1) nearestDot[n] = nearestDot[n-1];
+			}
+			if (n < AZAUDIO_BINAURAL_DIRECTION_TAPS+1) nearestDot[n] = dot;
+		}
+		float furthest = acosf(AZA_CLAMP(nearestDot[AZAUDIO_BINAURAL_DIRECTION_TAPS], -1.0f, 1.0f));
+		// With a little extra for the edges being curves and for rounding
+		float limit = furthest + radius * 2.2f + 0.001f;
+		limits[cell] = limit >= AZA_PI ? -2.0f : cosf(limit);
+		centers[cell] = center;
 	}
-	for (uint8_t i = 0; i < dstBuffer.channelLayout.count; i++) {
-		channelsStart[i].channel = i;
-		channelsEnd[i].channel = i;
-		channelDot[i] = azaVec3Dot(channelVectors[i], srcNormalStart);
-		channelsStart[i].amp = 0.5f * normStart + 0.5f * channelDot[i] + allChannelAddAmpStart / (float)nonSubChannels;
-		channelsEnd[i].amp = 0.5f * normEnd + 0.5f * azaVec3Dot(channelVectors[i], srcNormalEnd) + allChannelAddAmpEnd / (float)nonSubChannels;
-		azaVec3 earPos = azaMulVec3Scalar(channelVectors[i], earDistance);
-		if (data->config.mode == AZA_SPATIALIZE_ADVANCED) {
-			// channelDelayStart[i] = 0.01f;
-			// channelDelayEnd[i] = 0.01f;
-			channelDelayStart[i] = azaVec3Norm(azaSubVec3(srcPosStart, earPos)) / world->speedOfSound * 1000.0f;
-			channelDelayEnd[i] = azaVec3Norm(azaSubVec3(srcPosEnd, earPos)) / world->speedOfSound * 1000.0f;
-		} else {
-			channelDelayStart[i] = delayStart;
-			channelDelayEnd[i] = delayEnd;
+	// Count, then fill
+	uint32_t total = 0;
+	for (uint32_t cell = 0; cell < cells; cell++) {
+		data->cellStart[cell] = total;
+		for (uint32_t d = 0; d < data->directionCount; d++) {
+			if (azaVec3Dot(centers[cell], data->directions[d]) >= limits[cell]) total++;
+		}
+	}
+	data->cellStart[cells] = total;
+	data->cellDirections = aza_malloc(sizeof(uint32_t) * total);
+	if (!data->cellDirections) goto outOfMemory;
+	for (uint32_t cell = 0; cell < cells; cell++) {
+		uint32_t *dst = data->cellDirections + data->cellStart[cell];
+		for (uint32_t d = 0; d < data->directionCount; d++) {
+			if (azaVec3Dot(centers[cell], data->directions[d]) >= limits[cell]) *dst++ = d;
 		}
-		// channelsStart[i].amp = azaVec3Dot(channelVectors[i], srcNormalStart) + allChannelAddAmpStart / (float)nonSubChannels;
-		// channelsEnd[i].amp = azaVec3Dot(channelVectors[i], srcNormalEnd) + allChannelAddAmpEnd / (float)nonSubChannels;
-		// if (channelsStart[i].amp < 0.0f) channelsStart[i].amp = 0.0f;
-		// if (channelsEnd[i].amp < 0.0f) channelsEnd[i].amp = 0.0f;
-		// channelsStart[i].amp = 0.25f + 0.75f * channelsStart[i].amp;
-		// channelsEnd[i].amp = 0.25f + 0.75f * channelsEnd[i].amp;
-		totalMagnitudeStart += channelsStart[i].amp;
-		totalMagnitudeEnd += channelsEnd[i].amp;
 	}
+	aza_free(limits);
+	aza_free(centers);
+	return AZA_SUCCESS;
+outOfMemory:
+	if (limits) aza_free(limits);
+	if (centers) aza_free(centers);
+	azaHRTFDeinit(data);
+	return AZA_ERROR_OUT_OF_MEMORY;
+}
+
+int azaHRTFInit(azaHRTF *data, uint32_t samplerate, uint32_t irFrames, uint32_t directionCount, const float *positions, const float *irs) {
+	memset(data, 0, sizeof(*data));
+	if (!positions || !irs) return AZA_ERROR_NULL_POINTER;
+	if (samplerate == 0 || irFrames == 0 || directionCount == 0) return AZA_ERROR_INVALID_CONFIGURATION;
+	// Don't let the allocation sizes wrap where size_t is 32 bits.
+	if ((uint64_t)directionCount > SIZE_MAX / sizeof(azaVec3) || (uint64_t)irFrames * directionCount > SIZE_MAX / (sizeof(float) * 2)) return AZA_ERROR_OUT_OF_MEMORY;
+	data->directions = aza_malloc(sizeof(azaVec3) * directionCount);
+	data->irs = aza_malloc(sizeof(float) * 2 * irFrames * directionCount);
+	if (!data->directions || !data->irs) {
+		azaHRTFDeinit(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	data->samplerate = samplerate;
+	data->irFrames = irFrames;
+	data->directionCount = directionCount;
+	for (uint32_t i = 0; i < directionCount; i++) {
+		float azimuth = AZA_DEG_TO_RAD(positions[i*3+0]);
+		float elevation = AZA_DEG_TO_RAD(positions[i*3+1]);
+		// Positive azimuth is towards the left, which is -x in headspace
+		data->directions[i] = (azaVec3) {
+			-sinf(azimuth) * cosf(elevation),
+			sinf(elevation),
+			cosf(azimuth) * cosf(elevation),
+		};
+	}
+	memcpy(data->irs, irs, sizeof(float) * 2 * irFrames * directionCount);
+	return azaHRTFMakeGrid(data);
+}
 
-	float minAmp = data->config.mode == AZA_SPATIALIZE_SIMPLE ? 0.0f : 0.8f;
+static inline uint32_t azaHRTFReadU32LE(const uint8_t *src) {
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
 
-	if (dstBuffer.channelLayout.count > 2) {
-		int minChannel = 2;
-		if (dstBuffer.channelLayout.count > 3 && hasAerials) {
-			// TODO: This probably isn't a reliable way to use aerials. Probably do something smarter.
-			minChannel = 3;
-		}
-		// Get channel amps in descending order
-		qsort(channelsStart, dstBuffer.channelLayout.count, sizeof(struct channelMetadata), compareChannelMetadataAmp);
-		qsort(channelsEnd, dstBuffer.channelLayout.count, sizeof(struct channelMetadata), compareChannelMetadataAmp);
+int azaHRTFLoad(azaHRTF *data, const char *path) {
+	memset(data, 0, sizeof(*data));
+	azaFileMapping file;
+	if (azaFileMap(&file, path)) {
+		AZA_LOG_ERR("azaHRTFLoad error: Failed to map \"%s\"\n", path);
+		return AZA_ERROR_FILE_IO;
+	}
+	int err = AZA_ERROR_UNSUPPORTED_FORMAT;
+	const uint64_t headerSize = 20;
+	if (file.size < headerSize || memcmp(file.data, "AZAHRIR1", 8) != 0) goto done;
+	uint32_t samplerate = azaHRTFReadU32LE(file.data + 8);
+	uint32_t irFrames = azaHRTFReadU32LE(file.data + 12);
+	uint32_t directionCount = azaHRTFReadU32LE(file.data + 16);
+	if (directionCount == 0 || irFrames == 0) goto done;
+	// Bound the header's counts by what the file can actually hold before multiplying them, so a bogus header can't wrap the size check around.
+	uint64_t fileFloats = (file.size - headerSize) / sizeof(float);
+	if (directionCount > fileFloats / 3) goto done;
+	uint64_t positionFloats = (uint64_t)directionCount * 3;
+	if ((uint64_t)irFrames > (fileFloats - positionFloats) / 2 / directionCount) goto done;
+	// Mappings are page-aligned and the header keeps the floats 4-byte aligned, so they can be read in place. Like the F32 path in file_stream.c, this assumes a little-endian machine.
+	const float *positions = (const float*)(file.data + headerSize);
+	err = azaHRTFInit(data, samplerate, irFrames, directionCount, positions, positions + positionFloats);
+done:
+	if (err == AZA_ERROR_UNSUPPORTED_FORMAT) {
+		AZA_LOG_ERR("azaHRTFLoad error: \"%s\" isn't an HRIR set we can read\n", path);
+	}
+	azaFileUnmap(&file);
+	return err;
+}
+
+void azaHRTFDeinit(azaHRTF *data) {
+	if (data->directions) {
+		aza_free(data->directions);
+	}
+	if (data->irs) {
+		aza_free(data->irs);
+	}
+	if (data->cellStart) {
+		aza_free(data->cellStart);
+	}
+	if (data->cellDirections) {
+		aza_free(data->cellDirections);
+	}
+	memset(data, 0, sizeof(*data));
+}
 
-		float ampMaxRangeStart = channelsStart[0].amp;
-		float ampMaxRangeEnd = channelsEnd[0].amp;
-		float ampMinRangeStart = channelsStart[minChannel].amp;
-		float ampMinRangeEnd = channelsEnd[minChannel].amp;
-		totalMagnitudeStart = 0.0f;
-		totalMagnitudeEnd = 0.0f;
-		for (uint8_t i = 0; i < dstBuffer.channelLayout.count; i++) {
-			channelsStart[i].amp = linstepf(channelsStart[i].amp, ampMinRangeStart, ampMaxRangeStart) + allChannelAddAmpStart / (float)nonSubChannels;
-			channelsEnd[i].amp = linstepf(channelsEnd[i].amp, ampMinRangeEnd, ampMaxRangeEnd) + allChannelAddAmpEnd / (float)nonSubChannels;
-			totalMagnitudeStart += channelsStart[i].amp;
-			totalMagnitudeEnd += channelsEnd[i].amp;
+// Finds the measured directions to spread a sound coming from dir over, and how much of it each one gets. Weights add up to 1.
+// Weights come from how close each direction is, minus how close the next one after them is, so a direction fades all the way out before another one takes its place and moving sources never jump.
+// returns how many directions were written
+static uint32_t azaHRTFGetDirectionWeights(const azaHRTF *hrtf, azaVec3 dir, uint32_t dstIndices[AZAUDIO_BINAURAL_DIRECTION_TAPS], float dstWeights[AZAUDIO_BINAURAL_DIRECTION_TAPS]) {
+	// One more than we keep, to fade against
+	uint32_t nearest[AZAUDIO_BINAURAL_DIRECTION_TAPS+1];
+	float nearestDot[AZAUDIO_BINAURAL_DIRECTION_TAPS+1];
+	uint32_t count = 0;
+	const uint32_t *candidates = NULL;
+	uint32_t candidateCount = hrtf->directionCount;
+	if (hrtf->cellStart) {
+		uint32_t cell = azaHRTFGetCell(dir);
+		candidates = hrtf->cellDirections + hrtf->cellStart[cell];
+		candidateCount = hrtf->cellStart[cell+1] - hrtf->cellStart[cell];
+	}
+	for (uint32_t c = 0; c < candidateCount; c++) {
+		uint32_t i = candidates ? candidates[c] : c;
+		float dot = azaVec3Dot(hrtf->directions[i], dir);
+		if (count == AZAUDIO_BINAURAL_DIRECTION_TAPS+1 && dot <= nearestDot[count-1]) continue;
+		uint32_t j = AZA_MIN(count, AZAUDIO_BINAURAL_DIRECTION_TAPS);
+		for (; j > 0 && nearestDot[j-1] < dot; j--) {
+			nearest[j] = nearest[j-1];
+			nearestDot[j] = nearestDot[j-1];
+		}
+		nearest[j] = i;
+		nearestDot[j] = dot;
+		if (count < AZAUDIO_BINAURAL_DIRECTION_TAPS+1) count++;
+	}
+	uint32_t result = AZA_MIN(count, AZAUDIO_BINAURAL_DIRECTION_TAPS);
+	float baseline = 0.0f;
+	if (count > AZAUDIO_BINAURAL_DIRECTION_TAPS) {
+		baseline = 1.0f / (1.0f - nearestDot[AZAUDIO_BINAURAL_DIRECTION_TAPS] + 1e-6f);
+	}
+	float total = 0.0f;
+	for (uint32_t i = 0; i < result; i++) {
+		dstIndices[i] = nearest[i];
+		dstWeights[i] = 1.0f / (1.0f - nearestDot[i] + 1e-6f) - baseline;
+		total += dstWeights[i];
+	}
+	if (total <= 0.0f) {
+		// Every direction is the same distance away, so they get equal shares
+		for (uint32_t i = 0; i < result; i++) {
+			dstWeights[i] = 1.0f / (float)result;
+		}
+	} else {
+		for (uint32_t i = 0; i < result; i++) {
+			dstWeights[i] /= total;
 		}
+	}
+	return result;
+}
+
+uint32_t azaBinauralGetAllocSize() {
+	return sizeof(azaBinaural);
+}
+
+void azaBinauralInit(azaBinaural *data, uint32_t allocSize, azaBinauralConfig config) {
+	assert(allocSize >= azaBinauralGetAllocSize());
+	memset(data, 0, sizeof(*data));
+	data->header.kind = AZA_DSP_BINAURAL;
+	data->header.structSize = allocSize;
+	data->config = config;
+}
 
-		// Put the amps back into channel order
-		qsort(channelsStart, dstBuffer.channelLayout.count, sizeof(struct channelMetadata), compareChannelMetadataChannel);
-		qsort(channelsEnd, dstBuffer.channelLayout.count, sizeof(struct channelMetadata), compareChannelMetadataChannel);
+static void azaBinauralFreeBuffers(azaBinaural *data) {
+	azaFFTDeinit(&data->fft);
+	if (data->buffer) {
+		aza_free(data->buffer);
+	}
+	if (data->directions) {
+		aza_free(data->directions);
 	}
+	data->buffer = NULL;
+	data->directions = NULL;
+	data->hrtf = NULL;
+	data->partitionFrames = 0;
+	data->partitionCount = 0;
+}
+
+void azaBinauralDeinit(azaBinaural *data) {
+	azaBinauralFreeBuffers(data);
+}
 
-#if PRINT_CHANNEL_AMPS || PRINT_CHANNEL_DELAYS
-	if (repeatCount == 0) {
-		AZA_LOG_INFO("\n");
+azaBinaural* azaMakeBinaural(azaBinauralConfig config) {
+	uint32_t size = azaBinauralGetAllocSize();
+	azaBinaural *result = aza_calloc(1, size);
+	if (result) azaBinauralInit(result, size, config);
+	return result;
+}
+
+void azaFreeBinaural(azaBinaural *data) {
+	azaBinauralDeinit(data);
+	aza_free(data);
+}
+
+static int azaBinauralHandleBufferResizes(azaBinaural *data) {
+	const azaHRTF *hrtf = data->config.hrtf;
+	uint32_t requested = data->config.partitionFrames ? AZA_MIN(data->config.partitionFrames, 65536) : AZAUDIO_BINAURAL_DEFAULT_PARTITION_FRAMES;
+	uint32_t partitionFrames = 2;
+	while (partitionFrames < requested) {
+		partitionFrames *= 2;
 	}
-#endif
-	for (uint8_t c = 0; c < sideBuffer.channelLayout.count; c++) {
-		float ampStart = srcAmpStart;
-		float ampEnd = srcAmpEnd;
-		if (dstBuffer.channelLayout.positions[c] != AZA_POS_SUBWOOFER) {
-			ampStart *= (channelsStart[c].amp / totalMagnitudeStart) * (1.0f - minAmp) + minAmp;
-			ampEnd *= (channelsEnd[c].amp / totalMagnitudeEnd) * (1.0f - minAmp) + minAmp;
+	if (data->hrtf == hrtf && data->partitionFrames == partitionFrames) return AZA_SUCCESS;
+	azaBinauralFreeBuffers(data);
+	int err = azaFFTInit(&data->fft, partitionFrames * 2);
+	if (err) return err;
+	uint32_t partitionCount = (hrtf->irFrames + partitionFrames - 1) / partitionFrames;
+	size_t spectrumFloats = AZA_FFT_SPECTRUM_FLOATS(partitionFrames * 2);
+	size_t filterFloats = spectrumFloats * partitionCount * 2 * hrtf->directionCount;
+	size_t directionFloats = partitionFrames * 2 + spectrumFloats * partitionCount;
+	size_t total = filterFloats + directionFloats * hrtf->directionCount + spectrumFloats * 2 + partitionFrames * 2 + partitionFrames * 2;
+	data->buffer = aza_calloc(total, sizeof(float));
+	data->directions = aza_calloc(hrtf->directionCount, sizeof(azaBinauralDirection));
+	if (!data->buffer || !data->directions) {
+		azaBinauralFreeBuffers(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	float *next = data->buffer;
+	data->filters = next;
+	next += filterFloats;
+	for (uint32_t i = 0; i < hrtf->directionCount; i++) {
+		azaBinauralDirection *direction = &data->directions[i];
+		direction->input = next;
+		next += partitionFrames * 2;
+		direction->spectra = next;
+		next += spectrumFloats * partitionCount;
+		// Nothing's ringing yet
+		direction->silentPartitions = partitionCount;
+	}
+	data->accum = next;
+	next += spectrumFloats * 2;
+	data->output = next;
+	next += partitionFrames * 2;
+	data->window = next;
+	// Each partition of each impulse response, zero-padded to the window length. The inverse FFT's scale goes in here so it costs nothing per partition.
+	float scale = 1.0f / (float)(partitionFrames * 2);
+	float *filter = data->filters;
+	for (uint32_t i = 0; i < hrtf->directionCount * 2; i++) {
+		const float *ir = hrtf->irs + (size_t)i * hrtf->irFrames;
+		for (uint32_t p = 0; p < partitionCount; p++) {
+			uint32_t start = p * partitionFrames;
+			uint32_t frames = AZA_MIN(partitionFrames, hrtf->irFrames - start);
+			memset(data->window, 0, sizeof(float) * partitionFrames * 2);
+			for (uint32_t f = 0; f < frames; f++) {
+				data->window[f] = ir[start + f] * scale;
+			}
+			azaFFTForward(&data->fft, filter, data->window);
+			filter += spectrumFloats;
 		}
-#if PRINT_CHANNEL_AMPS
-		if (repeatCount == 0) {
-			AZA_LOG_INFO("Channel %u amp: %f\n", (uint32_t)c, ampStart);
+	}
+	data->hrtf = hrtf;
+	data->partitionFrames = partitionFrames;
+	data->partitionCount = partitionCount;
+	data->fill = 0;
+	data->partitionIndex = 0;
+	return AZA_SUCCESS;
+}
+
+// Convolves everything gathered for the partition that just filled up, leaving the result in data->output
+static void azaBinauralProcessPartition(azaBinaural *data) {
+	uint32_t partitionFrames = data->partitionFrames;
+	uint32_t partitionCount = data->partitionCount;
+	uint32_t bins = partitionFrames + 1;
+	size_t spectrumFloats = AZA_FFT_SPECTRUM_FLOATS(partitionFrames * 2);
+	data->partitionIndex = (data->partitionIndex + 1) % partitionCount;
+	float *accumLeft = data->accum;
+	float *accumRight = data->accum + spectrumFloats;
+	memset(data->accum, 0, sizeof(float) * spectrumFloats * 2);
+	for (uint32_t i = 0; i < data->hrtf->directionCount; i++) {
+		azaBinauralDirection *direction = &data->directions[i];
+		if (direction->active || direction->activePrev) {
+			azaFFTForward(&data->fft, direction->spectra + spectrumFloats * data->partitionIndex, direction->input);
+			direction->silentPartitions = 0;
+			// Slide the window along
+			memcpy(direction->input, direction->input + partitionFrames, sizeof(float) * partitionFrames);
+			memset(direction->input + partitionFrames, 0, sizeof(float) * partitionFrames);
+		} else if (direction->silentPartitions < partitionCount) {
+			memset(direction->spectra + spectrumFloats * data->partitionIndex, 0, sizeof(float) * spectrumFloats);
+			direction->silentPartitions++;
 		}
-#endif
-#if PRINT_CHANNEL_DELAYS
-		if (repeatCount == 0) {
-			AZA_LOG_INFO("Channel %u delay: %f\n", (uint32_t)c, channelDelayStart[c]);
+		direction->activePrev = direction->active;
+		direction->active = false;
+		if (direction->silentPartitions >= partitionCount) continue;
+		const float *filters = data->filters + spectrumFloats * partitionCount * 2 * i;
+		// The newest silentPartitions spectra are all zeroes, so skip them
+		for (uint32_t p = direction->silentPartitions; p < partitionCount; p++) {
+			const float *spectrum = direction->spectra + spectrumFloats * ((data->partitionIndex + partitionCount - p) % partitionCount);
+			azaSpectrumMulAdd(accumLeft, spectrum, filters + spectrumFloats * p, bins);
+			azaSpectrumMulAdd(accumRight, spectrum, filters + spectrumFloats * (partitionCount + p), bins);
 		}
-#endif
-		azaBufferMixFade(azaBufferOneChannel(sideBuffer, c), 1.0f, 1.0f, srcBuffer, ampStart, ampEnd);
 	}
-	if (data->config.mode == AZA_SPATIALIZE_ADVANCED) {
-		// Gotta do the doppler
-		azaDelayDynamic *delay = azaSpatializeGetDelayDynamic(data);
-		err = azaEnsureChannels(&data->channelData, sideBuffer.channelLayout.count);
-		if (err) return err;
-		err = azaEnsureChannels(&delay->channelData, sideBuffer.channelLayout.count);
-		if (err) return err;
-		for (uint8_t c = 0; c < sideBuffer.channelLayout.count; c++) {
-			azaDelayDynamicChannelConfig *channelConfig = azaDelayDynamicGetChannelConfig(delay, c);
-			channelConfig->delay = channelDelayStart[c];
-			azaSpatializeChannelData *channelData = azaGetChannelData(&data->channelData, c);
-			channelData->filter.config.frequency = azaSpatializeGetFilterCutoff(channelDelayStart[c], channelDot[c]);
-			// AZA_LOG_INFO("(c %u) filter freq = %f\n", c, channelData->filter.config.frequency);
-			err = azaFilterProcess(&channelData->filter, azaBufferOneChannel(sideBuffer, c));
-			if (err) return err;
+	// Overlap-save: Only the second half of each window is free of circular wraparound
+	azaFFTInverse(&data->fft, data->window, accumLeft);
+	memcpy(data->output, data->window + partitionFrames, sizeof(float) * partitionFrames);
+	azaFFTInverse(&data->fft, data->window, accumRight);
+	memcpy(data->output + partitionFrames, data->window + partitionFrames, sizeof(float) * partitionFrames);
+}
+
+typedef struct azaBinauralTap {
+	uint32_t direction;
+	float ampStart;
+	float ampEnd;
+} azaBinauralTap;
+
+// Works out which directions a source goes to over the whole buffer, putting them in dstTaps
+// returns how many taps were written
+static uint32_t azaBinauralGetSourceTaps(azaBinaural *data, const azaWorld *world, const azaSpatializeSource *source, azaBinauralTap dstTaps[AZAUDIO_BINAURAL_DIRECTION_TAPS*2]) {
+	const azaVec3 forward = { 0.0f, 0.0f, 1.0f };
+	azaVec3 dirStart = azaVec3NormalizedDef(azaMulVec3Mat3(azaSubVec3(source->posStart, world->origin), world->orientation), 0.00001f, forward);
+	azaVec3 dirEnd = azaVec3NormalizedDef(azaMulVec3Mat3(azaSubVec3(source->posEnd, world->origin), world->orientation), 0.00001f, forward);
+	uint32_t indices[AZAUDIO_BINAURAL_DIRECTION_TAPS];
+	float weights[AZAUDIO_BINAURAL_DIRECTION_TAPS];
+	uint32_t count = azaHRTFGetDirectionWeights(data->hrtf, dirStart, indices, weights);
+	for (uint32_t i = 0; i < count; i++) {
+		dstTaps[i] = (azaBinauralTap) { indices[i], weights[i] * source->ampStart, 0.0f };
+	}
+	// Sources that haven't moved (which is most of them) don't need another search
+	if (azaVec3Dot(dirStart, dirEnd) > 0.999999f) {
+		for (uint32_t i = 0; i < count; i++) {
+			dstTaps[i].ampEnd = weights[i] * source->ampEnd;
 		}
-		err = azaDelayDynamicProcess(delay, sideBuffer, channelDelayEnd);
+		return count;
+	}
+	uint32_t countStart = count;
+	uint32_t countEnd = azaHRTFGetDirectionWeights(data->hrtf, dirEnd, indices, weights);
+	for (uint32_t i = 0; i < countEnd; i++) {
+		uint32_t t = 0;
+		while (t < countStart && dstTaps[t].direction != indices[i]) t++;
+		if (t == countStart) {
+			dstTaps[count++] = (azaBinauralTap) { indices[i], 0.0f, weights[i] * source->ampEnd };
+		} else {
+			dstTaps[t].ampEnd = weights[i] * source->ampEnd;
+		}
+	}
+	return count;
+}
+
+int azaBinauralProcess(azaBinaural *data, azaBuffer dstBuffer, const azaSpatializeSource *sources, uint32_t sourceCount) {
+	int err = AZA_SUCCESS;
+	if (data->config.hrtf == NULL) return AZA_ERROR_NULL_POINTER;
+	err = azaCheckBuffer(&dstBuffer);
+	if (err) return err;
+	if (dstBuffer.channelLayout.count != 2) return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	if (dstBuffer.samplerate != data->config.hrtf->samplerate) return AZA_ERROR_MISMATCHED_SAMPLERATE;
+	for (uint32_t i = 0; i < sourceCount; i++) {
+		err = azaSpatializeCheckSource(dstBuffer, sources[i].buffer);
 		if (err) return err;
 	}
-	azaBufferMix(dstBuffer, 1.0f, sideBuffer, 1.0f);
-#if PRINT_CHANNEL_AMPS || PRINT_CHANNEL_DELAYS
-	repeatCount = (repeatCount + 1) % 10;
-#endif
-	azaPopSideBuffer();
+	err = azaBinauralHandleBufferResizes(data);
+	if (err) return err;
+	const azaWorld *world = data->config.world;
+	if (world == NULL) {
+		world = &azaWorldDefault;
+	}
+	azaScratch *scratch = azaGetScratch();
+	if AZA_UNLIKELY(!scratch) return AZA_ERROR_OUT_OF_MEMORY;
+	azaScratchMark mark = azaScratchGetMark(scratch);
+	// Every source's taps, AZAUDIO_BINAURAL_DIRECTION_TAPS*2 apiece, with tapCounts saying how many each one actually uses
+	azaBinauralTap *taps = azaScratchAlloc(scratch, sizeof(azaBinauralTap) * AZAUDIO_BINAURAL_DIRECTION_TAPS * 2 * sourceCount + 1);
+	uint8_t *tapCounts = azaScratchAlloc(scratch, sourceCount + 1);
+	if (!taps || !tapCounts) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto done;
+	}
+	for (uint32_t s = 0; s < sourceCount; s++) {
+		tapCounts[s] = (uint8_t)azaBinauralGetSourceTaps(data, world, &sources[s], taps + AZAUDIO_BINAURAL_DIRECTION_TAPS * 2 * s);
+	}
+	uint32_t partitionFrames = data->partitionFrames;
+	float frameStep = 1.0f / (float)dstBuffer.frames;
+	for (uint32_t done = 0; done < dstBuffer.frames;) {
+		uint32_t frames = AZA_MIN(dstBuffer.frames - done, partitionFrames - data->fill);
+		// Gather this stretch of every source into its directions
+		for (uint32_t s = 0; s < sourceCount; s++) {
+			azaBuffer src = sources[s].buffer;
+			const float *srcSamples = src.samples + done * src.stride;
+			const azaBinauralTap *sourceTaps = taps + AZAUDIO_BINAURAL_DIRECTION_TAPS * 2 * s;
+			for (uint32_t t = 0; t < tapCounts[s]; t++) {
+				const azaBinauralTap *tap = &sourceTaps[t];
+				azaBinauralDirection *direction = &data->directions[tap->direction];
+				float ampStep = (tap->ampEnd - tap->ampStart) * frameStep;
+				float amp = tap->ampStart + ampStep * (float)done;
+				if (amp == 0.0f && ampStep == 0.0f) continue;
+				float *input = direction->input + partitionFrames + data->fill;
+				if (src.stride == 1) {
+					for (uint32_t i = 0; i < frames; i++) {
+						input[i] += srcSamples[i] * (amp + ampStep * (float)i);
+					}
+				} else {
+					for (uint32_t i = 0; i < frames; i++) {
+						input[i] += srcSamples[i * src.stride] * (amp + ampStep * (float)i);
+					}
+				}
+				direction->active = true;
+			}
+		}
+		// Play out the last partition's output in step with gathering the next one
+		float *dstLeft = dstBuffer.samples + done * dstBuffer.stride;
+		float *dstRight = dstLeft + dstBuffer.channelStride;
+		const float *outLeft = data->output + data->fill;
+		const float *outRight = data->output + partitionFrames + data->fill;
+		for (uint32_t i = 0; i < frames; i++) {
+			dstLeft[i * dstBuffer.stride] += outLeft[i];
+			dstRight[i * dstBuffer.stride] += outRight[i];
+		}
+		data->fill += frames;
+		done += frames;
+		if (data->fill == partitionFrames) {
+			azaBinauralProcessPartition(data);
+			data->fill = 0;
+		}
+	}
+done:
+	azaScratchRelease(scratch, mark);
 	return err;
-}
\ No newline at end of file
+}
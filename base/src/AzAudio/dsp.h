@@ -10,21 +10,57 @@
 #include "header_utils.h"
 #include "math.h"
 #include "channel_layout.h"
+#include "fft.h"
+#include "file_stream.h"
+#include "simd.h"
 
 #include <assert.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define AZAUDIO_LOOKAHEAD_SAMPLES 64
+// Used by azaRMS when its config leaves window at 0
+#define AZAUDIO_RMS_DEFAULT_WINDOW_MS 3.0f
+// Used by azaLookaheadLimiter when its config leaves lookahead or release at 0
+#define AZAUDIO_LOOKAHEAD_LIMITER_DEFAULT_LOOKAHEAD_MS 2.0f
+#define AZAUDIO_LOOKAHEAD_LIMITER_DEFAULT_RELEASE_MS 20.0f
 // The duration of transitions between the variable parameter values
 #define AZAUDIO_SAMPLER_TRANSITION_FRAMES 128
+// azaSampler's sinc interpolation lowers its cutoff in steps of this many per octave of playback ratio, rounding towards more filtering, so a kernel only needs a table for each step
+#define AZAUDIO_SAMPLER_SINC_CUTOFF_STEPS_PER_OCTAVE 8
+// The cutoff stops following the playback ratio past this, because the number of taps grows with it
+#define AZAUDIO_SAMPLER_SINC_MAX_CUTOFF_SCALE 8.0f
+// How many kernels azaSampler keeps every step's table around for. Samplers using any more kernels rebuild their own table whenever the step changes.
+#define AZAUDIO_SAMPLER_SINC_CACHE_CAP 8
+// How many frames azaSamplerBank renders between updates to its smoothed voice parameters
+#define AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES 64
+// How finely azaSpeakerGeometry samples panning gains over all directions. The grid has (res+1)^2 points.
+#define AZAUDIO_SPEAKER_GEOMETRY_GRID_RES 64
+// How many different layouts azaGetSpeakerGeometry remembers. Any more than this get worked out from scratch every time.
+#define AZAUDIO_SPEAKER_GEOMETRY_CACHE_CAP 16
+// Highest order azaAmbisonicEncode and azaAmbisonicDecode support
+#define AZAUDIO_AMBISONIC_MAX_ORDER 3
+// How many virtual speakers spread evenly over the sphere ambisonic decoders are made from. Each one is panned to the real speakers the same way azaSpatialize pans a source.
+#define AZAUDIO_AMBISONIC_DECODE_POINTS 240
+// Used by azaConvolution when its config leaves partitionFrames or tailPartitionFrames at 0
+#define AZAUDIO_CONVOLUTION_DEFAULT_PARTITION_FRAMES 128
+#define AZAUDIO_CONVOLUTION_DEFAULT_TAIL_PARTITION_FRAMES 1024
+// How many tail partitions of input and output azaConvolution keeps in flight between itself and the worker
+#define AZAUDIO_CONVOLUTION_TAIL_SLOTS 4
+// Used by azaBinaural when its config leaves partitionFrames at 0
+#define AZAUDIO_BINAURAL_DEFAULT_PARTITION_FRAMES 128
+// How many measured directions azaBinaural spreads each source position over
+#define AZAUDIO_BINAURAL_DIRECTION_TAPS 3
+// How finely azaHRTF divides up all directions to narrow down which measurements are nearest to a source. The grid has res^2 cells.
+#define AZAUDIO_HRTF_GRID_RES 32
 
 // Buffer used by DSP functions for their input/output
 typedef struct azaBuffer {
 	// actual read/write-able data
-	// one frame is a single sample from each channel, one after the other
+	// for interleaved buffers, one frame is a single sample from each channel, one after the other
+	// for planar buffers, each channel's samples are contiguous
 	float *samples;
 	// samples per second, used by DSP functions that rely on timing
 	uint32_t samplerate;
@@ -32,6 +68,10 @@ typedef struct azaBuffer {
 	uint32_t frames;
 	// distance between samples from one channel in number of floats
 	uint16_t stride;
+	// distance between the same frame of adjacent channels in number of floats
+	// This is 1 for interleaved buffers. Planar buffers have a stride of 1 and this is at least frames.
+	// 0 is treated as 1, so buffers built by hand without setting this are interleaved.
+	uint32_t channelStride;
 	// how many channels are stored in this buffer for user-created buffers, or how many channels should be accessed by DSP functions, and an optional layout for said channels. Some functions expect the layout to be fully-specified, others don't care.
 	azaChannelLayout channelLayout;
 } azaBuffer;
@@ -40,8 +80,21 @@ typedef struct azaBuffer {
 // May return AZA_ERROR_INVALID_CHANNEL_COUNT if channelLayout.count == 0
 // May return AZA_ERROR_OUT_OF_MEMORY if the allocation of data->samples failed
 int azaBufferInit(azaBuffer *data, uint32_t frames, azaChannelLayout channelLayout);
+// Same as azaBufferInit, but each channel gets its own contiguous run of samples, which lets per-channel processing skip the strided access.
+int azaBufferInitPlanar(azaBuffer *data, uint32_t frames, azaChannelLayout channelLayout);
 void azaBufferDeinit(azaBuffer *data);
 
+// Turns a channelStride of 0 into 1. Every function that takes an azaBuffer does this for you.
+static inline void azaBufferNormalize(azaBuffer *buffer) {
+	if (buffer->channelStride == 0) {
+		buffer->channelStride = 1;
+	}
+}
+
+static inline bool azaBufferIsPlanar(azaBuffer buffer) {
+	return buffer.channelStride > 1;
+}
+
 // Zeroes out an entire buffer
 void azaBufferZero(azaBuffer buffer);
 
@@ -55,6 +108,7 @@ void azaBufferMix(azaBuffer dst, float volumeDst, azaBuffer src, float volumeSrc
 void azaBufferMixFade(azaBuffer dst, float volumeDstStart, float volumeDstEnd, azaBuffer src, float volumeSrcStart, float volumeSrcEnd);
 
 // Copies the contents of one buffer into the other. They must have the same number of frames and channels.
+// If one is planar and the other is interleaved, this is where the conversion happens.
 // NOTE: asserts that dst and src have the same frame count and channel count. If that's a problem, then handle these conditions before calling this.
 void azaBufferCopy(azaBuffer dst, azaBuffer src);
 
@@ -70,6 +124,7 @@ static inline azaBuffer azaBufferSlice(azaBuffer src, uint32_t frameStart, uint3
 		/* .samplerate    = */ src.samplerate,
 		/* .frames        = */ frameCount,
 		/* .stride        = */ src.stride,
+		/* .channelStride = */ src.channelStride,
 		/* .channelLayout = */ src.channelLayout,
 	};
 }
@@ -80,16 +135,19 @@ static inline azaBuffer azaBufferOneSample(float *sample, uint32_t samplerate) {
 		/* .samplerate    = */ samplerate,
 		/* .frames        = */ 1,
 		/* .stride        = */ 1,
+		/* .channelStride = */ 1,
 		/* .channelLayout = */ azaChannelLayoutMono(),
 	};
 }
 
 static inline azaBuffer azaBufferOneChannel(azaBuffer src, uint8_t channel) {
+	azaBufferNormalize(&src);
 	return AZA_CLITERAL(azaBuffer) {
-		/* .samples       = */ src.samples + channel,
+		/* .samples       = */ src.samples + channel * src.channelStride,
 		/* .samplerate    = */ src.samplerate,
 		/* .frames        = */ src.frames,
 		/* .stride        = */ src.stride,
+		/* .channelStride = */ src.channelStride,
 		/* .channelLayout = */ azaChannelLayoutOneChannel(src.channelLayout, channel),
 	};
 }
@@ -99,16 +157,97 @@ typedef int (*fp_azaMixCallback)(void *userdata, azaBuffer buffer);
 typedef int (*fp_azaMixCallbackDual)(void *userdata, azaBuffer dst, azaBuffer src);
 
 
+// Every allocation out of an azaScratch is aligned to this
+#define AZA_SCRATCH_ALIGNMENT 64
+// The smallest chunk an azaScratch will allocate on its own
+#define AZA_SCRATCH_CHUNK_SIZE_DEFAULT (64 * 1024)
+
+typedef struct azaScratchChunk {
+	struct azaScratchChunk *next;
+	// In bytes, not including this header
+	size_t capacity;
+	char *data;
+} azaScratchChunk;
+
+typedef struct azaScratchMark {
+	azaScratchChunk *chunk;
+	size_t used;
+	// How many bytes were in use across every chunk
+	size_t total;
+	// The side buffer most recently pushed, if any
+	struct azaSideBufferHeader *sideBufferTop;
+	// How many side buffer pushes failed and haven't been popped
+	uint32_t sideBuffersFailed;
+} azaScratchMark;
+
+// Growable scratch memory for processing, where allocating is just bumping an offset and everything allocated after a mark is freed at once by releasing back to it.
+// Chunks are kept around when released, so once a scratch has grown enough to fit the deepest processing it ever sees it never allocates again. Use azaScratchReserve to get there before processing starts.
+typedef struct azaScratch {
+	// All of our chunks, in the order we use them
+	azaScratchChunk *chunks;
+	// Where we are right now. Every chunk before this one is full (enough), and every chunk after it is unused.
+	azaScratchMark top;
+	// The most bytes that were ever in use at once, including alignment padding
+	size_t highWaterMark;
+	// How many bytes all of our chunks add up to
+	size_t capacity;
+} azaScratch;
+
+void azaScratchInit(azaScratch *data);
+// Frees all the chunks. Everything allocated from data is invalid after this.
+void azaScratchDeinit(azaScratch *data);
+// Makes sure we can allocate at least bytes in total from the top without allocating any chunks. Best done outside of the audio thread, before processing starts (such as with data->highWaterMark from a previous run).
+// May return AZA_ERROR_OUT_OF_MEMORY
+int azaScratchReserve(azaScratch *data, size_t bytes);
+// Returns AZA_SCRATCH_ALIGNMENT-aligned memory, or NULL if we needed a new chunk and failed to allocate it.
+void* azaScratchAlloc(azaScratch *data, size_t bytes);
+static inline azaScratchMark azaScratchGetMark(azaScratch *data) {
+	return data->top;
+}
+// Frees everything allocated since mark was taken. Releasing to a mark taken before another mark we already released to is fine, but not the other way around.
+static inline void azaScratchRelease(azaScratch *data, azaScratchMark mark) {
+	data->top = mark;
+}
+
+// Returns the scratch that side buffers come from on the calling thread.
+// If azaSetScratch hasn't been called on this thread, this is a default one which is made the first time it's needed and freed when the thread exits.
+// May return NULL if we failed to allocate the default.
+azaScratch* azaGetScratch();
+// Makes side buffers on the calling thread come from scratch, which must outlive its use on this thread. Pass NULL to go back to the default.
+// Returns what was set before, or NULL if that was the default, so you can put it back when you're done.
+azaScratch* azaSetScratch(azaScratch *scratch);
+// Called by azaInit and azaDeinit, so you don't have to.
+int azaScratchInitThreadLocal();
+void azaScratchDeinitThreadLocal();
+
+// Side buffers are a stack of temporary buffers that DSP uses to hold intermediate results, allocated from azaGetScratch().
+// If memory runs out, the resulting buffer's samples will be NULL.
 azaBuffer azaPushSideBuffer(uint32_t frames, uint32_t channels, uint32_t samplerate);
 
 azaBuffer azaPushSideBufferZero(uint32_t frames, uint32_t channels, uint32_t samplerate);
 
+// Same as azaPushSideBuffer, but the result is planar
+azaBuffer azaPushSideBufferPlanar(uint32_t frames, uint32_t channels, uint32_t samplerate);
+
+// The result has the same layout (planar or interleaved) as src
 azaBuffer azaPushSideBufferCopy(azaBuffer src);
 
 void azaPopSideBuffer();
 
 void azaPopSideBuffers(uint8_t count);
 
+// Marks the current top of the side buffer stack so that releasing to it pops however many side buffers were pushed since. Makes early returns hard to get wrong.
+static inline azaScratchMark azaMarkSideBuffers() {
+	azaScratch *scratch = azaGetScratch();
+	if (!scratch) return AZA_CLITERAL(azaScratchMark) {0};
+	return azaScratchGetMark(scratch);
+}
+static inline void azaReleaseSideBuffers(azaScratchMark mark) {
+	azaScratch *scratch = azaGetScratch();
+	if (!scratch) return;
+	azaScratchRelease(scratch, mark);
+}
+
 
 
 typedef enum azaDSPKind {
@@ -129,6 +268,11 @@ typedef enum azaDSPKind {
 	AZA_DSP_GATE,
 	AZA_DSP_DELAY_DYNAMIC,
 	AZA_DSP_SPATIALIZE,
+	AZA_DSP_REVERB_FDN,
+	AZA_DSP_FILTER_SVF,
+	AZA_DSP_SAMPLER_BANK,
+	AZA_DSP_BINAURAL,
+	AZA_DSP_CONVOLUTION,
 } azaDSPKind;
 
 // Generic interface to all the DSP structures
@@ -177,27 +321,35 @@ void azaOpMax(float *lhs, float rhs);
 
 
 typedef struct azaRMSConfig {
-	uint32_t windowSamples;
+	// window size in ms. 0 means AZAUDIO_RMS_DEFAULT_WINDOW_MS
+	float window;
 	// Used in azaRMSProcessDual to combine all the channel values into a single RMS value per frame. If left NULL, defaults to azaOpMax
 	fp_azaOp combineOp;
 } azaRMSConfig;
 
 typedef struct azaRMSChannelData {
+	// Sum of the squares currently in the window
 	float squaredSum;
+	// Sum of the squares that went in since the ring last wrapped, which is exactly what's in the ring once it wraps again
+	float squaredSumLap;
 } azaRMSChannelData;
 
+// Keeps the squares of the last windowFrames frames in a ring with every channel of a frame side by side, so all the channels' running sums move together.
+// Every time the ring wraps, squaredSum is replaced by squaredSumLap, which has only ever been added to, so rounding error can't pile up no matter how long it runs.
 typedef struct azaRMS {
 	azaDSP header;
 	azaRMSConfig config;
-	uint32_t index;
-	uint32_t bufferCap;
+	// Ring of windowFrames frames of squares with channelCount floats each. Changing the window, samplerate, or channel count starts it over.
 	float *buffer;
+	uint32_t bufferCap;
+	uint32_t windowFrames;
+	uint8_t channelCount;
+	uint32_t index;
 	azaDSPChannelData channelData;
-	// float inlineBuffer[256]; // optional
 } azaRMS;
 
 // returns the size in bytes of azaRMS with the given channelCapInline
-uint32_t azaRMSGetAllocSize(azaRMSConfig config, uint8_t channelCapInline);
+uint32_t azaRMSGetAllocSize(uint8_t channelCapInline);
 // initializes azaRMS in existing memory
 void azaRMSInit(azaRMS *data, uint32_t allocSize, azaRMSConfig config, uint8_t channelCapInline);
 // frees any additional memory that the azaRMS may have allocated
@@ -240,23 +392,52 @@ typedef struct azaLookaheadLimiterConfig {
 	float gainInput;
 	// output gain in dB
 	float gainOutput;
+	// how far ahead to look for peaks in ms, which is also the latency this limiter adds. 0 means AZAUDIO_LOOKAHEAD_LIMITER_DEFAULT_LOOKAHEAD_MS
+	float lookahead;
+	// time in ms for the attenuation to fall by a factor of e once the peaks are gone. 0 means AZAUDIO_LOOKAHEAD_LIMITER_DEFAULT_RELEASE_MS
+	float release;
 } azaLookaheadLimiterConfig;
 
 typedef struct azaLookaheadLimiterChannelData {
-	float valBuffer[AZAUDIO_LOOKAHEAD_SAMPLES];
+	// Ring of lookaheadFrames input samples waiting to come out, pointing into azaLookaheadLimiter::buffer
+	// Every channel's ring comes right after the previous channel's, so together they're one planar buffer starting at channel 0's
+	float *delay;
 } azaLookaheadLimiterChannelData;
 
-// NOTE: This limiter increases latency by AZAUDIO_LOOKAHEAD_SAMPLES samples
+// One entry in the sliding window maximum of attenuation
+typedef struct azaLookaheadLimiterPeak {
+	// in dB
+	float attenuation;
+	// The frame at which this peak came in
+	uint32_t frame;
+} azaLookaheadLimiterPeak;
+
+// NOTE: This limiter increases latency by config.lookahead ms
+// The attenuation needed for each frame goes through a sliding window maximum lookaheadFrames+1 frames wide, and then a moving average just as wide. This ramps the attenuation up linearly so it reaches each peak exactly when that peak comes out of the delay line, without ever scanning the window.
 typedef struct azaLookaheadLimiter {
 	azaDSP header;
 	azaLookaheadLimiterConfig config;
 
 	// Data shared by all channels
-	float peakBuffer[AZAUDIO_LOOKAHEAD_SAMPLES];
-	int index;
-	int cooldown;
-	float sum;
-	float slope;
+	// Combined big buffer that holds the peaks, the moving average window, and each channel's delay line. Changing the lookahead, samplerate, or channel count starts it over.
+	void *buffer;
+	size_t bufferCap;
+	uint32_t lookaheadFrames;
+	uint8_t channelCount;
+	// Monotonic deque of lookaheadFrames+1 peaks, where attenuation strictly decreases from first to last, so the first one is always the window's maximum
+	azaLookaheadLimiterPeak *peaks;
+	uint32_t peakFirst;
+	uint32_t peakCount;
+	// Counts frames for expiring peaks. Allowed to wrap.
+	uint32_t frame;
+	// Ring of the last lookaheadFrames+1 window maximums, and their sum
+	float *window;
+	uint32_t windowIndex;
+	double windowSum;
+	// Index into every channel's delay line
+	uint32_t delayIndex;
+	// Current attenuation in dB after release smoothing
+	float attenuation;
 
 	azaDSPChannelData channelData;
 } azaLookaheadLimiter;
@@ -318,6 +499,73 @@ int azaFilterProcess(azaFilter *data, azaBuffer buffer);
 
 
 
+typedef enum azaFilterSVFKind {
+	AZA_FILTER_SVF_LOW_PASS=0,
+	AZA_FILTER_SVF_HIGH_PASS,
+	// Peaks at 0dB at the center frequency
+	AZA_FILTER_SVF_BAND_PASS,
+	AZA_FILTER_SVF_NOTCH,
+	// Bell curve boosting or cutting around the center frequency
+	AZA_FILTER_SVF_PEAK,
+	AZA_FILTER_SVF_LOW_SHELF,
+	AZA_FILTER_SVF_HIGH_SHELF,
+} azaFilterSVFKind;
+
+typedef enum azaFilterSVFSlope {
+	AZA_FILTER_SVF_12DB=0,
+	AZA_FILTER_SVF_24DB,
+} azaFilterSVFSlope;
+
+typedef struct azaFilterSVFConfig {
+	azaFilterSVFKind kind;
+	azaFilterSVFSlope slope;
+	// Cutoff or center frequency in Hz
+	float frequency;
+	// Resonance, where 0.7071 is the flattest response without a bump. 0 means 0.7071.
+	// With a 24dB slope, low and high pass sections get staggered so 0.7071 gives a 4th order Butterworth response.
+	float q;
+	// Boost or cut in dB, only used by peak and shelf kinds
+	float gain;
+	// Blends the effect output with the dry signal where 1 is fully dry and 0 is fully wet.
+	float dryMix;
+} azaFilterSVFConfig;
+
+#define AZAUDIO_FILTER_SVF_MAX_SECTIONS AZA_SIMD_SVF_MAX_SECTIONS
+
+typedef struct azaFilterSVFChannelData {
+	// Integrator states for each section
+	float ic1eq[AZAUDIO_FILTER_SVF_MAX_SECTIONS];
+	float ic2eq[AZAUDIO_FILTER_SVF_MAX_SECTIONS];
+} azaFilterSVFChannelData;
+
+// Filter made of 1 or 2 cascaded topology-preserving transform state-variable filter sections. Unlike azaFilter, it has resonance, proper 12 and 24dB slopes, and EQ shapes, and all the channels in a frame get filtered together with SIMD.
+typedef struct azaFilterSVF {
+	azaDSP header;
+	azaFilterSVFConfig config;
+	// What the coefficients were last computed for, so we only redo them when something changes
+	azaFilterSVFConfig configCoefficients;
+	uint32_t samplerateCoefficients;
+	uint8_t sectionCount;
+	azaSIMDSVFCoefficients coefficients[AZAUDIO_FILTER_SVF_MAX_SECTIONS];
+	azaDSPChannelData channelData;
+} azaFilterSVF;
+// returns the size in bytes of azaFilterSVF
+uint32_t azaFilterSVFGetAllocSize(uint8_t channelCapInline);
+// initializes azaFilterSVF in existing memory
+void azaFilterSVFInit(azaFilterSVF *data, uint32_t allocSize, azaFilterSVFConfig config, uint8_t channelCapInline);
+// frees any additional memory that the azaFilterSVF may have allocated
+void azaFilterSVFDeinit(azaFilterSVF *data);
+
+// Convenience function that allocates and inits an azaFilterSVF for you
+// May return NULL indicating an out-of-memory error
+azaFilterSVF* azaMakeFilterSVF(azaFilterSVFConfig config, uint8_t channelCapInline);
+// Frees an azaFilterSVF that was created with azaMakeFilterSVF
+void azaFreeFilterSVF(azaFilterSVF *data);
+
+int azaFilterSVFProcess(azaFilterSVF *data, azaBuffer buffer);
+
+
+
 typedef struct azaCompressorConfig {
 	// Activation threshold in dB
 	float threshold;
@@ -453,18 +701,325 @@ int azaReverbProcess(azaReverb *data, azaBuffer buffer);
 
 
 
+typedef enum azaReverbFDNMatrix {
+	// I - 2/N, which is the cheapest, but each line mostly feeds back into itself so the tail takes a bit longer to get dense
+	AZA_REVERB_FDN_HOUSEHOLDER=0,
+	// Every line feeds into every line equally, for about the same cost as Householder
+	AZA_REVERB_FDN_HADAMARD,
+} azaReverbFDNMatrix;
+
+typedef struct azaReverbFDNConfig {
+	// The first 5 mean the same as they do in azaReverbConfig, so one can stand in for the other
+	// effect gain in dB
+	float gain;
+	// dry gain in dB
+	float gainDry;
+	// value affecting reverb feedback, roughly in the range of 1 to 100 for reasonable results
+	float roomsize;
+	// value affecting damping of high frequencies, roughly in the range of 1 to 5
+	float color;
+	// delay for first reflections in ms
+	float delay;
+	// How many delay lines make up the network, either 8 or 16. 0 means 8.
+	uint8_t lineCount;
+	azaReverbFDNMatrix matrix;
+} azaReverbFDNConfig;
+
+static inline azaReverbFDNConfig azaReverbFDNConfigFromReverb(azaReverbConfig config) {
+	azaReverbFDNConfig result = {0};
+	result.gain = config.gain;
+	result.gainDry = config.gainDry;
+	result.roomsize = config.roomsize;
+	result.color = config.color;
+	result.delay = config.delay;
+	return result;
+}
+
+#define AZAUDIO_REVERB_FDN_MAX_LINES 16
+
+typedef struct azaReverbFDNLine {
+	float *buffer;
+	uint32_t length;
+	uint32_t index;
+	// State of the damping lowpass
+	float damping;
+} azaReverbFDNLine;
+
+// Feedback delay network reverb. Does the job of azaReverb for a fraction of the cost, since the whole network is processed in a handful of passes over each block.
+typedef struct azaReverbFDN {
+	azaDSP header;
+	azaReverbFDNConfig config;
+	// What the lines are currently sized for
+	uint32_t samplerate;
+	uint8_t lineCount;
+	// Combined big buffer that gets split for each line
+	float *buffer;
+	uint32_t bufferCap;
+	azaReverbFDNLine lines[AZAUDIO_REVERB_FDN_MAX_LINES];
+	// Must be last since it has inline channel data
+	azaDelay inputDelay;
+} azaReverbFDN;
+
+// returns the size in bytes of azaReverbFDN
+uint32_t azaReverbFDNGetAllocSize(uint8_t channelCapInline);
+// initializes azaReverbFDN in existing memory
+void azaReverbFDNInit(azaReverbFDN *data, uint32_t allocSize, azaReverbFDNConfig config, uint8_t channelCapInline);
+// frees any additional memory that the azaReverbFDN may have allocated
+void azaReverbFDNDeinit(azaReverbFDN *data);
+
+// Convenience function that allocates and inits an azaReverbFDN for you
+// May return NULL indicating an out-of-memory error
+azaReverbFDN* azaMakeReverbFDN(azaReverbFDNConfig config, uint8_t channelCapInline);
+// Frees an azaReverbFDN that was created with azaMakeReverbFDN
+void azaFreeReverbFDN(azaReverbFDN *data);
+
+int azaReverbFDNProcess(azaReverbFDN *data, azaBuffer buffer);
+
+
+
+typedef struct azaConvolutionConfig {
+	// effect gain in dB
+	float gain;
+	// dry gain in dB
+	float gainDry;
+	// MUST outlive the azaConvolution and not change while it uses it. Must have the same samplerate as the buffers we process, and either 1 channel that's used for every channel or 1 channel per channel we process.
+	const azaBuffer *impulseResponse;
+	// Frames per partition for the head of the impulse response, which is convolved in azaConvolutionProcess. This is also how far the wet signal lags behind the dry one. Rounded up to a power of 2. If this is zero, it will use AZAUDIO_CONVOLUTION_DEFAULT_PARTITION_FRAMES.
+	uint32_t partitionFrames;
+	// Frames per partition for the rest, which is convolved by a worker thread. The head covers the first 2 tail partitions so the worker always has a whole partition's worth of time to finish each one. Rounded up to a power of 2 and to at least twice partitionFrames. If this is zero, it will use AZAUDIO_CONVOLUTION_DEFAULT_TAIL_PARTITION_FRAMES.
+	uint32_t tailPartitionFrames;
+	// If true, the tail is convolved right in azaConvolutionProcess instead of by the worker. Blocks that finish a tail partition cost a lot more, but nothing is ever left out, which is what you want when rendering faster than realtime.
+	bool offline;
+} azaConvolutionConfig;
+
+// Uniformly partitioned overlap-save convolution of every channel with one stretch of an impulse response
+typedef struct azaConvolutionStage {
+	azaFFT fft;
+	uint32_t partitionFrames;
+	uint32_t partitionCount;
+	// One allocation for everything below
+	float *buffer;
+	// partitionCount spectra per impulse response channel
+	float *filters;
+	// For each channel, the previous partition's input followed by the current one
+	float *windows;
+	// For each channel, a ring of spectra of the last partitionCount windows
+	float *spectra;
+	// One spectrum to sum into
+	float *accum;
+	// Time-domain scratch of 2*partitionFrames
+	float *scratch;
+	// partitionFrames of output per channel from the last partition. Only used by the head, since the tail's output goes straight to the worker's slots.
+	float *output;
+	// Which of every channel's spectra is the newest
+	uint32_t partitionIndex;
+} azaConvolutionStage;
+
+// Convolution reverb using non-uniformly partitioned FFT convolution, so impulse responses of several seconds cost a small and steady amount per block.
+// Short partitions for the head of the impulse response are convolved in azaConvolutionProcess, and long partitions for the rest are handed to a worker thread that has a whole partition's worth of time to finish each one.
+typedef struct azaConvolution {
+	azaDSP header;
+	azaConvolutionConfig config;
+	// What the stages were made for, so we know when to remake them
+	const azaBuffer *impulseResponse;
+	uint32_t samplerate;
+	uint8_t channels;
+	uint8_t irChannels;
+	bool offline;
+	azaConvolutionStage head;
+	// partitionCount is 0 if the head covers the whole impulse response
+	azaConvolutionStage tail;
+	// Frames processed since the stages were made
+	uint64_t frame;
+	// AZAUDIO_CONVOLUTION_TAIL_SLOTS tail partitions of input being gathered for the worker and of output coming back from it, each being tail.partitionFrames per channel
+	float *tailInput;
+	float *tailOutput;
+	// Which tail partition each slot holds plus 1, or 0 while it's being written
+	uint32_t tailInputTags[AZAUDIO_CONVOLUTION_TAIL_SLOTS];
+	uint32_t tailOutputTags[AZAUDIO_CONVOLUTION_TAIL_SLOTS];
+	// How many tail partitions have been handed off
+	uint32_t tailSubmitted;
+	// Which tail partition gets convolved next. Only touched by whoever convolves the tail.
+	uint32_t tailNext;
+	// How many times a stretch of tail wasn't ready in time and was left out, which means the worker can't keep up
+	uint32_t tailMisses;
+	// For the worker's list
+	struct azaConvolution *workerNext;
+	bool workerRegistered;
+} azaConvolution;
+
+// returns the size in bytes of azaConvolution
+uint32_t azaConvolutionGetAllocSize();
+// initializes azaConvolution in existing memory
+void azaConvolutionInit(azaConvolution *data, uint32_t allocSize, azaConvolutionConfig config);
+// frees any additional memory that the azaConvolution may have allocated
+void azaConvolutionDeinit(azaConvolution *data);
+
+// Convenience function that allocates and inits an azaConvolution for you
+// May return NULL indicating an out-of-memory error
+azaConvolution* azaMakeConvolution(azaConvolutionConfig config);
+// Frees an azaConvolution that was created with azaMakeConvolution
+void azaFreeConvolution(azaConvolution *data);
+
+// The impulse response is transformed the first time this is called, or whenever config.impulseResponse, the partition sizes, offline, or the buffer's channel count or samplerate change.
+// The impulse response is checked like any other buffer, so an empty one returns AZA_ERROR_NULL_POINTER or AZA_ERROR_INVALID_FRAME_COUNT.
+int azaConvolutionProcess(azaConvolution *data, azaBuffer buffer);
+
+// Called by azaInit and azaDeinit, so you don't have to.
+void azaConvolutionWorkerInit();
+void azaConvolutionWorkerDeinit();
+
+
+
+typedef struct azaGateConfig {
+	// cutoff threshold in dB
+	float threshold;
+	// attack time in ms
+	float attack;
+	// decay time in ms
+	float decay;
+	// Any effects to apply to the activation signal
+	azaDSP *activationEffects;
+} azaGateConfig;
+
+typedef struct azaGate {
+	azaDSP header;
+	azaGateConfig config;
+	float attenuation;
+	float gain;
+	azaRMS rms;
+} azaGate;
+
+// returns the size in bytes of azaGate with the given channelCapInline
+uint32_t azaGateGetAllocSize();
+// initializes azaGate in existing memory
+void azaGateInit(azaGate *data, uint32_t allocSize, azaGateConfig config);
+// frees any additional memory that the azaGate may have allocated
+void azaGateDeinit(azaGate *data);
+
+// Convenience function that allocates and inits an azaGate for you
+// May return NULL indicating an out-of-memory error
+azaGate* azaMakeGate(azaGateConfig config);
+// Frees an azaGate that was created with azaMakeGate
+void azaFreeGate(azaGate *data);
+
+int azaGateProcess(azaGate *data, azaBuffer buffer);
+
+
+
+typedef struct azaKernel {
+	// if this is 1, we only store half of the actual table
+	int isSymmetrical;
+	// length of the kernel, which is half of the actual length if we're symmetrical
+	float length;
+	// How many samples there are between an interval of length 1
+	float scale;
+	// total size of table, which is length * scale
+	uint32_t size;
+	float *table;
+} azaKernel;
+
+extern azaKernel azaKernelDefaultLanczos;
+// Same as azaKernelDefaultLanczos with a radius of 8 instead of 50, for places like azaSampler that run a kernel for every sound
+extern azaKernel azaKernelDefaultLanczosShort;
+
+// Creates a blank kernel
+// Will allocate memory for the table (may return AZA_ERROR_OUT_OF_MEMORY)
+// NOTE: asserts that length and scale are > 0.0f.
+int azaKernelInit(azaKernel *kernel, int isSymmetrical, float length, float scale);
+void azaKernelDeinit(azaKernel *kernel);
+
+float azaKernelSample(azaKernel *kernel, float x);
+
+// Makes a lanczos kernel. resolution is the number of samples between zero crossings
+void azaKernelMakeLanczos(azaKernel *kernel, float resolution, float radius);
+
+// NOTE: These evaluate the kernel separately for every tap, which adds up fast with long kernels. For anything running per-block, azaResampler below does the same job with precomputed tables.
+float azaSampleWithKernel(float *src, int stride, int minFrame, int maxFrame, azaKernel *kernel, float pos);
+
+// Performs resampling of src into dst with the given scaling factor and kernel.
+// srcFrames is not actually needed here because the sampleable extent is provided by srcFrameMin and srcFrameMax, but for this description it refers to how many samples within src are considered the "meat" of the signal (excluding padding carried over from the last iteration of resampling a stream).
+// factor is the scaling ratio (defined roughly as `srcFrames / dstFrames`), passed in explicitly because the exact desired ratio may not be represented accurately by a ratio of the length of two small buffers. For no actual time scaling, this ratio should be perfectly represented by `srcSamplerate / dstSamplerate`.
+// src should point at least `-srcFrameMin` frames into an existing source buffer with a total extent of `srcFrameMax-srcFrameMin`.
+// srcFrameMin and srcFrameMax allow the accessible extent of src to go outside of the given 0...srcFrames extent, since that's required for perfect resampling of chunks of a stream (while accepting some latency). Ideally, srcFrameMin would be `-kernel->size` and srcFrameMax would be `srcFrames+kernel->size` for a symmetric kernel. For a non-symmetric kernel, srcFrameMin can be 0, and srcFrameMax would still be srcFrames+kernel->size. For two isolated buffers, srcFrameMin should be 0 and srcFrameMax should be srcFrames. Any samples outside of this extent will be considered to be zeroes.
+// srcSampleOffset should be in the range 0 to 1
+void azaResample(azaKernel *kernel, float factor, float *dst, int dstStride, int dstFrames, float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset);
+
+// Same as azaResample, except the resampled values are added to dst instead of replacing them. Every sample is multiplied by amp before being added.
+void azaResampleAdd(azaKernel *kernel, float factor, float amp, float *dst, int dstStride, int dstFrames, float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset);
+
+
+// Stateful polyphase resampler built from an azaKernel prototype. The kernel is baked into a table of coefficients for each of `phases` fractional offsets between source samples, so sampling is a lerp between two adjacent phases and a dot product instead of a kernel lookup per tap.
+typedef struct azaResampler {
+	// Prototype kernel the tables are built from
+	azaKernel *kernel;
+	// Scaling ratio (`srcSamplerate / dstSamplerate`) used by azaResamplerProcess
+	float factor;
+	// How much the kernel is stretched, which is max(1, factor). Stretching lowers the cutoff to the destination's nyquist frequency to prevent aliasing when downsampling.
+	float cutoffScale;
+	// Number of fractional offsets between adjacent source samples in the table
+	uint32_t phases;
+	// Number of source samples that contribute to each output sample
+	uint32_t taps;
+	// taps rounded up to a multiple of 8, which is the distance between rows in table
+	uint32_t tapsStride;
+	// Where the first tap lands relative to floor(pos)
+	int32_t tapOffset;
+	// How many frames on either side of the meat of src will be sampled. This is what your srcFrameMin and srcFrameMax padding should be.
+	uint32_t padding;
+	// phases+1 rows of tapsStride coefficients. The last row is there so we never have to wrap when lerping between phases.
+	float *table;
+	uint32_t tableCap;
+} azaResampler;
+
+// Builds the tables from kernel. phases of 0 uses kernel->scale, which matches the kernel's own resolution.
+// factor is the scaling ratio (`srcSamplerate / dstSamplerate`)
+// May return AZA_ERROR_OUT_OF_MEMORY
+int azaResamplerInit(azaResampler *data, azaKernel *kernel, uint32_t phases, float factor);
+void azaResamplerDeinit(azaResampler *data);
+
+// Changes the factor, only rebuilding the tables if the cutoff has to change. Upsampling always uses the unstretched kernel, so changing between factors <= 1 is free.
+// May return AZA_ERROR_OUT_OF_MEMORY
+int azaResamplerSetFactor(azaResampler *data, float factor);
+
+// Same as azaSampleWithKernel, but with the resampler's tables.
+float azaResamplerSample(azaResampler *data, const float *src, int stride, int minFrame, int maxFrame, float pos);
+
+// Same as azaResample, but uses data->factor and the resampler's tables. Ideally srcFrameMin would be `-data->padding` and srcFrameMax would be `srcFrames+data->padding`.
+void azaResamplerProcess(azaResampler *data, float *dst, int dstStride, int dstFrames, const float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset);
+
+// Same as azaResamplerProcess, except the resampled values are added to dst instead of replacing them. Every sample is multiplied by amp before being added.
+void azaResamplerProcessAdd(azaResampler *data, float amp, float *dst, int dstStride, int dstFrames, const float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset);
+
+
+
 typedef struct azaSamplerPos {
 	uint32_t frame;
 	float fraction;
 } azaSamplerPos;
 
+typedef enum azaSamplerInterpolation {
+	// 4-point cubic Hermite (Catmull-Rom). Smooth when slowing down, but aliases when speeding up.
+	AZA_SAMPLER_INTERPOLATION_CUBIC=0,
+	// Cheapest option, for sounds where nobody will notice
+	AZA_SAMPLER_INTERPOLATION_LINEAR,
+	// Windowed sinc from an azaResampler's polyphase tables, with the cutoff lowered to follow the playback ratio so speeding up doesn't alias
+	AZA_SAMPLER_INTERPOLATION_SINC,
+} azaSamplerInterpolation;
+
 typedef struct azaSamplerConfig {
 	// buffer containing the sound we're sampling
 	azaBuffer *buffer;
+	// If not NULL, we play this instead of buffer, reading only what the I/O thread has ready and outputting silence whenever it falls behind or the file ends. Looping is up to the stream.
+	azaFileStream *stream;
 	// playback speed as a multiple where 1 is full speed
 	float speed;
 	// volume of effect in dB (0.0f indicates full volume)
 	float gain;
+	// How we sample between frames of buffer, trading quality for cost
+	azaSamplerInterpolation interpolation;
+	// Kernel for AZA_SAMPLER_INTERPOLATION_SINC. If NULL it will use azaKernelDefaultLanczosShort
+	azaKernel *kernel;
 } azaSamplerConfig;
 
 typedef struct azaSampler {
@@ -473,6 +1028,10 @@ typedef struct azaSampler {
 	azaSamplerPos pos;
 	float s; // Smooth speed
 	float g; // Smooth gain
+	// What AZA_SAMPLER_INTERPOLATION_SINC used last block. Usually one of the tables shared by every sampler with the same kernel, otherwise resampler.
+	const azaResampler *sinc;
+	// Only built from config.kernel if the shared tables couldn't be made
+	azaResampler resampler;
 } azaSampler;
 
 // returns the size in bytes of azaSampler (included for completeness)
@@ -491,42 +1050,100 @@ azaSampler* azaMakeSampler(azaSamplerConfig config);
 void azaFreeSampler(azaSampler *data);
 
 int azaSamplerProcess(azaSampler *data, azaBuffer buffer);
+// Moves playback along as if we'd processed frames frames at samplerate, without making any sound. Meant for sounds nobody can hear right now (see AZA_SPATIALIZE_LOD_VIRTUAL), so they're in the right place once they can be heard again.
+int azaSamplerSkip(azaSampler *data, uint32_t frames, uint32_t samplerate);
 
+// Builds the sinc tables for every cutoff step of kernel, which every azaSampler using kernel then shares. Finding them is lock-free, but building them allocates and takes a while, so call this ahead of time rather than letting the audio thread do it on the first sinc block. kernel NULL means azaKernelDefaultLanczosShort.
+// kernel MUST stay alive and unchanged until azaDeinit.
+// May return AZA_ERROR_OUT_OF_MEMORY, or AZA_ERROR_INVALID_CONFIGURATION if AZAUDIO_SAMPLER_SINC_CACHE_CAP kernels already have tables.
+int azaSamplerPrepareSinc(azaKernel *kernel);
 
+// Called by azaInit and azaDeinit, so you don't have to.
+void azaSamplerSincCacheInit();
+void azaSamplerSincCacheDeinit();
 
-typedef struct azaGateConfig {
-	// cutoff threshold in dB
-	float threshold;
-	// attack time in ms
-	float attack;
-	// decay time in ms
-	float decay;
-	// Any effects to apply to the activation signal
-	azaDSP *activationEffects;
-} azaGateConfig;
 
-typedef struct azaGate {
-	azaDSP header;
-	azaGateConfig config;
-	float attenuation;
-	float gain;
-	azaRMS rms;
-} azaGate;
 
-// returns the size in bytes of azaGate with the given channelCapInline
-uint32_t azaGateGetAllocSize();
-// initializes azaGate in existing memory
-void azaGateInit(azaGate *data, uint32_t allocSize, azaGateConfig config);
-// frees any additional memory that the azaGate may have allocated
-void azaGateDeinit(azaGate *data);
+typedef struct azaSamplerBankConfig {
+	// volume of the whole bank in dB (0.0f indicates full volume)
+	float gain;
+} azaSamplerBankConfig;
 
-// Convenience function that allocates and inits an azaGate for you
+typedef struct azaSamplerBankVoiceConfig {
+	// buffer containing the sound to play, which must stay alive while the voice does
+	// Mono buffers play on every channel, otherwise channels map one to one and any extras are dropped
+	azaBuffer *buffer;
+	// playback speed as a multiple where 1 is full speed
+	float speed;
+	// volume of the voice in dB (0.0f indicates full volume)
+	float gain;
+	// Region in frames that repeats until the voice is released. If loopEnd <= loopStart, the voice plays once and stops itself at the end of the buffer.
+	uint32_t loopStart;
+	uint32_t loopEnd;
+	// When every voice is taken, a new voice steals the lowest priority voice that isn't higher priority than itself, oldest first
+	int32_t priority;
+} azaSamplerBankVoiceConfig;
+
+// Identifies one voice played by an azaSamplerBank. 0 is never valid, and once a voice stops its id never refers to anything again.
+typedef uint32_t azaSamplerBankVoiceID;
+
+// Plays any number of voices from shared azaBuffers, replacing the contents of the buffer it processes.
+// Voices are stored struct-of-arrays and kept packed into the first voiceCount slots so the per-voice loops stay dense.
+// Gain and speed are smoothed once every AZAUDIO_SAMPLER_BANK_CHUNK_FRAMES frames and ramp linearly in between.
+typedef struct azaSamplerBank {
+	azaDSP header;
+	azaSamplerBankConfig config;
+	float amp; // Smooth gain of the whole bank
+	uint16_t voiceCap;
+	uint16_t voiceCount;
+	uint16_t handleFreeCount;
+	uint32_t serial;
+	// Per slot
+	azaBuffer **voiceBuffer;
+	uint32_t *voiceFrame;
+	float *voiceFraction;
+	float *voiceSpeed;
+	float *voiceSpeedTarget;
+	float *voiceAmp;
+	float *voiceAmpTarget;
+	uint32_t *voiceLoopStart;
+	uint32_t *voiceLoopEnd;
+	int32_t *voicePriority;
+	uint32_t *voiceSerial;
+	uint16_t *voiceHandle;
+	uint8_t *voiceFlags;
+	// Per handle, so ids survive voices moving between slots
+	uint16_t *handleSlot;
+	uint16_t *handleGeneration;
+	uint16_t *handleFree;
+} azaSamplerBank;
+
+// returns the size in bytes of azaSamplerBank with room for voiceCap voices
+uint32_t azaSamplerBankGetAllocSize(uint16_t voiceCap);
+// initializes azaSamplerBank in existing memory
+void azaSamplerBankInit(azaSamplerBank *data, uint32_t allocSize, azaSamplerBankConfig config, uint16_t voiceCap);
+// frees any additional memory that the azaSamplerBank may have allocated
+void azaSamplerBankDeinit(azaSamplerBank *data);
+
+// Convenience function that allocates and inits an azaSamplerBank for you
 // May return NULL indicating an out-of-memory error
-azaGate* azaMakeGate(azaGateConfig config);
-// Frees an azaGate that was created with azaMakeGate
-void azaFreeGate(azaGate *data);
+azaSamplerBank* azaMakeSamplerBank(azaSamplerBankConfig config, uint16_t voiceCap);
+// Frees an azaSamplerBank that was created with azaMakeSamplerBank
+void azaFreeSamplerBank(azaSamplerBank *data);
 
-int azaGateProcess(azaGate *data, azaBuffer buffer);
+// Voices must only be touched from the thread processing the bank, so from another thread go through azaMixerCommandCallback.
+// Starts a voice fading in from silence. Returns 0 if every voice is taken by something of higher priority.
+azaSamplerBankVoiceID azaSamplerBankPlay(azaSamplerBank *data, azaSamplerBankVoiceConfig config);
+// Fades the voice out and stops it once it's silent
+void azaSamplerBankStop(azaSamplerBank *data, azaSamplerBankVoiceID id);
+// Lets a looping voice leave its loop and play through to the end of its buffer
+void azaSamplerBankRelease(azaSamplerBank *data, azaSamplerBankVoiceID id);
+void azaSamplerBankSetGain(azaSamplerBank *data, azaSamplerBankVoiceID id, float gain);
+void azaSamplerBankSetSpeed(azaSamplerBank *data, azaSamplerBankVoiceID id, float speed);
+// Any of the above are safe to call with ids of voices that already stopped, they just do nothing.
+bool azaSamplerBankIsPlaying(azaSamplerBank *data, azaSamplerBankVoiceID id);
+
+int azaSamplerBankProcess(azaSamplerBank *data, azaBuffer buffer);
 
 
 
@@ -545,7 +1162,7 @@ typedef struct azaDelayDynamicConfig {
 	// You can provide a chain of effects to operate on the wet input
 	azaDSP *wetEffects;
 	// Resampling kernel. If NULL it will use azaKernelDefaultLanczos
-	struct azaKernel *kernel;
+	azaKernel *kernel;
 } azaDelayDynamicConfig;
 
 typedef struct azaDelayDynamicChannelConfig {
@@ -554,6 +1171,7 @@ typedef struct azaDelayDynamicChannelConfig {
 } azaDelayDynamicChannelConfig;
 
 typedef struct azaDelayDynamicChannelData {
+	// This channel's ring within azaDelayDynamic::buffer
 	float *buffer;
 	// Calculate this when processing
 	// float delaySamples;
@@ -567,6 +1185,13 @@ typedef struct azaDelayDynamic {
 	// Combined big buffer that gets split for each channel
 	float *buffer;
 	uint32_t bufferCap;
+	// Each channel's history is a ring of bufferFrames, followed by bufferGuard frames repeating its start so the kernel can read across the wrap in one go
+	uint32_t bufferFrames;
+	uint32_t bufferGuard;
+	// Where the next frame goes in every channel's ring
+	uint32_t bufferHead;
+	// Built from config.kernel the first time we process
+	azaResampler resampler;
 	azaDSPChannelData channelData;
 } azaDelayDynamic;
 
@@ -591,49 +1216,13 @@ void azaFreeDelayDynamic(azaDelayDynamic *data);
 
 // if endChannelDelays is not NULL, then over the length of the buffer each channel's delay will lerp towards its respective endChannelDelay, and finally set the value in the channel config once it's done processing.
 int azaDelayDynamicProcess(azaDelayDynamic *data, azaBuffer buffer, float *endChannelDelays);
+// Feeds buffer into the delay lines the same way azaDelayDynamicProcess would, but without touching buffer or reading anything back out, so processing can pick up later as if it had been running all along. endChannelDelays works the same as in azaDelayDynamicProcess.
+int azaDelayDynamicPrime(azaDelayDynamic *data, azaBuffer buffer, float *endChannelDelays);
+// Forgets everything in the delay lines, so whatever comes next starts from silence
+void azaDelayDynamicClear(azaDelayDynamic *data);
 
 
 
-typedef struct azaKernel {
-	// if this is 1, we only store half of the actual table
-	int isSymmetrical;
-	// length of the kernel, which is half of the actual length if we're symmetrical
-	float length;
-	// How many samples there are between an interval of length 1
-	float scale;
-	// total size of table, which is length * scale
-	uint32_t size;
-	float *table;
-} azaKernel;
-
-extern azaKernel azaKernelDefaultLanczos;
-
-// Creates a blank kernel
-// Will allocate memory for the table (may return AZA_ERROR_OUT_OF_MEMORY)
-// NOTE: asserts that length and scale are > 0.0f.
-int azaKernelInit(azaKernel *kernel, int isSymmetrical, float length, float scale);
-void azaKernelDeinit(azaKernel *kernel);
-
-float azaKernelSample(azaKernel *kernel, float x);
-
-// Makes a lanczos kernel. resolution is the number of samples between zero crossings
-void azaKernelMakeLanczos(azaKernel *kernel, float resolution, float radius);
-
-
-float azaSampleWithKernel(float *src, int stride, int minFrame, int maxFrame, azaKernel *kernel, float pos);
-
-// Performs resampling of src into dst with the given scaling factor and kernel.
-// srcFrames is not actually needed here because the sampleable extent is provided by srcFrameMin and srcFrameMax, but for this description it refers to how many samples within src are considered the "meat" of the signal (excluding padding carried over from the last iteration of resampling a stream).
-// factor is the scaling ratio (defined roughly as `srcFrames / dstFrames`), passed in explicitly because the exact desired ratio may not be represented accurately by a ratio of the length of two small buffers. For no actual time scaling, this ratio should be perfectly represented by `srcSamplerate / dstSamplerate`.
-// src should point at least `-srcFrameMin` frames into an existing source buffer with a total extent of `srcFrameMax-srcFrameMin`.
-// srcFrameMin and srcFrameMax allow the accessible extent of src to go outside of the given 0...srcFrames extent, since that's required for perfect resampling of chunks of a stream (while accepting some latency). Ideally, srcFrameMin would be `-kernel->size` and srcFrameMax would be `srcFrames+kernel->size` for a symmetric kernel. For a non-symmetric kernel, srcFrameMin can be 0, and srcFrameMax would still be srcFrames+kernel->size. For two isolated buffers, srcFrameMin should be 0 and srcFrameMax should be srcFrames. Any samples outside of this extent will be considered to be zeroes.
-// srcSampleOffset should be in the range 0 to 1
-void azaResample(azaKernel *kernel, float factor, float *dst, int dstStride, int dstFrames, float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset);
-
-// Same as azaResample, except the resampled values are added to dst instead of replacing them. Every sample is multiplied by amp before being added.
-void azaResampleAdd(azaKernel *kernel, float factor, float amp, float *dst, int dstStride, int dstFrames, float *src, int srcStride, int srcFrameMin, int srcFrameMax, float srcSampleOffset);
-
-
 typedef struct azaWorld {
 	// Position of our ears
 	azaVec3 origin;
@@ -647,6 +1236,41 @@ extern azaWorld azaWorldDefault;
 #define AZA_WORLD_DEFAULT ((azaWorld*)0ull)
 
 
+// How many channels an ambisonic soundfield of the given order has
+#define AZA_AMBISONIC_CHANNELS(order) (((order)+1)*((order)+1))
+// Floats per speaker for the decoders of every order from 1 to AZAUDIO_AMBISONIC_MAX_ORDER, which is the sum of AZA_AMBISONIC_CHANNELS over those orders
+#define AZA_AMBISONIC_DECODERS_FLOATS ((AZAUDIO_AMBISONIC_MAX_ORDER+1)*(AZAUDIO_AMBISONIC_MAX_ORDER+2)*(AZAUDIO_AMBISONIC_MAX_ORDER*2+3)/6 - 1)
+
+// Everything azaSpatialize needs to know about an output layout. It only depends on the layout, so it can be worked out once and shared by every source going to it.
+typedef struct azaSpeakerGeometry {
+	azaChannelLayout layout;
+	// Direction of each speaker from the listener in headspace. Zero for the subwoofer.
+	azaVec3 vectors[AZA_MAX_CHANNEL_POSITIONS];
+	uint8_t nonSubChannels;
+	uint8_t hasAerials;
+	// Index of the subwoofer, or layout.count if there isn't one
+	uint8_t subChannel;
+	// For layouts with more than 2 channels, panning gains sampled over every direction with an octahedral map, so sources only have to interpolate between them. Every grid point holds a gain per channel followed by their sum.
+	// NULL for smaller layouts, which are cheaper to work out directly.
+	float *gainGrid;
+	// Ambisonic decoders for every order from 1 to AZAUDIO_AMBISONIC_MAX_ORDER, one after another, each with a row of AZA_AMBISONIC_CHANNELS(order) gains per channel.
+	float ambisonicDecoders[AZA_MAX_CHANNEL_POSITIONS * AZA_AMBISONIC_DECODERS_FLOATS];
+	// Only azaSpeakerGeometryInit makes the decoders, so this is false for geometry worked out on the fly when the cache is full.
+	bool hasAmbisonicDecoders;
+} azaSpeakerGeometry;
+
+// Works out everything for layout. May return AZA_ERROR_OUT_OF_MEMORY.
+int azaSpeakerGeometryInit(azaSpeakerGeometry *data, azaChannelLayout layout);
+void azaSpeakerGeometryDeinit(azaSpeakerGeometry *data);
+
+// Returns the shared azaSpeakerGeometry for layout, making it the first time we see that layout. Finding one is lock-free, but making one allocates, so call this when a layout changes rather than letting the audio thread find out. azaMixerStreamOpen does this for the stream's layout.
+// Returns NULL if the cache is full or out of memory.
+const azaSpeakerGeometry* azaGetSpeakerGeometry(azaChannelLayout layout);
+
+// Called by azaInit and azaDeinit, so you don't have to.
+void azaSpeakerGeometryCacheInit();
+void azaSpeakerGeometryCacheDeinit();
+
 typedef enum azaSpatializeMode {
 	AZA_SPATIALIZE_SIMPLE,
 	AZA_SPATIALIZE_ADVANCED,
@@ -697,6 +1321,180 @@ void azaFreeSpatialize(azaSpatialize *data);
 // Doesn't attenuate the volume by distance. You must do that yourself and pass the result into srcAmp.
 int azaSpatializeProcess(azaSpatialize *data, azaBuffer dstBuffer, azaBuffer srcBuffer, azaVec3 srcPosStart, float srcAmpStart, azaVec3 srcPosEnd, float srcAmpEnd);
 
+// How much work azaSpatializeProcessBatch puts into a source, as decided by azaSpatializeUpdateLOD
+typedef enum azaSpatializeLOD {
+	// Spatialized however its azaSpatialize is configured
+	AZA_SPATIALIZE_LOD_FULL=0,
+	// AZA_SPATIALIZE_ADVANCED sources get AZA_SPATIALIZE_SIMPLE instead, but keep feeding their delays so they can go back to ADVANCED without a click
+	AZA_SPATIALIZE_LOD_SIMPLE,
+	// Not mixed at all. After the first block, which fades it out, its buffer isn't read, so there's no need to render it. Whatever plays it should still keep going (see azaSamplerSkip).
+	AZA_SPATIALIZE_LOD_VIRTUAL,
+} azaSpatializeLOD;
+
+typedef struct azaSpatializeSource {
+	// Holds the filters and delays for AZA_SPATIALIZE_ADVANCED, which must be kept from one block to the next. If NULL, the source gets AZA_SPATIALIZE_SIMPLE in the batch's world, which needs no state at all.
+	azaSpatialize *spatialize;
+	// MUST be 1-channel, with the same number of frames and samplerate as dstBuffer
+	azaBuffer buffer;
+	azaVec3 posStart;
+	float ampStart;
+	azaVec3 posEnd;
+	float ampEnd;
+	// How much this source matters in dB, added to its amp when azaSpatializeUpdateLOD decides its lod. 0 is neutral, so ambience might be -12 and dialogue +12.
+	float priority;
+	// Set by azaSpatializeUpdateLOD, and left alone otherwise. Keep the same azaSpatializeSource for a sound from one block to the next, so changes between them can be faded in and out.
+	azaSpatializeLOD lod;
+	azaSpatializeLOD lodPrev;
+} azaSpatializeSource;
+
+typedef struct azaSpatializeLODConfig {
+	// Sources quieter than this in dB (counting priority) go virtual. If this is zero, it will default to -60dB.
+	float virtualGain;
+	// Sources this many dB quieter than the loudest source are considered masked by it and go virtual too. If this is zero, it will default to 50dB.
+	float maskRange;
+	// Sources quieter than this in dB (counting priority) are downgraded from ADVANCED to SIMPLE. If this is zero, it will default to -30dB.
+	float simpleGain;
+	// Sources further than this from the listener are downgraded from ADVANCED to SIMPLE. If this is zero, there's no limit.
+	float simpleDistance;
+	// At most this many sources get ADVANCED, loudest first. If this is zero, there's no limit.
+	uint32_t advancedMax;
+	// How far past a threshold in dB a source has to get to move back up, so sources sitting right on one don't flip back and forth every block. Distances use the same ratio. If this is zero, it will default to 3dB.
+	float hysteresis;
+} azaSpatializeLODConfig;
+
+// Decides the lod of every source from its amp, distance and priority, moving the last one into lodPrev. Call it every block before rendering the sources, so virtual ones can be skipped.
+// world is used by sources without an azaSpatialize. If world is NULL, it will use azaWorldDefault.
+void azaSpatializeUpdateLOD(azaSpatializeLODConfig config, const azaWorld *world, azaSpatializeSource *sources, uint32_t sourceCount);
+
+// Same as calling azaSpatializeProcess for every source, except the speaker geometry is only worked out once and AZA_SPATIALIZE_SIMPLE sources are added straight into dstBuffer without any side buffers.
+// world is used by sources without an azaSpatialize. If world is NULL, it will use azaWorldDefault.
+// Every source is checked before any are mixed, so on error dstBuffer is untouched unless the error came from an AZA_SPATIALIZE_ADVANCED source's processing.
+// May return AZA_ERROR_INVALID_CHANNEL_COUNT if dstBuffer has more than AZA_MAX_CHANNEL_POSITIONS channels
+// Each source is mixed according to its lod, and when that differs from lodPrev the old way fades out while the new one fades in. Sources that were already virtual last block aren't checked or read, since their buffers needn't be rendered.
+int azaSpatializeProcessBatch(const azaWorld *world, azaBuffer dstBuffer, const azaSpatializeSource *sources, uint32_t sourceCount);
+
+
+
+// Ambisonics lets any number of sources share one soundfield of AZA_AMBISONIC_CHANNELS(order) channels, which is turned with the listener and decoded for the speakers only once. Spatializing S sources to C speakers costs about S*K + K*C instead of S*C.
+// Soundfields use ACN channel order and SN3D normalization (AmbiX).
+typedef struct azaAmbisonicConfig {
+	// if world is NULL, it will use azaWorldDefault
+	const azaWorld *world;
+	// From 1 to AZAUDIO_AMBISONIC_MAX_ORDER. Higher orders place sources more sharply, but cost more channels.
+	uint8_t order;
+} azaAmbisonicConfig;
+
+// Puts the gains for a sound coming from direction into dstGains, which needs room for AZA_AMBISONIC_CHANNELS(order) floats.
+// direction MUST be normalized, and uses our axes (x right, y up, z forward), not the ambisonic ones.
+void azaAmbisonicGetGains(uint8_t order, azaVec3 direction, float *dstGains);
+
+// Adds every source to soundfield, which MUST have AZA_AMBISONIC_CHANNELS(config.order) channels. Sources are used the same way as in azaSpatializeProcessBatch except that their spatialize is ignored.
+// The soundfield is centered on the world's origin but not turned with its orientation, which azaAmbisonicDecode takes care of for the whole soundfield at once.
+// Doesn't attenuate the volume by distance. You must do that yourself and pass the result into each source's amp.
+int azaAmbisonicEncode(azaAmbisonicConfig config, azaBuffer soundfield, const azaSpatializeSource *sources, uint32_t sourceCount);
+
+// Turns soundfield (as made by azaAmbisonicEncode) with the world's orientation, decodes it for dstBuffer's layout, and adds it to dstBuffer times amp.
+// Turning is folded into the decoder once per call, so every frame costs one gain per soundfield channel per speaker.
+// May return AZA_ERROR_INVALID_CHANNEL_COUNT if dstBuffer has more than AZA_MAX_CHANNEL_POSITIONS channels
+int azaAmbisonicDecode(azaAmbisonicConfig config, azaBuffer dstBuffer, azaBuffer soundfield, float amp);
+
+
+
+// Head-related impulse responses measured from many directions around a listener, which is what lets headphones place a sound somewhere outside your head.
+typedef struct azaHRTF {
+	uint32_t samplerate;
+	uint32_t irFrames;
+	uint32_t directionCount;
+	// Unit vector in headspace for each measurement
+	azaVec3 *directions;
+	// For each direction, irFrames samples for the left ear followed by irFrames samples for the right ear
+	float *irs;
+	// Every cell of an octahedral grid over all directions lists the only measurements that can be among the nearest to anywhere inside it, so sources don't have to look at every one. cellStart has an offset into cellDirections for each cell plus one for the end.
+	// NULL if there are so few measurements that every one is always a candidate.
+	uint32_t *cellStart;
+	uint32_t *cellDirections;
+} azaHRTF;
+
+// Copies measurements from memory.
+// positions holds an azimuth, elevation, and distance per direction, the same as SOFA's SourcePosition: degrees counter-clockwise from straight ahead, degrees up from the horizon, and a distance that we ignore.
+// irs is laid out like azaHRTF.irs, which is also how SOFA's Data.IR is laid out.
+// May return AZA_ERROR_NULL_POINTER, AZA_ERROR_INVALID_CONFIGURATION, or AZA_ERROR_OUT_OF_MEMORY
+int azaHRTFInit(azaHRTF *data, uint32_t samplerate, uint32_t irFrames, uint32_t directionCount, const float *positions, const float *irs);
+// Loads measurements from a file. SOFA files are HDF5, which is far too much to depend on, so this reads the same data flattened into a little-endian file:
+// - The 8 bytes "AZAHRIR1"
+// - uint32 samplerate, irFrames, and directionCount
+// - float32 positions and irs, laid out as in azaHRTFInit
+// May return AZA_ERROR_FILE_IO, AZA_ERROR_UNSUPPORTED_FORMAT, or AZA_ERROR_OUT_OF_MEMORY
+int azaHRTFLoad(azaHRTF *data, const char *path);
+void azaHRTFDeinit(azaHRTF *data);
+
+typedef struct azaBinauralConfig {
+	// The measurements to render with. MUST outlive the azaBinaural and not change while it uses them.
+	const azaHRTF *hrtf;
+	// if world is NULL, it will use azaWorldDefault
+	const azaWorld *world;
+	// How many frames each convolution partition covers, which is also how far the output lags behind the input. Rounded up to a power of 2. If this is zero, it will use AZAUDIO_BINAURAL_DEFAULT_PARTITION_FRAMES.
+	uint32_t partitionFrames;
+} azaBinauralConfig;
+
+typedef struct azaBinauralDirection {
+	// The previous partition's input followed by the one being gathered, which is the window each partition's FFT sees
+	float *input;
+	// Ring of spectra of the last partitionCount windows
+	float *spectra;
+	// How many of the newest spectra are silent. Once it reaches partitionCount there's nothing left ringing and this direction costs nothing.
+	uint32_t silentPartitions;
+	// Whether the current partition got any input
+	bool active;
+	// Whether the previous partition got any input, which means this window isn't silent even without new input
+	bool activePrev;
+} azaBinauralDirection;
+
+// Renders any number of sources for headphones through an azaHRTF.
+// Each source is spread over the measured directions nearest to it, and then each direction is convolved with its impulse responses using uniformly partitioned FFT convolution. Sources only add to their directions' input, so any number of sources near the same directions cost about the same as one.
+typedef struct azaBinaural {
+	azaDSP header;
+	azaBinauralConfig config;
+	// What the buffers below were made for, so we know when to remake them
+	const azaHRTF *hrtf;
+	uint32_t partitionFrames;
+	uint32_t partitionCount;
+	azaFFT fft;
+	// One allocation for everything below
+	float *buffer;
+	// For each direction, partitionCount spectra for the left ear followed by partitionCount spectra for the right ear, scaled so azaFFTInverse comes out at unity gain
+	float *filters;
+	azaBinauralDirection *directions;
+	// The left and right spectra being summed for the current partition
+	float *accum;
+	// The left and right output of the last partition, played while the next one is gathered
+	float *output;
+	// Time-domain scratch of 2*partitionFrames
+	float *window;
+	// How many frames of the current partition have been gathered
+	uint32_t fill;
+	// Which of every direction's spectra is the newest
+	uint32_t partitionIndex;
+} azaBinaural;
+
+// returns the size in bytes of azaBinaural
+uint32_t azaBinauralGetAllocSize();
+// initializes azaBinaural in existing memory
+void azaBinauralInit(azaBinaural *data, uint32_t allocSize, azaBinauralConfig config);
+// frees any additional memory that the azaBinaural may have allocated
+void azaBinauralDeinit(azaBinaural *data);
+
+// Convenience function that allocates and inits an azaBinaural for you
+// May return NULL indicating an out-of-memory error
+azaBinaural* azaMakeBinaural(azaBinauralConfig config);
+// Frees an azaBinaural that was created with azaMakeBinaural
+void azaFreeBinaural(azaBinaural *data);
+
+// Adds every source to dstBuffer, which MUST have 2 channels (left and right ear) and the same samplerate as the HRTF. Sources are used the same way as in azaSpatializeProcessBatch except that their spatialize is ignored.
+// The HRTF's impulse responses are transformed the first time this is called, or whenever config.hrtf or config.partitionFrames change.
+// Doesn't attenuate the volume by distance. You must do that yourself and pass the result into each source's amp.
+int azaBinauralProcess(azaBinaural *data, azaBuffer dstBuffer, const azaSpatializeSource *sources, uint32_t sourceCount);
+
 
 
 #ifdef __cplusplus
@@ -49,6 +49,12 @@ enum {
 	AZA_ERROR_DSP_INTERFACE_NOT_GENERIC,
 	// Attempted to process an azaMixer with circular track routing
 	AZA_ERROR_MIXER_ROUTING_CYCLE,
+	// An azaMixer's command queue had no room for another command
+	AZA_ERROR_MIXER_COMMAND_QUEUE_FULL,
+	// A file couldn't be opened or read
+	AZA_ERROR_FILE_IO,
+	// A file's contents weren't in a format we know how to read
+	AZA_ERROR_UNSUPPORTED_FORMAT,
 	// Enum count
 	AZA_ERROR_ONE_AFTER_LAST,
 };
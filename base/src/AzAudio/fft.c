@@ -0,0 +1,182 @@
+/*
+	File: fft.c
+	Author: Philip Haynes
+*/
+
+#include "fft.h"
+
+#include "AzAudio.h"
+#include "error.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+int azaFFTInit(azaFFT *data, uint32_t size) {
+	memset(data, 0, sizeof(*data));
+	if (size < 4 || (size & (size - 1)) != 0) return AZA_ERROR_INVALID_CONFIGURATION;
+	uint32_t half = size / 2;
+	// One allocation for everything
+	float *memory = aza_malloc(sizeof(uint32_t) * half + sizeof(float) * (half * 2 + (half + 1) * 2 + size));
+	if (!memory) return AZA_ERROR_OUT_OF_MEMORY;
+	data->size = size;
+	data->bitReverse = (uint32_t*)memory;
+	data->twiddles = memory + half;
+	data->splitTwiddles = data->twiddles + half * 2;
+	data->work = data->splitTwiddles + (half + 1) * 2;
+	uint32_t bits = 0;
+	while ((1u << bits) < half) bits++;
+	for (uint32_t i = 0; i < half; i++) {
+		uint32_t reversed = 0;
+		for (uint32_t b = 0; b < bits; b++) {
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		data->bitReverse[i] = reversed;
+	}
+	// Worked out in double so the error doesn't pile up for big sizes
+	const double tau = 6.283185307179586;
+	for (uint32_t span = 1; span < half; span *= 2) {
+		float *twiddles = data->twiddles + span * 2;
+		for (uint32_t k = 0; k < span; k++) {
+			twiddles[k*2+0] = (float)cos(tau * k / (span * 2));
+			twiddles[k*2+1] = (float)-sin(tau * k / (span * 2));
+		}
+	}
+	for (uint32_t k = 0; k <= half; k++) {
+		data->splitTwiddles[k*2+0] = (float)cos(tau * k / size);
+		data->splitTwiddles[k*2+1] = (float)-sin(tau * k / size);
+	}
+	return AZA_SUCCESS;
+}
+
+void azaFFTDeinit(azaFFT *data) {
+	// bitReverse is the start of the allocation
+	if (data->bitReverse) {
+		aza_free(data->bitReverse);
+	}
+	memset(data, 0, sizeof(*data));
+}
+
+// In-place radix-2 transform of count interleaved complex numbers that are already in bit-reversed order.
+static void azaFFTComplex(float *work, uint32_t count, const float *twiddles, bool inverse) {
+	// The first two stages only multiply by 1 and -i, so they're done together without any twiddles
+	if (count >= 4) {
+		float rot = inverse ? -1.0f : 1.0f;
+		for (uint32_t i = 0; i < count * 2; i += 8) {
+			float *x = work + i;
+			float ar = x[0] + x[2], ai = x[1] + x[3];
+			float br = x[0] - x[2], bi = x[1] - x[3];
+			float cr = x[4] + x[6], ci = x[5] + x[7];
+			// (x2 - x3) * -i, or * i for the inverse
+			float dr = (x[5] - x[7]) * rot, di = (x[6] - x[4]) * rot;
+			x[0] = ar + cr; x[1] = ai + ci;
+			x[4] = ar - cr; x[5] = ai - ci;
+			x[2] = br + dr; x[3] = bi + di;
+			x[6] = br - dr; x[7] = bi - di;
+		}
+	} else {
+		for (uint32_t i = 0; i < count * 2; i += 4) {
+			float *x = work + i;
+			float ar = x[0], ai = x[1];
+			x[0] = ar + x[2]; x[1] = ai + x[3];
+			x[2] = ar - x[2]; x[3] = ai - x[3];
+		}
+	}
+	float sign = inverse ? -1.0f : 1.0f;
+	for (uint32_t span = 4; span < count; span *= 2) {
+		// Each stage's twiddles are contiguous, starting at span
+		const float *w = twiddles + span * 2;
+		for (uint32_t start = 0; start < count; start += span * 2) {
+			float *a = work + start * 2;
+			float *b = a + span * 2;
+			for (uint32_t j = 0; j < span; j++) {
+				float wr = w[j*2+0];
+				float wi = w[j*2+1] * sign;
+				float tr = b[j*2+0] * wr - b[j*2+1] * wi;
+				float ti = b[j*2+0] * wi + b[j*2+1] * wr;
+				b[j*2+0] = a[j*2+0] - tr;
+				b[j*2+1] = a[j*2+1] - ti;
+				a[j*2+0] += tr;
+				a[j*2+1] += ti;
+			}
+		}
+	}
+}
+
+// The real signal is transformed as half as many complex numbers made of its even and odd samples, and then untangled using the symmetry of real spectra.
+
+void azaFFTForward(azaFFT *data, float *dst, const float *src) {
+	uint32_t half = data->size / 2;
+	float *work = data->work;
+	for (uint32_t k = 0; k < half; k++) {
+		uint32_t r = data->bitReverse[k];
+		work[r*2+0] = src[k*2+0];
+		work[r*2+1] = src[k*2+1];
+	}
+	azaFFTComplex(work, half, data->twiddles, false);
+	float *re = dst;
+	float *im = dst + half + 1;
+	re[0] = work[0] + work[1];
+	im[0] = 0.0f;
+	re[half] = work[0] - work[1];
+	im[half] = 0.0f;
+	for (uint32_t k = 1; k < half; k++) {
+		// a = Z[k], b = conj(Z[half-k])
+		float ar = work[k*2+0];
+		float ai = work[k*2+1];
+		float br = work[(half-k)*2+0];
+		float bi = -work[(half-k)*2+1];
+		// Spectrum of the even samples
+		float evenRe = 0.5f * (ar + br);
+		float evenIm = 0.5f * (ai + bi);
+		// Spectrum of the odd samples, (a - b) / 2i
+		float oddRe = 0.5f * (ai - bi);
+		float oddIm = -0.5f * (ar - br);
+		float wr = data->splitTwiddles[k*2+0];
+		float wi = data->splitTwiddles[k*2+1];
+		re[k] = evenRe + wr * oddRe - wi * oddIm;
+		im[k] = evenIm + wr * oddIm + wi * oddRe;
+	}
+}
+
+void azaFFTInverse(azaFFT *data, float *dst, const float *src) {
+	uint32_t half = data->size / 2;
+	float *work = data->work;
+	const float *re = src;
+	const float *im = src + half + 1;
+	for (uint32_t k = 0; k < half; k++) {
+		// a = X[k], b = conj(X[half-k])
+		float ar = re[k];
+		float ai = im[k];
+		float br = re[half-k];
+		float bi = -im[half-k];
+		// Twice the spectra of the even and odd samples. The 2 goes into the overall scale.
+		float evenRe = ar + br;
+		float evenIm = ai + bi;
+		float dr = ar - br;
+		float di = ai - bi;
+		float wr = data->splitTwiddles[k*2+0];
+		float wi = -data->splitTwiddles[k*2+1];
+		float oddRe = dr * wr - di * wi;
+		float oddIm = dr * wi + di * wr;
+		// Z[k] = even + i*odd
+		uint32_t r = data->bitReverse[k];
+		work[r*2+0] = evenRe - oddIm;
+		work[r*2+1] = evenIm + oddRe;
+	}
+	azaFFTComplex(work, half, data->twiddles, true);
+	memcpy(dst, work, sizeof(float) * data->size);
+}
+
+void azaSpectrumMulAdd(float *dst, const float *lhs, const float *rhs, uint32_t bins) {
+	float *dstRe = dst;
+	float *dstIm = dst + bins;
+	const float *lhsRe = lhs;
+	const float *lhsIm = lhs + bins;
+	const float *rhsRe = rhs;
+	const float *rhsIm = rhs + bins;
+	for (uint32_t i = 0; i < bins; i++) {
+		dstRe[i] += lhsRe[i] * rhsRe[i] - lhsIm[i] * rhsIm[i];
+		dstIm[i] += lhsRe[i] * rhsIm[i] + lhsIm[i] * rhsRe[i];
+	}
+}
@@ -0,0 +1,51 @@
+/*
+	File: fft.h
+	Author: Philip Haynes
+	Real-valued FFTs and the spectrum math that FFT convolution is made of.
+*/
+
+#ifndef AZAUDIO_FFT_H
+#define AZAUDIO_FFT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Spectra of real signals are stored as size/2+1 bins in split form: every real part followed by every imaginary part, so a spectrum takes size+2 floats. Keeping them apart lets the per-bin math vectorize.
+#define AZA_FFT_SPECTRUM_FLOATS(size) ((size) + 2)
+
+// A plan for transforming real signals of one size. Holds its own scratch memory, so one azaFFT MUST NOT be used by multiple threads at once.
+typedef struct azaFFT {
+	// Length of the real signal. Always a power of 2.
+	uint32_t size;
+	// Where each of the size/2 complex inputs goes for the in-place transform
+	uint32_t *bitReverse;
+	// For each stage of the half-size complex transform that combines pairs of span-long transforms, exp(-i*tau*k/(span*2)) for k < span starting at twiddles[span*2], interleaved real and imaginary
+	float *twiddles;
+	// exp(-i*tau*k/size) for k <= size/2, interleaved real and imaginary. Used to untangle the half-size complex transform into the real one.
+	float *splitTwiddles;
+	// size floats of scratch
+	float *work;
+} azaFFT;
+
+// size MUST be a power of 2 and at least 4
+// May return AZA_ERROR_INVALID_CONFIGURATION or AZA_ERROR_OUT_OF_MEMORY
+int azaFFTInit(azaFFT *data, uint32_t size);
+void azaFFTDeinit(azaFFT *data);
+
+// Transforms size samples from src into the spectrum dst
+void azaFFTForward(azaFFT *data, float *dst, const float *src);
+// Transforms the spectrum src back into size samples in dst.
+// NOTE: Like most FFT libraries, this is unnormalized, so a round trip comes out size times louder. Convolution usually folds 1/size into the filter's spectrum instead.
+void azaFFTInverse(azaFFT *data, float *dst, const float *src);
+
+// dst += lhs * rhs for bins complex numbers in split form
+void azaSpectrumMulAdd(float *dst, const float *lhs, const float *rhs, uint32_t bins);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_FFT_H
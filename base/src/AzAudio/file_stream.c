@@ -0,0 +1,284 @@
+/*
+	File: file_stream.c
+	Author: Philip Haynes
+*/
+
+#include "file_stream.h"
+
+#include "AzAudio.h"
+#include "atomic.h"
+#include "error.h"
+#include "helpers.h"
+#include "backend/threads.h"
+
+#include <string.h>
+#include <math.h>
+
+
+
+static azaMutex azaFileStreamMutex;
+static azaThread azaFileStreamThread;
+static bool azaFileStreamThreadLaunched = false;
+static volatile uint32_t azaFileStreamThreadQuit = 0;
+// Every open stream, guarded by azaFileStreamMutex
+static azaFileStream *azaFileStreamHead = NULL;
+
+
+
+static inline uint16_t azaReadU16LE(const uint8_t *src) {
+	return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline uint32_t azaReadU32LE(const uint8_t *src) {
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static uint32_t azaSampleFormatBytes(azaSampleFormat format) {
+	switch (format) {
+		case AZA_SAMPLE_FORMAT_S16: return 2;
+		case AZA_SAMPLE_FORMAT_S24: return 3;
+		case AZA_SAMPLE_FORMAT_S32: return 4;
+		case AZA_SAMPLE_FORMAT_F32: return 4;
+		default: return 0;
+	}
+}
+
+// Finds the PCM in a RIFF WAVE file. Returns AZA_ERROR_INVALID_CONFIGURATION if it's not a WAV file at all.
+static int azaFileStreamParseWAV(azaFileStream *data) {
+	const uint8_t *file = data->file.data;
+	uint64_t size = data->file.size;
+	if (size < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) return AZA_ERROR_INVALID_CONFIGURATION;
+	uint16_t formatTag = 0, channels = 0, blockAlign = 0, bits = 0;
+	uint32_t samplerate = 0;
+	bool hasFormat = false;
+	uint64_t offset = 12;
+	while (offset + 8 <= size) {
+		const uint8_t *chunk = file + offset;
+		uint64_t chunkSize = azaReadU32LE(chunk + 4);
+		offset += 8;
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16 && offset + 16 <= size) {
+			formatTag = azaReadU16LE(file + offset);
+			channels = azaReadU16LE(file + offset + 2);
+			samplerate = azaReadU32LE(file + offset + 4);
+			blockAlign = azaReadU16LE(file + offset + 12);
+			bits = azaReadU16LE(file + offset + 14);
+			// WAVE_FORMAT_EXTENSIBLE keeps the real format tag at the start of the SubFormat GUID
+			if (formatTag == 0xFFFE && chunkSize >= 40 && offset + 26 <= size) {
+				formatTag = azaReadU16LE(file + offset + 24);
+			}
+			hasFormat = true;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			if (!hasFormat) return AZA_ERROR_UNSUPPORTED_FORMAT;
+			// Writers that couldn't seek back leave the size too big, so trust the file size over it
+			uint64_t dataSize = AZA_MIN(chunkSize, size - offset);
+			if (formatTag == 1 && bits == 16) {
+				data->format = AZA_SAMPLE_FORMAT_S16;
+			} else if (formatTag == 1 && bits == 24) {
+				data->format = AZA_SAMPLE_FORMAT_S24;
+			} else if (formatTag == 1 && bits == 32) {
+				data->format = AZA_SAMPLE_FORMAT_S32;
+			} else if (formatTag == 3 && bits == 32) {
+				data->format = AZA_SAMPLE_FORMAT_F32;
+			} else {
+				return AZA_ERROR_UNSUPPORTED_FORMAT;
+			}
+			if (channels == 0 || channels > UINT8_MAX || samplerate == 0) return AZA_ERROR_UNSUPPORTED_FORMAT;
+			data->channels = (uint8_t)channels;
+			data->samplerate = samplerate;
+			data->frameBytes = azaSampleFormatBytes(data->format) * channels;
+			if (blockAlign != data->frameBytes) return AZA_ERROR_UNSUPPORTED_FORMAT;
+			data->pcm = file + offset;
+			data->pcmFrames = dataSize / data->frameBytes;
+			return AZA_SUCCESS;
+		}
+		// Chunks are padded to an even size
+		offset += chunkSize + (chunkSize & 1);
+	}
+	return AZA_ERROR_UNSUPPORTED_FORMAT;
+}
+
+static int azaFileStreamParseRaw(azaFileStream *data) {
+	uint32_t sampleBytes = azaSampleFormatBytes(data->config.rawFormat);
+	if (sampleBytes == 0 || data->config.rawChannels == 0 || data->config.rawSamplerate == 0) return AZA_ERROR_UNSUPPORTED_FORMAT;
+	data->format = data->config.rawFormat;
+	data->channels = data->config.rawChannels;
+	data->samplerate = data->config.rawSamplerate;
+	data->frameBytes = sampleBytes * data->channels;
+	uint64_t offset = AZA_MIN(data->config.rawOffset, data->file.size);
+	data->pcm = data->file.data + offset;
+	data->pcmFrames = (data->file.size - offset) / data->frameBytes;
+	return AZA_SUCCESS;
+}
+
+static void azaFileStreamConvert(azaFileStream *data, float *dst, uint64_t frame, uint32_t frames) {
+	const uint8_t *src = data->pcm + frame * data->frameBytes;
+	uint32_t samples = frames * data->channels;
+	switch (data->format) {
+		case AZA_SAMPLE_FORMAT_S16:
+			for (uint32_t i = 0; i < samples; i++, src += 2) {
+				dst[i] = (float)(int16_t)azaReadU16LE(src) * (1.0f / 32768.0f);
+			}
+			break;
+		case AZA_SAMPLE_FORMAT_S24:
+			for (uint32_t i = 0; i < samples; i++, src += 3) {
+				// Putting the 24 bits at the top lets the sign come along for free
+				uint32_t value = ((uint32_t)src[0] << 8) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 24);
+				dst[i] = (float)(int32_t)value * (1.0f / 2147483648.0f);
+			}
+			break;
+		case AZA_SAMPLE_FORMAT_S32:
+			for (uint32_t i = 0; i < samples; i++, src += 4) {
+				dst[i] = (float)(int32_t)azaReadU32LE(src) * (1.0f / 2147483648.0f);
+			}
+			break;
+		case AZA_SAMPLE_FORMAT_F32:
+			memcpy(dst, src, samples * sizeof(float));
+			break;
+		default:
+			memset(dst, 0, samples * sizeof(float));
+			break;
+	}
+	azaFileMappingRelease(&data->file, (uint64_t)(data->pcm - data->file.data) + frame * data->frameBytes, (uint64_t)frames * data->frameBytes);
+}
+
+// Tops up the ring as far as bufferFrames ahead of the consumer. Once a non-looping file runs out we keep writing silence until there's enough for interpolation to run off the end, and only then call it ended.
+static void azaFileStreamFill(azaFileStream *data) {
+	if (data->ended) return;
+	uint32_t mask = data->capacity - 1;
+	uint32_t written = data->written;
+	uint32_t consumed = azaAtomicLoad32(&data->consumed);
+	uint32_t space = data->bufferFrames - (written - consumed);
+	bool ended = false;
+	while (space) {
+		uint32_t index = written & mask;
+		uint32_t count = AZA_MIN(space, data->capacity - index);
+		if (data->pcmFrame >= data->pcmFrames && data->config.loop && data->pcmFrames) {
+			data->pcmFrame = 0;
+		}
+		if (data->pcmFrame < data->pcmFrames) {
+			count = (uint32_t)AZA_MIN((uint64_t)count, data->pcmFrames - data->pcmFrame);
+			azaFileStreamConvert(data, data->ring + index * data->channels, data->pcmFrame, count);
+			data->pcmFrame += count;
+		} else {
+			count = AZA_MIN(count, AZAUDIO_FILE_STREAM_HISTORY_FRAMES - data->paddingFrames);
+			memset(data->ring + index * data->channels, 0, count * data->channels * sizeof(float));
+			data->paddingFrames += count;
+			if (data->paddingFrames == AZAUDIO_FILE_STREAM_HISTORY_FRAMES) {
+				written += count;
+				ended = true;
+				break;
+			}
+		}
+		written += count;
+		space -= count;
+	}
+	azaAtomicStore32(&data->written, written);
+	if (ended) {
+		azaAtomicStore32(&data->ended, 1);
+	}
+}
+
+static AZA_THREAD_PROC_DEF(azaFileStreamThreadProc, userdata) {
+	(void)userdata;
+	while (!azaAtomicLoad32(&azaFileStreamThreadQuit)) {
+		azaMutexLock(&azaFileStreamMutex);
+		for (azaFileStream *stream = azaFileStreamHead; stream; stream = stream->next) {
+			azaFileStreamFill(stream);
+		}
+		azaMutexUnlock(&azaFileStreamMutex);
+		azaThreadSleep(AZAUDIO_FILE_STREAM_POLL_MS);
+	}
+	return 0;
+}
+
+int azaFileStreamOpen(azaFileStream *data, const char *path, azaFileStreamConfig config) {
+	int err = AZA_SUCCESS;
+	memset(data, 0, sizeof(*data));
+	data->config = config;
+	if (azaFileMap(&data->file, path)) {
+		AZA_LOG_ERR("azaFileStreamOpen error: Failed to map \"%s\"\n", path);
+		return AZA_ERROR_FILE_IO;
+	}
+	err = azaFileStreamParseWAV(data);
+	if (err == AZA_ERROR_INVALID_CONFIGURATION) {
+		err = azaFileStreamParseRaw(data);
+	}
+	if (err) {
+		AZA_LOG_ERR("azaFileStreamOpen error: \"%s\" isn't PCM we can read\n", path);
+		goto fail;
+	}
+	float bufferMs = config.bufferMs > 0.0f ? AZA_MIN(config.bufferMs, AZAUDIO_FILE_STREAM_MAX_BUFFER_MS) : AZAUDIO_FILE_STREAM_DEFAULT_BUFFER_MS;
+	data->bufferFrames = AZA_MAX((uint32_t)ceilf(aza_ms_to_samples(bufferMs, (float)data->samplerate)), 1);
+	data->capacity = 1;
+	while (data->capacity < data->bufferFrames + AZAUDIO_FILE_STREAM_HISTORY_FRAMES) {
+		data->capacity *= 2;
+	}
+	// Zeroed, so the history before the first frame is silent
+	data->ring = aza_calloc((size_t)data->capacity * data->channels, sizeof(float));
+	if (!data->ring) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto fail;
+	}
+	// Nobody else can see it yet, so we can fill it right here and be ready to play immediately
+	azaFileStreamFill(data);
+	azaMutexLock(&azaFileStreamMutex);
+	data->next = azaFileStreamHead;
+	azaFileStreamHead = data;
+	if (!azaFileStreamThreadLaunched) {
+		if (azaThreadLaunch(&azaFileStreamThread, azaFileStreamThreadProc, NULL)) {
+			AZA_LOG_ERR("azaFileStreamOpen error: Failed to launch the I/O thread\n");
+		} else {
+			azaFileStreamThreadLaunched = true;
+		}
+	}
+	azaMutexUnlock(&azaFileStreamMutex);
+	return AZA_SUCCESS;
+fail:
+	if (data->ring) {
+		aza_free(data->ring);
+		data->ring = NULL;
+	}
+	azaFileUnmap(&data->file);
+	return err;
+}
+
+void azaFileStreamClose(azaFileStream *data) {
+	azaMutexLock(&azaFileStreamMutex);
+	for (azaFileStream **link = &azaFileStreamHead; *link; link = &(*link)->next) {
+		if (*link == data) {
+			*link = data->next;
+			break;
+		}
+	}
+	azaMutexUnlock(&azaFileStreamMutex);
+	if (data->ring) {
+		aza_free(data->ring);
+		data->ring = NULL;
+	}
+	azaFileUnmap(&data->file);
+}
+
+uint32_t azaFileStreamGetReady(azaFileStream *data) {
+	return azaAtomicLoad32(&data->written) - data->consumed;
+}
+
+void azaFileStreamConsume(azaFileStream *data, uint32_t frames) {
+	assert(frames <= azaFileStreamGetReady(data));
+	azaAtomicStore32(&data->consumed, data->consumed + frames);
+}
+
+void azaFileStreamInitThread() {
+	azaMutexInit(&azaFileStreamMutex);
+	azaFileStreamThreadQuit = 0;
+	azaFileStreamThreadLaunched = false;
+	azaFileStreamHead = NULL;
+}
+
+void azaFileStreamDeinitThread() {
+	if (azaFileStreamThreadLaunched) {
+		azaAtomicStore32(&azaFileStreamThreadQuit, 1);
+		azaThreadJoin(&azaFileStreamThread);
+		azaFileStreamThreadLaunched = false;
+	}
+	azaMutexDeinit(&azaFileStreamMutex);
+}
@@ -0,0 +1,106 @@
+/*
+	File: file_stream.h
+	Author: Philip Haynes
+	Streams PCM from disk through a small ring buffer, so long sounds don't have to be fully decoded into memory before they can be played.
+*/
+
+#ifndef AZAUDIO_FILE_STREAM_H
+#define AZAUDIO_FILE_STREAM_H
+
+#include "backend/file.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Used by azaFileStreamOpen when its config leaves bufferMs at 0
+#define AZAUDIO_FILE_STREAM_DEFAULT_BUFFER_MS 250.0f
+// Longer buffers are clamped to this
+#define AZAUDIO_FILE_STREAM_MAX_BUFFER_MS 500.0f
+// Frames behind the consumer that the I/O thread leaves alone, which is what lets interpolation look backwards. They're silent until the stream has played this far.
+#define AZAUDIO_FILE_STREAM_HISTORY_FRAMES 256
+// How often the I/O thread tops up every stream
+#define AZAUDIO_FILE_STREAM_POLL_MS 10
+
+typedef enum azaSampleFormat {
+	AZA_SAMPLE_FORMAT_NONE=0,
+	// 16-bit signed integer
+	AZA_SAMPLE_FORMAT_S16,
+	// 24-bit signed integer packed into 3 bytes
+	AZA_SAMPLE_FORMAT_S24,
+	// 32-bit signed integer
+	AZA_SAMPLE_FORMAT_S32,
+	// 32-bit IEEE float
+	AZA_SAMPLE_FORMAT_F32,
+} azaSampleFormat;
+
+typedef struct azaFileStreamConfig {
+	// How much audio to keep decoded ahead of playback in ms. 0 means AZAUDIO_FILE_STREAM_DEFAULT_BUFFER_MS
+	float bufferMs;
+	// Whether to start over from the beginning once we reach the end of the file
+	bool loop;
+	// Files that don't start with a RIFF WAVE header are treated as raw little-endian interleaved PCM described by these
+	azaSampleFormat rawFormat;
+	uint8_t rawChannels;
+	uint32_t rawSamplerate;
+	// Bytes to skip at the start of a raw file
+	uint64_t rawOffset;
+} azaFileStreamConfig;
+
+// A file being read into a ring buffer by a background I/O thread, which one consumer (such as azaSampler) reads from without ever waiting on it.
+// Frame counters are absolute and wrap around at 2^32, and since capacity is a power of two they map to the ring with a mask.
+typedef struct azaFileStream {
+	azaFileStreamConfig config;
+	azaFileMapping file;
+	// PCM data within file
+	const uint8_t *pcm;
+	uint64_t pcmFrames;
+	azaSampleFormat format;
+	uint32_t frameBytes;
+	uint32_t samplerate;
+	uint8_t channels;
+	// Interleaved frames
+	float *ring;
+	uint32_t capacity;
+	// How far ahead of consumed the I/O thread fills, always at least AZAUDIO_FILE_STREAM_HISTORY_FRAMES less than capacity
+	uint32_t bufferFrames;
+	// Only touched by the I/O thread
+	uint64_t pcmFrame;
+	// Silent frames written after the end of a non-looping file. Only touched by the I/O thread.
+	uint32_t paddingFrames;
+	// Everything before written is ready to read. Only the I/O thread moves it.
+	volatile uint32_t written;
+	// Everything before consumed can be reused by the I/O thread. Only the consumer moves it.
+	volatile uint32_t consumed;
+	// Set once a non-looping stream has written its last frame, followed by AZAUDIO_FILE_STREAM_HISTORY_FRAMES of silence.
+	volatile uint32_t ended;
+	// How many times the consumer needed frames that weren't ready yet. Only the consumer touches this.
+	uint32_t underruns;
+	struct azaFileStream *next;
+} azaFileStream;
+
+// Maps the file, reads the header, allocates the ring and fills it, then hands it to the I/O thread (launching it if it isn't running yet).
+// Call this from somewhere that can wait on the disk, never the audio thread.
+// May return AZA_ERROR_FILE_IO if the file couldn't be opened, AZA_ERROR_UNSUPPORTED_FORMAT if it isn't PCM we understand, or AZA_ERROR_OUT_OF_MEMORY
+int azaFileStreamOpen(azaFileStream *data, const char *path, azaFileStreamConfig config);
+// Takes the stream away from the I/O thread, then frees everything. Nothing can be reading from the stream at this point.
+void azaFileStreamClose(azaFileStream *data);
+
+// Consumer side, safe to call from the audio thread.
+// Returns how many frames from consumed onward are ready to read
+uint32_t azaFileStreamGetReady(azaFileStream *data);
+// Gives frames back to the I/O thread
+void azaFileStreamConsume(azaFileStream *data, uint32_t frames);
+
+// Called by azaInit and azaDeinit, so you don't have to.
+void azaFileStreamInitThread();
+void azaFileStreamDeinitThread();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_FILE_STREAM_H
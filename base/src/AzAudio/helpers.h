@@ -108,8 +108,10 @@ struct {\
 	if ((name).count == (name).capacity) {\
 		(name).capacity = (uint32_t)aza_grow((name).capacity, (name).count+1, 8);\
 		type *newData = aza_calloc((name).capacity, sizeof(type));\
-		memcpy(newData, (name).data, (name).count * sizeof(type));\
-		aza_free((name).data);\
+		if ((name).data) {\
+			memcpy(newData, (name).data, (name).count * sizeof(type));\
+			aza_free((name).data);\
+		}\
 		(name).data = newData;\
 	}\
 	(name).data[(name).count++] = value;\
@@ -119,6 +121,7 @@ struct {\
 	for (int64_t aza_i = (index); aza_i < (int64_t)(name).count - (num); aza_i++) {\
 		(name).data[aza_i] = (name).data[aza_i + (num)];\
 	}\
+	(name).count -= (num);\
 }
 
 #ifdef __cplusplus
@@ -7,6 +7,7 @@
 #define AZAUDIO_MATH_H
 
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "header_utils.h"
@@ -42,6 +43,80 @@ static inline float azaWrap01f(float a) {
 	return a - (float)intPart;
 }
 
+
+
+// Fast approximations of exp2 and log2 for places that need a lot of them, like converting a whole block between amplitude and decibels. The same math is vectorized in simd.c as azaSIMDDbToAmp and azaSIMDAmpToDb.
+// azaFastExp2f is within a few ulp (relative error around 3e-7), returns exactly 1 for 0 and exactly 0 below -126.
+// azaFastLog2f has an absolute error around 2e-7 on top of the float rounding of the result, and returns exactly 0 for 1. Anything below the smallest normal float (including 0 and negatives) is treated as that, giving -126.
+
+#define AZA_LOG2_E 1.44269504089f
+// log2(10) / 20
+#define AZA_DB_TO_LOG2 0.166096404744f
+// 20 * log10(2)
+#define AZA_LOG2_TO_DB 6.02059991328f
+
+// Adding and subtracting this rounds to the nearest integer for anything with a magnitude under 2^22
+#define AZA_ROUND_MAGIC 12582912.0f
+
+// Minimax fit of 2^f for f in [-0.5, 0.5] with the constant term pinned to 1
+#define AZA_EXP2_C1 0.693146977f
+#define AZA_EXP2_C2 0.240222420f
+#define AZA_EXP2_C3 0.0555073399f
+#define AZA_EXP2_C4 0.00967151902f
+#define AZA_EXP2_C5 0.00132646516f
+
+// Series for log2(m) = 2/ln(2) * atanh(t) where t = (m-1)/(m+1) and m is in [sqrt(0.5), sqrt(2)]
+#define AZA_LOG2_C1 2.88539008178f
+#define AZA_LOG2_C3 0.961796693926f
+#define AZA_LOG2_C5 0.577078016356f
+#define AZA_LOG2_C7 0.412198583111f
+// 1.0f's bits minus sqrt(0.5)'s bits
+#define AZA_LOG2_MANTISSA_OFFSET 0x004afb0du
+
+static inline uint32_t azaFloatBits(float a) {
+	uint32_t result;
+	memcpy(&result, &a, sizeof(result));
+	return result;
+}
+
+static inline float azaFloatFromBits(uint32_t a) {
+	float result;
+	memcpy(&result, &a, sizeof(result));
+	return result;
+}
+
+static inline float azaFastExp2f(float x) {
+	if (!(x >= -126.0f)) return 0.0f;
+	if (x > 127.0f) x = 127.0f;
+	float rounded = (x + AZA_ROUND_MAGIC) - AZA_ROUND_MAGIC;
+	float f = x - rounded;
+	float p = 1.0f + f * (AZA_EXP2_C1 + f * (AZA_EXP2_C2 + f * (AZA_EXP2_C3 + f * (AZA_EXP2_C4 + f * AZA_EXP2_C5))));
+	return p * azaFloatFromBits((uint32_t)((int32_t)rounded + 127) << 23);
+}
+
+static inline float azaFastLog2f(float x) {
+	if (!(x >= 1.17549435e-38f)) x = 1.17549435e-38f;
+	uint32_t bits = azaFloatBits(x);
+	// Offsetting by the bits of sqrt(0.5) before pulling out the exponent lands the mantissa in [sqrt(0.5), sqrt(2)) without any compares
+	int32_t exponent = (int32_t)((bits + AZA_LOG2_MANTISSA_OFFSET) >> 23) - 127;
+	float m = azaFloatFromBits(bits - ((uint32_t)exponent << 23));
+	float t = (m - 1.0f) / (m + 1.0f);
+	float t2 = t * t;
+	return (float)exponent + t * (AZA_LOG2_C1 + t2 * (AZA_LOG2_C3 + t2 * (AZA_LOG2_C5 + t2 * AZA_LOG2_C7)));
+}
+
+static inline float azaFastExpf(float x) {
+	return azaFastExp2f(x * AZA_LOG2_E);
+}
+
+static inline float azaFastDbToAmpf(float db) {
+	return azaFastExp2f(db * AZA_DB_TO_LOG2);
+}
+
+static inline float azaFastAmpToDbf(float amp) {
+	return azaFastLog2f(amp) * AZA_LOG2_TO_DB;
+}
+
 #define AZA_OSC_SINE_SAMPLES 128
 extern float azaOscSineValues[AZA_OSC_SINE_SAMPLES+1];
 // A LUT-based approximate sine oscillator where t is periodic between 0 and 1
@@ -7,15 +7,65 @@
 #include "AzAudio.h"
 #include "error.h"
 #include "helpers.h"
+#include "atomic.h"
+#include "backend/threads.h"
 
 #include <string.h>
 
+// Bumped whenever any track's receives change, which is how mixers know their schedule is stale. Starts at 1 so a zeroed schedule is always stale.
+static volatile uint32_t azaRoutingVersion = 1;
+
+static void azaRoutingChanged() {
+	azaAtomicFetchAdd32(&azaRoutingVersion, 1);
+}
+
+static void azaTrackInitCommon(azaTrack *data) {
+	data->dsp = NULL;
+	data->receives.data = NULL;
+	data->receives.count = 0;
+	data->receives.capacity = 0;
+	data->mark = 0;
+	data->level = 0;
+	data->ambisonic = (azaAmbisonicConfig) {0};
+	azaRoutingChanged();
+}
+
 int azaTrackInit(azaTrack *data, uint32_t bufferFrames, azaChannelLayout bufferChannelLayout) {
+	azaTrackInitCommon(data);
 	return azaBufferInit(&data->buffer, bufferFrames, bufferChannelLayout);
 }
 
+int azaTrackInitPlanar(azaTrack *data, uint32_t bufferFrames, azaChannelLayout bufferChannelLayout) {
+	azaTrackInitCommon(data);
+	return azaBufferInitPlanar(&data->buffer, bufferFrames, bufferChannelLayout);
+}
+
+int azaTrackSetAmbisonic(azaTrack *data, azaAmbisonicConfig config) {
+	if (config.order < 1 || config.order > AZAUDIO_AMBISONIC_MAX_ORDER) return AZA_ERROR_INVALID_CONFIGURATION;
+	azaChannelLayout layout = {
+		.count = AZA_AMBISONIC_CHANNELS(config.order),
+		.formFactor = AZA_FORM_FACTOR_SPEAKERS,
+	};
+	// Interleaved buffers always have a channelStride of 1, and planar ones never do
+	bool planar = data->buffer.channelStride != 1;
+	azaBuffer buffer;
+	int err = planar ? azaBufferInitPlanar(&buffer, data->buffer.frames, layout) : azaBufferInit(&buffer, data->buffer.frames, layout);
+	if (err) return err;
+	azaBufferDeinit(&data->buffer);
+	data->buffer = buffer;
+	data->ambisonic = config;
+	return AZA_SUCCESS;
+}
+
 void azaTrackDeinit(azaTrack *data) {
 	azaBufferDeinit(&data->buffer);
+	if (data->receives.data) {
+		aza_free(data->receives.data);
+	}
+	data->receives.data = NULL;
+	data->receives.count = 0;
+	data->receives.capacity = 0;
+	azaRoutingChanged();
 }
 
 void azaTrackAppendDSP(azaTrack *data, azaDSP *dsp) {
@@ -48,6 +98,7 @@ azaTrackRoute* azaTrackConnect(azaTrack *from, azaTrack *to, float gain) {
 		.gain = gain,
 	};
 	AZA_DYNAMIC_ARRAY_APPEND(azaTrackRoute, to->receives, route);
+	azaRoutingChanged();
 	return &to->receives.data[to->receives.count-1];
 }
 
@@ -55,85 +106,513 @@ void azaTrackDisconnect(azaTrack *from, azaTrack *to) {
 	for (uint32_t i = 0; i < to->receives.count; i++) {
 		if (to->receives.data[i].track == from) {
 			AZA_DYNAMIC_ARRAY_ERASE(to->receives, i, 1);
+			azaRoutingChanged();
 			break;
 		}
 	}
 }
 
-int azaTrackProcess(uint32_t frames, uint32_t samplerate, azaTrack *data) {
+// Mixes our receives and runs our dsp chain, expecting everything we receive from to be processed already
+static int azaTrackProcessReceived(uint32_t frames, uint32_t samplerate, azaTrack *data) {
 	data->buffer.samplerate = samplerate;
 	azaBuffer buffer = azaBufferSlice(data->buffer, 0, frames);
 	azaBufferZero(buffer);
 	for (uint32_t i = 0; i < data->receives.count; i++) {
 		azaTrackRoute *route = &data->receives.data[i];
-		int err = azaTrackProcess(frames, samplerate, route->track);
-		if (err) return err;
 		// TODO: Channel matrices
 		// TODO: Latency compensation
-		azaBufferMix(buffer, 1.0f, azaBufferSlice(route->track->buffer, 0, frames), aza_db_to_ampf(route->gain));
+		azaBuffer src = azaBufferSlice(route->track->buffer, 0, frames);
+		if (route->track->ambisonic.order && !data->ambisonic.order) {
+			int err = azaAmbisonicDecode(route->track->ambisonic, buffer, src, aza_db_to_ampf(route->gain));
+			if (err) return err;
+		} else if (route->track->ambisonic.order && data->ambisonic.order) {
+			// Lower orders are the first channels of higher ones, so mixing them is only a matter of leaving out what the other side doesn't have
+			azaBuffer dst = buffer;
+			dst.channelLayout.count = src.channelLayout.count = AZA_MIN(dst.channelLayout.count, src.channelLayout.count);
+			azaBufferMix(dst, 1.0f, src, aza_db_to_ampf(route->gain));
+		} else {
+			azaBufferMix(buffer, 1.0f, src, aza_db_to_ampf(route->gain));
+		}
 	}
 	if (data->dsp) {
-		return azaDSPProcessSingle(data->dsp, buffer);
+		// Even if some DSP loses track of its side buffers, they don't pile up past this track
+		azaScratchMark mark = azaMarkSideBuffers();
+		int err = azaDSPProcessSingle(data->dsp, buffer);
+		azaReleaseSideBuffers(mark);
+		return err;
+	}
+	return AZA_SUCCESS;
+}
+
+int azaTrackProcess(uint32_t frames, uint32_t samplerate, azaTrack *data) {
+	for (uint32_t i = 0; i < data->receives.count; i++) {
+		int err = azaTrackProcess(frames, samplerate, data->receives.data[i].track);
+		if (err) return err;
+	}
+	return azaTrackProcessReceived(frames, samplerate, data);
+}
+
+
+
+// Multithreading
+
+
+
+// Counters that every thread hammers on get their own cache lines
+#define AZA_CACHE_LINE_SIZE 64
+
+enum {
+	AZA_MIXER_WORKERS_IDLE=0,
+	AZA_MIXER_WORKERS_RUNNING,
+	AZA_MIXER_WORKERS_QUIT,
+};
+
+typedef struct azaMixerWorkers {
+	azaMixer *mixer;
+	azaThread *threads;
+	uint32_t threadCount;
+	azaSemaphore wake;
+	// Posted whenever a job finishes while workers are blocked waiting on jobsDone
+	azaSemaphore progress;
+	uint32_t frames;
+	uint32_t samplerate;
+	// One of the AZA_MIXER_WORKERS_ enum values
+	volatile uint32_t state;
+	// How many workers are awake and looking at state. We can only set up the next block once this is zero.
+	volatile uint32_t busy;
+	// The first error any job had
+	volatile uint32_t err;
+	char _pad0[AZA_CACHE_LINE_SIZE];
+	// Index into mixer->schedule.tracks of the next job to hand out
+	volatile uint32_t nextJob;
+	char _pad1[AZA_CACHE_LINE_SIZE - sizeof(uint32_t)];
+	// How many jobs are finished
+	volatile uint32_t jobsDone;
+	// How many workers are blocked on progress
+	volatile uint32_t waiting;
+	char _pad2[AZA_CACHE_LINE_SIZE - sizeof(uint32_t)*2];
+} azaMixerWorkers;
+
+// Spin for a bit since the wait is usually short, then just yield. This never sleeps because the audio thread uses it too, and a sleep costs at least a millisecond.
+static void azaMixerWorkersBackoff(uint32_t spins) {
+	if (spins < 256) {
+		azaSpinPause();
+	} else {
+		azaThreadYield();
+	}
+}
+
+// Waits until jobsDone reaches count. Workers may have realtime priority, so if whoever we're waiting on shares our core, yielding alone may never let them run. For that reason, once they've spun and yielded for a while workers block until a job finishes. The audio thread never blocks.
+static void azaMixerWorkersWaitForJobs(azaMixerWorkers *workers, uint32_t count, bool mayBlock) {
+	for (uint32_t spins = 0; azaAtomicLoad32(&workers->jobsDone) < count; spins++) {
+		if (!mayBlock || spins < 320) {
+			azaMixerWorkersBackoff(spins);
+			continue;
+		}
+		// Whoever finishes a job checks waiting after bumping jobsDone, so either they see us here or we see their job done below.
+		azaAtomicFetchAdd32(&workers->waiting, 1);
+		while (azaAtomicLoad32(&workers->jobsDone) < count) {
+			azaSemaphoreWait(&workers->progress);
+		}
+		azaAtomicFetchAdd32(&workers->waiting, (uint32_t)-1);
+		break;
+	}
+}
+
+// Grabs jobs until there are none left. Jobs are handed out in order and every job only waits on jobs from lower levels, which were all handed out before it, so this can't deadlock.
+// mayBlock is false on the audio thread
+static void azaMixerWorkersRunJobs(azaMixerWorkers *workers, bool mayBlock) {
+	azaMixer *mixer = workers->mixer;
+	uint32_t jobCount = mixer->schedule.count;
+	while (true) {
+		uint32_t job = azaAtomicFetchAdd32(&workers->nextJob, 1);
+		if (job >= jobCount) break;
+		// Jobs on lower levels can finish in any order, but none of the jobs on this level or above can finish before all of them do, so once jobsDone gets here they're all done.
+		azaMixerWorkersWaitForJobs(workers, mixer->schedule.waitFor[job], mayBlock);
+		int err = azaTrackProcessReceived(workers->frames, workers->samplerate, mixer->schedule.tracks[job]);
+		if (err) {
+			uint32_t expected = AZA_SUCCESS;
+			azaAtomicCompareExchange32(&workers->err, &expected, (uint32_t)err);
+		}
+		// Even failed jobs count as done, otherwise anything waiting on them would wait forever
+		azaAtomicFetchAdd32(&workers->jobsDone, 1);
+		uint32_t waiting = azaAtomicLoad32(&workers->waiting);
+		if (waiting) {
+			// Extra posts only cause a spurious wakeup later, and the waiters check jobsDone again anyway
+			azaSemaphorePost(&workers->progress, waiting);
+		}
+	}
+}
+
+static AZA_THREAD_PROC_DEF(azaMixerWorkerProc, userdata) {
+	azaMixerWorkers *workers = userdata;
+	if (azaThreadSetRealtime()) {
+		AZA_LOG_INFO("azaMixer worker couldn't get realtime priority, continuing without it.\n");
+	}
+	// Our side buffers come from this thread's default scratch, which gets freed when we exit.
+	if (workers->mixer->config.scratchReserve) {
+		azaScratch *scratch = azaGetScratch();
+		if (!scratch || azaScratchReserve(scratch, workers->mixer->config.scratchReserve)) {
+			AZA_LOG_ERR("azaMixer worker failed to reserve %u bytes of scratch memory, continuing without it.\n", workers->mixer->config.scratchReserve);
+		}
+	}
+	while (true) {
+		azaSemaphoreWait(&workers->wake);
+		azaAtomicFetchAdd32(&workers->busy, 1);
+		uint32_t state = azaAtomicLoad32(&workers->state);
+		if (state == AZA_MIXER_WORKERS_RUNNING) {
+			azaMixerWorkersRunJobs(workers, true);
+		}
+		azaAtomicFetchAdd32(&workers->busy, (uint32_t)-1);
+		if (state == AZA_MIXER_WORKERS_QUIT) break;
+	}
+	return 0;
+}
+
+static void azaMixerWorkersDeinit(azaMixer *data) {
+	azaMixerWorkers *workers = data->workers;
+	if (!workers) return;
+	azaAtomicStore32(&workers->state, AZA_MIXER_WORKERS_QUIT);
+	azaSemaphorePost(&workers->wake, workers->threadCount);
+	for (uint32_t i = 0; i < workers->threadCount; i++) {
+		azaThreadJoin(&workers->threads[i]);
+	}
+	azaSemaphoreDeinit(&workers->wake);
+	azaSemaphoreDeinit(&workers->progress);
+	aza_free(workers->threads);
+	aza_free(workers);
+	data->workers = NULL;
+}
+
+static int azaMixerWorkersInit(azaMixer *data, uint32_t threadCount) {
+	azaMixerWorkers *workers = aza_calloc(1, sizeof(azaMixerWorkers));
+	if (!workers) return AZA_ERROR_OUT_OF_MEMORY;
+	workers->threads = aza_calloc(threadCount, sizeof(azaThread));
+	if (!workers->threads) {
+		aza_free(workers);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	workers->mixer = data;
+	azaSemaphoreInit(&workers->wake, 0);
+	azaSemaphoreInit(&workers->progress, 0);
+	data->workers = workers;
+	for (uint32_t i = 0; i < threadCount; i++) {
+		if (azaThreadLaunch(&workers->threads[i], azaMixerWorkerProc, workers)) {
+			AZA_LOG_ERR("azaMixerInit error: only managed to launch %u of %u worker threads.\n", i, threadCount);
+			break;
+		}
+		workers->threadCount++;
+	}
+	if (workers->threadCount == 0) {
+		// Everything happens on the calling thread anyway
+		azaMixerWorkersDeinit(data);
+	}
+	return AZA_SUCCESS;
+}
+
+static int azaMixerProcessThreaded(uint32_t frames, uint32_t samplerate, azaMixer *data) {
+	azaMixerWorkers *workers = data->workers;
+	workers->frames = frames;
+	workers->samplerate = samplerate;
+	azaAtomicStore32(&workers->err, AZA_SUCCESS);
+	azaAtomicStore32(&workers->jobsDone, 0);
+	azaAtomicStore32(&workers->nextJob, 0);
+	azaAtomicStore32(&workers->state, AZA_MIXER_WORKERS_RUNNING);
+	// No sense waking more workers than can ever be busy at once, and we're one of them.
+	azaSemaphorePost(&workers->wake, AZA_MIN(workers->threadCount, data->schedule.widest - 1));
+	azaMixerWorkersRunJobs(workers, false);
+	azaMixerWorkersWaitForJobs(workers, data->schedule.count, false);
+	// Any worker that wakes up from here on will see we're idle and go back to sleep, but the ones already awake might still be looking at nextJob.
+	azaAtomicStore32(&workers->state, AZA_MIXER_WORKERS_IDLE);
+	for (uint32_t spins = 0; azaAtomicLoad32(&workers->busy); spins++) {
+		azaMixerWorkersBackoff(spins);
 	}
+	return (int)azaAtomicLoad32(&workers->err);
+}
+
+
+
+typedef struct azaMixerCommand {
+	// If NULL, payload gets copied over target
+	fp_azaMixerCommandCallback callback;
+	// dst for a set, userdata for a callback
+	void *target;
+	uint32_t size;
+	char payload[AZA_MIXER_COMMAND_PAYLOAD_SIZE];
+} azaMixerCommand;
+
+// Single producer single consumer ring buffer. head and tail only ever count up, wrapping around at 2^32, and the ring's capacity is a power of 2 so that wrapping never breaks the indexing.
+typedef struct azaMixerCommandQueue {
+	azaMixerCommand *commands;
+	uint32_t mask;
+	char _pad0[AZA_CACHE_LINE_SIZE];
+	// Owned by the producer
+	volatile uint32_t tail;
+	// The last head the producer saw, so it only has to touch the consumer's cache line when the queue looks full
+	uint32_t headCache;
+	char _pad1[AZA_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+	// Owned by the consumer
+	volatile uint32_t head;
+	char _pad2[AZA_CACHE_LINE_SIZE - sizeof(uint32_t)];
+} azaMixerCommandQueue;
+
+static int azaMixerCommandsInit(azaMixer *data, uint32_t capacity) {
+	if (capacity == 0) capacity = AZA_MIXER_COMMAND_CAPACITY_DEFAULT;
+	uint32_t capacityPow2 = 1;
+	while (capacityPow2 < capacity) capacityPow2 <<= 1;
+	azaMixerCommandQueue *queue = aza_calloc(1, sizeof(azaMixerCommandQueue));
+	if (!queue) return AZA_ERROR_OUT_OF_MEMORY;
+	queue->commands = aza_malloc(sizeof(azaMixerCommand) * capacityPow2);
+	if (!queue->commands) {
+		aza_free(queue);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	queue->mask = capacityPow2 - 1;
+	data->commands = queue;
 	return AZA_SUCCESS;
 }
 
+static void azaMixerCommandsDeinit(azaMixer *data) {
+	if (!data->commands) return;
+	aza_free(data->commands->commands);
+	aza_free(data->commands);
+	data->commands = NULL;
+}
+
+static int azaMixerCommandPush(azaMixer *data, fp_azaMixerCommandCallback callback, void *target, const void *payload, uint32_t size) {
+	azaMixerCommandQueue *queue = data->commands;
+	if (size > AZA_MIXER_COMMAND_PAYLOAD_SIZE) {
+		AZA_LOG_ERR("azaMixerCommand error: size (%u) is more than AZA_MIXER_COMMAND_PAYLOAD_SIZE (%u)\n", size, (uint32_t)AZA_MIXER_COMMAND_PAYLOAD_SIZE);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	uint32_t tail = queue->tail;
+	if (tail - queue->headCache > queue->mask) {
+		queue->headCache = azaAtomicLoad32(&queue->head);
+		if (tail - queue->headCache > queue->mask) {
+			return AZA_ERROR_MIXER_COMMAND_QUEUE_FULL;
+		}
+	}
+	azaMixerCommand *command = &queue->commands[tail & queue->mask];
+	command->callback = callback;
+	command->target = target;
+	command->size = size;
+	if (size) {
+		memcpy(command->payload, payload, size);
+	}
+	// Publishes the command
+	azaAtomicStore32(&queue->tail, tail + 1);
+	return AZA_SUCCESS;
+}
+
+int azaMixerCommandSet(azaMixer *data, void *dst, const void *src, uint32_t size) {
+	return azaMixerCommandPush(data, NULL, dst, src, size);
+}
+
+int azaMixerCommandCallback(azaMixer *data, fp_azaMixerCommandCallback callback, void *userdata, const void *payload, uint32_t size) {
+	return azaMixerCommandPush(data, callback, userdata, payload, size);
+}
+
+// Only applies what was queued by the time we got here, so a producer that never stops can't hold up the block.
+static void azaMixerCommandsApply(azaMixer *data) {
+	azaMixerCommandQueue *queue = data->commands;
+	uint32_t head = queue->head;
+	uint32_t tail = azaAtomicLoad32(&queue->tail);
+	if (head == tail) return;
+	for (; head != tail; head++) {
+		azaMixerCommand *command = &queue->commands[head & queue->mask];
+		if (command->callback) {
+			command->callback(command->target, command->payload, command->size);
+		} else {
+			memcpy(command->target, command->payload, command->size);
+		}
+	}
+	// Hands all the slots back at once
+	azaAtomicStore32(&queue->head, head);
+}
+
+
+
+static int azaMixerScheduleReserve(azaMixer *data, uint32_t capacity) {
+	if (data->schedule.capacity >= capacity) return AZA_SUCCESS;
+	uint32_t newCapacity = (uint32_t)aza_grow(data->schedule.capacity, capacity, 16);
+	azaTrack **visited = aza_calloc(newCapacity, sizeof(azaTrack*));
+	azaTrack **tracks = aza_calloc(newCapacity, sizeof(azaTrack*));
+	uint32_t *waitFor = aza_calloc(newCapacity, sizeof(uint32_t));
+	uint32_t *levelStart = aza_calloc(newCapacity+1, sizeof(uint32_t));
+	if (!visited || !tracks || !waitFor || !levelStart) {
+		if (visited) aza_free(visited);
+		if (tracks) aza_free(tracks);
+		if (waitFor) aza_free(waitFor);
+		if (levelStart) aza_free(levelStart);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	if (data->schedule.visited) {
+		memcpy(visited, data->schedule.visited, sizeof(azaTrack*) * data->schedule.count);
+		aza_free(data->schedule.visited);
+		aza_free(data->schedule.tracks);
+		aza_free(data->schedule.waitFor);
+		aza_free(data->schedule.levelStart);
+	}
+	data->schedule.visited = visited;
+	data->schedule.tracks = tracks;
+	data->schedule.waitFor = waitFor;
+	data->schedule.levelStart = levelStart;
+	data->schedule.capacity = newCapacity;
+	return AZA_SUCCESS;
+}
+
+static void azaMixerScheduleDeinit(azaMixer *data) {
+	if (data->schedule.visited) {
+		aza_free(data->schedule.visited);
+		aza_free(data->schedule.tracks);
+		aza_free(data->schedule.waitFor);
+		aza_free(data->schedule.levelStart);
+	}
+	memset(&data->schedule, 0, sizeof(data->schedule));
+}
+
 int azaMixerInit(azaMixer *data, azaMixerConfig config, azaChannelLayout bufferChannelLayout) {
 	int err = AZA_SUCCESS;
 	data->config = config;
+	data->tracks = NULL;
+	data->workers = NULL;
+	data->commands = NULL;
+	memset(&data->schedule, 0, sizeof(data->schedule));
+	azaScratchInit(&data->scratch);
+	if (config.scratchReserve) {
+		err = azaScratchReserve(&data->scratch, config.scratchReserve);
+		if (err) return err;
+	}
 	if (config.trackCount) {
 		data->tracks = aza_calloc(config.trackCount, sizeof(azaTrack));
 		if (!data->tracks) return AZA_ERROR_OUT_OF_MEMORY;
 	}
-	err = azaTrackInit(&data->output, config.bufferFrames, bufferChannelLayout);
+	int (*trackInit)(azaTrack*, uint32_t, azaChannelLayout) = config.planar ? azaTrackInitPlanar : azaTrackInit;
+	err = trackInit(&data->output, config.bufferFrames, bufferChannelLayout);
 	if (err) return err;
 	for (uint32_t i = 0; i < config.trackCount; i++) {
-		err = azaTrackInit(&data->tracks[i], config.bufferFrames, bufferChannelLayout);
+		err = trackInit(&data->tracks[i], config.bufferFrames, bufferChannelLayout);
 		if (err) return err;
 		azaTrackConnect(&data->tracks[i], &data->output, 0.0f);
 	}
+	// Every one of our tracks plus output. Tracks from elsewhere connected to ours can still grow this later.
+	err = azaMixerScheduleReserve(data, config.trackCount + 1);
+	if (err) return err;
+	err = azaMixerCommandsInit(data, config.commandCapacity);
+	if (err) return err;
+	if (config.threadCount) {
+		err = azaMixerWorkersInit(data, config.threadCount);
+		if (err) return err;
+	}
 	return AZA_SUCCESS;
 }
 
 void azaMixerDeinit(azaMixer *data) {
+	azaMixerWorkersDeinit(data);
 	for (uint32_t i = 0; i < data->config.trackCount; i++) {
 		azaTrackDeinit(&data->tracks[i]);
 	}
+	if (data->tracks) {
+		aza_free(data->tracks);
+		data->tracks = NULL;
+	}
 	azaTrackDeinit(&data->output);
+	azaMixerScheduleDeinit(data);
+	azaMixerCommandsDeinit(data);
+	azaScratchDeinit(&data->scratch);
 }
 
-// Modified depth-first search for directed graphs to determine whether a cycle exists.
-static int azaMixerCheckRoutingVisit(azaTrack *track) {
+// Modified depth-first search for directed graphs to determine whether a cycle exists. Also works out each track's level and collects them in schedule.visited such that every track comes after the tracks it receives from.
+static int azaMixerCheckRoutingVisit(azaMixer *data, azaTrack *track) {
+	int err;
+	track->mark = 1;
+	track->level = 0;
 	for (uint32_t i = 0; i < track->receives.count; i++) {
 		azaTrack *recv = track->receives.data[i].track;
 		if (!recv) break;
-		if (recv->mark == 2) continue;
 		if (recv->mark == 1) return AZA_ERROR_MIXER_ROUTING_CYCLE;
-		recv->mark = 1;
-		if (azaMixerCheckRoutingVisit(recv)) return AZA_ERROR_MIXER_ROUTING_CYCLE;
-		recv->mark = 2;
+		if (recv->mark == 0) {
+			if ((err = azaMixerCheckRoutingVisit(data, recv))) return err;
+		}
+		track->level = AZA_MAX(track->level, recv->level + 1);
 	}
+	track->mark = 2;
+	if ((err = azaMixerScheduleReserve(data, data->schedule.count + 1))) return err;
+	data->schedule.visited[data->schedule.count++] = track;
 	return AZA_SUCCESS;
 }
 
 static int azaMixerCheckRouting(azaMixer *data) {
+	int err;
+	// Tracks that aren't ours but were connected last time still have their marks
+	for (uint32_t i = 0; i < data->schedule.count; i++) {
+		data->schedule.visited[i]->mark = 0;
+	}
 	for (uint32_t i = 0; i < data->config.trackCount; i++) {
 		data->tracks[i].mark = 0;
 	}
-	azaTrack *track = &data->output;
-	track->mark = 0;
-	return azaMixerCheckRoutingVisit(track);
+	data->output.mark = 0;
+	data->schedule.count = 0;
+	if ((err = azaMixerCheckRoutingVisit(data, &data->output))) return err;
+	// Counting sort by level. output is always the last one visited and has the highest level.
+	uint32_t levelCount = data->output.level + 1;
+	uint32_t *levelStart = data->schedule.levelStart;
+	memset(levelStart, 0, sizeof(uint32_t) * (levelCount + 1));
+	for (uint32_t i = 0; i < data->schedule.count; i++) {
+		levelStart[data->schedule.visited[i]->level + 1]++;
+	}
+	data->schedule.widest = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		data->schedule.widest = AZA_MAX(data->schedule.widest, levelStart[level + 1]);
+		levelStart[level + 1] += levelStart[level];
+	}
+	for (uint32_t i = 0; i < data->schedule.count; i++) {
+		azaTrack *track = data->schedule.visited[i];
+		data->schedule.tracks[levelStart[track->level]++] = track;
+	}
+	// levelStart[level] is now the end of each level, so a level starts where the one below it ends
+	for (uint32_t i = 0; i < data->schedule.count; i++) {
+		uint32_t level = data->schedule.tracks[i]->level;
+		data->schedule.waitFor[i] = level ? levelStart[level-1] : 0;
+	}
+	return AZA_SUCCESS;
 }
 
-int azaMixerProcess(uint32_t frames, uint32_t samplerate, azaMixer *data) {
+static int azaMixerProcessScheduled(uint32_t frames, uint32_t samplerate, azaMixer *data) {
 	int err;
-	if ((err = azaMixerCheckRouting(data))) return err;
-	if ((err = azaTrackProcess(frames, samplerate, &data->output))) return err;
+	azaMixerCommandsApply(data);
+	uint32_t routingVersion = azaAtomicLoad32(&azaRoutingVersion);
+	if (data->schedule.routingVersion != routingVersion) {
+		// If this fails we leave the version stale so we check again (and report the error again) next time
+		if ((err = azaMixerCheckRouting(data))) return err;
+		data->schedule.routingVersion = routingVersion;
+	}
+	if (data->workers) {
+		return azaMixerProcessThreaded(frames, samplerate, data);
+	}
+	for (uint32_t i = 0; i < data->schedule.count; i++) {
+		if ((err = azaTrackProcessReceived(frames, samplerate, data->schedule.tracks[i]))) return err;
+	}
 	return AZA_SUCCESS;
 }
 
+int azaMixerProcess(uint32_t frames, uint32_t samplerate, azaMixer *data) {
+	azaScratch *scratchPrev = azaSetScratch(&data->scratch);
+	int err = azaMixerProcessScheduled(frames, samplerate, data);
+	azaSetScratch(scratchPrev);
+	return err;
+}
+
 int azaMixerCallback(void *userdata, azaBuffer buffer) {
 	azaMixer *mixer = (azaMixer*)userdata;
+	if (azaBufferIsPlanar(mixer->output.buffer)) {
+		// Streams want interleaved buffers, so we mix into our own and convert at the end
+		if (buffer.frames > mixer->output.buffer.frames) return AZA_ERROR_INVALID_FRAME_COUNT;
+		int err = azaMixerProcess(buffer.frames, buffer.samplerate, mixer);
+		if (err) return err;
+		azaBufferCopy(buffer, azaBufferSlice(mixer->output.buffer, 0, buffer.frames));
+		return AZA_SUCCESS;
+	}
 	azaBuffer stash = mixer->output.buffer;
 	mixer->output.buffer = buffer;
 	int err = azaMixerProcess(buffer.frames, buffer.samplerate, mixer);
@@ -151,7 +630,13 @@ int azaMixerStreamOpen(azaMixer *data, azaMixerConfig config, azaStreamConfig st
 		return err;
 	}
 	config.bufferFrames = AZA_MAX(config.bufferFrames, azaStreamGetBufferFrameCount(&data->stream));
-	azaMixerInit(data, config, azaStreamGetChannelLayout(&data->stream));
+	azaChannelLayout channelLayout = azaStreamGetChannelLayout(&data->stream);
+	if ((err = azaMixerInit(data, config, channelLayout))) {
+		azaStreamDeinit(&data->stream);
+		return err;
+	}
+	// Spatializing onto this stream should find its speaker geometry ready instead of making it on the audio thread
+	azaGetSpeakerGeometry(channelLayout);
 	if (activate) {
 		azaStreamSetActive(&data->stream, true);
 	}
@@ -31,10 +31,19 @@ typedef struct azaTrack {
 	} receives;
 	// Used to determine whether routing is cyclic.
 	uint8_t mark;
+	// Length of the longest chain of receives feeding into us, where a track that receives nothing is level 0. Tracks on the same level don't depend on each other, so the mixer can process them in parallel.
+	uint32_t level;
+	// If ambisonic.order isn't 0, we're an ambisonic bus and our buffer holds a soundfield (see azaAmbisonicEncode). Tracks that receive from us decode it for their own layout, or add it to their own soundfield if they're ambisonic too.
+	azaAmbisonicConfig ambisonic;
 } azaTrack;
-// Initializes our buffer
+// Initializes our buffer, and clears the dsp chain and receives
 // May return any error azaBufferInit can return
 int azaTrackInit(azaTrack *data, uint32_t bufferFrames, azaChannelLayout bufferChannelLayout);
+// Same as azaTrackInit, but our buffer is planar (see azaBufferInitPlanar)
+int azaTrackInitPlanar(azaTrack *data, uint32_t bufferFrames, azaChannelLayout bufferChannelLayout);
+// Makes data an ambisonic bus, replacing our buffer with one of AZA_AMBISONIC_CHANNELS(config.order) channels with the same frames and planarity. Sources get in by way of DSP on our chain that calls azaAmbisonicEncode.
+// May return AZA_ERROR_INVALID_CONFIGURATION, or any error azaBufferInit can return
+int azaTrackSetAmbisonic(azaTrack *data, azaAmbisonicConfig config);
 void azaTrackDeinit(azaTrack *data);
 // Adds a dsp to the end of the dsp chain
 void azaTrackAppendDSP(azaTrack *data, azaDSP *dsp);
@@ -42,25 +51,73 @@ void azaTrackAppendDSP(azaTrack *data, azaDSP *dsp);
 void azaTrackPrependDSP(azaTrack *data, azaDSP *dsp);
 
 // Routes the output of from to the input of to and returns the connection
+// Any mixer will rebuild its schedule the next time it processes
+// NOTE: The returned pointer is only good until the next time to's receives change
 azaTrackRoute* azaTrackConnect(azaTrack *from, azaTrack *to, float gain);
 void azaTrackDisconnect(azaTrack *from, azaTrack *to);
 
+// Processes everything data receives from recursively, and then data itself.
+// NOTE: A track reachable through more than one route gets processed once per route, so this is only really suitable for simple trees. azaMixerProcess processes each track exactly once.
 int azaTrackProcess(uint32_t frames, uint32_t samplerate, azaTrack *data);
 
 typedef struct azaMixerConfig {
 	uint32_t trackCount;
 	uint32_t bufferFrames;
+	// How many worker threads help process tracks, on top of the thread that calls azaMixerProcess. Tracks on the same level get spread across all of them, and a bus only starts once everything it receives from is done.
+	// 0 means everything gets processed on the calling thread.
+	uint32_t threadCount;
+	// How many commands can be waiting for the next azaMixerProcess at once. Gets rounded up to a power of 2.
+	// 0 means AZA_MIXER_COMMAND_CAPACITY_DEFAULT
+	uint32_t commandCapacity;
+	// How many bytes of scratch memory (where side buffers come from) to set aside for each thread that processes tracks, so processing never has to allocate any. azaMixer.scratch.highWaterMark after a representative run is a good guide.
+	// 0 means scratch memory starts empty and grows during processing until it's big enough.
+	uint32_t scratchReserve;
+	// Whether track buffers are planar, which lets DSP work on each channel contiguously.
+	// azaMixerCallback interleaves the output for the stream, so that's the only place a conversion happens.
+	bool planar;
 } azaMixerConfig;
 
+#define AZA_MIXER_COMMAND_CAPACITY_DEFAULT 256
+// The most bytes one command can carry, chosen so a whole command fits in a 64 byte cache line
+#define AZA_MIXER_COMMAND_PAYLOAD_SIZE 44
+
+// payload points to a copy of what was passed to azaMixerCommandCallback, which is only good for the duration of the call.
+typedef void (*fp_azaMixerCommandCallback)(void *userdata, const void *payload, uint32_t size);
+
 typedef struct azaMixer {
 	azaMixerConfig config;
 	azaTrack *tracks;
 	azaTrack output;
 	// We may optionally own a stream to which we output the track contents of output.
 	azaStream stream;
+	// Every track reachable from output in the order they get processed. azaMixerProcess only rebuilds this when some track's receives have changed since the last time.
+	struct {
+		// In the order the routing check finished with them
+		azaTrack **visited;
+		// Sorted by level, such that every track comes after everything it receives from
+		azaTrack **tracks;
+		// For each track in tracks, how many tracks have to be done before it can start (everything on lower levels)
+		uint32_t *waitFor;
+		// Scratch space for sorting by level, has capacity+1 entries
+		uint32_t *levelStart;
+		uint32_t count;
+		uint32_t capacity;
+		// Most tracks on any one level, which is the most threads that can be busy at once
+		uint32_t widest;
+		// The routing version we were built for. 0 means we haven't been built.
+		uint32_t routingVersion;
+	} schedule;
+	// Only exists when config.threadCount > 0
+	struct azaMixerWorkers *workers;
+	// Changes queued up by another thread to be applied at the start of the next azaMixerProcess
+	struct azaMixerCommandQueue *commands;
+	// Side buffers for the thread that calls azaMixerProcess. Worker threads each use their own default.
+	azaScratch scratch;
 } azaMixer;
 
 // Allocates config.trackCount tracks and initializes them
+// Also allocates the command queue, and reserves config.scratchReserve bytes of scratch memory
+// If config.threadCount > 0, also launches that many worker threads
 // If config.isOutputRemote is zero, also initializes the inline output track
 // bufferFrames indicates how many frames our buffers should have. This should probably match the maximum size of the backend buffer.
 // bufferChannelLayout will be used to initialize buffer channel layouts
@@ -68,9 +125,23 @@ typedef struct azaMixer {
 int azaMixerInit(azaMixer *data, azaMixerConfig config, azaChannelLayout bufferChannelLayout);
 void azaMixerDeinit(azaMixer *data);
 // Processes all the tracks to produce a result into the output track.
+// First applies any queued commands, in the order they were queued.
+// Every track reachable from output is processed exactly once, after everything it receives from.
 // frames MUST be <= data->config.bufferFrames
 int azaMixerProcess(uint32_t frames, uint32_t samplerate, azaMixer *data);
 
+// Commands let one other thread (such as your game thread) change anything the mixer's DSP reads without a lock. They're applied on the thread that calls azaMixerProcess, before any processing happens, so a DSP never sees a change partway through a block.
+// The queue is wait-free for a single producer. If more than one thread wants to queue commands, they have to take turns on their own.
+// These may return AZA_ERROR_MIXER_COMMAND_QUEUE_FULL if the mixer hasn't caught up with the commands already queued, in which case nothing was queued and you can try again later.
+// May return AZA_ERROR_INVALID_CONFIGURATION if size > AZA_MIXER_COMMAND_PAYLOAD_SIZE
+
+// Queues a copy of size bytes from src to be written over dst
+// Ex: azaMixerCommandSet(&mixer, &filter->config.frequency, &frequency, sizeof(frequency));
+int azaMixerCommandSet(azaMixer *data, void *dst, const void *src, uint32_t size);
+
+// Queues a call to callback with a copy of size bytes from payload (payload may be NULL if size is 0)
+int azaMixerCommandCallback(azaMixer *data, fp_azaMixerCommandCallback callback, void *userdata, const void *payload, uint32_t size);
+
 // Builtin callback for processing the mixer on a stream
 int azaMixerCallback(void *userdata, azaBuffer buffer);
 
@@ -0,0 +1,1749 @@
+/*
+	File: simd.c
+	Author: Philip Haynes
+*/
+
+#include "simd.h"
+
+#include "AzAudio.h"
+#include "math.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if AZA_ARCH_X86
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+	#include <immintrin.h>
+#elif AZA_ARCH_ARM && defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define AZA_HAS_NEON 1
+#endif
+
+// MSVC lets you use any intrinsic anywhere, but GCC and Clang need to be told which functions are allowed to use what.
+#if defined(__GNUC__) || defined(__clang__)
+	#define AZA_TARGET_SSE2 __attribute__((target("sse2")))
+	#define AZA_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+	#define AZA_TARGET_SSE2
+	#define AZA_TARGET_AVX2
+#endif
+
+azaCPUFeatures azaCPU = {0};
+azaSIMDLevel azaSIMDLevelCurrent = AZA_SIMD_SCALAR;
+
+
+
+// Scalar kernels, which are also used to finish off any remainders
+
+
+
+static void azaSIMDMixScalar(float *dst, uint32_t dstStride, float volumeDst, const float *src, uint32_t srcStride, float volumeSrc, uint32_t frames, uint32_t channels) {
+	if (dstStride == channels && srcStride == channels) {
+		channels *= frames;
+		frames = 1;
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			dst[c] = dst[c] * volumeDst + src[c] * volumeSrc;
+		}
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+static void azaSIMDMixFadeScalar(float *dst, uint32_t dstStride, float volumeDstStart, float volumeDstStep, const float *src, uint32_t srcStride, float volumeSrcStart, float volumeSrcStep, uint32_t frames, uint32_t channels) {
+	for (uint32_t i = 0; i < frames; i++) {
+		float volumeDst = volumeDstStart + volumeDstStep * (float)i;
+		float volumeSrc = volumeSrcStart + volumeSrcStep * (float)i;
+		for (uint32_t c = 0; c < channels; c++) {
+			dst[c] = dst[c] * volumeDst + src[c] * volumeSrc;
+		}
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+static void azaSIMDCopyScalar(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	if (dstStride == channels && srcStride == channels) {
+		memcpy(dst, src, sizeof(float) * frames * channels);
+		return;
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			dst[c] = src[c];
+		}
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+static void azaSIMDZeroScalar(float *dst, uint32_t dstStride, uint32_t frames, uint32_t channels) {
+	if (dstStride == channels) {
+		memset(dst, 0, sizeof(float) * frames * channels);
+		return;
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			dst[c] = 0.0f;
+		}
+		dst += dstStride;
+	}
+}
+
+static float azaSIMDDotLerpScalar(const float *src, uint32_t srcStride, const float *coefficients0, const float *coefficients1, float t, uint32_t count) {
+	float sum0 = 0.0f, sum1 = 0.0f;
+	for (uint32_t i = 0; i < count; i++) {
+		float s = src[i * srcStride];
+		sum0 += s * coefficients0[i];
+		sum1 += s * coefficients1[i];
+	}
+	return sum0 + t * (sum1 - sum0);
+}
+
+static void azaSIMDButterflyScalar(float *a, float *b, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		float sum = a[i] + b[i];
+		float difference = a[i] - b[i];
+		a[i] = sum;
+		b[i] = difference;
+	}
+}
+
+static void azaSIMDInterleaveScalar(float *dst, uint32_t dstStride, const float *src, uint32_t srcChannelStride, uint32_t frames, uint32_t channels) {
+	for (uint32_t c = 0; c < channels; c++) {
+		const float *srcChannel = src + c * srcChannelStride;
+		for (uint32_t i = 0; i < frames; i++) {
+			dst[i * dstStride + c] = srcChannel[i];
+		}
+	}
+}
+
+static void azaSIMDDeinterleaveScalar(float *dst, uint32_t dstChannelStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	for (uint32_t c = 0; c < channels; c++) {
+		float *dstChannel = dst + c * dstChannelStride;
+		for (uint32_t i = 0; i < frames; i++) {
+			dstChannel[i] = src[i * srcStride + c];
+		}
+	}
+}
+
+typedef struct azaSVFSectionScalar {
+	azaSIMDSVFCoefficients k;
+	float s1, s2;
+} azaSVFSectionScalar;
+
+static inline float azaSVFTickScalar(azaSVFSectionScalar *section, float v) {
+	const azaSIMDSVFCoefficients *k = &section->k;
+	float out = k->c1 * section->s1 + k->c2 * section->s2 + k->d * v;
+	float next1 = k->a11 * section->s1 + k->a12 * section->s2 + k->b1 * v;
+	float next2 = k->a21 * section->s1 + k->a22 * section->s2 + k->b2 * v;
+	section->s1 = next1;
+	section->s2 = next2;
+	return out;
+}
+
+static void azaSIMDSVFScalar(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, uint32_t channels) {
+	for (uint32_t c = 0; c < channels; c++) {
+		float *channel = samples + c;
+		azaSVFSectionScalar first = { coefficients[0], ic1eq[c], ic2eq[c] };
+		if (sections == 2) {
+			azaSVFSectionScalar second = { coefficients[1], ic1eq[stateStride + c], ic2eq[stateStride + c] };
+			for (uint32_t i = 0; i < frames; i++) {
+				channel[i * stride] = azaSVFTickScalar(&second, azaSVFTickScalar(&first, channel[i * stride]));
+			}
+			ic1eq[stateStride + c] = second.s1;
+			ic2eq[stateStride + c] = second.s2;
+		} else {
+			for (uint32_t i = 0; i < frames; i++) {
+				channel[i * stride] = azaSVFTickScalar(&first, channel[i * stride]);
+			}
+		}
+		ic1eq[c] = first.s1;
+		ic2eq[c] = first.s2;
+	}
+}
+
+static void azaSIMDDbToAmpScalar(float *dst, const float *src, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		dst[i] = azaFastDbToAmpf(src[i]);
+	}
+}
+
+static void azaSIMDAmpToDbScalar(float *dst, const float *src, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		dst[i] = azaFastAmpToDbf(src[i]);
+	}
+}
+
+static void azaSIMDApplyGainScalar(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, const float *gain, float limit, uint32_t frames, uint32_t channels) {
+	for (uint32_t i = 0; i < frames; i++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			dst[c] = azaClampf(src[c] * gain[i], -limit, limit);
+		}
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+// Rounding can leave the sum a hair below zero once the window goes quiet, and sqrtf would make that a NaN
+static void azaSIMDRMSScalar(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, uint32_t channels) {
+	for (uint32_t i = 0; i < frames; i++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			float squared = azaSqr(src[c]);
+			sums[c] += squared - ring[c];
+			lapSums[c] += squared;
+			ring[c] = squared;
+			dst[c] = sqrtf(sums[c] > 0.0f ? sums[c] * scale : 0.0f);
+		}
+		dst += dstStride;
+		src += srcStride;
+		ring += ringStride;
+	}
+}
+
+
+
+#if AZA_ARCH_X86
+
+
+
+// SSE2
+
+
+
+AZA_TARGET_SSE2
+static inline void azaMixFrameSSE2(float *dst, const float *src, float volumeDst, float volumeSrc, uint32_t channels) {
+	__m128 vd = _mm_set1_ps(volumeDst);
+	__m128 vs = _mm_set1_ps(volumeSrc);
+	uint32_t c = 0;
+	for (; c+4 <= channels; c += 4) {
+		__m128 d = _mm_loadu_ps(dst + c);
+		__m128 s = _mm_loadu_ps(src + c);
+		_mm_storeu_ps(dst + c, _mm_add_ps(_mm_mul_ps(d, vd), _mm_mul_ps(s, vs)));
+	}
+	for (; c < channels; c++) {
+		dst[c] = dst[c] * volumeDst + src[c] * volumeSrc;
+	}
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDMixSSE2(float *dst, uint32_t dstStride, float volumeDst, const float *src, uint32_t srcStride, float volumeSrc, uint32_t frames, uint32_t channels) {
+	__m128 vd = _mm_set1_ps(volumeDst);
+	__m128 vs = _mm_set1_ps(volumeSrc);
+	uint32_t i = 0;
+	if (dstStride == channels && srcStride == channels) {
+		uint32_t count = frames * channels;
+		for (; i+4 <= count; i += 4) {
+			__m128 d = _mm_loadu_ps(dst + i);
+			__m128 s = _mm_loadu_ps(src + i);
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(d, vd), _mm_mul_ps(s, vs)));
+		}
+		for (; i < count; i++) {
+			dst[i] = dst[i] * volumeDst + src[i] * volumeSrc;
+		}
+	} else if (channels >= 4) {
+		for (; i < frames; i++) {
+			azaMixFrameSSE2(dst + i * dstStride, src + i * srcStride, volumeDst, volumeSrc, channels);
+		}
+	} else if (channels == 2) {
+		// Pack 2 frames into each vector
+		for (; i+2 <= frames; i += 2) {
+			float *d0 = dst + i * dstStride;
+			float *d1 = d0 + dstStride;
+			const float *s0 = src + i * srcStride;
+			const float *s1 = s0 + srcStride;
+			__m128 d = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)d0), (const __m64*)d1);
+			__m128 s = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)s0), (const __m64*)s1);
+			__m128 r = _mm_add_ps(_mm_mul_ps(d, vd), _mm_mul_ps(s, vs));
+			_mm_storel_pi((__m64*)d0, r);
+			_mm_storeh_pi((__m64*)d1, r);
+		}
+		azaSIMDMixScalar(dst + i * dstStride, dstStride, volumeDst, src + i * srcStride, srcStride, volumeSrc, frames - i, channels);
+	} else if (channels == 1) {
+		// Pack 4 frames into each vector
+		for (; i+4 <= frames; i += 4) {
+			float *d0 = dst + i * dstStride;
+			const float *s0 = src + i * srcStride;
+			__m128 d = _mm_setr_ps(d0[0], d0[dstStride], d0[2*dstStride], d0[3*dstStride]);
+			__m128 s = _mm_setr_ps(s0[0], s0[srcStride], s0[2*srcStride], s0[3*srcStride]);
+			float r[4];
+			_mm_storeu_ps(r, _mm_add_ps(_mm_mul_ps(d, vd), _mm_mul_ps(s, vs)));
+			d0[0] = r[0];
+			d0[dstStride] = r[1];
+			d0[2*dstStride] = r[2];
+			d0[3*dstStride] = r[3];
+		}
+		azaSIMDMixScalar(dst + i * dstStride, dstStride, volumeDst, src + i * srcStride, srcStride, volumeSrc, frames - i, channels);
+	} else {
+		azaSIMDMixScalar(dst, dstStride, volumeDst, src, srcStride, volumeSrc, frames, channels);
+	}
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDMixFadeSSE2(float *dst, uint32_t dstStride, float volumeDstStart, float volumeDstStep, const float *src, uint32_t srcStride, float volumeSrcStart, float volumeSrcStep, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (dstStride == channels && srcStride == channels && 4 % channels == 0) {
+		// Every vector holds a whole number of frames, so we can just walk the volumes along with them
+		__m128 laneFrame;
+		switch (channels) {
+			case 1: laneFrame = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); break;
+			case 2: laneFrame = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f); break;
+			default: laneFrame = _mm_setzero_ps(); break;
+		}
+		__m128 vdStart = _mm_set1_ps(volumeDstStart), vdStep = _mm_set1_ps(volumeDstStep);
+		__m128 vsStart = _mm_set1_ps(volumeSrcStart), vsStep = _mm_set1_ps(volumeSrcStep);
+		float framesPerVector = (float)(4 / channels);
+		float frame = 0.0f;
+		uint32_t count = frames * channels;
+		for (; i+4 <= count; i += 4, frame += framesPerVector) {
+			__m128 f = _mm_add_ps(_mm_set1_ps(frame), laneFrame);
+			__m128 vd = _mm_add_ps(vdStart, _mm_mul_ps(vdStep, f));
+			__m128 vs = _mm_add_ps(vsStart, _mm_mul_ps(vsStep, f));
+			__m128 d = _mm_loadu_ps(dst + i);
+			__m128 s = _mm_loadu_ps(src + i);
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(d, vd), _mm_mul_ps(s, vs)));
+		}
+		i /= channels;
+	} else if (channels >= 4) {
+		for (; i < frames; i++) {
+			azaMixFrameSSE2(dst + i * dstStride, src + i * srcStride, volumeDstStart + volumeDstStep * (float)i, volumeSrcStart + volumeSrcStep * (float)i, channels);
+		}
+	} else if (channels == 1) {
+		__m128 laneFrame = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		__m128 vdStart = _mm_set1_ps(volumeDstStart), vdStep = _mm_set1_ps(volumeDstStep);
+		__m128 vsStart = _mm_set1_ps(volumeSrcStart), vsStep = _mm_set1_ps(volumeSrcStep);
+		for (; i+4 <= frames; i += 4) {
+			float *d0 = dst + i * dstStride;
+			const float *s0 = src + i * srcStride;
+			__m128 f = _mm_add_ps(_mm_set1_ps((float)i), laneFrame);
+			__m128 vd = _mm_add_ps(vdStart, _mm_mul_ps(vdStep, f));
+			__m128 vs = _mm_add_ps(vsStart, _mm_mul_ps(vsStep, f));
+			__m128 d = _mm_setr_ps(d0[0], d0[dstStride], d0[2*dstStride], d0[3*dstStride]);
+			__m128 s = _mm_setr_ps(s0[0], s0[srcStride], s0[2*srcStride], s0[3*srcStride]);
+			float r[4];
+			_mm_storeu_ps(r, _mm_add_ps(_mm_mul_ps(d, vd), _mm_mul_ps(s, vs)));
+			d0[0] = r[0];
+			d0[dstStride] = r[1];
+			d0[2*dstStride] = r[2];
+			d0[3*dstStride] = r[3];
+		}
+	}
+	if (i < frames) {
+		azaSIMDMixFadeScalar(dst + i * dstStride, dstStride, volumeDstStart + volumeDstStep * (float)i, volumeDstStep, src + i * srcStride, srcStride, volumeSrcStart + volumeSrcStep * (float)i, volumeSrcStep, frames - i, channels);
+	}
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDCopySSE2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	if ((dstStride == channels && srcStride == channels) || channels < 4) {
+		azaSIMDCopyScalar(dst, dstStride, src, srcStride, frames, channels);
+		return;
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		uint32_t c = 0;
+		for (; c+4 <= channels; c += 4) {
+			_mm_storeu_ps(dst + c, _mm_loadu_ps(src + c));
+		}
+		for (; c < channels; c++) {
+			dst[c] = src[c];
+		}
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDZeroSSE2(float *dst, uint32_t dstStride, uint32_t frames, uint32_t channels) {
+	if (dstStride == channels || channels < 4) {
+		azaSIMDZeroScalar(dst, dstStride, frames, channels);
+		return;
+	}
+	__m128 zero = _mm_setzero_ps();
+	for (uint32_t i = 0; i < frames; i++) {
+		uint32_t c = 0;
+		for (; c+4 <= channels; c += 4) {
+			_mm_storeu_ps(dst + c, zero);
+		}
+		for (; c < channels; c++) {
+			dst[c] = 0.0f;
+		}
+		dst += dstStride;
+	}
+}
+
+AZA_TARGET_SSE2
+static inline float azaHorizontalSumSSE2(__m128 v) {
+	__m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuf);
+	shuf = _mm_movehl_ps(shuf, sums);
+	sums = _mm_add_ss(sums, shuf);
+	return _mm_cvtss_f32(sums);
+}
+
+AZA_TARGET_SSE2
+static float azaSIMDDotLerpSSE2(const float *src, uint32_t srcStride, const float *coefficients0, const float *coefficients1, float t, uint32_t count) {
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	uint32_t i = 0;
+	if (srcStride == 1) {
+		for (; i+4 <= count; i += 4) {
+			__m128 s = _mm_loadu_ps(src + i);
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(s, _mm_loadu_ps(coefficients0 + i)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(s, _mm_loadu_ps(coefficients1 + i)));
+		}
+	} else {
+		for (; i+4 <= count; i += 4) {
+			const float *p = src + i * srcStride;
+			__m128 s = _mm_setr_ps(p[0], p[srcStride], p[srcStride*2], p[srcStride*3]);
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(s, _mm_loadu_ps(coefficients0 + i)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(s, _mm_loadu_ps(coefficients1 + i)));
+		}
+	}
+	float result0 = azaHorizontalSumSSE2(sum0);
+	float result1 = azaHorizontalSumSSE2(sum1);
+	for (; i < count; i++) {
+		float s = src[i * srcStride];
+		result0 += s * coefficients0[i];
+		result1 += s * coefficients1[i];
+	}
+	return result0 + t * (result1 - result0);
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDButterflySSE2(float *a, float *b, uint32_t count) {
+	uint32_t i = 0;
+	for (; i+4 <= count; i += 4) {
+		__m128 va = _mm_loadu_ps(a + i);
+		__m128 vb = _mm_loadu_ps(b + i);
+		_mm_storeu_ps(a + i, _mm_add_ps(va, vb));
+		_mm_storeu_ps(b + i, _mm_sub_ps(va, vb));
+	}
+	azaSIMDButterflyScalar(a + i, b + i, count - i);
+}
+
+// Stereo and quad get shuffled 4 frames at a time. Anything else is rare enough to leave to the scalar version.
+AZA_TARGET_SSE2
+static void azaSIMDInterleaveSSE2(float *dst, uint32_t dstStride, const float *src, uint32_t srcChannelStride, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (channels == 2 && dstStride == 2) {
+		const float *src0 = src, *src1 = src + srcChannelStride;
+		for (; i+4 <= frames; i += 4) {
+			__m128 a = _mm_loadu_ps(src0 + i);
+			__m128 b = _mm_loadu_ps(src1 + i);
+			_mm_storeu_ps(dst + i*2 + 0, _mm_unpacklo_ps(a, b));
+			_mm_storeu_ps(dst + i*2 + 4, _mm_unpackhi_ps(a, b));
+		}
+	} else if (channels == 4 && dstStride == 4) {
+		for (; i+4 <= frames; i += 4) {
+			__m128 a = _mm_loadu_ps(src + 0*srcChannelStride + i);
+			__m128 b = _mm_loadu_ps(src + 1*srcChannelStride + i);
+			__m128 c = _mm_loadu_ps(src + 2*srcChannelStride + i);
+			__m128 d = _mm_loadu_ps(src + 3*srcChannelStride + i);
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			_mm_storeu_ps(dst + i*4 +  0, a);
+			_mm_storeu_ps(dst + i*4 +  4, b);
+			_mm_storeu_ps(dst + i*4 +  8, c);
+			_mm_storeu_ps(dst + i*4 + 12, d);
+		}
+	}
+	if (i < frames) {
+		azaSIMDInterleaveScalar(dst + i * dstStride, dstStride, src + i, srcChannelStride, frames - i, channels);
+	}
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDDeinterleaveSSE2(float *dst, uint32_t dstChannelStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (channels == 2 && srcStride == 2) {
+		float *dst0 = dst, *dst1 = dst + dstChannelStride;
+		for (; i+4 <= frames; i += 4) {
+			__m128 a = _mm_loadu_ps(src + i*2 + 0);
+			__m128 b = _mm_loadu_ps(src + i*2 + 4);
+			_mm_storeu_ps(dst0 + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(dst1 + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	} else if (channels == 4 && srcStride == 4) {
+		for (; i+4 <= frames; i += 4) {
+			__m128 a = _mm_loadu_ps(src + i*4 +  0);
+			__m128 b = _mm_loadu_ps(src + i*4 +  4);
+			__m128 c = _mm_loadu_ps(src + i*4 +  8);
+			__m128 d = _mm_loadu_ps(src + i*4 + 12);
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			_mm_storeu_ps(dst + 0*dstChannelStride + i, a);
+			_mm_storeu_ps(dst + 1*dstChannelStride + i, b);
+			_mm_storeu_ps(dst + 2*dstChannelStride + i, c);
+			_mm_storeu_ps(dst + 3*dstChannelStride + i, d);
+		}
+	}
+	if (i < frames) {
+		azaSIMDDeinterleaveScalar(dst + i, dstChannelStride, src + i * srcStride, srcStride, frames - i, channels);
+	}
+}
+
+// lanes is 4 or 2, where 2 only touches the low half of the register. It's meant to be a constant so each gets its own loop.
+AZA_TARGET_SSE2
+static inline __m128 azaLoadLanesSSE2(const float *src, const uint32_t lanes) {
+	return lanes == 4 ? _mm_loadu_ps(src) : _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)src);
+}
+
+AZA_TARGET_SSE2
+static inline void azaStoreLanesSSE2(float *dst, __m128 v, const uint32_t lanes) {
+	if (lanes == 4) {
+		_mm_storeu_ps(dst, v);
+	} else {
+		_mm_storel_pi((__m64*)dst, v);
+	}
+}
+
+typedef struct azaSVFSectionSSE2 {
+	__m128 a11, a12, a21, a22, b1, b2, c1, c2, d;
+	__m128 s1, s2;
+} azaSVFSectionSSE2;
+
+AZA_TARGET_SSE2
+static inline azaSVFSectionSSE2 azaSVFSectionLoadSSE2(const azaSIMDSVFCoefficients *k, const float *ic1eq, const float *ic2eq, const uint32_t lanes) {
+	azaSVFSectionSSE2 result;
+	result.a11 = _mm_set1_ps(k->a11);
+	result.a12 = _mm_set1_ps(k->a12);
+	result.a21 = _mm_set1_ps(k->a21);
+	result.a22 = _mm_set1_ps(k->a22);
+	result.b1 = _mm_set1_ps(k->b1);
+	result.b2 = _mm_set1_ps(k->b2);
+	result.c1 = _mm_set1_ps(k->c1);
+	result.c2 = _mm_set1_ps(k->c2);
+	result.d = _mm_set1_ps(k->d);
+	result.s1 = azaLoadLanesSSE2(ic1eq, lanes);
+	result.s2 = azaLoadLanesSSE2(ic2eq, lanes);
+	return result;
+}
+
+AZA_TARGET_SSE2
+static inline void azaSVFSectionStoreSSE2(const azaSVFSectionSSE2 *section, float *ic1eq, float *ic2eq, const uint32_t lanes) {
+	azaStoreLanesSSE2(ic1eq, section->s1, lanes);
+	azaStoreLanesSSE2(ic2eq, section->s2, lanes);
+}
+
+AZA_TARGET_SSE2
+static inline __m128 azaSVFTickSSE2(azaSVFSectionSSE2 *section, __m128 v) {
+	__m128 out = _mm_add_ps(_mm_add_ps(_mm_mul_ps(section->c1, section->s1), _mm_mul_ps(section->c2, section->s2)), _mm_mul_ps(section->d, v));
+	__m128 next1 = _mm_add_ps(_mm_mul_ps(section->a11, section->s1), _mm_add_ps(_mm_mul_ps(section->a12, section->s2), _mm_mul_ps(section->b1, v)));
+	__m128 next2 = _mm_add_ps(_mm_mul_ps(section->a22, section->s2), _mm_add_ps(_mm_mul_ps(section->a21, section->s1), _mm_mul_ps(section->b2, v)));
+	section->s1 = next1;
+	section->s2 = next2;
+	return out;
+}
+
+AZA_TARGET_SSE2
+static inline void azaSVFGroupSSE2(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, const uint32_t lanes) {
+	azaSVFSectionSSE2 first = azaSVFSectionLoadSSE2(&coefficients[0], ic1eq, ic2eq, lanes);
+	if (sections == 2) {
+		azaSVFSectionSSE2 second = azaSVFSectionLoadSSE2(&coefficients[1], ic1eq + stateStride, ic2eq + stateStride, lanes);
+		for (uint32_t i = 0; i < frames; i++) {
+			__m128 v = azaLoadLanesSSE2(samples, lanes);
+			azaStoreLanesSSE2(samples, azaSVFTickSSE2(&second, azaSVFTickSSE2(&first, v)), lanes);
+			samples += stride;
+		}
+		azaSVFSectionStoreSSE2(&second, ic1eq + stateStride, ic2eq + stateStride, lanes);
+	} else {
+		for (uint32_t i = 0; i < frames; i++) {
+			__m128 v = azaLoadLanesSSE2(samples, lanes);
+			azaStoreLanesSSE2(samples, azaSVFTickSSE2(&first, v), lanes);
+			samples += stride;
+		}
+	}
+	azaSVFSectionStoreSSE2(&first, ic1eq, ic2eq, lanes);
+}
+
+// Groups of 4 channels, then a pair, then whatever's left goes through the scalar version.
+AZA_TARGET_SSE2
+static void azaSIMDSVFSSE2(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, uint32_t channels) {
+	uint32_t c = 0;
+	for (; c+4 <= channels; c += 4) {
+		azaSVFGroupSSE2(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, 4);
+	}
+	if (c+2 <= channels) {
+		azaSVFGroupSSE2(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, 2);
+		c += 2;
+	}
+	if (c < channels) {
+		azaSIMDSVFScalar(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, channels - c);
+	}
+}
+
+// These mirror azaFastExp2f and azaFastLog2f in math.h step for step
+AZA_TARGET_SSE2
+static inline __m128 azaFastExp2SSE2(__m128 x) {
+	__m128 zero = _mm_cmpnge_ps(x, _mm_set1_ps(-126.0f));
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.0f));
+	__m128 magic = _mm_set1_ps(AZA_ROUND_MAGIC);
+	__m128 rounded = _mm_sub_ps(_mm_add_ps(x, magic), magic);
+	__m128 f = _mm_sub_ps(x, rounded);
+	__m128 p = _mm_add_ps(_mm_set1_ps(AZA_EXP2_C4), _mm_mul_ps(f, _mm_set1_ps(AZA_EXP2_C5)));
+	p = _mm_add_ps(_mm_set1_ps(AZA_EXP2_C3), _mm_mul_ps(f, p));
+	p = _mm_add_ps(_mm_set1_ps(AZA_EXP2_C2), _mm_mul_ps(f, p));
+	p = _mm_add_ps(_mm_set1_ps(AZA_EXP2_C1), _mm_mul_ps(f, p));
+	p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, p));
+	__m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(rounded), _mm_set1_epi32(127)), 23);
+	return _mm_andnot_ps(zero, _mm_mul_ps(p, _mm_castsi128_ps(exponent)));
+}
+
+AZA_TARGET_SSE2
+static inline __m128 azaFastLog2SSE2(__m128 x) {
+	// max returns the second operand for NaN, so those get clamped too
+	__m128i bits = _mm_castps_si128(_mm_max_ps(x, _mm_set1_ps(1.17549435e-38f)));
+	__m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(bits, _mm_set1_epi32(AZA_LOG2_MANTISSA_OFFSET)), 23), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_sub_epi32(bits, _mm_slli_epi32(exponent, 23)));
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_add_ps(_mm_set1_ps(AZA_LOG2_C5), _mm_mul_ps(t2, _mm_set1_ps(AZA_LOG2_C7)));
+	p = _mm_add_ps(_mm_set1_ps(AZA_LOG2_C3), _mm_mul_ps(t2, p));
+	p = _mm_add_ps(_mm_set1_ps(AZA_LOG2_C1), _mm_mul_ps(t2, p));
+	return _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(t, p));
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDDbToAmpSSE2(float *dst, const float *src, uint32_t count) {
+	__m128 scale = _mm_set1_ps(AZA_DB_TO_LOG2);
+	uint32_t i = 0;
+	for (; i+4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, azaFastExp2SSE2(_mm_mul_ps(_mm_loadu_ps(src + i), scale)));
+	}
+	azaSIMDDbToAmpScalar(dst + i, src + i, count - i);
+}
+
+AZA_TARGET_SSE2
+static void azaSIMDAmpToDbSSE2(float *dst, const float *src, uint32_t count) {
+	__m128 scale = _mm_set1_ps(AZA_LOG2_TO_DB);
+	uint32_t i = 0;
+	for (; i+4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(azaFastLog2SSE2(_mm_loadu_ps(src + i)), scale));
+	}
+	azaSIMDAmpToDbScalar(dst + i, src + i, count - i);
+}
+
+AZA_TARGET_SSE2
+static inline __m128 azaApplyGainSSE2(__m128 s, __m128 g, __m128 limit) {
+	__m128 v = _mm_mul_ps(s, g);
+	return _mm_min_ps(_mm_max_ps(v, _mm_sub_ps(_mm_setzero_ps(), limit)), limit);
+}
+
+// Mono and stereo spread frames across the vector with the gains lined up to match, and 4 or more channels broadcast one frame's gain at a time.
+AZA_TARGET_SSE2
+static void azaSIMDApplyGainSSE2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, const float *gain, float limit, uint32_t frames, uint32_t channels) {
+	__m128 vl = _mm_set1_ps(limit);
+	uint32_t i = 0;
+	if (channels == 1 && dstStride == 1 && srcStride == 1) {
+		for (; i+4 <= frames; i += 4) {
+			_mm_storeu_ps(dst + i, azaApplyGainSSE2(_mm_loadu_ps(src + i), _mm_loadu_ps(gain + i), vl));
+		}
+	} else if (channels == 2 && dstStride == 2 && srcStride == 2) {
+		for (; i+4 <= frames; i += 4) {
+			__m128 g = _mm_loadu_ps(gain + i);
+			_mm_storeu_ps(dst + i*2, azaApplyGainSSE2(_mm_loadu_ps(src + i*2), _mm_unpacklo_ps(g, g), vl));
+			_mm_storeu_ps(dst + i*2 + 4, azaApplyGainSSE2(_mm_loadu_ps(src + i*2 + 4), _mm_unpackhi_ps(g, g), vl));
+		}
+	} else if (channels >= 4) {
+		for (; i < frames; i++) {
+			__m128 g = _mm_set1_ps(gain[i]);
+			float *d = dst + i * dstStride;
+			const float *s = src + i * srcStride;
+			uint32_t c = 0;
+			for (; c+4 <= channels; c += 4) {
+				_mm_storeu_ps(d + c, azaApplyGainSSE2(_mm_loadu_ps(s + c), g, vl));
+			}
+			for (; c < channels; c++) {
+				d[c] = azaClampf(s[c] * gain[i], -limit, limit);
+			}
+		}
+	}
+	azaSIMDApplyGainScalar(dst + i * dstStride, dstStride, src + i * srcStride, srcStride, gain + i, limit, frames - i, channels);
+}
+
+AZA_TARGET_SSE2
+static inline __m128 azaRMSOutSSE2(__m128 sum, __m128 scale) {
+	return _mm_sqrt_ps(_mm_mul_ps(_mm_max_ps(sum, _mm_setzero_ps()), scale));
+}
+
+AZA_TARGET_SSE2
+static inline void azaRMSGroupSSE2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, const uint32_t lanes) {
+	__m128 vscale = _mm_set1_ps(scale);
+	__m128 sum = azaLoadLanesSSE2(sums, lanes);
+	__m128 lapSum = azaLoadLanesSSE2(lapSums, lanes);
+	for (uint32_t i = 0; i < frames; i++) {
+		__m128 v = azaLoadLanesSSE2(src + i * srcStride, lanes);
+		__m128 squared = _mm_mul_ps(v, v);
+		sum = _mm_add_ps(sum, _mm_sub_ps(squared, azaLoadLanesSSE2(ring + i * ringStride, lanes)));
+		lapSum = _mm_add_ps(lapSum, squared);
+		azaStoreLanesSSE2(ring + i * ringStride, squared, lanes);
+		azaStoreLanesSSE2(dst + i * dstStride, azaRMSOutSSE2(sum, vscale), lanes);
+	}
+	azaStoreLanesSSE2(sums, sum, lanes);
+	azaStoreLanesSSE2(lapSums, lapSum, lanes);
+}
+
+// One contiguous channel, where 4 frames of differences get a prefix sum in the register before being added to the running sum
+AZA_TARGET_SSE2
+static void azaRMSMonoSSE2(float *dst, const float *src, float *ring, float *sums, float *lapSums, float scale, uint32_t frames) {
+	__m128 vscale = _mm_set1_ps(scale);
+	__m128 sum = _mm_set1_ps(*sums);
+	// Kept in 4 lanes until the end
+	__m128 lapSum = _mm_setzero_ps();
+	uint32_t i = 0;
+	for (; i+4 <= frames; i += 4) {
+		__m128 v = _mm_loadu_ps(src + i);
+		__m128 squared = _mm_mul_ps(v, v);
+		lapSum = _mm_add_ps(lapSum, squared);
+		__m128 delta = _mm_sub_ps(squared, _mm_loadu_ps(ring + i));
+		_mm_storeu_ps(ring + i, squared);
+		delta = _mm_add_ps(delta, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(delta), 4)));
+		delta = _mm_add_ps(delta, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(delta), 8)));
+		__m128 result = _mm_add_ps(sum, delta);
+		_mm_storeu_ps(dst + i, azaRMSOutSSE2(result, vscale));
+		sum = _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	*sums = _mm_cvtss_f32(sum);
+	*lapSums += azaHorizontalSumSSE2(lapSum);
+	azaSIMDRMSScalar(dst + i, 1, src + i, 1, ring + i, 1, sums, lapSums, scale, frames - i, 1);
+}
+
+// Groups of 4 channels, then a pair, then whatever's left goes through the scalar version.
+AZA_TARGET_SSE2
+static void azaSIMDRMSSSE2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, uint32_t channels) {
+	if (channels == 1 && dstStride == 1 && srcStride == 1 && ringStride == 1) {
+		azaRMSMonoSSE2(dst, src, ring, sums, lapSums, scale, frames);
+		return;
+	}
+	uint32_t c = 0;
+	for (; c+4 <= channels; c += 4) {
+		azaRMSGroupSSE2(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, 4);
+	}
+	if (c+2 <= channels) {
+		azaRMSGroupSSE2(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, 2);
+		c += 2;
+	}
+	if (c < channels) {
+		azaSIMDRMSScalar(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, channels - c);
+	}
+}
+
+
+
+// AVX2 + FMA
+
+// GCC does not reliably emit vzeroupper when a target("avx2") kernel tail-calls into an SSE2 kernel, and dirty upper halves make every later legacy SSE instruction (libm included) pay a state transition. Kernels that fall through to a narrower kernel clear them explicitly.
+
+
+
+AZA_TARGET_AVX2
+static inline void azaMixFrameAVX2(float *dst, const float *src, float volumeDst, float volumeSrc, uint32_t channels) {
+	__m256 vd = _mm256_set1_ps(volumeDst);
+	__m256 vs = _mm256_set1_ps(volumeSrc);
+	uint32_t c = 0;
+	for (; c+8 <= channels; c += 8) {
+		__m256 d = _mm256_loadu_ps(dst + c);
+		__m256 s = _mm256_loadu_ps(src + c);
+		_mm256_storeu_ps(dst + c, _mm256_fmadd_ps(d, vd, _mm256_mul_ps(s, vs)));
+	}
+	for (; c < channels; c++) {
+		dst[c] = dst[c] * volumeDst + src[c] * volumeSrc;
+	}
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDMixAVX2(float *dst, uint32_t dstStride, float volumeDst, const float *src, uint32_t srcStride, float volumeSrc, uint32_t frames, uint32_t channels) {
+	__m256 vd = _mm256_set1_ps(volumeDst);
+	__m256 vs = _mm256_set1_ps(volumeSrc);
+	uint32_t i = 0;
+	if (dstStride == channels && srcStride == channels) {
+		uint32_t count = frames * channels;
+		for (; i+16 <= count; i += 16) {
+			__m256 d0 = _mm256_loadu_ps(dst + i);
+			__m256 d1 = _mm256_loadu_ps(dst + i + 8);
+			__m256 s0 = _mm256_loadu_ps(src + i);
+			__m256 s1 = _mm256_loadu_ps(src + i + 8);
+			_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(d0, vd, _mm256_mul_ps(s0, vs)));
+			_mm256_storeu_ps(dst + i + 8, _mm256_fmadd_ps(d1, vd, _mm256_mul_ps(s1, vs)));
+		}
+		for (; i+8 <= count; i += 8) {
+			__m256 d = _mm256_loadu_ps(dst + i);
+			__m256 s = _mm256_loadu_ps(src + i);
+			_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(d, vd, _mm256_mul_ps(s, vs)));
+		}
+		for (; i < count; i++) {
+			dst[i] = dst[i] * volumeDst + src[i] * volumeSrc;
+		}
+	} else if (channels >= 8) {
+		for (; i < frames; i++) {
+			azaMixFrameAVX2(dst + i * dstStride, src + i * srcStride, volumeDst, volumeSrc, channels);
+		}
+	} else if (channels == 1 && dstStride <= INT32_MAX / 8 && srcStride <= INT32_MAX / 8) {
+		// Gather 8 frames into each vector
+		__m256i dstIndex = _mm256_mullo_epi32(_mm256_set1_epi32((int)dstStride), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i srcIndex = _mm256_mullo_epi32(_mm256_set1_epi32((int)srcStride), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		for (; i+8 <= frames; i += 8) {
+			float *d0 = dst + i * dstStride;
+			const float *s0 = src + i * srcStride;
+			__m256 d = _mm256_i32gather_ps(d0, dstIndex, 4);
+			__m256 s = _mm256_i32gather_ps(s0, srcIndex, 4);
+			float r[8];
+			_mm256_storeu_ps(r, _mm256_fmadd_ps(d, vd, _mm256_mul_ps(s, vs)));
+			for (uint32_t j = 0; j < 8; j++) {
+				d0[j * dstStride] = r[j];
+			}
+		}
+		_mm256_zeroupper();
+		azaSIMDMixScalar(dst + i * dstStride, dstStride, volumeDst, src + i * srcStride, srcStride, volumeSrc, frames - i, channels);
+	} else {
+		_mm256_zeroupper();
+		azaSIMDMixSSE2(dst, dstStride, volumeDst, src, srcStride, volumeSrc, frames, channels);
+	}
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDMixFadeAVX2(float *dst, uint32_t dstStride, float volumeDstStart, float volumeDstStep, const float *src, uint32_t srcStride, float volumeSrcStart, float volumeSrcStep, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (dstStride == channels && srcStride == channels && 8 % channels == 0) {
+		__m256 laneFrame;
+		switch (channels) {
+			case 1: laneFrame = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); break;
+			case 2: laneFrame = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f); break;
+			case 4: laneFrame = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f); break;
+			default: laneFrame = _mm256_setzero_ps(); break;
+		}
+		__m256 vdStart = _mm256_set1_ps(volumeDstStart), vdStep = _mm256_set1_ps(volumeDstStep);
+		__m256 vsStart = _mm256_set1_ps(volumeSrcStart), vsStep = _mm256_set1_ps(volumeSrcStep);
+		float framesPerVector = (float)(8 / channels);
+		float frame = 0.0f;
+		uint32_t count = frames * channels;
+		for (; i+8 <= count; i += 8, frame += framesPerVector) {
+			__m256 f = _mm256_add_ps(_mm256_set1_ps(frame), laneFrame);
+			__m256 vd = _mm256_fmadd_ps(vdStep, f, vdStart);
+			__m256 vs = _mm256_fmadd_ps(vsStep, f, vsStart);
+			__m256 d = _mm256_loadu_ps(dst + i);
+			__m256 s = _mm256_loadu_ps(src + i);
+			_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(d, vd, _mm256_mul_ps(s, vs)));
+		}
+		i /= channels;
+	} else if (channels >= 8) {
+		for (; i < frames; i++) {
+			azaMixFrameAVX2(dst + i * dstStride, src + i * srcStride, volumeDstStart + volumeDstStep * (float)i, volumeSrcStart + volumeSrcStep * (float)i, channels);
+		}
+	} else {
+		_mm256_zeroupper();
+		azaSIMDMixFadeSSE2(dst, dstStride, volumeDstStart, volumeDstStep, src, srcStride, volumeSrcStart, volumeSrcStep, frames, channels);
+		return;
+	}
+	if (i < frames) {
+		_mm256_zeroupper();
+		azaSIMDMixFadeScalar(dst + i * dstStride, dstStride, volumeDstStart + volumeDstStep * (float)i, volumeDstStep, src + i * srcStride, srcStride, volumeSrcStart + volumeSrcStep * (float)i, volumeSrcStep, frames - i, channels);
+	}
+}
+
+AZA_TARGET_AVX2
+static float azaSIMDDotLerpAVX2(const float *src, uint32_t srcStride, const float *coefficients0, const float *coefficients1, float t, uint32_t count) {
+	__m256 sum0 = _mm256_setzero_ps();
+	__m256 sum1 = _mm256_setzero_ps();
+	uint32_t i = 0;
+	if (srcStride == 1) {
+		for (; i+8 <= count; i += 8) {
+			__m256 s = _mm256_loadu_ps(src + i);
+			sum0 = _mm256_fmadd_ps(s, _mm256_loadu_ps(coefficients0 + i), sum0);
+			sum1 = _mm256_fmadd_ps(s, _mm256_loadu_ps(coefficients1 + i), sum1);
+		}
+	} else {
+		__m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)srcStride));
+		for (; i+8 <= count; i += 8) {
+			__m256 s = _mm256_i32gather_ps(src + i * srcStride, offsets, 4);
+			sum0 = _mm256_fmadd_ps(s, _mm256_loadu_ps(coefficients0 + i), sum0);
+			sum1 = _mm256_fmadd_ps(s, _mm256_loadu_ps(coefficients1 + i), sum1);
+		}
+	}
+	__m128 half0 = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+	__m128 half1 = _mm_add_ps(_mm256_castps256_ps128(sum1), _mm256_extractf128_ps(sum1, 1));
+	float result0 = azaHorizontalSumSSE2(half0);
+	float result1 = azaHorizontalSumSSE2(half1);
+	for (; i < count; i++) {
+		float s = src[i * srcStride];
+		result0 += s * coefficients0[i];
+		result1 += s * coefficients1[i];
+	}
+	return result0 + t * (result1 - result0);
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDButterflyAVX2(float *a, float *b, uint32_t count) {
+	uint32_t i = 0;
+	for (; i+8 <= count; i += 8) {
+		__m256 va = _mm256_loadu_ps(a + i);
+		__m256 vb = _mm256_loadu_ps(b + i);
+		_mm256_storeu_ps(a + i, _mm256_add_ps(va, vb));
+		_mm256_storeu_ps(b + i, _mm256_sub_ps(va, vb));
+	}
+	_mm256_zeroupper();
+	azaSIMDButterflySSE2(a + i, b + i, count - i);
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDInterleaveAVX2(float *dst, uint32_t dstStride, const float *src, uint32_t srcChannelStride, uint32_t frames, uint32_t channels) {
+	if (channels != 2 || dstStride != 2) {
+		azaSIMDInterleaveSSE2(dst, dstStride, src, srcChannelStride, frames, channels);
+		return;
+	}
+	const float *src0 = src, *src1 = src + srcChannelStride;
+	uint32_t i = 0;
+	for (; i+8 <= frames; i += 8) {
+		__m256 a = _mm256_loadu_ps(src0 + i);
+		__m256 b = _mm256_loadu_ps(src1 + i);
+		// unpack works within 128-bit lanes, so the halves come out in the wrong order
+		__m256 lo = _mm256_unpacklo_ps(a, b);
+		__m256 hi = _mm256_unpackhi_ps(a, b);
+		_mm256_storeu_ps(dst + i*2 + 0, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(dst + i*2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+	_mm256_zeroupper();
+	if (i < frames) {
+		azaSIMDInterleaveSSE2(dst + i*2, 2, src + i, srcChannelStride, frames - i, 2);
+	}
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDDeinterleaveAVX2(float *dst, uint32_t dstChannelStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	if (channels != 2 || srcStride != 2) {
+		azaSIMDDeinterleaveSSE2(dst, dstChannelStride, src, srcStride, frames, channels);
+		return;
+	}
+	float *dst0 = dst, *dst1 = dst + dstChannelStride;
+	uint32_t i = 0;
+	for (; i+8 <= frames; i += 8) {
+		__m256 a = _mm256_loadu_ps(src + i*2 + 0);
+		__m256 b = _mm256_loadu_ps(src + i*2 + 8);
+		__m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+		__m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+		_mm256_storeu_ps(dst0 + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm256_storeu_ps(dst1 + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	_mm256_zeroupper();
+	if (i < frames) {
+		azaSIMDDeinterleaveSSE2(dst + i, dstChannelStride, src + i*2, 2, frames - i, 2);
+	}
+}
+
+typedef struct azaSVFSectionAVX2 {
+	__m256 a11, a12, a21, a22, b1, b2, c1, c2, d;
+	__m256 s1, s2;
+} azaSVFSectionAVX2;
+
+AZA_TARGET_AVX2
+static inline azaSVFSectionAVX2 azaSVFSectionLoadAVX2(const azaSIMDSVFCoefficients *k, const float *ic1eq, const float *ic2eq) {
+	azaSVFSectionAVX2 result;
+	result.a11 = _mm256_set1_ps(k->a11);
+	result.a12 = _mm256_set1_ps(k->a12);
+	result.a21 = _mm256_set1_ps(k->a21);
+	result.a22 = _mm256_set1_ps(k->a22);
+	result.b1 = _mm256_set1_ps(k->b1);
+	result.b2 = _mm256_set1_ps(k->b2);
+	result.c1 = _mm256_set1_ps(k->c1);
+	result.c2 = _mm256_set1_ps(k->c2);
+	result.d = _mm256_set1_ps(k->d);
+	result.s1 = _mm256_loadu_ps(ic1eq);
+	result.s2 = _mm256_loadu_ps(ic2eq);
+	return result;
+}
+
+AZA_TARGET_AVX2
+static inline void azaSVFSectionStoreAVX2(const azaSVFSectionAVX2 *section, float *ic1eq, float *ic2eq) {
+	_mm256_storeu_ps(ic1eq, section->s1);
+	_mm256_storeu_ps(ic2eq, section->s2);
+}
+
+AZA_TARGET_AVX2
+static inline __m256 azaSVFTickAVX2(azaSVFSectionAVX2 *section, __m256 v) {
+	__m256 out = _mm256_fmadd_ps(section->c1, section->s1, _mm256_fmadd_ps(section->c2, section->s2, _mm256_mul_ps(section->d, v)));
+	__m256 next1 = _mm256_fmadd_ps(section->a11, section->s1, _mm256_fmadd_ps(section->a12, section->s2, _mm256_mul_ps(section->b1, v)));
+	__m256 next2 = _mm256_fmadd_ps(section->a22, section->s2, _mm256_fmadd_ps(section->a21, section->s1, _mm256_mul_ps(section->b2, v)));
+	section->s1 = next1;
+	section->s2 = next2;
+	return out;
+}
+
+AZA_TARGET_AVX2
+static inline void azaSVFGroupAVX2(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames) {
+	azaSVFSectionAVX2 first = azaSVFSectionLoadAVX2(&coefficients[0], ic1eq, ic2eq);
+	if (sections == 2) {
+		azaSVFSectionAVX2 second = azaSVFSectionLoadAVX2(&coefficients[1], ic1eq + stateStride, ic2eq + stateStride);
+		for (uint32_t i = 0; i < frames; i++) {
+			__m256 v = _mm256_loadu_ps(samples);
+			_mm256_storeu_ps(samples, azaSVFTickAVX2(&second, azaSVFTickAVX2(&first, v)));
+			samples += stride;
+		}
+		azaSVFSectionStoreAVX2(&second, ic1eq + stateStride, ic2eq + stateStride);
+	} else {
+		for (uint32_t i = 0; i < frames; i++) {
+			__m256 v = _mm256_loadu_ps(samples);
+			_mm256_storeu_ps(samples, azaSVFTickAVX2(&first, v));
+			samples += stride;
+		}
+	}
+	azaSVFSectionStoreAVX2(&first, ic1eq, ic2eq);
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDSVFAVX2(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, uint32_t channels) {
+	uint32_t c = 0;
+	for (; c+8 <= channels; c += 8) {
+		azaSVFGroupAVX2(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames);
+	}
+	_mm256_zeroupper();
+	if (c < channels) {
+		azaSIMDSVFSSE2(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, channels - c);
+	}
+}
+
+AZA_TARGET_AVX2
+static inline __m256 azaFastExp2AVX2(__m256 x) {
+	__m256 zero = _mm256_cmp_ps(x, _mm256_set1_ps(-126.0f), _CMP_NGE_UQ);
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+	__m256 magic = _mm256_set1_ps(AZA_ROUND_MAGIC);
+	__m256 rounded = _mm256_sub_ps(_mm256_add_ps(x, magic), magic);
+	__m256 f = _mm256_sub_ps(x, rounded);
+	__m256 p = _mm256_fmadd_ps(f, _mm256_set1_ps(AZA_EXP2_C5), _mm256_set1_ps(AZA_EXP2_C4));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(AZA_EXP2_C3));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(AZA_EXP2_C2));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(AZA_EXP2_C1));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(1.0f));
+	__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(rounded), _mm256_set1_epi32(127)), 23);
+	return _mm256_andnot_ps(zero, _mm256_mul_ps(p, _mm256_castsi256_ps(exponent)));
+}
+
+AZA_TARGET_AVX2
+static inline __m256 azaFastLog2AVX2(__m256 x) {
+	__m256i bits = _mm256_castps_si256(_mm256_max_ps(x, _mm256_set1_ps(1.17549435e-38f)));
+	__m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(AZA_LOG2_MANTISSA_OFFSET)), 23), _mm256_set1_epi32(127));
+	__m256 m = _mm256_castsi256_ps(_mm256_sub_epi32(bits, _mm256_slli_epi32(exponent, 23)));
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+	__m256 t2 = _mm256_mul_ps(t, t);
+	__m256 p = _mm256_fmadd_ps(t2, _mm256_set1_ps(AZA_LOG2_C7), _mm256_set1_ps(AZA_LOG2_C5));
+	p = _mm256_fmadd_ps(t2, p, _mm256_set1_ps(AZA_LOG2_C3));
+	p = _mm256_fmadd_ps(t2, p, _mm256_set1_ps(AZA_LOG2_C1));
+	return _mm256_fmadd_ps(t, p, _mm256_cvtepi32_ps(exponent));
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDDbToAmpAVX2(float *dst, const float *src, uint32_t count) {
+	__m256 scale = _mm256_set1_ps(AZA_DB_TO_LOG2);
+	uint32_t i = 0;
+	for (; i+8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, azaFastExp2AVX2(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale)));
+	}
+	_mm256_zeroupper();
+	azaSIMDDbToAmpSSE2(dst + i, src + i, count - i);
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDAmpToDbAVX2(float *dst, const float *src, uint32_t count) {
+	__m256 scale = _mm256_set1_ps(AZA_LOG2_TO_DB);
+	uint32_t i = 0;
+	for (; i+8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(azaFastLog2AVX2(_mm256_loadu_ps(src + i)), scale));
+	}
+	_mm256_zeroupper();
+	azaSIMDAmpToDbSSE2(dst + i, src + i, count - i);
+}
+
+AZA_TARGET_AVX2
+static inline __m256 azaApplyGainAVX2(__m256 s, __m256 g, __m256 limit) {
+	__m256 v = _mm256_mul_ps(s, g);
+	return _mm256_min_ps(_mm256_max_ps(v, _mm256_sub_ps(_mm256_setzero_ps(), limit)), limit);
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDApplyGainAVX2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, const float *gain, float limit, uint32_t frames, uint32_t channels) {
+	__m256 vl = _mm256_set1_ps(limit);
+	uint32_t i = 0;
+	if (channels == 1 && dstStride == 1 && srcStride == 1) {
+		for (; i+8 <= frames; i += 8) {
+			_mm256_storeu_ps(dst + i, azaApplyGainAVX2(_mm256_loadu_ps(src + i), _mm256_loadu_ps(gain + i), vl));
+		}
+	} else if (channels == 2 && dstStride == 2 && srcStride == 2) {
+		__m256i lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+		__m256i hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+		for (; i+8 <= frames; i += 8) {
+			__m256 g = _mm256_loadu_ps(gain + i);
+			_mm256_storeu_ps(dst + i*2, azaApplyGainAVX2(_mm256_loadu_ps(src + i*2), _mm256_permutevar8x32_ps(g, lo), vl));
+			_mm256_storeu_ps(dst + i*2 + 8, azaApplyGainAVX2(_mm256_loadu_ps(src + i*2 + 8), _mm256_permutevar8x32_ps(g, hi), vl));
+		}
+	} else if (channels >= 8) {
+		for (; i < frames; i++) {
+			__m256 g = _mm256_set1_ps(gain[i]);
+			float *d = dst + i * dstStride;
+			const float *s = src + i * srcStride;
+			uint32_t c = 0;
+			for (; c+8 <= channels; c += 8) {
+				_mm256_storeu_ps(d + c, azaApplyGainAVX2(_mm256_loadu_ps(s + c), g, vl));
+			}
+			for (; c < channels; c++) {
+				d[c] = azaClampf(s[c] * gain[i], -limit, limit);
+			}
+		}
+	}
+	_mm256_zeroupper();
+	azaSIMDApplyGainSSE2(dst + i * dstStride, dstStride, src + i * srcStride, srcStride, gain + i, limit, frames - i, channels);
+}
+
+AZA_TARGET_AVX2
+static inline void azaRMSGroupAVX2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames) {
+	__m256 vscale = _mm256_set1_ps(scale);
+	__m256 sum = _mm256_loadu_ps(sums);
+	__m256 lapSum = _mm256_loadu_ps(lapSums);
+	for (uint32_t i = 0; i < frames; i++) {
+		__m256 v = _mm256_loadu_ps(src + i * srcStride);
+		__m256 squared = _mm256_mul_ps(v, v);
+		sum = _mm256_add_ps(sum, _mm256_sub_ps(squared, _mm256_loadu_ps(ring + i * ringStride)));
+		lapSum = _mm256_add_ps(lapSum, squared);
+		_mm256_storeu_ps(ring + i * ringStride, squared);
+		_mm256_storeu_ps(dst + i * dstStride, _mm256_sqrt_ps(_mm256_mul_ps(_mm256_max_ps(sum, _mm256_setzero_ps()), vscale)));
+	}
+	_mm256_storeu_ps(sums, sum);
+	_mm256_storeu_ps(lapSums, lapSum);
+}
+
+AZA_TARGET_AVX2
+static void azaSIMDRMSAVX2(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, uint32_t channels) {
+	uint32_t c = 0;
+	for (; c+8 <= channels; c += 8) {
+		azaRMSGroupAVX2(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames);
+	}
+	_mm256_zeroupper();
+	if (c < channels) {
+		azaSIMDRMSSSE2(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, channels - c);
+	}
+}
+
+#endif // AZA_ARCH_X86
+
+
+
+#if AZA_HAS_NEON
+
+
+
+static inline void azaMixFrameNEON(float *dst, const float *src, float volumeDst, float volumeSrc, uint32_t channels) {
+	float32x4_t vd = vdupq_n_f32(volumeDst);
+	float32x4_t vs = vdupq_n_f32(volumeSrc);
+	uint32_t c = 0;
+	for (; c+4 <= channels; c += 4) {
+		float32x4_t d = vld1q_f32(dst + c);
+		float32x4_t s = vld1q_f32(src + c);
+		vst1q_f32(dst + c, vmlaq_f32(vmulq_f32(s, vs), d, vd));
+	}
+	for (; c < channels; c++) {
+		dst[c] = dst[c] * volumeDst + src[c] * volumeSrc;
+	}
+}
+
+static void azaSIMDMixNEON(float *dst, uint32_t dstStride, float volumeDst, const float *src, uint32_t srcStride, float volumeSrc, uint32_t frames, uint32_t channels) {
+	float32x4_t vd = vdupq_n_f32(volumeDst);
+	float32x4_t vs = vdupq_n_f32(volumeSrc);
+	uint32_t i = 0;
+	if (dstStride == channels && srcStride == channels) {
+		uint32_t count = frames * channels;
+		for (; i+4 <= count; i += 4) {
+			float32x4_t d = vld1q_f32(dst + i);
+			float32x4_t s = vld1q_f32(src + i);
+			vst1q_f32(dst + i, vmlaq_f32(vmulq_f32(s, vs), d, vd));
+		}
+		for (; i < count; i++) {
+			dst[i] = dst[i] * volumeDst + src[i] * volumeSrc;
+		}
+	} else if (channels >= 4) {
+		for (; i < frames; i++) {
+			azaMixFrameNEON(dst + i * dstStride, src + i * srcStride, volumeDst, volumeSrc, channels);
+		}
+	} else if (channels == 2) {
+		for (; i+2 <= frames; i += 2) {
+			float *d0 = dst + i * dstStride;
+			float *d1 = d0 + dstStride;
+			const float *s0 = src + i * srcStride;
+			const float *s1 = s0 + srcStride;
+			float32x4_t d = vcombine_f32(vld1_f32(d0), vld1_f32(d1));
+			float32x4_t s = vcombine_f32(vld1_f32(s0), vld1_f32(s1));
+			float32x4_t r = vmlaq_f32(vmulq_f32(s, vs), d, vd);
+			vst1_f32(d0, vget_low_f32(r));
+			vst1_f32(d1, vget_high_f32(r));
+		}
+		azaSIMDMixScalar(dst + i * dstStride, dstStride, volumeDst, src + i * srcStride, srcStride, volumeSrc, frames - i, channels);
+	} else {
+		azaSIMDMixScalar(dst, dstStride, volumeDst, src, srcStride, volumeSrc, frames, channels);
+	}
+}
+
+static void azaSIMDMixFadeNEON(float *dst, uint32_t dstStride, float volumeDstStart, float volumeDstStep, const float *src, uint32_t srcStride, float volumeSrcStart, float volumeSrcStep, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (dstStride == channels && srcStride == channels && 4 % channels == 0) {
+		static const float laneFrames[3][4] = {
+			{ 0.0f, 1.0f, 2.0f, 3.0f },
+			{ 0.0f, 0.0f, 1.0f, 1.0f },
+			{ 0.0f, 0.0f, 0.0f, 0.0f },
+		};
+		float32x4_t laneFrame = vld1q_f32(laneFrames[channels == 1 ? 0 : (channels == 2 ? 1 : 2)]);
+		float32x4_t vdStart = vdupq_n_f32(volumeDstStart), vdStep = vdupq_n_f32(volumeDstStep);
+		float32x4_t vsStart = vdupq_n_f32(volumeSrcStart), vsStep = vdupq_n_f32(volumeSrcStep);
+		float framesPerVector = (float)(4 / channels);
+		float frame = 0.0f;
+		uint32_t count = frames * channels;
+		for (; i+4 <= count; i += 4, frame += framesPerVector) {
+			float32x4_t f = vaddq_f32(vdupq_n_f32(frame), laneFrame);
+			float32x4_t vd = vmlaq_f32(vdStart, vdStep, f);
+			float32x4_t vs = vmlaq_f32(vsStart, vsStep, f);
+			float32x4_t d = vld1q_f32(dst + i);
+			float32x4_t s = vld1q_f32(src + i);
+			vst1q_f32(dst + i, vmlaq_f32(vmulq_f32(s, vs), d, vd));
+		}
+		i /= channels;
+	} else if (channels >= 4) {
+		for (; i < frames; i++) {
+			azaMixFrameNEON(dst + i * dstStride, src + i * srcStride, volumeDstStart + volumeDstStep * (float)i, volumeSrcStart + volumeSrcStep * (float)i, channels);
+		}
+	}
+	if (i < frames) {
+		azaSIMDMixFadeScalar(dst + i * dstStride, dstStride, volumeDstStart + volumeDstStep * (float)i, volumeDstStep, src + i * srcStride, srcStride, volumeSrcStart + volumeSrcStep * (float)i, volumeSrcStep, frames - i, channels);
+	}
+}
+
+static void azaSIMDCopyNEON(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	if ((dstStride == channels && srcStride == channels) || channels < 4) {
+		azaSIMDCopyScalar(dst, dstStride, src, srcStride, frames, channels);
+		return;
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		uint32_t c = 0;
+		for (; c+4 <= channels; c += 4) {
+			vst1q_f32(dst + c, vld1q_f32(src + c));
+		}
+		for (; c < channels; c++) {
+			dst[c] = src[c];
+		}
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+static void azaSIMDZeroNEON(float *dst, uint32_t dstStride, uint32_t frames, uint32_t channels) {
+	if (dstStride == channels || channels < 4) {
+		azaSIMDZeroScalar(dst, dstStride, frames, channels);
+		return;
+	}
+	float32x4_t zero = vdupq_n_f32(0.0f);
+	for (uint32_t i = 0; i < frames; i++) {
+		uint32_t c = 0;
+		for (; c+4 <= channels; c += 4) {
+			vst1q_f32(dst + c, zero);
+		}
+		for (; c < channels; c++) {
+			dst[c] = 0.0f;
+		}
+		dst += dstStride;
+	}
+}
+
+static float azaSIMDDotLerpNEON(const float *src, uint32_t srcStride, const float *coefficients0, const float *coefficients1, float t, uint32_t count) {
+	float32x4_t sum0 = vdupq_n_f32(0.0f);
+	float32x4_t sum1 = vdupq_n_f32(0.0f);
+	uint32_t i = 0;
+	if (srcStride == 1) {
+		for (; i+4 <= count; i += 4) {
+			float32x4_t s = vld1q_f32(src + i);
+			sum0 = vmlaq_f32(sum0, s, vld1q_f32(coefficients0 + i));
+			sum1 = vmlaq_f32(sum1, s, vld1q_f32(coefficients1 + i));
+		}
+	} else {
+		for (; i+4 <= count; i += 4) {
+			const float *p = src + i * srcStride;
+			float gathered[4] = { p[0], p[srcStride], p[srcStride*2], p[srcStride*3] };
+			float32x4_t s = vld1q_f32(gathered);
+			sum0 = vmlaq_f32(sum0, s, vld1q_f32(coefficients0 + i));
+			sum1 = vmlaq_f32(sum1, s, vld1q_f32(coefficients1 + i));
+		}
+	}
+	float32x2_t pair0 = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+	float32x2_t pair1 = vadd_f32(vget_low_f32(sum1), vget_high_f32(sum1));
+	float result0 = vget_lane_f32(vpadd_f32(pair0, pair0), 0);
+	float result1 = vget_lane_f32(vpadd_f32(pair1, pair1), 0);
+	for (; i < count; i++) {
+		float s = src[i * srcStride];
+		result0 += s * coefficients0[i];
+		result1 += s * coefficients1[i];
+	}
+	return result0 + t * (result1 - result0);
+}
+
+static void azaSIMDButterflyNEON(float *a, float *b, uint32_t count) {
+	uint32_t i = 0;
+	for (; i+4 <= count; i += 4) {
+		float32x4_t va = vld1q_f32(a + i);
+		float32x4_t vb = vld1q_f32(b + i);
+		vst1q_f32(a + i, vaddq_f32(va, vb));
+		vst1q_f32(b + i, vsubq_f32(va, vb));
+	}
+	azaSIMDButterflyScalar(a + i, b + i, count - i);
+}
+
+static void azaSIMDInterleaveNEON(float *dst, uint32_t dstStride, const float *src, uint32_t srcChannelStride, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (channels == 2 && dstStride == 2) {
+		for (; i+4 <= frames; i += 4) {
+			float32x4x2_t v;
+			v.val[0] = vld1q_f32(src + i);
+			v.val[1] = vld1q_f32(src + srcChannelStride + i);
+			vst2q_f32(dst + i*2, v);
+		}
+	} else if (channels == 4 && dstStride == 4) {
+		for (; i+4 <= frames; i += 4) {
+			float32x4x4_t v;
+			v.val[0] = vld1q_f32(src + 0*srcChannelStride + i);
+			v.val[1] = vld1q_f32(src + 1*srcChannelStride + i);
+			v.val[2] = vld1q_f32(src + 2*srcChannelStride + i);
+			v.val[3] = vld1q_f32(src + 3*srcChannelStride + i);
+			vst4q_f32(dst + i*4, v);
+		}
+	}
+	if (i < frames) {
+		azaSIMDInterleaveScalar(dst + i * dstStride, dstStride, src + i, srcChannelStride, frames - i, channels);
+	}
+}
+
+static void azaSIMDDeinterleaveNEON(float *dst, uint32_t dstChannelStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels) {
+	uint32_t i = 0;
+	if (channels == 2 && srcStride == 2) {
+		for (; i+4 <= frames; i += 4) {
+			float32x4x2_t v = vld2q_f32(src + i*2);
+			vst1q_f32(dst + i, v.val[0]);
+			vst1q_f32(dst + dstChannelStride + i, v.val[1]);
+		}
+	} else if (channels == 4 && srcStride == 4) {
+		for (; i+4 <= frames; i += 4) {
+			float32x4x4_t v = vld4q_f32(src + i*4);
+			vst1q_f32(dst + 0*dstChannelStride + i, v.val[0]);
+			vst1q_f32(dst + 1*dstChannelStride + i, v.val[1]);
+			vst1q_f32(dst + 2*dstChannelStride + i, v.val[2]);
+			vst1q_f32(dst + 3*dstChannelStride + i, v.val[3]);
+		}
+	}
+	if (i < frames) {
+		azaSIMDDeinterleaveScalar(dst + i, dstChannelStride, src + i * srcStride, srcStride, frames - i, channels);
+	}
+}
+
+// Same deal as the SSE2 version, where lanes is 4 or 2
+static inline float32x4_t azaLoadLanesNEON(const float *src, const uint32_t lanes) {
+	return lanes == 4 ? vld1q_f32(src) : vcombine_f32(vld1_f32(src), vdup_n_f32(0.0f));
+}
+
+static inline void azaStoreLanesNEON(float *dst, float32x4_t v, const uint32_t lanes) {
+	if (lanes == 4) {
+		vst1q_f32(dst, v);
+	} else {
+		vst1_f32(dst, vget_low_f32(v));
+	}
+}
+
+typedef struct azaSVFSectionNEON {
+	float32x4_t a11, a12, a21, a22, b1, b2, c1, c2, d;
+	float32x4_t s1, s2;
+} azaSVFSectionNEON;
+
+static inline azaSVFSectionNEON azaSVFSectionLoadNEON(const azaSIMDSVFCoefficients *k, const float *ic1eq, const float *ic2eq, const uint32_t lanes) {
+	azaSVFSectionNEON result;
+	result.a11 = vdupq_n_f32(k->a11);
+	result.a12 = vdupq_n_f32(k->a12);
+	result.a21 = vdupq_n_f32(k->a21);
+	result.a22 = vdupq_n_f32(k->a22);
+	result.b1 = vdupq_n_f32(k->b1);
+	result.b2 = vdupq_n_f32(k->b2);
+	result.c1 = vdupq_n_f32(k->c1);
+	result.c2 = vdupq_n_f32(k->c2);
+	result.d = vdupq_n_f32(k->d);
+	result.s1 = azaLoadLanesNEON(ic1eq, lanes);
+	result.s2 = azaLoadLanesNEON(ic2eq, lanes);
+	return result;
+}
+
+static inline void azaSVFSectionStoreNEON(const azaSVFSectionNEON *section, float *ic1eq, float *ic2eq, const uint32_t lanes) {
+	azaStoreLanesNEON(ic1eq, section->s1, lanes);
+	azaStoreLanesNEON(ic2eq, section->s2, lanes);
+}
+
+static inline float32x4_t azaSVFTickNEON(azaSVFSectionNEON *section, float32x4_t v) {
+	float32x4_t out = vmlaq_f32(vmlaq_f32(vmulq_f32(section->d, v), section->c2, section->s2), section->c1, section->s1);
+	float32x4_t next1 = vmlaq_f32(vmlaq_f32(vmulq_f32(section->b1, v), section->a12, section->s2), section->a11, section->s1);
+	float32x4_t next2 = vmlaq_f32(vmlaq_f32(vmulq_f32(section->b2, v), section->a21, section->s1), section->a22, section->s2);
+	section->s1 = next1;
+	section->s2 = next2;
+	return out;
+}
+
+static inline void azaSVFGroupNEON(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, const uint32_t lanes) {
+	azaSVFSectionNEON first = azaSVFSectionLoadNEON(&coefficients[0], ic1eq, ic2eq, lanes);
+	if (sections == 2) {
+		azaSVFSectionNEON second = azaSVFSectionLoadNEON(&coefficients[1], ic1eq + stateStride, ic2eq + stateStride, lanes);
+		for (uint32_t i = 0; i < frames; i++) {
+			float32x4_t v = azaLoadLanesNEON(samples, lanes);
+			azaStoreLanesNEON(samples, azaSVFTickNEON(&second, azaSVFTickNEON(&first, v)), lanes);
+			samples += stride;
+		}
+		azaSVFSectionStoreNEON(&second, ic1eq + stateStride, ic2eq + stateStride, lanes);
+	} else {
+		for (uint32_t i = 0; i < frames; i++) {
+			float32x4_t v = azaLoadLanesNEON(samples, lanes);
+			azaStoreLanesNEON(samples, azaSVFTickNEON(&first, v), lanes);
+			samples += stride;
+		}
+	}
+	azaSVFSectionStoreNEON(&first, ic1eq, ic2eq, lanes);
+}
+
+static void azaSIMDSVFNEON(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, uint32_t channels) {
+	uint32_t c = 0;
+	for (; c+4 <= channels; c += 4) {
+		azaSVFGroupNEON(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, 4);
+	}
+	if (c+2 <= channels) {
+		azaSVFGroupNEON(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, 2);
+		c += 2;
+	}
+	if (c < channels) {
+		azaSIMDSVFScalar(samples + c, stride, coefficients, sections, ic1eq + c, ic2eq + c, stateStride, frames, channels - c);
+	}
+}
+
+// 32-bit ARM doesn't have a vector divide, so we refine the reciprocal estimate instead
+static inline float32x4_t azaReciprocalNEON(float32x4_t x) {
+	float32x4_t result = vrecpeq_f32(x);
+	result = vmulq_f32(result, vrecpsq_f32(x, result));
+	result = vmulq_f32(result, vrecpsq_f32(x, result));
+	return result;
+}
+
+static inline float32x4_t azaFastExp2NEON(float32x4_t x) {
+	uint32x4_t keep = vcgeq_f32(x, vdupq_n_f32(-126.0f));
+	x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-126.0f)), vdupq_n_f32(127.0f));
+	float32x4_t magic = vdupq_n_f32(AZA_ROUND_MAGIC);
+	float32x4_t rounded = vsubq_f32(vaddq_f32(x, magic), magic);
+	float32x4_t f = vsubq_f32(x, rounded);
+	float32x4_t p = vmlaq_f32(vdupq_n_f32(AZA_EXP2_C4), f, vdupq_n_f32(AZA_EXP2_C5));
+	p = vmlaq_f32(vdupq_n_f32(AZA_EXP2_C3), f, p);
+	p = vmlaq_f32(vdupq_n_f32(AZA_EXP2_C2), f, p);
+	p = vmlaq_f32(vdupq_n_f32(AZA_EXP2_C1), f, p);
+	p = vmlaq_f32(vdupq_n_f32(1.0f), f, p);
+	int32x4_t exponent = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(rounded), vdupq_n_s32(127)), 23);
+	float32x4_t result = vmulq_f32(p, vreinterpretq_f32_s32(exponent));
+	return vreinterpretq_f32_u32(vandq_u32(keep, vreinterpretq_u32_f32(result)));
+}
+
+static inline float32x4_t azaFastLog2NEON(float32x4_t x) {
+	// vmaxq_f32 would let NaN through, so clamp with a compare instead
+	float32x4_t smallest = vdupq_n_f32(1.17549435e-38f);
+	x = vbslq_f32(vcgeq_f32(x, smallest), x, smallest);
+	uint32x4_t bits = vreinterpretq_u32_f32(x);
+	uint32x4_t exponent = vsubq_u32(vshrq_n_u32(vaddq_u32(bits, vdupq_n_u32(AZA_LOG2_MANTISSA_OFFSET)), 23), vdupq_n_u32(127));
+	float32x4_t m = vreinterpretq_f32_u32(vsubq_u32(bits, vshlq_n_u32(exponent, 23)));
+	float32x4_t one = vdupq_n_f32(1.0f);
+	float32x4_t t = vmulq_f32(vsubq_f32(m, one), azaReciprocalNEON(vaddq_f32(m, one)));
+	float32x4_t t2 = vmulq_f32(t, t);
+	float32x4_t p = vmlaq_f32(vdupq_n_f32(AZA_LOG2_C5), t2, vdupq_n_f32(AZA_LOG2_C7));
+	p = vmlaq_f32(vdupq_n_f32(AZA_LOG2_C3), t2, p);
+	p = vmlaq_f32(vdupq_n_f32(AZA_LOG2_C1), t2, p);
+	return vmlaq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(exponent)), t, p);
+}
+
+static void azaSIMDDbToAmpNEON(float *dst, const float *src, uint32_t count) {
+	float32x4_t scale = vdupq_n_f32(AZA_DB_TO_LOG2);
+	uint32_t i = 0;
+	for (; i+4 <= count; i += 4) {
+		vst1q_f32(dst + i, azaFastExp2NEON(vmulq_f32(vld1q_f32(src + i), scale)));
+	}
+	azaSIMDDbToAmpScalar(dst + i, src + i, count - i);
+}
+
+static void azaSIMDAmpToDbNEON(float *dst, const float *src, uint32_t count) {
+	float32x4_t scale = vdupq_n_f32(AZA_LOG2_TO_DB);
+	uint32_t i = 0;
+	for (; i+4 <= count; i += 4) {
+		vst1q_f32(dst + i, vmulq_f32(azaFastLog2NEON(vld1q_f32(src + i)), scale));
+	}
+	azaSIMDAmpToDbScalar(dst + i, src + i, count - i);
+}
+
+static inline float32x4_t azaApplyGainNEON(float32x4_t s, float32x4_t g, float32x4_t limit) {
+	float32x4_t v = vmulq_f32(s, g);
+	return vminq_f32(vmaxq_f32(v, vnegq_f32(limit)), limit);
+}
+
+static void azaSIMDApplyGainNEON(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, const float *gain, float limit, uint32_t frames, uint32_t channels) {
+	float32x4_t vl = vdupq_n_f32(limit);
+	uint32_t i = 0;
+	if (channels == 1 && dstStride == 1 && srcStride == 1) {
+		for (; i+4 <= frames; i += 4) {
+			vst1q_f32(dst + i, azaApplyGainNEON(vld1q_f32(src + i), vld1q_f32(gain + i), vl));
+		}
+	} else if (channels == 2 && dstStride == 2 && srcStride == 2) {
+		for (; i+4 <= frames; i += 4) {
+			float32x4_t g = vld1q_f32(gain + i);
+			float32x4x2_t gg = vzipq_f32(g, g);
+			vst1q_f32(dst + i*2, azaApplyGainNEON(vld1q_f32(src + i*2), gg.val[0], vl));
+			vst1q_f32(dst + i*2 + 4, azaApplyGainNEON(vld1q_f32(src + i*2 + 4), gg.val[1], vl));
+		}
+	} else if (channels >= 4) {
+		for (; i < frames; i++) {
+			float32x4_t g = vdupq_n_f32(gain[i]);
+			float *d = dst + i * dstStride;
+			const float *s = src + i * srcStride;
+			uint32_t c = 0;
+			for (; c+4 <= channels; c += 4) {
+				vst1q_f32(d + c, azaApplyGainNEON(vld1q_f32(s + c), g, vl));
+			}
+			for (; c < channels; c++) {
+				d[c] = azaClampf(s[c] * gain[i], -limit, limit);
+			}
+		}
+	}
+	azaSIMDApplyGainScalar(dst + i * dstStride, dstStride, src + i * srcStride, srcStride, gain + i, limit, frames - i, channels);
+}
+
+// 32-bit ARM has no vector sqrt, so this is x * 1/sqrt(x) with two Newton-Raphson steps, and the max keeps 0 coming out as 0 rather than 0 * inf
+static inline float32x4_t azaSqrtNEON(float32x4_t x) {
+	float32x4_t safe = vmaxq_f32(x, vdupq_n_f32(1.17549435e-38f));
+	float32x4_t estimate = vrsqrteq_f32(safe);
+	estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(safe, estimate), estimate));
+	estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(safe, estimate), estimate));
+	return vmulq_f32(x, estimate);
+}
+
+static inline float32x4_t azaRMSOutNEON(float32x4_t sum, float32x4_t scale) {
+	return azaSqrtNEON(vmulq_f32(vmaxq_f32(sum, vdupq_n_f32(0.0f)), scale));
+}
+
+static inline void azaRMSGroupNEON(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, const uint32_t lanes) {
+	float32x4_t vscale = vdupq_n_f32(scale);
+	float32x4_t sum = azaLoadLanesNEON(sums, lanes);
+	float32x4_t lapSum = azaLoadLanesNEON(lapSums, lanes);
+	for (uint32_t i = 0; i < frames; i++) {
+		float32x4_t v = azaLoadLanesNEON(src + i * srcStride, lanes);
+		float32x4_t squared = vmulq_f32(v, v);
+		sum = vaddq_f32(sum, vsubq_f32(squared, azaLoadLanesNEON(ring + i * ringStride, lanes)));
+		lapSum = vaddq_f32(lapSum, squared);
+		azaStoreLanesNEON(ring + i * ringStride, squared, lanes);
+		azaStoreLanesNEON(dst + i * dstStride, azaRMSOutNEON(sum, vscale), lanes);
+	}
+	azaStoreLanesNEON(sums, sum, lanes);
+	azaStoreLanesNEON(lapSums, lapSum, lanes);
+}
+
+static void azaRMSMonoNEON(float *dst, const float *src, float *ring, float *sums, float *lapSums, float scale, uint32_t frames) {
+	float32x4_t vscale = vdupq_n_f32(scale);
+	float32x4_t zero = vdupq_n_f32(0.0f);
+	float32x4_t sum = vdupq_n_f32(*sums);
+	// Kept in 4 lanes until the end
+	float32x4_t lapSum = zero;
+	uint32_t i = 0;
+	for (; i+4 <= frames; i += 4) {
+		float32x4_t v = vld1q_f32(src + i);
+		float32x4_t squared = vmulq_f32(v, v);
+		lapSum = vaddq_f32(lapSum, squared);
+		float32x4_t delta = vsubq_f32(squared, vld1q_f32(ring + i));
+		vst1q_f32(ring + i, squared);
+		delta = vaddq_f32(delta, vextq_f32(zero, delta, 3));
+		delta = vaddq_f32(delta, vextq_f32(zero, delta, 2));
+		float32x4_t result = vaddq_f32(sum, delta);
+		vst1q_f32(dst + i, azaRMSOutNEON(result, vscale));
+		sum = vdupq_lane_f32(vget_high_f32(result), 1);
+	}
+	*sums = vgetq_lane_f32(sum, 0);
+	float32x2_t lapHalf = vadd_f32(vget_low_f32(lapSum), vget_high_f32(lapSum));
+	*lapSums += vget_lane_f32(vpadd_f32(lapHalf, lapHalf), 0);
+	azaSIMDRMSScalar(dst + i, 1, src + i, 1, ring + i, 1, sums, lapSums, scale, frames - i, 1);
+}
+
+static void azaSIMDRMSNEON(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, uint32_t channels) {
+	if (channels == 1 && dstStride == 1 && srcStride == 1 && ringStride == 1) {
+		azaRMSMonoNEON(dst, src, ring, sums, lapSums, scale, frames);
+		return;
+	}
+	uint32_t c = 0;
+	for (; c+4 <= channels; c += 4) {
+		azaRMSGroupNEON(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, 4);
+	}
+	if (c+2 <= channels) {
+		azaRMSGroupNEON(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, 2);
+		c += 2;
+	}
+	if (c < channels) {
+		azaSIMDRMSScalar(dst + c, dstStride, src + c, srcStride, ring + c, ringStride, sums + c, lapSums + c, scale, frames, channels - c);
+	}
+}
+
+#endif // AZA_HAS_NEON
+
+
+
+fp_azaSIMDMix azaSIMDMix = azaSIMDMixScalar;
+fp_azaSIMDMixFade azaSIMDMixFade = azaSIMDMixFadeScalar;
+fp_azaSIMDCopy azaSIMDCopy = azaSIMDCopyScalar;
+fp_azaSIMDZero azaSIMDZero = azaSIMDZeroScalar;
+fp_azaSIMDDotLerp azaSIMDDotLerp = azaSIMDDotLerpScalar;
+fp_azaSIMDButterfly azaSIMDButterfly = azaSIMDButterflyScalar;
+fp_azaSIMDInterleave azaSIMDInterleave = azaSIMDInterleaveScalar;
+fp_azaSIMDDeinterleave azaSIMDDeinterleave = azaSIMDDeinterleaveScalar;
+fp_azaSIMDSVF azaSIMDSVF = azaSIMDSVFScalar;
+fp_azaSIMDDbToAmp azaSIMDDbToAmp = azaSIMDDbToAmpScalar;
+fp_azaSIMDAmpToDb azaSIMDAmpToDb = azaSIMDAmpToDbScalar;
+fp_azaSIMDApplyGain azaSIMDApplyGain = azaSIMDApplyGainScalar;
+fp_azaSIMDRMS azaSIMDRMS = azaSIMDRMSScalar;
+
+
+
+#if AZA_ARCH_X86
+static void azaCPUID(uint32_t regs[4], uint32_t leaf, uint32_t subleaf) {
+#ifdef _MSC_VER
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t azaXGETBV() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t lo, hi;
+	__asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+#endif // AZA_ARCH_X86
+
+static void azaDetectCPUFeatures() {
+	memset(&azaCPU, 0, sizeof(azaCPU));
+#if AZA_ARCH_X86
+	uint32_t regs[4];
+	azaCPUID(regs, 0, 0);
+	uint32_t maxLeaf = regs[0];
+	if (maxLeaf < 1) return;
+	azaCPUID(regs, 1, 0);
+	uint32_t ecx = regs[2], edx = regs[3];
+	azaCPU.sse2   = (edx >> 26) & 1;
+	azaCPU.sse3   = (ecx >>  0) & 1;
+	azaCPU.ssse3  = (ecx >>  9) & 1;
+	azaCPU.sse4_1 = (ecx >> 19) & 1;
+	bool hasFMA     = (ecx >> 12) & 1;
+	bool hasOSXSAVE = (ecx >> 27) & 1;
+	bool hasAVX     = (ecx >> 28) & 1;
+	// The OS also has to save the upper halves of the ymm registers for us, otherwise AVX is a no-go
+	if (hasOSXSAVE && hasAVX && (azaXGETBV() & 0x6) == 0x6) {
+		azaCPU.avx = 1;
+		azaCPU.fma = hasFMA;
+		if (maxLeaf >= 7) {
+			azaCPUID(regs, 7, 0);
+			azaCPU.avx2 = (regs[1] >> 5) & 1;
+		}
+	}
+#elif AZA_HAS_NEON
+	// NEON is mandatory on aarch64, and if we were compiled with it on 32-bit ARM we're already assuming it's there
+	azaCPU.neon = 1;
+#endif
+}
+
+void azaSIMDSetLevel(azaSIMDLevel level) {
+#if AZA_ARCH_X86
+	if (level >= AZA_SIMD_AVX2 && azaCPU.avx2 && azaCPU.fma) {
+		azaSIMDMix = azaSIMDMixAVX2;
+		azaSIMDMixFade = azaSIMDMixFadeAVX2;
+		// Copies and zeroes are bound by memory bandwidth, so wider registers don't buy us anything
+		azaSIMDCopy = azaSIMDCopySSE2;
+		azaSIMDZero = azaSIMDZeroSSE2;
+		azaSIMDDotLerp = azaSIMDDotLerpAVX2;
+		azaSIMDButterfly = azaSIMDButterflyAVX2;
+		azaSIMDInterleave = azaSIMDInterleaveAVX2;
+		azaSIMDDeinterleave = azaSIMDDeinterleaveAVX2;
+		azaSIMDSVF = azaSIMDSVFAVX2;
+		azaSIMDDbToAmp = azaSIMDDbToAmpAVX2;
+		azaSIMDAmpToDb = azaSIMDAmpToDbAVX2;
+		azaSIMDApplyGain = azaSIMDApplyGainAVX2;
+		azaSIMDRMS = azaSIMDRMSAVX2;
+		azaSIMDLevelCurrent = AZA_SIMD_AVX2;
+		return;
+	}
+	if (level >= AZA_SIMD_SSE2 && azaCPU.sse2) {
+		azaSIMDMix = azaSIMDMixSSE2;
+		azaSIMDMixFade = azaSIMDMixFadeSSE2;
+		azaSIMDCopy = azaSIMDCopySSE2;
+		azaSIMDZero = azaSIMDZeroSSE2;
+		azaSIMDDotLerp = azaSIMDDotLerpSSE2;
+		azaSIMDButterfly = azaSIMDButterflySSE2;
+		azaSIMDInterleave = azaSIMDInterleaveSSE2;
+		azaSIMDDeinterleave = azaSIMDDeinterleaveSSE2;
+		azaSIMDSVF = azaSIMDSVFSSE2;
+		azaSIMDDbToAmp = azaSIMDDbToAmpSSE2;
+		azaSIMDAmpToDb = azaSIMDAmpToDbSSE2;
+		azaSIMDApplyGain = azaSIMDApplyGainSSE2;
+		azaSIMDRMS = azaSIMDRMSSSE2;
+		azaSIMDLevelCurrent = AZA_SIMD_SSE2;
+		return;
+	}
+#elif AZA_HAS_NEON
+	if (level >= AZA_SIMD_NEON && azaCPU.neon) {
+		azaSIMDMix = azaSIMDMixNEON;
+		azaSIMDMixFade = azaSIMDMixFadeNEON;
+		azaSIMDCopy = azaSIMDCopyNEON;
+		azaSIMDZero = azaSIMDZeroNEON;
+		azaSIMDDotLerp = azaSIMDDotLerpNEON;
+		azaSIMDButterfly = azaSIMDButterflyNEON;
+		azaSIMDInterleave = azaSIMDInterleaveNEON;
+		azaSIMDDeinterleave = azaSIMDDeinterleaveNEON;
+		azaSIMDSVF = azaSIMDSVFNEON;
+		azaSIMDDbToAmp = azaSIMDDbToAmpNEON;
+		azaSIMDAmpToDb = azaSIMDAmpToDbNEON;
+		azaSIMDApplyGain = azaSIMDApplyGainNEON;
+		azaSIMDRMS = azaSIMDRMSNEON;
+		azaSIMDLevelCurrent = AZA_SIMD_NEON;
+		return;
+	}
+#endif
+	azaSIMDMix = azaSIMDMixScalar;
+	azaSIMDMixFade = azaSIMDMixFadeScalar;
+	azaSIMDCopy = azaSIMDCopyScalar;
+	azaSIMDZero = azaSIMDZeroScalar;
+	azaSIMDDotLerp = azaSIMDDotLerpScalar;
+	azaSIMDButterfly = azaSIMDButterflyScalar;
+	azaSIMDInterleave = azaSIMDInterleaveScalar;
+	azaSIMDDeinterleave = azaSIMDDeinterleaveScalar;
+	azaSIMDSVF = azaSIMDSVFScalar;
+	azaSIMDDbToAmp = azaSIMDDbToAmpScalar;
+	azaSIMDAmpToDb = azaSIMDAmpToDbScalar;
+	azaSIMDApplyGain = azaSIMDApplyGainScalar;
+	azaSIMDRMS = azaSIMDRMSScalar;
+	azaSIMDLevelCurrent = AZA_SIMD_SCALAR;
+}
+
+void azaSIMDInit() {
+	azaDetectCPUFeatures();
+	azaSIMDSetLevel(AZA_SIMD_BEST);
+	AZA_LOG_INFO("AzAudio SIMD: %s\n", azaSIMDLevelString(azaSIMDLevelCurrent));
+}
+
+const char* azaSIMDLevelString(azaSIMDLevel level) {
+	switch (level) {
+		case AZA_SIMD_SCALAR: return "Scalar";
+		case AZA_SIMD_SSE2: return "SSE2";
+		case AZA_SIMD_AVX2: return "AVX2";
+		case AZA_SIMD_NEON: return "NEON";
+		case AZA_SIMD_BEST: break;
+	}
+	return "Unknown";
+}
@@ -0,0 +1,130 @@
+/*
+	File: simd.h
+	Author: Philip Haynes
+	CPU feature detection and vectorized inner loops that get picked once at azaInit.
+*/
+
+#ifndef AZAUDIO_SIMD_H
+#define AZAUDIO_SIMD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define AZA_ARCH_X86 1
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+	#define AZA_ARCH_ARM 1
+#endif
+
+typedef enum azaSIMDLevel {
+	AZA_SIMD_SCALAR=0,
+	AZA_SIMD_SSE2,
+	AZA_SIMD_AVX2,
+	AZA_SIMD_NEON,
+	// Whatever is the best the CPU supports
+	AZA_SIMD_BEST,
+} azaSIMDLevel;
+
+typedef struct azaCPUFeatures {
+	uint8_t sse2;
+	uint8_t sse3;
+	uint8_t ssse3;
+	uint8_t sse4_1;
+	uint8_t avx;
+	uint8_t avx2;
+	uint8_t fma;
+	uint8_t neon;
+} azaCPUFeatures;
+// Filled in by azaSIMDInit
+extern azaCPUFeatures azaCPU;
+// Which set of kernels is currently in use
+extern azaSIMDLevel azaSIMDLevelCurrent;
+
+// Queries the CPU and picks the best available kernels. Called by azaInit, so you don't have to.
+void azaSIMDInit();
+
+// Limits which set of kernels can be used. Useful for testing and benchmarking. If the CPU doesn't support the requested level, this picks the best one below it that it does support.
+void azaSIMDSetLevel(azaSIMDLevel level);
+
+const char* azaSIMDLevelString(azaSIMDLevel level);
+
+
+
+// All of the following operate on frames of channels where the channels in one frame are contiguous and the start of each frame is stride floats apart, exactly like azaBuffer.
+// Kernels take the fast path when stride == channels.
+
+// dst = dst * volumeDst + src * volumeSrc
+typedef void (*fp_azaSIMDMix)(float *dst, uint32_t dstStride, float volumeDst, const float *src, uint32_t srcStride, float volumeSrc, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDMix azaSIMDMix;
+
+// Same as azaSIMDMix, but volumes for frame i are volumeStart + volumeStep * i
+typedef void (*fp_azaSIMDMixFade)(float *dst, uint32_t dstStride, float volumeDstStart, float volumeDstStep, const float *src, uint32_t srcStride, float volumeSrcStart, float volumeSrcStep, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDMixFade azaSIMDMixFade;
+
+// dst = src
+typedef void (*fp_azaSIMDCopy)(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDCopy azaSIMDCopy;
+
+// dst = 0
+typedef void (*fp_azaSIMDZero)(float *dst, uint32_t dstStride, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDZero azaSIMDZero;
+
+// Returns the dot product of count samples from src (srcStride floats apart) with lerp(coefficients0, coefficients1, t). This is the inner loop of polyphase resampling, where the two sets of coefficients are adjacent phases.
+typedef float (*fp_azaSIMDDotLerp)(const float *src, uint32_t srcStride, const float *coefficients0, const float *coefficients1, float t, uint32_t count);
+extern fp_azaSIMDDotLerp azaSIMDDotLerp;
+
+// a, b = a + b, a - b for count contiguous floats. This is one stage of a fast Walsh-Hadamard transform.
+typedef void (*fp_azaSIMDButterfly)(float *a, float *b, uint32_t count);
+extern fp_azaSIMDButterfly azaSIMDButterfly;
+
+// dst is interleaved like the above, and src is planar, with each channel's frames contiguous and channels srcChannelStride floats apart
+typedef void (*fp_azaSIMDInterleave)(float *dst, uint32_t dstStride, const float *src, uint32_t srcChannelStride, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDInterleave azaSIMDInterleave;
+
+// The reverse of azaSIMDInterleave
+typedef void (*fp_azaSIMDDeinterleave)(float *dst, uint32_t dstChannelStride, const float *src, uint32_t srcStride, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDDeinterleave azaSIMDDeinterleave;
+
+typedef struct azaSIMDSVFCoefficients {
+	// A TPT state-variable filter section boiled down to its linear state-space form, which keeps the recursion as short as possible:
+	// out = c1 * ic1eq + c2 * ic2eq + d * in
+	// ic1eq, ic2eq = a11 * ic1eq + a12 * ic2eq + b1 * in, a21 * ic1eq + a22 * ic2eq + b2 * in
+	float a11, a12, a21, a22;
+	float b1, b2;
+	float c1, c2, d;
+} azaSIMDSVFCoefficients;
+
+#define AZA_SIMD_SVF_MAX_SECTIONS 2
+
+// Runs up to AZA_SIMD_SVF_MAX_SECTIONS cascaded state-variable filter sections over every channel in place. ic1eq and ic2eq hold the two integrator states, where section s of channel c is at [s * stateStride + c], and they get updated.
+// Channels run side by side so one frame's worth of channels shares a register, and all sections run in the same pass so their recursions overlap.
+typedef void (*fp_azaSIMDSVF)(float *samples, uint32_t stride, const azaSIMDSVFCoefficients *coefficients, uint32_t sections, float *ic1eq, float *ic2eq, uint32_t stateStride, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDSVF azaSIMDSVF;
+
+// dst = 10^(src/20) for count contiguous floats, using the same approximation as azaFastDbToAmpf. dst and src may be the same.
+typedef void (*fp_azaSIMDDbToAmp)(float *dst, const float *src, uint32_t count);
+extern fp_azaSIMDDbToAmp azaSIMDDbToAmp;
+
+// dst = 20*log10(src) for count contiguous floats, using the same approximation as azaFastAmpToDbf. dst and src may be the same.
+typedef void (*fp_azaSIMDAmpToDb)(float *dst, const float *src, uint32_t count);
+extern fp_azaSIMDAmpToDb azaSIMDAmpToDb;
+
+// dst = clamp(src * gain[i], -limit, limit) for every channel of frame i, where gain is contiguous. dst and src may be the same.
+typedef void (*fp_azaSIMDApplyGain)(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, const float *gain, float limit, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDApplyGain azaSIMDApplyGain;
+
+// Sliding window RMS over a ring of squared samples, where frame i's squares are at ring + i * ringStride, with one float per channel. The caller wraps the ring between calls.
+// For each frame i and channel c: sums[c] += src[c]^2 - ring[c], then ring[c] = src[c]^2, and dst[c] = sqrt(sums[c] * scale). dst and src may be the same.
+// lapSums[c] += src[c]^2 as well, so once the caller has gone all the way around the ring, lapSums holds exactly what's in it without ever having subtracted anything.
+// Channels run side by side, and a single contiguous channel gets its running sum done 4 frames at a time.
+typedef void (*fp_azaSIMDRMS)(float *dst, uint32_t dstStride, const float *src, uint32_t srcStride, float *ring, uint32_t ringStride, float *sums, float *lapSums, float scale, uint32_t frames, uint32_t channels);
+extern fp_azaSIMDRMS azaSIMDRMS;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_SIMD_H
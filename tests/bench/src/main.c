@@ -0,0 +1,765 @@
+/*
+	File: main.c
+	Author: singularity
+	Program for measuring the cost of every DSP across block sizes, channel counts and buffer layouts. Results are written as JSON.
+
+	Usage: bench [--quick] [--simd scalar|sse2|avx2|neon] [--only <dsp name>] [--out <file>]
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "AzAudio/AzAudio.h"
+#include "AzAudio/dsp.h"
+#include "AzAudio/error.h"
+#include "AzAudio/math.h"
+#include "AzAudio/simd.h"
+#include "AzAudio/backend/interface.h"
+#include "AzAudio/backend/threads.h"
+
+#define SAMPLERATE 48000
+#define MAX_BLOCK_FRAMES 4096
+#define MAX_CHANNELS 8
+// Extra floats between frames for the strided layout, as if we were processing a subset of a wider buffer
+#define STRIDE_PADDING 3
+
+static const uint32_t blockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+static const uint8_t channelCounts[] = { 1, 2, 6, 8 };
+
+typedef enum BenchLayout {
+	LAYOUT_INTERLEAVED,
+	LAYOUT_STRIDED,
+	LAYOUT_PLANAR,
+	LAYOUT_COUNT,
+} BenchLayout;
+static const char *layoutNames[LAYOUT_COUNT] = {
+	"interleaved",
+	"strided",
+	"planar",
+};
+
+// Pre-generated noise that every run starts from so the DSPs always see the same kind of signal
+static float noise[MAX_BLOCK_FRAMES * (MAX_CHANNELS + STRIDE_PADDING)];
+static float work[MAX_BLOCK_FRAMES * (MAX_CHANNELS + STRIDE_PADDING)];
+static float noiseMono[MAX_BLOCK_FRAMES];
+// Sound for the sampler to play, made per channel count
+static azaBuffer samplerSource[MAX_CHANNELS+1];
+// Made-up measurements for Binaural, about as dense and as long as a typical SOFA set
+#define BENCH_HRTF_FRAMES 256
+static azaHRTF benchHRTF;
+// Made-up room for Convolution, a couple seconds of decaying noise
+#define BENCH_IMPULSE_RESPONSE_FRAMES (SAMPLERATE * 2)
+static azaBuffer benchImpulseResponse;
+
+static uint32_t randomState = 0x12345678;
+static float randomNoise() {
+	// xorshift32
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return ((float)randomState / (float)UINT32_MAX * 2.0f - 1.0f) * 0.5f;
+}
+
+
+
+typedef struct BenchDSP {
+	const char *name;
+	azaDSP* (*make)(uint8_t channels);
+	int (*process)(azaDSP *dsp, azaBuffer buffer);
+	void (*free)(azaDSP *dsp);
+} BenchDSP;
+
+static azaDSP* makeCubicLimiter(uint8_t channels) {
+	return (azaDSP*)azaMakeCubicLimiter();
+}
+static int processCubicLimiter(azaDSP *dsp, azaBuffer buffer) {
+	return azaCubicLimiterProcess((azaCubicLimiter*)dsp, buffer);
+}
+static void freeCubicLimiter(azaDSP *dsp) {
+	azaFreeCubicLimiter((azaCubicLimiter*)dsp);
+}
+
+static azaDSP* makeRMS(uint8_t channels) {
+	return (azaDSP*)azaMakeRMS((azaRMSConfig) {
+		.window = 3.0f,
+	}, channels);
+}
+static int processRMS(azaDSP *dsp, azaBuffer buffer) {
+	return azaRMSProcessSingle((azaRMS*)dsp, buffer);
+}
+static void freeRMS(azaDSP *dsp) {
+	azaFreeRMS((azaRMS*)dsp);
+}
+
+static azaDSP* makeLookaheadLimiter(uint8_t channels) {
+	return (azaDSP*)azaMakeLookaheadLimiter((azaLookaheadLimiterConfig) {
+		.gainInput = 6.0f,
+		.gainOutput = 0.0f,
+	}, channels);
+}
+static int processLookaheadLimiter(azaDSP *dsp, azaBuffer buffer) {
+	return azaLookaheadLimiterProcess((azaLookaheadLimiter*)dsp, buffer);
+}
+static void freeLookaheadLimiter(azaDSP *dsp) {
+	azaFreeLookaheadLimiter((azaLookaheadLimiter*)dsp);
+}
+
+static azaDSP* makeFilter(uint8_t channels) {
+	return (azaDSP*)azaMakeFilter((azaFilterConfig) {
+		.kind = AZA_FILTER_LOW_PASS,
+		.frequency = 1000.0f,
+		.dryMix = 0.0f,
+	}, channels);
+}
+static int processFilter(azaDSP *dsp, azaBuffer buffer) {
+	return azaFilterProcess((azaFilter*)dsp, buffer);
+}
+static void freeFilter(azaDSP *dsp) {
+	azaFreeFilter((azaFilter*)dsp);
+}
+
+static azaDSP* makeFilterSVF(uint8_t channels) {
+	return (azaDSP*)azaMakeFilterSVF((azaFilterSVFConfig) {
+		.kind = AZA_FILTER_SVF_LOW_PASS,
+		.slope = AZA_FILTER_SVF_24DB,
+		.frequency = 1000.0f,
+		.dryMix = 0.0f,
+	}, channels);
+}
+static int processFilterSVF(azaDSP *dsp, azaBuffer buffer) {
+	return azaFilterSVFProcess((azaFilterSVF*)dsp, buffer);
+}
+static void freeFilterSVF(azaDSP *dsp) {
+	azaFreeFilterSVF((azaFilterSVF*)dsp);
+}
+
+static azaDSP* makeCompressor(uint8_t channels) {
+	return (azaDSP*)azaMakeCompressor((azaCompressorConfig) {
+		.threshold = -12.0f,
+		.ratio = 4.0f,
+		.attack = 10.0f,
+		.decay = 100.0f,
+	}, channels);
+}
+static int processCompressor(azaDSP *dsp, azaBuffer buffer) {
+	return azaCompressorProcess((azaCompressor*)dsp, buffer);
+}
+static void freeCompressor(azaDSP *dsp) {
+	azaFreeCompressor((azaCompressor*)dsp);
+}
+
+static azaDSP* makeDelay(uint8_t channels) {
+	return (azaDSP*)azaMakeDelay((azaDelayConfig) {
+		.gain = -6.0f,
+		.gainDry = 0.0f,
+		.delay = 250.0f,
+		.feedback = 0.5f,
+		.pingpong = 0.25f,
+	}, channels);
+}
+static int processDelay(azaDSP *dsp, azaBuffer buffer) {
+	return azaDelayProcess((azaDelay*)dsp, buffer);
+}
+static void freeDelay(azaDSP *dsp) {
+	azaFreeDelay((azaDelay*)dsp);
+}
+
+static azaDSP* makeReverb(uint8_t channels) {
+	return (azaDSP*)azaMakeReverb((azaReverbConfig) {
+		.gain = -12.0f,
+		.gainDry = 0.0f,
+		.roomsize = 10.0f,
+		.color = 2.0f,
+		.delay = 20.0f,
+	}, channels);
+}
+static int processReverb(azaDSP *dsp, azaBuffer buffer) {
+	return azaReverbProcess((azaReverb*)dsp, buffer);
+}
+static void freeReverb(azaDSP *dsp) {
+	azaFreeReverb((azaReverb*)dsp);
+}
+
+static azaDSP* makeReverbFDN(uint8_t channels) {
+	return (azaDSP*)azaMakeReverbFDN((azaReverbFDNConfig) {
+		.gain = -12.0f,
+		.gainDry = 0.0f,
+		.roomsize = 10.0f,
+		.color = 2.0f,
+		.delay = 20.0f,
+		.lineCount = 8,
+	}, channels);
+}
+static int processReverbFDN(azaDSP *dsp, azaBuffer buffer) {
+	return azaReverbFDNProcess((azaReverbFDN*)dsp, buffer);
+}
+static void freeReverbFDN(azaDSP *dsp) {
+	azaFreeReverbFDN((azaReverbFDN*)dsp);
+}
+
+static azaDSP* makeConvolution(uint8_t channels) {
+	return (azaDSP*)azaMakeConvolution((azaConvolutionConfig) {
+		.gain = -12.0f,
+		.gainDry = 0.0f,
+		.impulseResponse = &benchImpulseResponse,
+	});
+}
+// Convolves the tail in the callback too, so this is the whole cost of the convolution rather than just the part the callback pays for
+static azaDSP* makeConvolutionOffline(uint8_t channels) {
+	return (azaDSP*)azaMakeConvolution((azaConvolutionConfig) {
+		.gain = -12.0f,
+		.gainDry = 0.0f,
+		.impulseResponse = &benchImpulseResponse,
+		.offline = true,
+	});
+}
+static int processConvolution(azaDSP *dsp, azaBuffer buffer) {
+	return azaConvolutionProcess((azaConvolution*)dsp, buffer);
+}
+static void freeConvolution(azaDSP *dsp) {
+	azaFreeConvolution((azaConvolution*)dsp);
+}
+
+static azaDSP* makeSampler(uint8_t channels) {
+	return (azaDSP*)azaMakeSampler((azaSamplerConfig) {
+		.buffer = &samplerSource[channels],
+		.speed = 0.9f,
+		.gain = 0.0f,
+	});
+}
+static azaDSP* makeSamplerLinear(uint8_t channels) {
+	return (azaDSP*)azaMakeSampler((azaSamplerConfig) {
+		.buffer = &samplerSource[channels],
+		.speed = 0.9f,
+		.gain = 0.0f,
+		.interpolation = AZA_SAMPLER_INTERPOLATION_LINEAR,
+	});
+}
+// Faster than 1 so the cutoff has to follow the playback ratio
+static azaDSP* makeSamplerSinc(uint8_t channels) {
+	return (azaDSP*)azaMakeSampler((azaSamplerConfig) {
+		.buffer = &samplerSource[channels],
+		.speed = 1.3f,
+		.gain = 0.0f,
+		.interpolation = AZA_SAMPLER_INTERPOLATION_SINC,
+	});
+}
+static int processSampler(azaDSP *dsp, azaBuffer buffer) {
+	return azaSamplerProcess((azaSampler*)dsp, buffer);
+}
+static void freeSampler(azaDSP *dsp) {
+	azaFreeSampler((azaSampler*)dsp);
+}
+
+// Enough voices at mismatched speeds that the cost is dominated by voices rather than per-block overhead
+#define BENCH_SAMPLER_BANK_VOICES 64
+static azaDSP* makeSamplerBank(uint8_t channels) {
+	azaSamplerBank *result = azaMakeSamplerBank((azaSamplerBankConfig) {
+		.gain = 0.0f,
+	}, BENCH_SAMPLER_BANK_VOICES);
+	if (!result) return NULL;
+	for (uint32_t i = 0; i < BENCH_SAMPLER_BANK_VOICES; i++) {
+		azaSamplerBankPlay(result, (azaSamplerBankVoiceConfig) {
+			.buffer = &samplerSource[channels],
+			.speed = 0.5f + (float)i * 0.02f,
+			.gain = -18.0f,
+			.loopStart = 0,
+			.loopEnd = SAMPLERATE,
+		});
+	}
+	return (azaDSP*)result;
+}
+static int processSamplerBank(azaDSP *dsp, azaBuffer buffer) {
+	return azaSamplerBankProcess((azaSamplerBank*)dsp, buffer);
+}
+static void freeSamplerBank(azaDSP *dsp) {
+	azaFreeSamplerBank((azaSamplerBank*)dsp);
+}
+
+static azaDSP* makeGate(uint8_t channels) {
+	return (azaDSP*)azaMakeGate((azaGateConfig) {
+		.threshold = -20.0f,
+		.attack = 1.0f,
+		.decay = 50.0f,
+	});
+}
+static int processGate(azaDSP *dsp, azaBuffer buffer) {
+	return azaGateProcess((azaGate*)dsp, buffer);
+}
+static void freeGate(azaDSP *dsp) {
+	azaFreeGate((azaGate*)dsp);
+}
+
+static azaDSP* makeDelayDynamic(uint8_t channels) {
+	azaDelayDynamicChannelConfig channelConfigs[MAX_CHANNELS];
+	for (uint8_t c = 0; c < channels; c++) {
+		channelConfigs[c].delay = 5.0f + (float)c * 1.5f;
+	}
+	return (azaDSP*)azaMakeDelayDynamic((azaDelayDynamicConfig) {
+		.gain = 0.0f,
+		.gainDry = -INFINITY,
+		.delayMax = 100.0f,
+		.feedback = 0.0f,
+		.pingpong = 0.0f,
+	}, channels, channels, channelConfigs);
+}
+static int processDelayDynamic(azaDSP *dsp, azaBuffer buffer) {
+	return azaDelayDynamicProcess((azaDelayDynamic*)dsp, buffer, NULL);
+}
+static void freeDelayDynamic(azaDSP *dsp) {
+	azaFreeDelayDynamic((azaDelayDynamic*)dsp);
+}
+
+// Spatialize needs a moving mono source and fills in our whole buffer
+static float spatializeAngle = 0.0f;
+static int processSpatialize(azaDSP *dsp, azaBuffer buffer) {
+	azaVec3 start = { 10.0f * sinf(spatializeAngle), 1.0f, 10.0f * cosf(spatializeAngle) };
+	spatializeAngle += 0.01f;
+	azaVec3 end = { 10.0f * sinf(spatializeAngle), 1.0f, 10.0f * cosf(spatializeAngle) };
+	azaBuffer src = {
+		.samples = noiseMono,
+		.samplerate = buffer.samplerate,
+		.frames = buffer.frames,
+		.stride = 1,
+		.channelStride = 1,
+		.channelLayout = azaChannelLayoutMono(),
+	};
+	return azaSpatializeProcess((azaSpatialize*)dsp, buffer, src, start, 1.0f, end, 1.0f);
+}
+static azaDSP* makeSpatializeSimple(uint8_t channels) {
+	return (azaDSP*)azaMakeSpatialize((azaSpatializeConfig) {
+		.world = AZA_WORLD_DEFAULT,
+		.mode = AZA_SPATIALIZE_SIMPLE,
+	}, channels);
+}
+static azaDSP* makeSpatializeAdvanced(uint8_t channels) {
+	return (azaDSP*)azaMakeSpatialize((azaSpatializeConfig) {
+		.world = AZA_WORLD_DEFAULT,
+		.mode = AZA_SPATIALIZE_ADVANCED,
+	}, channels);
+}
+static void freeSpatialize(azaDSP *dsp) {
+	azaFreeSpatialize((azaSpatialize*)dsp);
+}
+
+// The batch is stateless for SIMPLE sources, so the DSP is only there to give the table something to hold
+#define SPATIALIZE_BATCH_SOURCES 64
+static int processSpatializeBatch(azaDSP *dsp, azaBuffer buffer) {
+	azaSpatializeSource sources[SPATIALIZE_BATCH_SOURCES];
+	azaBuffer src = {
+		.samples = noiseMono,
+		.samplerate = buffer.samplerate,
+		.frames = buffer.frames,
+		.stride = 1,
+		.channelStride = 1,
+		.channelLayout = azaChannelLayoutMono(),
+	};
+	for (uint32_t i = 0; i < SPATIALIZE_BATCH_SOURCES; i++) {
+		float angle = spatializeAngle + (float)i * 0.7f;
+		sources[i] = (azaSpatializeSource) {
+			.spatialize = NULL,
+			.buffer = src,
+			.posStart = { 10.0f * sinf(angle), 1.0f, 10.0f * cosf(angle) },
+			.ampStart = 1.0f / SPATIALIZE_BATCH_SOURCES,
+			.posEnd = { 10.0f * sinf(angle + 0.01f), 1.0f, 10.0f * cosf(angle + 0.01f) },
+			.ampEnd = 1.0f / SPATIALIZE_BATCH_SOURCES,
+		};
+	}
+	spatializeAngle += 0.01f;
+	return azaSpatializeProcessBatch(AZA_WORLD_DEFAULT, buffer, sources, SPATIALIZE_BATCH_SOURCES);
+}
+
+// Same sources as SpatializeBatch, but each with its own ADVANCED azaSpatialize and falling off in volume, so LOD has something to decide.
+// The first one stands in as the DSP for the table.
+static azaSpatialize *lodSpatialize[SPATIALIZE_BATCH_SOURCES];
+static azaSpatializeSource lodSources[SPATIALIZE_BATCH_SOURCES];
+static void freeSpatializeLOD(azaDSP *dsp) {
+	for (uint32_t i = 0; i < SPATIALIZE_BATCH_SOURCES; i++) {
+		if (lodSpatialize[i]) azaFreeSpatialize(lodSpatialize[i]);
+		lodSpatialize[i] = NULL;
+	}
+}
+static azaDSP* makeSpatializeLOD(uint8_t channels) {
+	for (uint32_t i = 0; i < SPATIALIZE_BATCH_SOURCES; i++) {
+		lodSpatialize[i] = azaMakeSpatialize((azaSpatializeConfig) {
+			.world = AZA_WORLD_DEFAULT,
+			.mode = AZA_SPATIALIZE_ADVANCED,
+		}, channels);
+		if (!lodSpatialize[i]) {
+			freeSpatializeLOD(NULL);
+			return NULL;
+		}
+		lodSources[i] = (azaSpatializeSource) { .spatialize = lodSpatialize[i] };
+	}
+	return (azaDSP*)lodSpatialize[0];
+}
+static int processSpatializeLODSources(azaBuffer buffer, bool lod) {
+	azaBuffer src = {
+		.samples = noiseMono,
+		.samplerate = buffer.samplerate,
+		.frames = buffer.frames,
+		.stride = 1,
+		.channelStride = 1,
+		.channelLayout = azaChannelLayoutMono(),
+	};
+	for (uint32_t i = 0; i < SPATIALIZE_BATCH_SOURCES; i++) {
+		float angle = spatializeAngle + (float)i * 0.7f;
+		azaSpatializeSource *source = &lodSources[i];
+		source->buffer = src;
+		source->posStart = (azaVec3) { 10.0f * sinf(angle), 1.0f, 10.0f * cosf(angle) };
+		source->ampStart = powf(0.85f, (float)i);
+		source->posEnd = (azaVec3) { 10.0f * sinf(angle + 0.01f), 1.0f, 10.0f * cosf(angle + 0.01f) };
+		source->ampEnd = powf(0.85f, (float)i);
+	}
+	spatializeAngle += 0.01f;
+	if (lod) {
+		azaSpatializeUpdateLOD((azaSpatializeLODConfig) { .advancedMax = 8 }, AZA_WORLD_DEFAULT, lodSources, SPATIALIZE_BATCH_SOURCES);
+	}
+	return azaSpatializeProcessBatch(AZA_WORLD_DEFAULT, buffer, lodSources, SPATIALIZE_BATCH_SOURCES);
+}
+static int processSpatializeNoLOD(azaDSP *dsp, azaBuffer buffer) {
+	return processSpatializeLODSources(buffer, false);
+}
+// The 8 loudest stay ADVANCED, the rest down to -30dB go SIMPLE, and the third or so below -60dB go virtual
+static int processSpatializeLOD(azaDSP *dsp, azaBuffer buffer) {
+	return processSpatializeLODSources(buffer, true);
+}
+
+// Same sources as SpatializeBatch, rendered for headphones. Only works with 2 channels.
+static int processBinaural(azaDSP *dsp, azaBuffer buffer) {
+	azaSpatializeSource sources[SPATIALIZE_BATCH_SOURCES];
+	azaBuffer src = {
+		.samples = noiseMono,
+		.samplerate = buffer.samplerate,
+		.frames = buffer.frames,
+		.stride = 1,
+		.channelStride = 1,
+		.channelLayout = azaChannelLayoutMono(),
+	};
+	for (uint32_t i = 0; i < SPATIALIZE_BATCH_SOURCES; i++) {
+		float angle = spatializeAngle + (float)i * 0.7f;
+		sources[i] = (azaSpatializeSource) {
+			.spatialize = NULL,
+			.buffer = src,
+			.posStart = { 10.0f * sinf(angle), 1.0f, 10.0f * cosf(angle) },
+			.ampStart = 1.0f / SPATIALIZE_BATCH_SOURCES,
+			.posEnd = { 10.0f * sinf(angle + 0.01f), 1.0f, 10.0f * cosf(angle + 0.01f) },
+			.ampEnd = 1.0f / SPATIALIZE_BATCH_SOURCES,
+		};
+	}
+	spatializeAngle += 0.01f;
+	return azaBinauralProcess((azaBinaural*)dsp, buffer, sources, SPATIALIZE_BATCH_SOURCES);
+}
+// Same sources as SpatializeBatch, but through a third order soundfield
+static float ambisonicSoundfield[MAX_BLOCK_FRAMES * AZA_AMBISONIC_CHANNELS(3)];
+static int processAmbisonic(azaDSP *dsp, azaBuffer buffer) {
+	azaSpatializeSource sources[SPATIALIZE_BATCH_SOURCES];
+	azaBuffer src = {
+		.samples = noiseMono,
+		.samplerate = buffer.samplerate,
+		.frames = buffer.frames,
+		.stride = 1,
+		.channelStride = 1,
+		.channelLayout = azaChannelLayoutMono(),
+	};
+	for (uint32_t i = 0; i < SPATIALIZE_BATCH_SOURCES; i++) {
+		float angle = spatializeAngle + (float)i * 0.7f;
+		sources[i] = (azaSpatializeSource) {
+			.spatialize = NULL,
+			.buffer = src,
+			.posStart = { 10.0f * sinf(angle), 1.0f, 10.0f * cosf(angle) },
+			.ampStart = 1.0f / SPATIALIZE_BATCH_SOURCES,
+			.posEnd = { 10.0f * sinf(angle + 0.01f), 1.0f, 10.0f * cosf(angle + 0.01f) },
+			.ampEnd = 1.0f / SPATIALIZE_BATCH_SOURCES,
+		};
+	}
+	spatializeAngle += 0.01f;
+	azaAmbisonicConfig config = {
+		.world = AZA_WORLD_DEFAULT,
+		.order = 3,
+	};
+	azaBuffer soundfield = {
+		.samples = ambisonicSoundfield,
+		.samplerate = buffer.samplerate,
+		.frames = buffer.frames,
+		.stride = AZA_AMBISONIC_CHANNELS(3),
+		.channelStride = 1,
+		.channelLayout = { .count = AZA_AMBISONIC_CHANNELS(3) },
+	};
+	azaBufferZero(soundfield);
+	int err = azaAmbisonicEncode(config, soundfield, sources, SPATIALIZE_BATCH_SOURCES);
+	if (err) return err;
+	return azaAmbisonicDecode(config, buffer, soundfield, 1.0f);
+}
+
+static azaDSP* makeBinaural(uint8_t channels) {
+	return (azaDSP*)azaMakeBinaural((azaBinauralConfig) {
+		.hrtf = &benchHRTF,
+		.world = AZA_WORLD_DEFAULT,
+	});
+}
+static void freeBinaural(azaDSP *dsp) {
+	azaFreeBinaural((azaBinaural*)dsp);
+}
+
+static int makeBenchHRTF() {
+	// Every 10 degrees around at 7 elevations
+	enum { AZIMUTHS = 36, ELEVATIONS = 7, DIRECTIONS = AZIMUTHS * ELEVATIONS };
+	float *positions = malloc(sizeof(float) * 3 * DIRECTIONS);
+	float *irs = malloc(sizeof(float) * 2 * BENCH_HRTF_FRAMES * DIRECTIONS);
+	int err = AZA_ERROR_OUT_OF_MEMORY;
+	if (positions && irs) {
+		for (uint32_t i = 0; i < DIRECTIONS; i++) {
+			positions[i*3+0] = (float)(i % AZIMUTHS) * 10.0f;
+			positions[i*3+1] = (float)(i / AZIMUTHS) * 20.0f - 40.0f;
+			positions[i*3+2] = 1.5f;
+		}
+		for (uint32_t i = 0; i < 2 * BENCH_HRTF_FRAMES * DIRECTIONS; i++) {
+			irs[i] = randomNoise() * expf(-(float)(i % BENCH_HRTF_FRAMES) / 40.0f);
+		}
+		err = azaHRTFInit(&benchHRTF, SAMPLERATE, BENCH_HRTF_FRAMES, DIRECTIONS, positions, irs);
+	}
+	free(positions);
+	free(irs);
+	return err;
+}
+
+static const BenchDSP benchDSPs[] = {
+	{ "CubicLimiter",       makeCubicLimiter,       processCubicLimiter,     freeCubicLimiter     },
+	{ "RMS",                makeRMS,                processRMS,              freeRMS              },
+	{ "LookaheadLimiter",   makeLookaheadLimiter,   processLookaheadLimiter, freeLookaheadLimiter },
+	{ "Filter",             makeFilter,             processFilter,           freeFilter           },
+	{ "FilterSVF",          makeFilterSVF,          processFilterSVF,        freeFilterSVF        },
+	{ "Compressor",         makeCompressor,         processCompressor,       freeCompressor       },
+	{ "Delay",              makeDelay,              processDelay,            freeDelay            },
+	{ "Reverb",             makeReverb,             processReverb,           freeReverb           },
+	{ "ReverbFDN",          makeReverbFDN,          processReverbFDN,        freeReverbFDN        },
+	{ "Convolution",        makeConvolution,        processConvolution,      freeConvolution      },
+	{ "ConvolutionOffline", makeConvolutionOffline, processConvolution,      freeConvolution      },
+	{ "Sampler",            makeSampler,            processSampler,          freeSampler          },
+	{ "SamplerLinear",      makeSamplerLinear,      processSampler,          freeSampler          },
+	{ "SamplerSinc",        makeSamplerSinc,        processSampler,          freeSampler          },
+	{ "SamplerBank",        makeSamplerBank,        processSamplerBank,      freeSamplerBank      },
+	{ "Gate",               makeGate,               processGate,             freeGate             },
+	{ "DelayDynamic",       makeDelayDynamic,       processDelayDynamic,     freeDelayDynamic     },
+	{ "SpatializeSimple",   makeSpatializeSimple,   processSpatialize,       freeSpatialize       },
+	{ "SpatializeAdvanced", makeSpatializeAdvanced, processSpatialize,       freeSpatialize       },
+	{ "SpatializeBatch",    makeSpatializeSimple,   processSpatializeBatch,  freeSpatialize       },
+	{ "SpatializeNoLOD",    makeSpatializeLOD,      processSpatializeNoLOD,  freeSpatializeLOD    },
+	{ "SpatializeLOD",      makeSpatializeLOD,      processSpatializeLOD,    freeSpatializeLOD    },
+	{ "Ambisonic",          makeSpatializeSimple,   processAmbisonic,        freeSpatialize       },
+	{ "Binaural",           makeBinaural,           processBinaural,         freeBinaural         },
+};
+#define BENCH_DSP_COUNT (sizeof(benchDSPs) / sizeof(benchDSPs[0]))
+
+
+
+typedef struct BenchResult {
+	double nsPerFrameChannel;
+	double realtimeFactor;
+	uint64_t framesProcessed;
+	int err;
+} BenchResult;
+
+static azaBuffer makeBuffer(float *samples, uint32_t frames, uint8_t channels, BenchLayout layout) {
+	azaBuffer result = {
+		.samples = samples,
+		.samplerate = SAMPLERATE,
+		.frames = frames,
+		.stride = channels,
+		.channelStride = 1,
+		.channelLayout = azaChannelLayoutStandardFromCount(channels),
+	};
+	if (layout == LAYOUT_STRIDED) {
+		result.stride += STRIDE_PADDING;
+	} else if (layout == LAYOUT_PLANAR) {
+		result.stride = 1;
+		result.channelStride = frames;
+	}
+	return result;
+}
+
+// Runs blocks until we've spent at least minNanoseconds on them, returning total elapsed time in nanoseconds. If dsp is NULL, we only measure the cost of refreshing the input.
+static uint64_t benchRun(const BenchDSP *bench, azaDSP *dsp, azaBuffer buffer, azaBuffer input, uint64_t minNanoseconds, uint64_t minBlocks, uint64_t *blocksOut, int *errOut) {
+	uint64_t blocks = 0;
+	uint64_t start = azaGetTimestampNanoseconds();
+	uint64_t elapsed = 0;
+	*errOut = AZA_SUCCESS;
+	do {
+		// Do a few blocks between checking the time so the clock doesn't dominate tiny blocks
+		for (int i = 0; i < 16; i++) {
+			azaBufferCopy(buffer, input);
+			if (dsp) {
+				int err = bench->process(dsp, buffer);
+				if (err) {
+					*errOut = err;
+					return 0;
+				}
+			}
+		}
+		blocks += 16;
+		elapsed = azaGetTimestampNanoseconds() - start;
+	} while (elapsed < minNanoseconds || blocks < minBlocks);
+	*blocksOut = blocks;
+	return elapsed;
+}
+
+static BenchResult benchOne(const BenchDSP *bench, uint8_t channels, BenchLayout layout, uint32_t frames, uint64_t minNanoseconds) {
+	BenchResult result = {0};
+	azaDSP *dsp = bench->make(channels);
+	if (!dsp) {
+		result.err = AZA_ERROR_OUT_OF_MEMORY;
+		return result;
+	}
+	azaBuffer buffer = makeBuffer(work, frames, channels, layout);
+	azaBuffer input = makeBuffer(noise, frames, channels, layout);
+	uint64_t blocks, blocksBaseline;
+	int err;
+	// Warm up caches and let any lazily-allocated buffers get allocated
+	benchRun(bench, dsp, buffer, input, 0, 16, &blocks, &err);
+	if (err) {
+		result.err = err;
+		bench->free(dsp);
+		return result;
+	}
+	uint64_t elapsed = benchRun(bench, dsp, buffer, input, minNanoseconds, 0, &blocks, &err);
+	bench->free(dsp);
+	if (err) {
+		result.err = err;
+		return result;
+	}
+	// Take out the cost of copying the input in for every block
+	uint64_t elapsedBaseline = benchRun(bench, NULL, buffer, input, 0, blocks, &blocksBaseline, &err);
+	double nsBaseline = (double)elapsedBaseline * (double)blocks / (double)blocksBaseline;
+	double ns = (double)elapsed - nsBaseline;
+	if (ns < 1.0) ns = 1.0;
+	result.framesProcessed = blocks * frames;
+	result.nsPerFrameChannel = ns / ((double)result.framesProcessed * (double)channels);
+	double secondsOfAudio = (double)result.framesProcessed / (double)SAMPLERATE;
+	result.realtimeFactor = secondsOfAudio / (ns * 1e-9);
+	return result;
+}
+
+
+
+int main(int argumentCount, char** argumentValues) {
+	bool quick = false;
+	const char *only = NULL;
+	const char *outPath = NULL;
+	int simdLevel = AZA_SIMD_BEST;
+	for (int i = 1; i < argumentCount; i++) {
+		if (strcmp(argumentValues[i], "--quick") == 0) {
+			quick = true;
+		} else if (strcmp(argumentValues[i], "--only") == 0 && i+1 < argumentCount) {
+			only = argumentValues[++i];
+		} else if (strcmp(argumentValues[i], "--out") == 0 && i+1 < argumentCount) {
+			outPath = argumentValues[++i];
+		} else if (strcmp(argumentValues[i], "--simd") == 0 && i+1 < argumentCount) {
+			const char *level = argumentValues[++i];
+			if (strcmp(level, "scalar") == 0) simdLevel = AZA_SIMD_SCALAR;
+			else if (strcmp(level, "sse2") == 0) simdLevel = AZA_SIMD_SSE2;
+			else if (strcmp(level, "avx2") == 0) simdLevel = AZA_SIMD_AVX2;
+			else if (strcmp(level, "neon") == 0) simdLevel = AZA_SIMD_NEON;
+			else {
+				fprintf(stderr, "Unknown SIMD level \"%s\"\n", level);
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "Usage: %s [--quick] [--simd scalar|sse2|avx2|neon] [--only <dsp name>] [--out <file>]\n", argumentValues[0]);
+			return 1;
+		}
+	}
+
+	// We don't need any devices and logging to stdout would mess up our JSON
+	azaLogLevel = AZA_LOG_LEVEL_ERROR;
+	azaBackendPreferred = AZA_BACKEND_NULL;
+	int err = azaInit();
+	if (err) {
+		fprintf(stderr, "Failed to azaInit!\n");
+		return 1;
+	}
+	azaSIMDSetLevel(simdLevel);
+
+	for (size_t i = 0; i < sizeof(noise) / sizeof(float); i++) {
+		noise[i] = randomNoise();
+	}
+	for (size_t i = 0; i < MAX_BLOCK_FRAMES; i++) {
+		noiseMono[i] = randomNoise();
+	}
+	for (uint8_t c = 1; c <= MAX_CHANNELS; c++) {
+		if ((err = azaBufferInit(&samplerSource[c], SAMPLERATE, azaChannelLayoutStandardFromCount(c)))) {
+			char buffer[64];
+			fprintf(stderr, "Failed to make sampler source (%s)\n", azaErrorString(err, buffer, sizeof(buffer)));
+			return 1;
+		}
+		samplerSource[c].samplerate = SAMPLERATE;
+		for (uint32_t i = 0; i < SAMPLERATE * c; i++) {
+			samplerSource[c].samples[i] = randomNoise();
+		}
+	}
+
+	if ((err = azaBufferInit(&benchImpulseResponse, BENCH_IMPULSE_RESPONSE_FRAMES, azaChannelLayoutStandardFromCount(1)))) {
+		char buffer[64];
+		fprintf(stderr, "Failed to make impulse response (%s)\n", azaErrorString(err, buffer, sizeof(buffer)));
+		return 1;
+	}
+	benchImpulseResponse.samplerate = SAMPLERATE;
+	for (uint32_t i = 0; i < BENCH_IMPULSE_RESPONSE_FRAMES; i++) {
+		benchImpulseResponse.samples[i] = randomNoise() * expf(-(float)i / (float)SAMPLERATE * 3.0f);
+	}
+
+	if ((err = makeBenchHRTF())) {
+		char buffer[64];
+		fprintf(stderr, "Failed to make HRTF (%s)\n", azaErrorString(err, buffer, sizeof(buffer)));
+		return 1;
+	}
+
+	FILE *out = stdout;
+	if (outPath) {
+		out = fopen(outPath, "w");
+		if (!out) {
+			fprintf(stderr, "Failed to open \"%s\" for writing\n", outPath);
+			return 1;
+		}
+	}
+
+	uint64_t minNanoseconds = quick ? 2000000 : 20000000;
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"samplerate\": %u,\n", SAMPLERATE);
+	fprintf(out, "\t\"simd\": \"%s\",\n", azaSIMDLevelString(azaSIMDLevelCurrent));
+	fprintf(out, "\t\"results\": [");
+	bool first = true;
+	for (size_t d = 0; d < BENCH_DSP_COUNT; d++) {
+		const BenchDSP *bench = &benchDSPs[d];
+		if (only && strcmp(only, bench->name) != 0) continue;
+		fprintf(stderr, "%s...\n", bench->name);
+		for (size_t c = 0; c < sizeof(channelCounts); c++) {
+			for (int layout = 0; layout < LAYOUT_COUNT; layout++) {
+				for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+					BenchResult result = benchOne(bench, channelCounts[c], (BenchLayout)layout, blockSizes[b], minNanoseconds);
+					fprintf(out, "%s\n\t\t{ \"dsp\": \"%s\", \"channels\": %u, \"layout\": \"%s\", \"frames\": %u, ", first ? "" : ",", bench->name, (uint32_t)channelCounts[c], layoutNames[layout], blockSizes[b]);
+					if (result.err) {
+						char buffer[64];
+						fprintf(out, "\"error\": \"%s\" }", azaErrorString(result.err, buffer, sizeof(buffer)));
+					} else {
+						fprintf(out, "\"nsPerFrameChannel\": %.4f, \"realtimeFactor\": %.1f, \"framesProcessed\": %llu }", result.nsPerFrameChannel, result.realtimeFactor, (unsigned long long)result.framesProcessed);
+					}
+					first = false;
+				}
+			}
+		}
+	}
+	fprintf(out, "\n\t]\n}\n");
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	for (uint8_t c = 1; c <= MAX_CHANNELS; c++) {
+		azaBufferDeinit(&samplerSource[c]);
+	}
+	azaBufferDeinit(&benchImpulseResponse);
+	azaHRTFDeinit(&benchHRTF);
+	azaDeinit();
+	return 0;
+}